@@ -0,0 +1,408 @@
+// ============================================================================
+// display_bench: headless display path, upload / draw / readback per format
+//
+// Usage: display_bench [iterations=50] [width=1920] [height=1080]
+//
+// Renders synthetic frames of every GPU-decoded format through the same path as
+// GLFWImageWindow (CImageDisplayerCPP geometry + cimage::MakeGpuUploadDesc + the
+// reference decode shaders) into an offscreen FBO on an EGL surfaceless context
+// (Mesa llvmpipe works, so this runs in CI without a display). Each result is read
+// back and compared with a CPU model of the shader:
+//   - 8-bit channel formats (Gray8, RGB888, BGR888) must match exactly.
+//   - RGB565 and decoded formats (YUV422, 16-bit window/level, Bayer) may differ
+//     by 1 LSB (driver unorm expansion, float rounding).
+// A second pass draws four different frames of each format as a 2x2 CImageMosaic
+// (one atlas texture, one GL_TRIANGLES draw) and applies the same check per tile, so
+// bleeding across atlas cells (demosaic/filter neighbours) shows up as a mismatch. It then
+// rewrites one rectangle in two tiles (one touching a tile edge) and checks that uploads()
+// sends only those rectangles (plus the gutter) before validating the whole mosaic again.
+// Timings are per frame, with glFinish after each stage. Exit code 1 on any mismatch.
+// ============================================================================
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <CFrameGrabber/CGrabberFrame.h>
+#include <CImageMosaic.h>          // CImageDisplayerCPP + atlas (same include root as CImageDisplayerGpu.h)
+#include "EGLOffscreenRenderer.h"
+
+namespace {
+
+using csh_img::En_ImageFormat;
+using csh_img::En_ImagePattern;
+using Byte = csh_img::CSH_Image::byte;
+
+struct BenchCase {
+    const char*     name;
+    En_ImageFormat  format;
+    En_ImagePattern pattern;
+    uint32_t        bytesPerPixel;
+    uint32_t        originalBit;
+    cimage::GpuViewParams view;
+};
+
+struct BenchResult {
+    double uploadMs = 0.0, drawMs = 0.0, readbackMs = 0.0;
+    int    maxDiff = 0;
+    size_t badPixels = 0;
+    bool   ok = false;
+};
+
+// ---------------- Synthetic frames ----------------
+// Gradients plus a hash so neighbouring pixels differ (exercises demosaic and chroma pairs).
+// seed != 0 gives a different frame of the same size (mosaic tiles).
+void fillFrame(const BenchCase& c, uint8_t* dst, uint32_t w, uint32_t h, uint32_t seed = 0) {
+    const uint32_t maxRaw = (1u << c.originalBit) - 1u;
+    for (uint32_t y = 0; y < h; ++y) {
+        for (uint32_t x = 0; x < w; ++x) {
+            const uint32_t hash = (x * 73856093u) ^ (y * 19349663u) ^ (seed * 83492791u);
+            uint8_t* p = dst + (static_cast<size_t>(y) * w + x) * c.bytesPerPixel;
+            if (c.bytesPerPixel == 2 && c.format != En_ImageFormat::YUV422 && c.format != En_ImageFormat::RGB565) {
+                const uint32_t v = ((x * maxRaw) / std::max(1u, w - 1) + (hash & 0xFF)) & maxRaw;
+                p[0] = static_cast<uint8_t>(v); p[1] = static_cast<uint8_t>(v >> 8);
+            } else {
+                for (uint32_t k = 0; k < c.bytesPerPixel; ++k) {
+                    p[k] = static_cast<uint8_t>(x * (k + 1) + y * (3 - k) + (hash >> (8 * k)));
+                }
+            }
+        }
+    }
+}
+
+// ---------------- CPU model of the reference shaders ----------------
+uint8_t toUnorm8(float f) {
+    f = std::clamp(f, 0.f, 1.f);
+    return static_cast<uint8_t>(std::floor(f * 255.f + 0.5f));
+}
+
+struct Reference {
+    const cimage::GpuUploadDesc& g;
+    const uint8_t* data;
+    int w, h;
+    bool wide;
+
+    float raw(int x, int y) const {
+        x = std::clamp(x, 0, w - 1); y = std::clamp(y, 0, h - 1);
+        const size_t i = static_cast<size_t>(y) * w + x;
+        return wide ? static_cast<float>(data[2 * i] | (data[2 * i + 1] << 8)) : data[i] / 255.f;
+    }
+    float px(int x, int y) const { return std::clamp((raw(x, y) - g.low) * g.invRange, 0.f, 1.f); }
+
+    void pixel(const BenchCase& c, int x, int y, uint8_t out[3]) const {
+        const size_t i = static_cast<size_t>(y) * w + x;
+        switch (g.shader) {
+        case cimage::GpuShader::Passthrough:
+            if (c.format == En_ImageFormat::RGB565) {
+                const uint32_t v = data[2 * i] | (data[2 * i + 1] << 8);
+                out[0] = toUnorm8(static_cast<float>(v >> 11) / 31.f);
+                out[1] = toUnorm8(static_cast<float>((v >> 5) & 63) / 63.f);
+                out[2] = toUnorm8(static_cast<float>(v & 31) / 31.f);
+            } else if (c.bytesPerPixel == 3) {
+                const bool bgr = c.format == En_ImageFormat::BGR888;
+                out[0] = data[3 * i + (bgr ? 2 : 0)]; out[1] = data[3 * i + 1]; out[2] = data[3 * i + (bgr ? 0 : 2)];
+            } else {
+                out[0] = out[1] = out[2] = data[i];
+            }
+            return;
+        case cimage::GpuShader::Yuv422: {
+            const uint8_t* t = data + (static_cast<size_t>(y) * w + (x & ~1)) * 2;
+            auto dot = [&](const float* s) { float r = 0.f; for (int k = 0; k < 4; ++k) r += t[k] / 255.f * s[k]; return r; };
+            float yy = dot((x & 1) == 0 ? g.ySel0 : g.ySel1);
+            const float u = dot(g.uSel) - 0.5f, v = dot(g.vSel) - 0.5f;
+            yy = 1.164f * (yy - 0.0625f);
+            out[0] = toUnorm8(yy + 1.596f * v);
+            out[1] = toUnorm8(yy - 0.392f * u - 0.813f * v);
+            out[2] = toUnorm8(yy + 2.017f * u);
+            return;
+        }
+        case cimage::GpuShader::Gray16:
+            out[0] = out[1] = out[2] = toUnorm8(px(x, y));
+            return;
+        case cimage::GpuShader::Bayer8:
+        case cimage::GpuShader::Bayer16: {
+            const float ctr = px(x, y);
+            const float cross4 = 0.25f * (px(x - 1, y) + px(x + 1, y) + px(x, y - 1) + px(x, y + 1));
+            const float diag4 = 0.25f * (px(x - 1, y - 1) + px(x + 1, y - 1) + px(x - 1, y + 1) + px(x + 1, y + 1));
+            const float horiz = 0.5f * (px(x - 1, y) + px(x + 1, y));
+            const float vert = 0.5f * (px(x, y - 1) + px(x, y + 1));
+            const int qx = (x + g.firstRed[0]) & 1, qy = (y + g.firstRed[1]) & 1;
+            float rgb[3];
+            if (qx == 0 && qy == 0)      { rgb[0] = ctr;    rgb[1] = cross4; rgb[2] = diag4; }
+            else if (qx == 1 && qy == 1) { rgb[0] = diag4;  rgb[1] = cross4; rgb[2] = ctr; }
+            else if (qy == 0)            { rgb[0] = horiz;  rgb[1] = ctr;    rgb[2] = vert; }
+            else                         { rgb[0] = vert;   rgb[1] = ctr;    rgb[2] = horiz; }
+            for (int k = 0; k < 3; ++k) out[k] = toUnorm8(rgb[k]);
+            return;
+        }
+        default:
+            out[0] = out[1] = out[2] = 0;
+            return;
+        }
+    }
+};
+
+// ---------------- One format ----------------
+BenchResult runCase(EGLOffscreenRenderer& r, const BenchCase& c, uint32_t w, uint32_t h, int iterations) {
+    BenchResult res;
+    const size_t bytes = static_cast<size_t>(w) * h * c.bytesPerPixel;
+    std::shared_ptr<Byte[]> buf(new Byte[bytes]);
+    fillFrame(c, buf.get(), w, h);
+
+    csh_img::CSH_Image frame;
+    SetFrameView(frame, buf, bytes, w, h, c.format, c.pattern, c.bytesPerPixel == 2 ? 16 : 8, c.originalBit);
+
+    // Geometry from the displayer, exactly as the window gets it (1:1 when the viewport matches the image).
+    cimage::CImageDisplayerCPP view;
+    view.setDimensionality(cimage::Dimensionality::_2D);
+    view.setFitMode(cimage::FitMode::Fit);
+    view.setViewport(static_cast<int>(w), static_cast<int>(h));
+    view.setImage(frame, csh_img::CopyMode::Shallow);
+    const cimage::RenderState& rs = view.renderState();
+
+    const cimage::GpuUploadDesc g = cimage::MakeGpuUploadDesc(frame, c.view);
+    if (!r.resize(static_cast<int>(w), static_cast<int>(h)) || !r.upload(g)) return res;
+
+    using clock = std::chrono::steady_clock;
+    auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    std::vector<uint8_t> rgba;
+
+    r.draw(rs.strip2D, 4); // warm-up: shader compile/link on first use
+    r.readback(rgba);
+
+    for (int i = 0; i < iterations; ++i) {
+        const auto t0 = clock::now();
+        r.upload(g);
+        r.finish();
+        const auto t1 = clock::now();
+        r.draw(rs.strip2D, 4);
+        r.finish();
+        const auto t2 = clock::now();
+        r.readback(rgba);
+        const auto t3 = clock::now();
+        res.uploadMs += ms(t1 - t0);
+        res.drawMs += ms(t2 - t1);
+        res.readbackMs += ms(t3 - t2);
+    }
+    const double n = std::max(1, iterations);
+    res.uploadMs /= n; res.drawMs /= n; res.readbackMs /= n;
+
+    // Validate the last frame against the CPU model.
+    const bool wide = g.glType == 0x1403; // GL_UNSIGNED_SHORT: raw 16-bit values
+    const Reference ref{ g, buf.get(), static_cast<int>(w), static_cast<int>(h), wide };
+    // 8-bit channels pass through untouched; RGB565 expansion and shader math round within 1 LSB.
+    const int tolerance = g.shader == cimage::GpuShader::Passthrough && c.format != En_ImageFormat::RGB565 ? 0 : 1;
+    for (uint32_t y = 0; y < h; ++y) {
+        for (uint32_t x = 0; x < w; ++x) {
+            uint8_t want[3];
+            ref.pixel(c, static_cast<int>(x), static_cast<int>(y), want);
+            const uint8_t* got = rgba.data() + (static_cast<size_t>(y) * w + x) * 4;
+            int diff = 0;
+            for (int k = 0; k < 3; ++k) diff = std::max(diff, std::abs(static_cast<int>(got[k]) - want[k]));
+            res.maxDiff = std::max(res.maxDiff, diff);
+            if (diff > tolerance) {
+                if (res.badPixels == 0) {
+                    std::fprintf(stderr, "[%s] first mismatch at (%u,%u): got %u,%u,%u want %u,%u,%u\n", c.name, x, y,
+                        got[0], got[1], got[2], want[0], want[1], want[2]);
+                }
+                ++res.badPixels;
+            }
+        }
+    }
+    res.ok = res.badPixels == 0;
+    return res;
+}
+
+// ---------------- 2x2 mosaic ----------------
+// Four different frames at 1:1 in their tiles, uploaded through CImageMosaic::uploads() into
+// the atlas of atlasDesc() and drawn with triangles(). Each tile must decode exactly as if it
+// were drawn alone; gaps between tiles stay black. The timed loop re-sets every tile, so each
+// iteration is a full upload; a dirty-rect pass follows.
+BenchResult runMosaicCase(EGLOffscreenRenderer& r, const BenchCase& c, uint32_t vpW, uint32_t vpH, int iterations) {
+    BenchResult res;
+    cimage::MosaicOptions opt;
+    opt.columns = 2;
+    opt.gap = 4; // with a viewport of multiples of 4, every tile is even-sized (YUV422 pairs)
+    cimage::CImageMosaic mosaic(4, opt);
+    mosaic.setViewport(static_cast<int>(vpW), static_cast<int>(vpH));
+    mosaic.setViewParams(c.view);
+
+    std::shared_ptr<Byte[]> bufs[4];
+    csh_img::CSH_Image frames[4];
+    for (int i = 0; i < 4; ++i) {
+        const cimage::MosaicRect& t = mosaic.tileRect(i);
+        const uint32_t tw = static_cast<uint32_t>(t.width), th = static_cast<uint32_t>(t.height);
+        const size_t bytes = static_cast<size_t>(tw) * th * c.bytesPerPixel;
+        bufs[i].reset(new Byte[bytes]);
+        fillFrame(c, bufs[i].get(), tw, th, static_cast<uint32_t>(i) + 1u);
+        SetFrameView(frames[i], bufs[i], bytes, tw, th, c.format, c.pattern, c.bytesPerPixel == 2 ? 16 : 8, c.originalBit);
+        mosaic.setImage(i, frames[i]);
+    }
+
+    const cimage::GpuUploadDesc atlas = mosaic.atlasDesc();
+    std::vector<float> tris;
+    const int vertices = static_cast<int>(mosaic.triangles(tris));
+    if (!r.resize(static_cast<int>(vpW), static_cast<int>(vpH)) || !r.allocate(atlas)) return res;
+
+    auto uploadAll = [&] {
+        for (const cimage::MosaicUpload& u : mosaic.uploads()) {
+            for (const cimage::MosaicBlit& b : u.blits) r.subImage(b.data, b.rowLength, b.x, b.y, b.width, b.height);
+        }
+    };
+
+    using clock = std::chrono::steady_clock;
+    auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    std::vector<uint8_t> rgba;
+
+    uploadAll(); // warm-up, as in runCase
+    r.draw(tris.data(), vertices, GL_TRIANGLES);
+    r.readback(rgba);
+
+    for (int i = 0; i < iterations; ++i) {
+        for (int k = 0; k < 4; ++k) mosaic.setImage(k, frames[k]); // uploads() lists changed tiles only
+        const auto t0 = clock::now();
+        uploadAll();
+        r.finish();
+        const auto t1 = clock::now();
+        r.draw(tris.data(), vertices, GL_TRIANGLES);
+        r.finish();
+        const auto t2 = clock::now();
+        r.readback(rgba);
+        const auto t3 = clock::now();
+        res.uploadMs += ms(t1 - t0);
+        res.drawMs += ms(t2 - t1);
+        res.readbackMs += ms(t3 - t2);
+    }
+    const double n = std::max(1, iterations);
+    res.uploadMs /= n; res.drawMs /= n; res.readbackMs /= n;
+
+    const bool wide = atlas.glType == 0x1403;
+    const int tolerance = atlas.shader == cimage::GpuShader::Passthrough && c.format != En_ImageFormat::RGB565 ? 0 : 1;
+    auto validate = [&](const char* pass) {
+        for (uint32_t y = 0; y < vpH; ++y) {
+            for (uint32_t x = 0; x < vpW; ++x) {
+                uint8_t want[3] = { 0, 0, 0 };
+                const int tile = mosaic.tileAt(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f);
+                if (tile >= 0) {
+                    const cimage::MosaicRect& t = mosaic.tileRect(tile);
+                    const Reference ref{ atlas, bufs[tile].get(), t.width, t.height, wide };
+                    ref.pixel(c, static_cast<int>(x) - t.x, static_cast<int>(y) - t.y, want);
+                }
+                const uint8_t* got = rgba.data() + (static_cast<size_t>(y) * vpW + x) * 4;
+                int diff = 0;
+                for (int k = 0; k < 3; ++k) diff = std::max(diff, std::abs(static_cast<int>(got[k]) - want[k]));
+                res.maxDiff = std::max(res.maxDiff, diff);
+                if (diff > tolerance) {
+                    if (res.badPixels == 0) {
+                        std::fprintf(stderr, "[mosaic %s, %s] first mismatch at (%u,%u) tile %d: got %u,%u,%u want %u,%u,%u\n",
+                            c.name, pass, x, y, tile, got[0], got[1], got[2], want[0], want[1], want[2]);
+                    }
+                    ++res.badPixels;
+                }
+            }
+        }
+    };
+    validate("full");
+
+    // Dirty-rect pass: new content in an edge rectangle of tile 1 and an interior one of tile 3
+    // (even offsets/sizes keep YUV422 pairs and Bayer quads whole).
+    struct Change { int tile; CImageRect rect; size_t blits; };
+    const Change changes[] = {
+        { 1, { 0, 20, 64, 40 }, 1 + 4 }, // touches the left edge: rect + top/bottom rows + gutter columns
+        { 3, { 100, 60, 80, 50 }, 1 },
+    };
+    for (const Change& ch : changes) {
+        const cimage::MosaicRect& t = mosaic.tileRect(ch.tile);
+        const size_t rowBytes = static_cast<size_t>(t.width) * c.bytesPerPixel;
+        std::vector<uint8_t> fresh(rowBytes * static_cast<size_t>(t.height));
+        fillFrame(c, fresh.data(), static_cast<uint32_t>(t.width), static_cast<uint32_t>(t.height), 7u);
+        for (int y = ch.rect.y; y < ch.rect.y + ch.rect.height; ++y) {
+            const size_t off = static_cast<size_t>(y) * rowBytes + static_cast<size_t>(ch.rect.x) * c.bytesPerPixel;
+            std::memcpy(bufs[ch.tile].get() + off, fresh.data() + off, static_cast<size_t>(ch.rect.width) * c.bytesPerPixel);
+        }
+        mosaic.setImage(ch.tile, frames[ch.tile], csh_img::CopyMode::Shallow, &ch.rect, 1);
+    }
+    const std::vector<cimage::MosaicUpload> ups = mosaic.uploads();
+    bool listed = ups.size() == 2;
+    for (size_t k = 0; listed && k < ups.size(); ++k) {
+        listed = ups[k].tile == changes[k].tile && ups[k].blits.size() == changes[k].blits;
+    }
+    if (!listed) {
+        std::fprintf(stderr, "[mosaic %s] dirty pass: uploads() listed %zu tiles, expected tiles 1 and 3 with 5 and 1 blits\n",
+            c.name, ups.size());
+        ++res.badPixels;
+    }
+    for (const cimage::MosaicUpload& u : ups) {
+        for (const cimage::MosaicBlit& b : u.blits) r.subImage(b.data, b.rowLength, b.x, b.y, b.width, b.height);
+    }
+    r.draw(tris.data(), vertices, GL_TRIANGLES);
+    r.readback(rgba);
+    validate("dirty");
+
+    res.ok = res.badPixels == 0;
+    return res;
+}
+
+void print(const BenchCase& c, const BenchResult& r, uint32_t w, uint32_t h) {
+    const double mb = static_cast<double>(w) * h * c.bytesPerPixel / 1e6;
+    std::printf("%-14s  upload %7.3f ms (%7.1f MB/s)  draw %7.3f ms  readback %7.3f ms  max diff %d  %s\n",
+        c.name, r.uploadMs, r.uploadMs > 0.0 ? mb / (r.uploadMs / 1e3) : 0.0, r.drawMs, r.readbackMs, r.maxDiff,
+        r.ok ? "OK" : "FAIL");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+    const uint32_t w = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) & ~1u : 1920;
+    const uint32_t h = argc > 3 ? static_cast<uint32_t>(std::atoi(argv[3])) : 1080;
+    if (w == 0 || h == 0) {
+        std::fprintf(stderr, "usage: %s [iterations] [width] [height]\n", argv[0]);
+        return 1;
+    }
+
+    EGLOffscreenRenderer r;
+    if (!r.initialize(static_cast<int>(w), static_cast<int>(h))) {
+        std::fprintf(stderr, "offscreen GLES 3.1 context unavailable\n");
+        return 2;
+    }
+
+    const cimage::GpuViewParams full{};
+    const cimage::GpuViewParams wl{ 2048.f, 1536.f, true }; // window/level inside the 12-bit range
+    const BenchCase cases[] = {
+        { "Gray8",         En_ImageFormat::Gray8,   En_ImagePattern::RGGB, 1, 8,  full },
+        { "RGB888",        En_ImageFormat::RGB888,  En_ImagePattern::RGB,  3, 8,  full },
+        { "BGR888",        En_ImageFormat::BGR888,  En_ImagePattern::BGR,  3, 8,  full },
+        { "RGB565",        En_ImageFormat::RGB565,  En_ImagePattern::RGB,  2, 8,  full },
+        { "YUV422/YUYV",   En_ImageFormat::YUV422,  En_ImagePattern::YUYV, 2, 8,  full },
+        { "YUV422/UYVY",   En_ImageFormat::YUV422,  En_ImagePattern::UYVY, 2, 8,  full },
+        { "Gray12",        En_ImageFormat::Gray12,  En_ImagePattern::RGGB, 2, 12, full },
+        { "Gray12 W/L",    En_ImageFormat::Gray12,  En_ImagePattern::RGGB, 2, 12, wl },
+        { "Bayer8/RGGB",   En_ImageFormat::Bayer8,  En_ImagePattern::RGGB, 1, 8,  full },
+        { "Bayer12/GBRG",  En_ImageFormat::Bayer12, En_ImagePattern::GBRG, 2, 12, wl },
+    };
+
+    std::printf("%ux%u, %d iterations, %s\n", w, h, iterations, r.rendererName());
+    bool ok = true;
+    for (const auto& c : cases) {
+        const BenchResult res = runCase(r, c, w, h, iterations);
+        print(c, res, w, h);
+        ok = ok && res.ok;
+    }
+
+    const uint32_t mw = w & ~3u, mh = h & ~3u;
+    if (mw >= 16 && mh >= 16) {
+        std::printf("2x2 CImageMosaic (one atlas, one draw), %ux%u\n", mw, mh);
+        for (const auto& c : cases) {
+            const BenchResult res = runMosaicCase(r, c, mw, mh, iterations);
+            print(c, res, mw, mh);
+            ok = ok && res.ok;
+        }
+    }
+    r.shutdown();
+    return ok ? 0 : 1;
+}
@@ -6,6 +6,9 @@
 #include <CSH_Log.h>
 #include <CSH_Image.h>
 #include <CFrameGrabber/CFrameGrabber.h>
+#include <CFrameGrabber/CFrameFanout.h>
+#include <CFrameGrabber/CImageSaver.h>
+#include <CFrameGrabber/CStillEncoder.h>
 #include <CImageProcessMng.h>
 #include <CIpmEnv.h>
 #include <CIpmUserCustom/CIpmUserCustom.h>
@@ -21,6 +24,7 @@ std::atomic<bool>            gHasNewFrame{ false };
 std::atomic<bool>            gShuttingDown{ false };
 cimage::CImageDisplayerCPP   gView;
 CFrameGrabber                grab;
+CFrameFanout                 gFanout;
 CImageProcessMng             ipm0, ipm1;
 
 using namespace cshlog;
@@ -113,20 +117,22 @@ void Example_Grabber() {
         std::cerr << "Config/Connect failed\n"; return;
     }
 
+    // Each consumer gets its own queue + thread; the grab thread only publishes.
     auto cb = std::bind(
         &CImageProcessMng::onNewFrame,
         &ipm0,
         std::placeholders::_1
     );
-    grab.RegisterCallbackProcessor(cb);
+    gFanout.Subscribe("ipm0", cb, { 4, CFrameFanout::DropPolicy::Block });
 
-    grab.RegisterCallbackDisplayer([&](const csh_img::CSH_Image& img) {
+    gFanout.Subscribe("display", [&](const csh_img::CSH_Image& img) {
         std::lock_guard<std::mutex> lk(gCameraMtx);
         ensureAllocatedOrResize(gCameraImage, img);
         if (gShuttingDown.load()) return;
         gCameraImage.copy(img, csh_img::CopyMode::Deep);
         gHasNewFrame.store(true);
-        });
+        }, { 1, CFrameFanout::DropPolicy::DropOldest });
+    gFanout.Attach(grab);
 
     if (!grab.GrabFrames()) {
         std::cerr << "GrabFrames failed\n"; return;
@@ -135,10 +141,33 @@ void Example_Grabber() {
 
 // ============================================================================
 // Example_VideoSaver
-// (stubbed)
 // ============================================================================
+CImageSaver gSaver;
 void Example_VideoSaver() {
-    std::cout << "[VideoSaver] Not implemented yet.\n";
+    CImageSaver::Options opt;
+    opt.format = CImageSaver::Format::TlvSequence;  // rec01/rec_000000.ish ... + timestamps.txt
+    opt.slot_count = 16;
+    if (!gSaver.Start("rec01", opt)) {
+        std::cerr << "Recorder start failed\n"; return;
+    }
+
+    // Push only copies into the ring; the disk is written on the recorder's own thread.
+    gFanout.Subscribe("recorder", gSaver.Input(), { 1, CFrameFanout::DropPolicy::DropNewest });
+}
+
+// ============================================================================
+// Example_Still
+// ============================================================================
+CStillEncoder gStill;
+void Example_Still() {
+    // Save the first frame as TIFF; the callback only queues a reference, workers encode.
+    auto once = std::make_shared<std::atomic<bool>>(false);
+    gFanout.Subscribe("still", [once](const csh_img::CSH_Image& img) {
+        if (once->exchange(true)) return;
+        gStill.Request(img, "still_first.tif", [](const CStillEncoder::Result& r) {
+            LOG_WRITE(cshlog::LogLevel::Info, L"still written: %d (%zu bytes, %.1f ms)", r.ok ? 1 : 0, r.bytes, r.encode_ms);
+        });
+        }, { 1, CFrameFanout::DropPolicy::DropNewest });
 }
 
 csh_img::CSH_Image in0(1920, 1080, En_ImageFormat::YUV422, true);
@@ -181,6 +210,10 @@ int main(int argc, char** argv) {
 
     Example_Grabber();
 
+    Example_VideoSaver();
+
+    Example_Still();
+
     Example_ImageProcessor();
     GLFWImageWindow window(gView, gCameraImage, gCameraMtx, gHasNewFrame, gShuttingDown);
     if (!window.initialize("CImageDisplayer - GLFW + GLEW", 1280, 720)) {
@@ -189,13 +222,18 @@ int main(int argc, char** argv) {
     window.mainLoop();
 
     gShuttingDown.store(true);
-    grab.RegisterCallbackDisplayer(nullptr);
+    gFanout.Detach();
+    gFanout.Clear();
     grab.StopGrabbing();
     grab.Disconnect();
 
-    window.shutdown();
+    gStill.Wait();
+    gSaver.Stop();
+    auto rs = gSaver.GetStats();
+    std::cout << "[VideoSaver] recorded " << rs.recorded << ", dropped " << rs.dropped
+        << ", backlog peak " << rs.backlog_peak << ", " << rs.mb_per_s << " MB/s\n";
 
-	//Example_VideoSaver(); // Not implemented yet.
+    window.shutdown();
 
     return 0;
 }
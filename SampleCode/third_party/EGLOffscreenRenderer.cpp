@@ -0,0 +1,380 @@
+#include "EGLOffscreenRenderer.h"
+
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// ============================ Shaders ========================================
+// Same vertex stage as GLFWImageWindow: viewport pixels (y down) to NDC.
+static const char* kVS = R"(
+#version 310 es
+layout(location=0) in vec2 aPos;
+layout(location=1) in vec2 aUV;
+uniform vec2 uViewport; // (W,H)
+out vec2 vUV;
+void main(){
+    vec2 ndc = vec2( (aPos.x/uViewport.x)*2.0 - 1.0, 1.0 - (aPos.y/uViewport.y)*2.0 );
+    gl_Position = vec4(ndc, 0.0, 1.0);
+    vUV = aUV;
+}
+)";
+
+// ======================== ctor/dtor ==========================================
+EGLOffscreenRenderer::~EGLOffscreenRenderer() { shutdown(); }
+
+// ======================== initialize/shutdown ================================
+bool EGLOffscreenRenderer::initialize(int width, int height) {
+    if (ctx_ != EGL_NO_CONTEXT) return resize(width, height);
+    if (!createContext_()) return false;
+
+    if (!gladLoadGLES2Loader((GLADloadproc)eglGetProcAddress)) {
+        std::fprintf(stderr, "[GLAD] load failed\n");
+        shutdown();
+        return false;
+    }
+    std::fprintf(stderr, "GL_VERSION  : %s\n", glGetString(GL_VERSION));
+    std::fprintf(stderr, "GL_RENDERER : %s\n", glGetString(GL_RENDERER));
+
+    for (auto s : { cimage::GpuShader::Passthrough, cimage::GpuShader::Yuv422, cimage::GpuShader::Gray16,
+                    cimage::GpuShader::Bayer8, cimage::GpuShader::Bayer16 }) {
+        progs_[static_cast<size_t>(s)] = makeGpuProgram_(cimage::GpuFragmentShader(s));
+    }
+    if (!progs_[static_cast<size_t>(cimage::GpuShader::Passthrough)].prog) {
+        shutdown();
+        return false;
+    }
+    for (const auto& p : progs_) {
+        if (!p.prog) continue;
+        glUseProgram(p.prog);
+        glUniform1i(p.uTex, 0);  // texture unit 0
+        glUniform1i(p.uTexU, 0); // (integer sampler variants)
+    }
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glEnableVertexAttribArray(0); // aPos
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)(uintptr_t)0);
+    glEnableVertexAttribArray(1); // aUV
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)(uintptr_t)(sizeof(float) * 2));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_DITHER); // keep the FBO bit-exact
+
+    if (!resize(width, height)) {
+        shutdown();
+        return false;
+    }
+    return true;
+}
+
+bool EGLOffscreenRenderer::createContext_() {
+    // Surfaceless platform first: no window system, no device node needed.
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    const char* clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (getPlatformDisplay && clientExts && std::strstr(clientExts, "EGL_MESA_platform_surfaceless")) {
+        dpy_ = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (dpy_ == EGL_NO_DISPLAY) dpy_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (dpy_ == EGL_NO_DISPLAY || !eglInitialize(dpy_, &major, &minor)) {
+        std::fprintf(stderr, "[EGL] no display (0x%x)\n", eglGetError());
+        dpy_ = EGL_NO_DISPLAY;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_ES_API)) {
+        std::fprintf(stderr, "[EGL] OpenGL ES API unavailable\n");
+        shutdown();
+        return false;
+    }
+
+    // Rendering goes to an FBO, so any ES3 config will do (surface type is irrelevant).
+    const EGLint cfgAttribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+        EGL_SURFACE_TYPE, EGL_DONT_CARE,
+        EGL_NONE
+    };
+    EGLConfig cfg = nullptr;
+    EGLint count = 0;
+    if (!eglChooseConfig(dpy_, cfgAttribs, &cfg, 1, &count) || count < 1) {
+        std::fprintf(stderr, "[EGL] no GLES 3 config\n");
+        shutdown();
+        return false;
+    }
+
+    // Request an OpenGL ES 3.1 context (same as the window)
+    const EGLint ctxAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 1,
+        EGL_NONE
+    };
+    ctx_ = eglCreateContext(dpy_, cfg, EGL_NO_CONTEXT, ctxAttribs);
+    if (ctx_ == EGL_NO_CONTEXT || !eglMakeCurrent(dpy_, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx_)) {
+        std::fprintf(stderr, "[EGL] surfaceless GLES 3.1 context failed (0x%x)\n", eglGetError());
+        shutdown();
+        return false;
+    }
+    std::fprintf(stderr, "[EGL] %d.%d %s\n", major, minor, eglQueryString(dpy_, EGL_VENDOR));
+    return true;
+}
+
+void EGLOffscreenRenderer::shutdown() {
+    if (ctx_ != EGL_NO_CONTEXT) {
+        if (tex_) { glDeleteTextures(1, &tex_); tex_ = 0; }
+        if (vbo_) { glDeleteBuffers(1, &vbo_); vbo_ = 0; }
+        if (vao_) { glDeleteVertexArrays(1, &vao_); vao_ = 0; }
+        if (fbo_) { glDeleteFramebuffers(1, &fbo_); fbo_ = 0; }
+        if (rbo_) { glDeleteRenderbuffers(1, &rbo_); rbo_ = 0; }
+        for (auto& p : progs_) {
+            if (p.prog) glDeleteProgram(p.prog);
+            p = Program{};
+        }
+        eglMakeCurrent(dpy_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(dpy_, ctx_);
+        ctx_ = EGL_NO_CONTEXT;
+    }
+    if (dpy_ != EGL_NO_DISPLAY) {
+        eglTerminate(dpy_);
+        dpy_ = EGL_NO_DISPLAY;
+    }
+    vboBytes_ = 0;
+    fbW_ = fbH_ = 0;
+    texAllocated_ = false;
+    gpu_ = cimage::GpuUploadDesc{};
+}
+
+bool EGLOffscreenRenderer::resize(int width, int height) {
+    width = std::max(1, width);
+    height = std::max(1, height);
+    if (fbo_ && width == fbW_ && height == fbH_) return true;
+
+    if (!fbo_) glGenFramebuffers(1, &fbo_);
+    if (!rbo_) glGenRenderbuffers(1, &rbo_);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbo_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo_);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::fprintf(stderr, "[GL] FBO incomplete (0x%x)\n", status);
+        return false;
+    }
+    fbW_ = width;
+    fbH_ = height;
+    glViewport(0, 0, fbW_, fbH_);
+    return true;
+}
+
+const char* EGLOffscreenRenderer::rendererName() const {
+    return ctx_ != EGL_NO_CONTEXT ? reinterpret_cast<const char*>(glGetString(GL_RENDERER)) : "";
+}
+
+// ======================== upload/draw/readback ===============================
+// Same texture handling as GLFWImageWindow::uploadTexture_, from client memory instead of a PBO.
+// Binds the texture and (re)allocates it when g's layout differs. Returns true if it did.
+bool EGLOffscreenRenderer::allocateTexture_(const cimage::GpuUploadDesc& g) {
+    if (tex_ == 0) glGenTextures(1, &tex_);
+    glBindTexture(GL_TEXTURE_2D, tex_);
+
+    const bool needAlloc =
+        !texAllocated_ ||
+        gpu_.texWidth != g.texWidth || gpu_.texHeight != g.texHeight ||
+        gpu_.glInternalFormat != g.glInternalFormat || gpu_.glFormat != g.glFormat || gpu_.glType != g.glType ||
+        gpu_.nearest != g.nearest || std::memcmp(gpu_.swizzle, g.swizzle, sizeof(g.swizzle)) != 0;
+
+    if (needAlloc) {
+        glTexImage2D(GL_TEXTURE_2D, 0, (GLint)g.glInternalFormat, g.texWidth, g.texHeight, 0,
+            g.glFormat, g.glType, nullptr);
+
+        const GLint filter = g.nearest ? GL_NEAREST : GL_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, (GLint)g.swizzle[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, (GLint)g.swizzle[1]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, (GLint)g.swizzle[2]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, (GLint)g.swizzle[3]);
+        texAllocated_ = true;
+    }
+    return needAlloc;
+}
+
+bool EGLOffscreenRenderer::upload(const cimage::GpuUploadDesc& g) {
+    if (g.shader == cimage::GpuShader::None || !g.data) return false;
+    if (!progs_[static_cast<size_t>(g.shader)].prog) return false;
+
+    const bool needAlloc = allocateTexture_(g);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, g.rowLength);
+
+    if (needAlloc || g.rectCount == 0) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, g.texWidth, g.texHeight, g.glFormat, g.glType, g.data);
+    } else {
+        if (g.rowLength == 0) glPixelStorei(GL_UNPACK_ROW_LENGTH, g.texWidth);
+        for (int i = 0; i < g.rectCount; ++i) {
+            const cimage::GpuRect& r = g.rects[i];
+            if (r.width <= 0 || r.height <= 0) continue;
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, r.x);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, r.y);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height, g.glFormat, g.glType, g.data);
+        }
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    gpu_ = g;
+    gpu_.data = nullptr; // not valid past this call
+    return true;
+}
+
+bool EGLOffscreenRenderer::allocate(const cimage::GpuUploadDesc& g) {
+    if (g.shader == cimage::GpuShader::None || g.texWidth <= 0 || g.texHeight <= 0) return false;
+    if (!progs_[static_cast<size_t>(g.shader)].prog) return false;
+
+    allocateTexture_(g);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    gpu_ = g;
+    gpu_.data = nullptr;
+    return true;
+}
+
+void EGLOffscreenRenderer::subImage(const void* data, int rowLength, int x, int y, int width, int height) {
+    if (!texAllocated_ || !data || width <= 0 || height <= 0) return;
+    glBindTexture(GL_TEXTURE_2D, tex_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, gpu_.glFormat, gpu_.glType, data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void EGLOffscreenRenderer::draw(const float* xyuv, int vertexCount, GLenum mode) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glViewport(0, 0, fbW_, fbH_);
+    glClearColor(0.f, 0.f, 0.f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (!texAllocated_ || !xyuv || vertexCount <= 0) return;
+
+    const Program& p = progs_[static_cast<size_t>(gpu_.shader)];
+    glUseProgram(p.prog);
+    glUniform2f(p.uViewport, (float)fbW_, (float)fbH_);
+    glUniform2i(p.uImageSize, gpu_.imageWidth, gpu_.imageHeight);
+    glUniform1f(p.uLow, gpu_.low);
+    glUniform1f(p.uInvRange, gpu_.invRange);
+    glUniform4fv(p.uYSel0, 1, gpu_.ySel0);
+    glUniform4fv(p.uYSel1, 1, gpu_.ySel1);
+    glUniform4fv(p.uUSel, 1, gpu_.uSel);
+    glUniform4fv(p.uVSel, 1, gpu_.vSel);
+    glUniform2i(p.uFirstRed, gpu_.firstRed[0], gpu_.firstRed[1]);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, tex_);
+
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    const size_t bytes = sizeof(float) * 4 * static_cast<size_t>(vertexCount);
+    if (bytes > vboBytes_) {
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(bytes), xyuv, GL_DYNAMIC_DRAW);
+        vboBytes_ = bytes;
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(bytes), xyuv);
+    }
+    glDrawArrays(mode, 0, vertexCount);
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
+
+void EGLOffscreenRenderer::readback(std::vector<uint8_t>& rgba) {
+    const size_t row = static_cast<size_t>(fbW_) * 4;
+    rgba.resize(row * static_cast<size_t>(fbH_));
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, fbW_, fbH_, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+    // GL rows are bottom-up; the vertex stage maps pixel y = 0 to the top.
+    std::vector<uint8_t> tmp(row);
+    for (int y = 0; y < fbH_ / 2; ++y) {
+        uint8_t* a = rgba.data() + row * static_cast<size_t>(y);
+        uint8_t* b = rgba.data() + row * static_cast<size_t>(fbH_ - 1 - y);
+        std::memcpy(tmp.data(), a, row);
+        std::memcpy(a, b, row);
+        std::memcpy(b, tmp.data(), row);
+    }
+}
+
+void EGLOffscreenRenderer::finish() {
+    if (ctx_ != EGL_NO_CONTEXT) glFinish();
+}
+
+// ======================== shader utils =======================================
+GLuint EGLOffscreenRenderer::makeShader_(GLenum type, const char* src) {
+    GLuint s = glCreateShader(type);
+    glShaderSource(s, 1, &src, nullptr);
+    glCompileShader(s);
+
+    GLint ok = GL_FALSE; glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0; glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
+        std::vector<char> log(len > 1 ? len : 1);
+        glGetShaderInfoLog(s, len, nullptr, log.data());
+        std::fprintf(stderr, "[GL] shader compile error:\n%s\n", log.data());
+        glDeleteShader(s);
+        return 0;
+    }
+    return s;
+}
+
+GLuint EGLOffscreenRenderer::makeProgram_(const char* vs, const char* fs) {
+    GLuint v = makeShader_(GL_VERTEX_SHADER, vs);
+    if (!v) return 0;
+    GLuint f = makeShader_(GL_FRAGMENT_SHADER, fs);
+    if (!f) { glDeleteShader(v); return 0; }
+
+    GLuint p = glCreateProgram();
+    glAttachShader(p, v); glAttachShader(p, f); glLinkProgram(p);
+    glDeleteShader(v); glDeleteShader(f);
+
+    GLint ok = GL_FALSE; glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0; glGetProgramiv(p, GL_INFO_LOG_LENGTH, &len);
+        std::vector<char> log(len > 1 ? len : 1);
+        glGetProgramInfoLog(p, len, nullptr, log.data());
+        std::fprintf(stderr, "[GL] program link error:\n%s\n", log.data());
+        glDeleteProgram(p);
+        return 0;
+    }
+    return p;
+}
+
+EGLOffscreenRenderer::Program EGLOffscreenRenderer::makeGpuProgram_(const char* fs) {
+    Program p;
+    if (!fs) return p;
+    p.prog = makeProgram_(kVS, fs);
+    if (!p.prog) return p;
+    p.uViewport  = glGetUniformLocation(p.prog, "uViewport");
+    p.uTex       = glGetUniformLocation(p.prog, "uTex");
+    p.uTexU      = glGetUniformLocation(p.prog, "uTexU");
+    p.uImageSize = glGetUniformLocation(p.prog, "uImageSize");
+    p.uLow       = glGetUniformLocation(p.prog, "uLow");
+    p.uInvRange  = glGetUniformLocation(p.prog, "uInvRange");
+    p.uYSel0     = glGetUniformLocation(p.prog, "uYSel0");
+    p.uYSel1     = glGetUniformLocation(p.prog, "uYSel1");
+    p.uUSel      = glGetUniformLocation(p.prog, "uUSel");
+    p.uVSel      = glGetUniformLocation(p.prog, "uVSel");
+    p.uFirstRed  = glGetUniformLocation(p.prog, "uFirstRed");
+    return p;
+}
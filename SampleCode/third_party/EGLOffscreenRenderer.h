@@ -0,0 +1,92 @@
+#pragma once
+// ============================================================================
+// EGLOffscreenRenderer.h  (headless GLES 3.1 display path)
+// ----------------------------------------------------------------------------
+// Runs the display path of GLFWImageWindow without a window:
+//   - EGL surfaceless context (EGL_MESA_platform_surfaceless; Mesa llvmpipe
+//     works), falling back to the default display.
+//   - Same vertex stage and reference decode shaders (CImageDisplayerGpu.h).
+//   - upload() takes a cimage::GpuUploadDesc (whole texture or dirty rects);
+//     allocate() + subImage() fill an atlas (CImageMosaic::atlasDesc / uploads).
+//   - draw() takes the viewport-pixel {x,y,u,v} geometry of CImageDisplayerCPP
+//     (triStrip2D_XYUV / renderState().strip2D) or CImageMosaic::triangles().
+//   - Renders into an RGBA8 FBO; readback() returns top-down RGBA rows, so
+//     pixel (x,y) matches the window's pixel (x,y).
+//
+// Threading: one thread (the context is current on the initializing thread).
+// ============================================================================
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <include/glad/glad.h>
+#include <CImageDisplayerGpu.h>
+
+class EGLOffscreenRenderer {
+public:
+    EGLOffscreenRenderer() = default;
+    ~EGLOffscreenRenderer();
+
+    EGLOffscreenRenderer(const EGLOffscreenRenderer&) = delete;
+    EGLOffscreenRenderer& operator=(const EGLOffscreenRenderer&) = delete;
+
+    // Create the context, the FBO (width x height) and the decode programs.
+    bool initialize(int width, int height);
+    void shutdown();
+
+    // Resize the FBO (viewport pixels).
+    bool resize(int width, int height);
+
+    // Upload from client memory (g.data). Reallocates the texture when the layout changes.
+    // Returns false for GpuShader::None or a shader that failed to build.
+    bool upload(const cimage::GpuUploadDesc& g);
+
+    // Allocate the texture for g's layout without data (g.data is ignored) and draw with g's
+    // shader and uniforms; fill it with subImage(). Returns false like upload().
+    bool allocate(const cimage::GpuUploadDesc& g);
+
+    // glTexSubImage2D of width x height texels at (x,y) in the last allocated/uploaded layout.
+    // rowLength: GL_UNPACK_ROW_LENGTH in texels (0 = tightly packed).
+    void subImage(const void* data, int rowLength, int x, int y, int width, int height);
+
+    // Clear and draw with the last upload's shader. xyuv: {x,y,u,v} per vertex in viewport
+    // pixels; mode GL_TRIANGLE_STRIP (2D quad) or GL_TRIANGLES (mosaic).
+    void draw(const float* xyuv, int vertexCount, GLenum mode = GL_TRIANGLE_STRIP);
+
+    // Read the FBO back as tightly packed RGBA8, top row first.
+    void readback(std::vector<uint8_t>& rgba);
+
+    // Block until all issued GL work has finished (for timing).
+    void finish();
+
+    int  width() const { return fbW_; }
+    int  height() const { return fbH_; }
+    const char* rendererName() const;
+
+private:
+    struct Program {
+        GLuint prog = 0;
+        GLint uViewport = -1, uTex = -1, uTexU = -1, uImageSize = -1, uLow = -1, uInvRange = -1;
+        GLint uYSel0 = -1, uYSel1 = -1, uUSel = -1, uVSel = -1, uFirstRed = -1;
+    };
+
+    EGLDisplay dpy_ = EGL_NO_DISPLAY;
+    EGLContext ctx_ = EGL_NO_CONTEXT;
+
+    GLuint fbo_ = 0, rbo_ = 0;
+    GLuint tex_ = 0, vao_ = 0, vbo_ = 0;
+    size_t vboBytes_ = 0;
+    int    fbW_ = 0, fbH_ = 0;
+
+    Program progs_[static_cast<size_t>(cimage::GpuShader::Count)];
+    cimage::GpuUploadDesc gpu_;     // last upload (layout + uniforms)
+    bool texAllocated_ = false;
+
+    bool   allocateTexture_(const cimage::GpuUploadDesc& g);
+    bool   createContext_();
+    GLuint makeShader_(GLenum type, const char* src);
+    GLuint makeProgram_(const char* vs, const char* fs);
+    Program makeGpuProgram_(const char* fs);
+};
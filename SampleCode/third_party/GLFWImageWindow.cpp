@@ -43,7 +43,8 @@ GLFWImageWindow::GLFWImageWindow(
     , cameraImage_(sharedCameraImage)
     , cameraMtx_(sharedImageMutex)
     , hasNewFrame_(hasNewFrameFlag)
-    , shuttingDown_(shuttingDownFlag) {
+    , shuttingDown_(shuttingDownFlag)
+    , pbo_([this](uint8_t* dst, size_t capacity, cimage::GpuUploadDesc& g) { return fillPbo_(dst, capacity, g); }) {
 }
 
 GLFWImageWindow::~GLFWImageWindow() { shutdown(); }
@@ -108,33 +109,43 @@ void GLFWImageWindow::mainLoop() {
         glfwPollEvents();
 
         if (hasNewFrame_.exchange(false, std::memory_order_acq_rel)) {
-            std::lock_guard<std::mutex> lk(cameraMtx_);
-            view_.setImage(cameraImage_, csh_img::CopyMode::Shallow);
-            uploadTextureFromView_();
+            {
+                std::lock_guard<std::mutex> lk(cameraMtx_);
+                view_.setImage(cameraImage_, csh_img::CopyMode::Shallow);
+            }
+            pbo_.requestCopy(); // pixel copy happens on the ring's copy thread
         }
+        pbo_.service([this](const cimage::GpuUploadDesc& g) { uploadTexture_(g); });
 
-        float strip[16]{ 0.0f };
-        view_.triStrip2D_XYUV(strip);
-
-        float quad[16] = {
-            strip[0], strip[1], strip[2], strip[3],
-            strip[4], strip[5], strip[6], strip[7],
-            strip[8], strip[9], strip[10], strip[11],
-            strip[12], strip[13], strip[14], strip[15],
-        };
+        // Cached in the wrapper; only refetched after a setter or pointer event.
+        const cimage::RenderState& rs = view_.renderState();
 
         glClearColor(0.12f, 0.12f, 0.14f, 1.f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glUseProgram(prog_);
-        glUniform2f(uViewport_, (float)fbW_, (float)fbH_);
+        const Program& p = progs_[static_cast<size_t>(gpu_.shader)].prog
+            ? progs_[static_cast<size_t>(gpu_.shader)]
+            : progs_[static_cast<size_t>(cimage::GpuShader::Passthrough)];
+        glUseProgram(p.prog);
+        glUniform2f(p.uViewport, (float)fbW_, (float)fbH_);
+        glUniform2i(p.uImageSize, gpu_.imageWidth, gpu_.imageHeight);
+        glUniform1f(p.uLow, gpu_.low);
+        glUniform1f(p.uInvRange, gpu_.invRange);
+        glUniform4fv(p.uYSel0, 1, gpu_.ySel0);
+        glUniform4fv(p.uYSel1, 1, gpu_.ySel1);
+        glUniform4fv(p.uUSel, 1, gpu_.uSel);
+        glUniform4fv(p.uVSel, 1, gpu_.vSel);
+        glUniform2i(p.uFirstRed, gpu_.firstRed[0], gpu_.firstRed[1]);
 
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, tex_);
 
         glBindVertexArray(vao_);
         glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(quad), quad);
+        if (rs.version2D != quadVersion_) { // geometry unchanged: keep the VBO as is
+            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(rs.strip2D), rs.strip2D);
+            quadVersion_ = rs.version2D;
+        }
 
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
@@ -152,10 +163,14 @@ void GLFWImageWindow::shutdown() {
 
     glfwSetWindowShouldClose(win_, GLFW_TRUE);
 
+    pbo_.shutdown();
     if (tex_) { glDeleteTextures(1, &tex_); tex_ = 0; }
     if (vbo_) { glDeleteBuffers(1, &vbo_); vbo_ = 0; }
     if (vao_) { glDeleteVertexArrays(1, &vao_); vao_ = 0; }
-    if (prog_) { glDeleteProgram(prog_); prog_ = 0; }
+    for (auto& p : progs_) {
+        if (p.prog) glDeleteProgram(p.prog);
+        p = Program{};
+    }
 
     glfwDestroyWindow(win_);
     win_ = nullptr;
@@ -165,14 +180,49 @@ void GLFWImageWindow::shutdown() {
 // ======================== Public: viewer helpers =============================
 void GLFWImageWindow::setFitMode(cimage::FitMode m) { view_.setFitMode(m); }
 void GLFWImageWindow::reset2D() { view_.reset2D(); }
+void GLFWImageWindow::setWindowLevel(float window, float level) {
+    {
+        std::lock_guard<std::mutex> lk(cameraMtx_);
+        gpuView_.window = window; gpuView_.level = level;
+        forceFull_ = true;
+    }
+    pbo_.requestCopy(); // re-upload the current frame with the new parameters
+}
+void GLFWImageWindow::setDemosaic(bool on) {
+    {
+        std::lock_guard<std::mutex> lk(cameraMtx_);
+        gpuView_.demosaic = on;
+        forceFull_ = true;
+    }
+    pbo_.requestCopy();
+}
+void GLFWImageWindow::addDirtyRectsLocked(const CImageRect* rects, int count) {
+    dirtyHinted_ = true;
+    if (dirtyFull_) return;
+    if (!rects || count <= 0 || dirtyHint_.size() + static_cast<size_t>(count) > CIMG_MAX_DIRTY_RECTS) {
+        dirtyFull_ = true;
+        dirtyHint_.clear();
+        return;
+    }
+    dirtyHint_.insert(dirtyHint_.end(), rects, rects + count);
+}
+void GLFWImageWindow::setFrameDiff(bool on) {
+    std::lock_guard<std::mutex> lk(cameraMtx_);
+    frameDiff_ = on;
+    prevFrame_.clear();
+}
 
 // ======================== Private: init GL objects ===========================
 bool GLFWImageWindow::initGLObjects_() {
-    prog_ = makeProgram_(kVS, kFS);
-    if (!prog_) return false;
-
-    uViewport_ = glGetUniformLocation(prog_, "uViewport");
-    uTex_      = glGetUniformLocation(prog_, "uTex");
+    // Passthrough is required; the decode programs are optional (a missing one falls back to
+    // a CPU path in fillPbo_ or leaves that format undisplayed).
+    auto& pass = progs_[static_cast<size_t>(cimage::GpuShader::Passthrough)];
+    pass = makeGpuProgram_(kFS);
+    if (!pass.prog) return false;
+    for (auto s : { cimage::GpuShader::Yuv422, cimage::GpuShader::Gray16,
+                    cimage::GpuShader::Bayer8, cimage::GpuShader::Bayer16 }) {
+        progs_[static_cast<size_t>(s)] = makeGpuProgram_(cimage::GpuFragmentShader(s));
+    }
 
     glGenVertexArrays(1, &vao_);
     glGenBuffers(1, &vbo_);
@@ -180,6 +230,7 @@ bool GLFWImageWindow::initGLObjects_() {
     glBindVertexArray(vao_);
     glBindBuffer(GL_ARRAY_BUFFER, vbo_);
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 16, nullptr, GL_DYNAMIC_DRAW);
+    quadVersion_ = 0; // fresh VBO: write the quad on the first frame
 
     glEnableVertexAttribArray(0); // aPos
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)(uintptr_t)0);
@@ -191,11 +242,16 @@ bool GLFWImageWindow::initGLObjects_() {
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
 
-    glUseProgram(prog_);
-    glUniform1i(uTex_, 0); // texture unit 0
+    for (const auto& p : progs_) {
+        if (!p.prog) continue;
+        glUseProgram(p.prog);
+        glUniform1i(p.uTex, 0);  // texture unit 0
+        glUniform1i(p.uTexU, 0); // (integer sampler variants)
+    }
     glUseProgram(0);
 
-    return true;
+    // Programs are final here; the copy thread reads them in fillPbo_.
+    return pbo_.initialize((GLADloadproc)glfwGetProcAddress);
 }
 
 // ======================== Private: shader utils ==============================
@@ -238,121 +294,138 @@ GLuint GLFWImageWindow::makeProgram_(const char* vs, const char* fs) {
     return p;
 }
 
+GLFWImageWindow::Program GLFWImageWindow::makeGpuProgram_(const char* fs) {
+    Program p;
+    p.prog = makeProgram_(kVS, fs);
+    if (!p.prog) return p;
+    p.uViewport  = glGetUniformLocation(p.prog, "uViewport");
+    p.uTex       = glGetUniformLocation(p.prog, "uTex");
+    p.uTexU      = glGetUniformLocation(p.prog, "uTexU");
+    p.uImageSize = glGetUniformLocation(p.prog, "uImageSize");
+    p.uLow       = glGetUniformLocation(p.prog, "uLow");
+    p.uInvRange  = glGetUniformLocation(p.prog, "uInvRange");
+    p.uYSel0     = glGetUniformLocation(p.prog, "uYSel0");
+    p.uYSel1     = glGetUniformLocation(p.prog, "uYSel1");
+    p.uUSel      = glGetUniformLocation(p.prog, "uUSel");
+    p.uVSel      = glGetUniformLocation(p.prog, "uVSel");
+    p.uFirstRed  = glGetUniformLocation(p.prog, "uFirstRed");
+    return p;
+}
+
 // ======================== Private: texture upload ============================
-// NOTE: We implement a robust Gray16→Gray8 fallback so the viewer works even if
-// GL_R16 normalized textures are not available in your GLES stack.
-void GLFWImageWindow::uploadTextureFromView_() {
-    const auto d = view_.uploadDesc();
-    if (!d.data || d.width <= 0 || d.height <= 0) {
-        return; // nothing to upload
+// The frame is uploaded as-is; cimage::MakeGpuUploadDesc picks the texture layout and the
+// fragment shader that decodes it (YUV422, 16-bit window/level, Bayer demosaic).
+// If a decode program failed to build, 16-bit gray/Bayer fall back to a CPU
+// window/level into R8 so the viewer still shows something.
+//
+// Runs on the PBO ring's copy thread: only the camera mutex is taken, never GL.
+size_t GLFWImageWindow::fillPbo_(uint8_t* dst, size_t capacity, cimage::GpuUploadDesc& g) {
+    std::lock_guard<std::mutex> lk(cameraMtx_);
+    if (shuttingDown_.load()) return 0;
+
+    g = cimage::MakeGpuUploadDesc(cameraImage_, gpuView_);
+    if (g.shader == cimage::GpuShader::None) return 0;
+
+    const bool cpuFallback = !progs_[static_cast<size_t>(g.shader)].prog;
+    if (cpuFallback && g.shader != cimage::GpuShader::Gray16 && g.shader != cimage::GpuShader::Bayer16) return 0;
+
+    const size_t w = static_cast<size_t>(g.texWidth), h = static_cast<size_t>(g.texHeight);
+    const size_t bytes = cpuFallback ? w * h : w * static_cast<size_t>(g.texelBytes) * h;
+    if (bytes > capacity) return bytes; // ring reallocates and calls again
+
+    // Which part changed: pipeline hint, else frame-diff, else everything.
+    // The PBO always receives the whole frame; only the texture upload is partial.
+    const size_t srcBytes = w * static_cast<size_t>(g.texelBytes) * h;
+    if (forceFull_) {
+        g.rectCount = 0;
+    } else if (dirtyHinted_) {
+        if (!dirtyFull_) cimage::SetGpuDirtyRects(g, dirtyHint_.data(), static_cast<int>(dirtyHint_.size()));
+    } else if (frameDiff_ && prevFrame_.size() == srcBytes) {
+        cimage::GpuRect rects[cimage::kGpuMaxDirtyRects];
+        const int n = cimage::FindDirtyRects(prevFrame_.data(), g.data, g.imageWidth, g.imageHeight, 0,
+            static_cast<int>(srcBytes / (static_cast<size_t>(g.imageWidth) * h)), 64, rects, cimage::kGpuMaxDirtyRects);
+        if (n == 0) return 0; // unchanged: nothing to upload
+        cimage::SetGpuDirtyRects(g, rects, n);
     }
-
-    const auto fmt = cameraImage_.getFormat();
-
-    // Decide GL storage/packing (defaults)
-    GLenum internalFormat = GL_RGB8;
-    GLenum format         = GL_RGB;
-    GLenum type           = GL_UNSIGNED_BYTE;
-
-    bool swizzleGray = false;
-    bool swizzleBGR  = false;
-
-    // Optional temporary buffer for downconversion (e.g., Gray16 -> Gray8)
-    std::vector<uint8_t> tmp8;  // keeps lifetime until glTexSubImage2D
-
-    switch (fmt) {
-    case csh_img::En_ImageFormat::Gray8:
-        internalFormat = GL_R8;  format = GL_RED; type = GL_UNSIGNED_BYTE; swizzleGray = true; break;
-
-    case csh_img::En_ImageFormat::Gray16:
-    case csh_img::En_ImageFormat::Gray10:
-    case csh_img::En_ImageFormat::Gray12:
-    case csh_img::En_ImageFormat::Gray14:
-        // Safe cross-driver path: downconvert to 8-bit on CPU.
-        // (Avoids relying on GL_R16 normalized support on GLES stacks.)
-        tmp8.resize(static_cast<size_t>(d.width) * static_cast<size_t>(d.height));
-        {
-            const uint16_t* src16 = reinterpret_cast<const uint16_t*>(d.data);
-            const size_t N = tmp8.size();
-            // Simple >>8 keeps MSBs; for 10/12/14-bit sources this is adequate for display.
-            for (size_t i = 0; i < N; ++i) tmp8[i] = static_cast<uint8_t>(src16[i] >> 8);
+    forceFull_ = dirtyHinted_ = dirtyFull_ = false;
+    dirtyHint_.clear();
+    if (frameDiff_) prevFrame_.assign(g.data, g.data + srcBytes);
+
+    if (cpuFallback) {
+        const uint16_t* src16 = reinterpret_cast<const uint16_t*>(g.data);
+        for (size_t i = 0; i < w * h; ++i) {
+            const float v = (static_cast<float>(src16[i]) - g.low) * g.invRange;
+            dst[i] = static_cast<uint8_t>(std::clamp(v, 0.f, 1.f) * 255.f + 0.5f);
         }
-        internalFormat = GL_R8;  format = GL_RED; type = GL_UNSIGNED_BYTE; swizzleGray = true;
-        break;
-
-    case csh_img::En_ImageFormat::RGB888:
-        internalFormat = GL_RGB8; format = GL_RGB; type = GL_UNSIGNED_BYTE; break;
-
-    case csh_img::En_ImageFormat::BGR888:
-        // Upload as RGB and swizzle R/B in the sampler state
-        internalFormat = GL_RGB8; format = GL_RGB; type = GL_UNSIGNED_BYTE; swizzleBGR = true; break;
-
-    case csh_img::En_ImageFormat::RGB565:
-        internalFormat = GL_RGB;  format = GL_RGB; type = GL_UNSIGNED_SHORT_5_6_5; break;
-
-    case csh_img::En_ImageFormat::YUV422:
-        // Not handled here—convert before upload or use a YUV shader path.
-        return;
-
-    default:
-        return;
+        g.shader = cimage::GpuShader::Passthrough;
+        g.glInternalFormat = GL_R8; g.glFormat = GL_RED; g.glType = GL_UNSIGNED_BYTE;
+        g.texelBytes = 1;
+        g.integerTexture = g.nearest = false;
+        g.swizzle[0] = g.swizzle[1] = g.swizzle[2] = GL_RED; g.swizzle[3] = GL_ONE;
+    } else {
+        std::memcpy(dst, g.data, bytes);
     }
+    g.data = nullptr; // not valid past this call
+    g.rowLength = 0;  // rows are tightly packed in the PBO
+    return bytes;
+}
 
+// Runs on the render thread with the filled PBO bound to GL_PIXEL_UNPACK_BUFFER.
+void GLFWImageWindow::uploadTexture_(const cimage::GpuUploadDesc& g) {
     if (tex_ == 0) glGenTextures(1, &tex_);
     glBindTexture(GL_TEXTURE_2D, tex_);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
     const bool needAlloc =
         !texAllocated_ ||
-        texW_ != d.width || texH_ != d.height ||
-        texInternal_ != internalFormat || texFormat_ != format || texType_ != type;
+        texW_ != g.texWidth || texH_ != g.texHeight ||
+        texInternal_ != g.glInternalFormat || texFormat_ != g.glFormat || texType_ != g.glType ||
+        gpu_.nearest != g.nearest || std::memcmp(gpu_.swizzle, g.swizzle, sizeof(g.swizzle)) != 0;
 
     if (needAlloc) {
-        // Allocate storage (no data yet)
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, d.width, d.height, 0, format, type, nullptr);
-
-        // (Re)apply sampler params when reallocating
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // Allocate storage (with the PBO bound, nullptr is offset 0 into it)
+        glTexImage2D(GL_TEXTURE_2D, 0, (GLint)g.glInternalFormat, g.texWidth, g.texHeight, 0,
+            g.glFormat, g.glType, nullptr);
+
+        // (Re)apply sampler params when reallocating. Decode shaders fetch exact texels
+        // (integer textures are incomplete with LINEAR filtering anyway).
+        const GLint filter = g.nearest ? GL_NEAREST : GL_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-        // Texture swizzle is core in GLES 3.x
-        if (swizzleGray) {
-            // Gray -> RGB, A=1
-            GLint sr = GL_RED, sg = GL_RED, sb = GL_RED, sa = GL_ONE;
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, sr);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, sg);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, sb);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, sa);
-        } else if (swizzleBGR) {
-            // BGR -> RGB
-            GLint sr = GL_BLUE, sg = GL_GREEN, sb = GL_RED, sa = GL_ONE;
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, sr);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, sg);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, sb);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, sa);
-        } else {
-            // Identity RGB, A=1
-            GLint sr = GL_RED, sg = GL_GREEN, sb = GL_BLUE, sa = GL_ONE;
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, sr);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, sg);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, sb);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, sa);
-        }
+        // Texture swizzle is core in GLES 3.x (gray -> RGB, BGR -> RGB, A=1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, (GLint)g.swizzle[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, (GLint)g.swizzle[1]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, (GLint)g.swizzle[2]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, (GLint)g.swizzle[3]);
 
         texAllocated_  = true;
-        texW_ = d.width;  texH_ = d.height;
-        texInternal_ = internalFormat; texFormat_ = format; texType_ = type;
+        texW_ = g.texWidth;  texH_ = g.texHeight;
+        texInternal_ = g.glInternalFormat; texFormat_ = g.glFormat; texType_ = g.glType;
     }
 
-    // Choose source pointer (original or downconverted)
-    const void* pixels = tmp8.empty() ? d.data : (const void*)tmp8.data();
-
-    // Fast path: just update the pixels
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, d.width, d.height, format, type, pixels);
+    // Source is the bound PBO (g.data is the offset); the driver copies asynchronously.
+    if (needAlloc || g.rectCount == 0) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, g.texWidth, g.texHeight, g.glFormat, g.glType, g.data);
+    } else {
+        // Dirty rectangles only: strided sub-image reads out of the full frame in the PBO.
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, g.texWidth);
+        for (int i = 0; i < g.rectCount; ++i) {
+            const cimage::GpuRect& r = g.rects[i];
+            if (r.width <= 0 || r.height <= 0) continue;
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, r.x);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, r.y);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height, g.glFormat, g.glType, g.data);
+        }
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
 
     glBindTexture(GL_TEXTURE_2D, 0);
+    gpu_ = g;
 }
 
 // ======================== Private: GLFW callbacks ============================
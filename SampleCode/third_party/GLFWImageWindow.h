@@ -32,6 +32,8 @@
 // Your SDK
 #include <../CImageDisplayer/CImageDisplayerCPP.h>
 #include <CSH_Image.h>
+#include <CImageDisplayerGpu.h>
+#include "GLPboUploadRing.h"
 
 class GLFWImageWindow {
 public:
@@ -52,6 +54,17 @@ public:
 
     void setFitMode(cimage::FitMode m);
     void reset2D();
+    /// Window/level for 16-bit gray and Bayer frames (raw units; window 0 = full range).
+    void setWindowLevel(float window, float level);
+    /// Bayer frames: demosaic on the GPU (true) or show the raw mosaic (false).
+    void setDemosaic(bool on);
+    /// Pipeline hint: regions of the shared image changed by the latest update (pixels).
+    /// Call with the shared image mutex held, in the same critical section that writes the image;
+    /// hints accumulate until the frame is uploaded. count 0 = whole image.
+    void addDirtyRectsLocked(const CImageRect* rects, int count);
+    /// Diff each frame against the previous one and upload only changed 64x64 tiles
+    /// (for mostly static content such as overlays; costs a compare + copy per frame).
+    void setFrameDiff(bool on);
     GLFWwindow* window() const { return win_; }
 
 private:
@@ -68,11 +81,30 @@ private:
     int fbH_ = 720;
 
     // ==== GL objects ====
-    GLuint prog_ = 0;
-    GLint  uViewport_ = -1; // vec2
-    GLint  uTex_ = -1;
+    // One program per cimage::GpuShader kind (YUV422 / 16-bit / Bayer decode in the fragment shader)
+    struct Program {
+        GLuint prog = 0;
+        GLint  uViewport = -1; // vec2
+        GLint  uTex = -1, uTexU = -1;
+        GLint  uImageSize = -1, uLow = -1, uInvRange = -1;
+        GLint  uYSel0 = -1, uYSel1 = -1, uUSel = -1, uVSel = -1, uFirstRed = -1;
+    };
+    Program progs_[static_cast<size_t>(cimage::GpuShader::Count)];
+    cimage::GpuUploadDesc gpu_;      // descriptor of the texture currently in tex_
+    cimage::GpuViewParams gpuView_;  // window/level + demosaic switch (guarded by cameraMtx_)
+    // Dirty-rectangle sources (guarded by cameraMtx_)
+    std::vector<CImageRect> dirtyHint_;
+    bool   dirtyHinted_ = false;     // dirtyHint_ is valid for the pending frame
+    bool   dirtyFull_ = false;       // a hinted update covered the whole image
+    bool   frameDiff_ = false;
+    bool   forceFull_ = false;       // view parameters changed: re-upload everything
+    std::vector<uint8_t> prevFrame_; // frame-diff reference (copy thread)
     GLuint vao_ = 0, vbo_ = 0;
+    uint64_t quadVersion_ = 0;       // cimage::RenderState::version2D last written to vbo_
     GLuint tex_ = 0;
+    // Frames are copied into PBOs on the ring's copy thread; the render thread only
+    // issues the fenced glTexSubImage2D from the buffer.
+    GLPboUploadRing pbo_;
     // Persisted texture state so we don’t reallocate every frame
     int    texW_ = 0, texH_ = 0;
     GLenum texInternal_ = 0, texFormat_ = 0, texType_ = 0;
@@ -85,7 +117,9 @@ private:
     bool   initGLObjects_();
     static GLuint makeShader_(GLenum type, const char* src);
     static GLuint makeProgram_(const char* vs, const char* fs);
-    void   uploadTextureFromView_();
+    static Program makeGpuProgram_(const char* fs);
+    size_t fillPbo_(uint8_t* dst, size_t capacity, cimage::GpuUploadDesc& g); // copy thread
+    void   uploadTexture_(const cimage::GpuUploadDesc& g);                     // GL thread, PBO bound
 
     // ---- GLFW callbacks (static trampolines -> member functions) ----
     static void framebufferSizeCB_(GLFWwindow* w, int width, int height);
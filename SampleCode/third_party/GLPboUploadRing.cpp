@@ -0,0 +1,268 @@
+#include "GLPboUploadRing.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// GL_EXT_buffer_storage (not in the generated GLAD header)
+static constexpr GLbitfield kMapPersistentBitExt = 0x0040;
+static constexpr GLbitfield kMapCoherentBitExt   = 0x0080;
+
+// ======================== ctor/dtor ==========================================
+GLPboUploadRing::GLPboUploadRing(FillFn fill, int slots)
+    : fill_(std::move(fill))
+    , slots_(static_cast<size_t>(std::max(2, slots))) {
+}
+
+GLPboUploadRing::~GLPboUploadRing() {
+    // GL objects must be released by shutdown() on the GL thread; only stop the copier here.
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (copier_.joinable()) copier_.join();
+}
+
+// ======================== GL thread ==========================================
+bool GLPboUploadRing::initialize(GLADloadproc load) {
+    if (running_) return true;
+
+    // Persistent + coherent mapping when GL_EXT_buffer_storage is exposed.
+    bufferStorage_ = nullptr;
+    if (load) {
+        GLint n = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+        for (GLint i = 0; i < n; ++i) {
+            const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (ext && std::strcmp(ext, "GL_EXT_buffer_storage") == 0) {
+                bufferStorage_ = reinterpret_cast<BufferStorageProc>(load("glBufferStorageEXT"));
+                break;
+            }
+        }
+    }
+    persistent_ = bufferStorage_ != nullptr;
+    std::fprintf(stderr, "[PBO] %zu-buffer upload ring (%s)\n", slots_.size(),
+        persistent_ ? "persistent mapping" : "map per frame");
+
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = false;
+        requested_ = false;
+    }
+    copier_ = std::thread(&GLPboUploadRing::copyLoop_, this);
+    running_ = true;
+    return true;
+}
+
+void GLPboUploadRing::shutdown() {
+    if (!running_) return;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (copier_.joinable()) copier_.join();
+
+    for (auto& s : slots_) {
+        if (s.fence) { glDeleteSync(s.fence); s.fence = nullptr; }
+        unmap_(s);
+        if (s.pbo) { glDeleteBuffers(1, &s.pbo); s.pbo = 0; }
+        s.capacity = 0;
+        s.state = SlotState::Empty;
+    }
+    running_ = false;
+}
+
+bool GLPboUploadRing::service(const UploadFn& upload) {
+    if (!running_) return false;
+
+    // 1) Retire buffers whose upload the GPU has finished reading.
+    for (auto& s : slots_) {
+        if (!s.fence) continue; // fences are only touched on this thread
+        if (glClientWaitSync(s.fence, 0, 0) == GL_TIMEOUT_EXPIRED) continue;
+        glDeleteSync(s.fence);
+        s.fence = nullptr;
+        std::lock_guard<std::mutex> lk(mtx_);
+        s.state = (s.ptr && s.capacity >= wanted_) ? SlotState::Writable : SlotState::Empty;
+    }
+
+    // 2) Upload the newest filled buffer; older filled ones are superseded.
+    Slot* up = nullptr;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (auto& s : slots_) {
+            if (s.state == SlotState::Ready && (!up || s.seq > up->seq)) up = &s;
+        }
+        for (auto& s : slots_) {
+            if (s.state == SlotState::Ready && &s != up) {
+                cimage::MergeGpuDirtyRects(up->desc, s.desc); // its changes must still reach the texture
+                s.state = SlotState::Writable;
+                ++stats_.dropped;
+                wake = true;
+            }
+        }
+        if (up) up->state = SlotState::Pending;
+    }
+
+    bool uploaded = false;
+    if (up) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, up->pbo);
+        bool ok = true;
+        if (!persistent_) {
+            ok = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE; // GL_FALSE: contents lost
+            up->ptr = nullptr;
+        }
+        if (ok) {
+            cimage::GpuUploadDesc g = up->desc;
+            g.data = nullptr; // offset 0 into the bound buffer
+            if (forceFull_) { g.rectCount = 0; forceFull_ = false; }
+            upload(g);
+            up->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (up->fence) {
+            ++stats_.uploads;
+            uploaded = true;
+        } else {
+            up->state = SlotState::Empty;
+            forceFull_ = true;
+        }
+    }
+
+    // 3) Map free buffers so the copy thread can write the next frame.
+    size_t wanted = 0;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        wanted = wanted_;
+    }
+    if (wanted) {
+        for (auto& s : slots_) {
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                if (s.state != SlotState::Empty) continue;
+            }
+            // Empty slots belong to this thread until published as Writable.
+            if (s.capacity < wanted && !allocate_(s, wanted)) continue;
+            if (!s.ptr) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s.pbo);
+                s.ptr = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                    static_cast<GLsizeiptr>(s.capacity),
+                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                if (!s.ptr) continue;
+            }
+            std::lock_guard<std::mutex> lk(mtx_);
+            s.state = SlotState::Writable;
+            wake = true;
+        }
+    }
+
+    if (wake) cv_.notify_all();
+    return uploaded;
+}
+
+bool GLPboUploadRing::allocate_(Slot& s, size_t bytes) {
+    bytes = (bytes + 4095) & ~static_cast<size_t>(4095);
+    unmap_(s);
+    if (s.pbo) { glDeleteBuffers(1, &s.pbo); s.pbo = 0; }
+    s.capacity = 0;
+
+    glGenBuffers(1, &s.pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s.pbo);
+    if (persistent_) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | kMapPersistentBitExt | kMapCoherentBitExt;
+        bufferStorage_(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, flags);
+        s.ptr = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+            static_cast<GLsizeiptr>(bytes), flags));
+        if (!s.ptr) {
+            // Immutable storage cannot be respecified; fall back to map-per-frame for all buffers.
+            std::fprintf(stderr, "[PBO] persistent mapping failed, falling back to map per frame\n");
+            persistent_ = false;
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glDeleteBuffers(1, &s.pbo);
+            glGenBuffers(1, &s.pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s.pbo);
+        }
+    }
+    if (!persistent_) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    s.capacity = bytes;
+    std::lock_guard<std::mutex> lk(mtx_);
+    ++stats_.resizes;
+    return true;
+}
+
+void GLPboUploadRing::unmap_(Slot& s) {
+    if (!s.ptr) return;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s.pbo);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    s.ptr = nullptr;
+}
+
+// ======================== any thread =========================================
+void GLPboUploadRing::requestCopy() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        requested_ = true;
+    }
+    cv_.notify_all();
+}
+
+GLPboUploadRing::Stats GLPboUploadRing::stats() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return stats_;
+}
+
+// ======================== copy thread ========================================
+GLPboUploadRing::Slot* GLPboUploadRing::writableLocked_() {
+    for (auto& s : slots_) {
+        if (s.state == SlotState::Writable) return &s;
+    }
+    return nullptr;
+}
+
+void GLPboUploadRing::copyLoop_() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    for (;;) {
+        // Without a known frame size there is nothing mapped yet: probe with capacity 0.
+        cv_.wait(lk, [&] { return stop_ || (requested_ && (writableLocked_() || wanted_ == 0)); });
+        if (stop_) break;
+
+        Slot* s = writableLocked_();
+        uint8_t* dst = s ? s->ptr : nullptr;
+        const size_t cap = s ? s->capacity : 0;
+        if (s) s->state = SlotState::Writing;
+        requested_ = false;
+        lk.unlock();
+
+        cimage::GpuUploadDesc g;
+        const size_t n = fill_(dst, cap, g);
+
+        lk.lock();
+        if (n > cap) {
+            // Too small: hand every undersized buffer back to the GL thread for reallocation,
+            // and keep the request so the frame is copied once a bigger buffer is mapped.
+            wanted_ = std::max(wanted_, n);
+            if (s) s->state = SlotState::Empty;
+            for (auto& o : slots_) {
+                if (o.state == SlotState::Writable && o.capacity < n) o.state = SlotState::Empty;
+            }
+            requested_ = true;
+        } else if (n == 0) {
+            if (s) s->state = SlotState::Writable;
+        } else {
+            s->desc = g;
+            s->seq = ++seq_;
+            s->state = SlotState::Ready;
+            ++stats_.copies;
+        }
+    }
+}
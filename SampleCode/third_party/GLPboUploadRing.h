@@ -0,0 +1,106 @@
+#pragma once
+// ============================================================================
+// GLPboUploadRing.h  (GLES 3 pixel-buffer-object upload ring)
+// ----------------------------------------------------------------------------
+// Moves texture uploads off the render thread's critical path:
+//   - N pixel-unpack buffers (default 3) are kept mapped for writing.
+//   - A copy thread fills a mapped buffer with the latest frame (FillFn),
+//     so the memcpy (and the camera mutex) never touch the render thread.
+//   - The render thread (service(), once per frame) unmaps the newest filled
+//     buffer, issues glTexSubImage2D from it (UploadFn) and fences it with
+//     glFenceSync; the buffer is reused only after the fence has signaled.
+//   - With GL_EXT_buffer_storage the buffers are mapped persistently and
+//     coherently once, so there is no map/unmap per frame.
+//   - Dirty rectangles (GpuUploadDesc::rects) of a superseded buffer are
+//     merged into the newer one, so partial uploads never miss a change.
+//
+// Threading:
+//   - initialize/service/shutdown: GL thread (context current).
+//   - requestCopy: any thread.
+//   - FillFn runs on the ring's copy thread and must not call GL.
+// ============================================================================
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <include/glad/glad.h>
+#include <CImageDisplayerGpu.h>
+
+class GLPboUploadRing {
+public:
+    /// Copy thread: write the frame into @p dst (@p capacity bytes) and describe it in @p g.
+    /// Return the bytes written, 0 if there is nothing to upload, or a value larger than
+    /// @p capacity (nothing written) to ask for bigger buffers. @p dst may be null with capacity 0.
+    using FillFn = std::function<size_t(uint8_t* dst, size_t capacity, cimage::GpuUploadDesc& g)>;
+    /// GL thread: upload @p g with the buffer bound to GL_PIXEL_UNPACK_BUFFER (g.data is offset 0).
+    using UploadFn = std::function<void(const cimage::GpuUploadDesc& g)>;
+
+    struct Stats {
+        uint64_t copies  = 0;  // frames written into a buffer
+        uint64_t uploads = 0;  // glTexSubImage2D calls issued from a buffer
+        uint64_t dropped = 0;  // filled buffers superseded by a newer frame before upload
+        uint64_t resizes = 0;  // buffer (re)allocations
+    };
+
+    explicit GLPboUploadRing(FillFn fill, int slots = 3);
+    ~GLPboUploadRing();
+
+    GLPboUploadRing(const GLPboUploadRing&) = delete;
+    GLPboUploadRing& operator=(const GLPboUploadRing&) = delete;
+
+    // GL thread. load resolves extension entry points (e.g., glfwGetProcAddress);
+    // pass nullptr to skip persistent mapping.
+    bool initialize(GLADloadproc load);
+    void shutdown();
+
+    // Any thread: a new frame is available; the copy thread fills the next free buffer.
+    void requestCopy();
+
+    // GL thread, once per frame: retire signaled fences, upload the newest filled buffer,
+    // map free buffers. Returns true if an upload was issued.
+    bool service(const UploadFn& upload);
+
+    bool  persistent() const { return persistent_; }
+    Stats stats() const;
+
+private:
+    enum class SlotState { Empty, Writable, Writing, Ready, Pending };
+    struct Slot {
+        GLuint    pbo = 0;
+        size_t    capacity = 0;
+        uint8_t*  ptr = nullptr;     // mapped pointer (nullptr when unmapped)
+        GLsync    fence = nullptr;
+        SlotState state = SlotState::Empty;
+        cimage::GpuUploadDesc desc;
+        uint64_t  seq = 0;
+    };
+
+    typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+    FillFn            fill_;
+    std::vector<Slot> slots_;        // fixed size; states guarded by mtx_
+    bool              persistent_ = false;
+    BufferStorageProc bufferStorage_ = nullptr;
+    bool              running_ = false;
+    bool              forceFull_ = false; // GL thread: a buffer was lost, next upload covers the whole texture
+
+    mutable std::mutex      mtx_;
+    std::condition_variable cv_;
+    bool     stop_ = false;
+    bool     requested_ = false;
+    size_t   wanted_ = 0;            // bytes the last frame needed
+    uint64_t seq_ = 0;
+    Stats    stats_;
+    std::thread copier_;
+
+    void copyLoop_();
+    Slot* writableLocked_();
+    bool  allocate_(Slot& s, size_t bytes);
+    void  unmap_(Slot& s);
+};
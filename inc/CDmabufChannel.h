@@ -0,0 +1,705 @@
+#pragma once
+/**
+ * @file CDmabufChannel.h
+ * @brief Cross-process zero-copy: pass frame dma-buf fds over a UNIX socket (SCM_RIGHTS).
+ *
+ * Consumers such as a local encoder or a GL compositor want the driver buffer itself, not a
+ * copy. @ref CDmabufServer listens on a SOCK_SEQPACKET socket; for every published frame it
+ * sends each connected client one message with the frame metadata and plane layout, plus the
+ * plane dma-buf fds as SCM_RIGHTS ancillary data.
+ *
+ * Buffer return protocol:
+ *  - The server keeps a reference to every frame a client holds, so the driver buffer is not
+ *    re-queued while the client may still read it.
+ *  - @ref CDmabufClient wraps each received frame as a @ref csh_img::CSH_Image view (read-only
+ *    mapping of the fds, planes in @ref CFrameMeta). When the last copy is released the client
+ *    unmaps, closes the fds and sends RELEASE; the server then drops its reference.
+ *  - A client holds at most `max_inflight` frames; further frames are skipped for it (counted).
+ *    Disconnecting releases everything the client held.
+ *
+ * Frames without dma-buf fds (MMAP pools, test patterns, replay) are copied once into a
+ * memfd-backed pool (@ref CMemfdFramePool), so the channel also works without a camera.
+ *
+ * @code
+ * // capture process
+ * CDmabufServer server("/run/cam0.sock");
+ * server.Start();
+ * fanout.Subscribe("dmabuf", server.Input());
+ *
+ * // encoder process
+ * CDmabufClient client("/run/cam0.sock");
+ * csh_img::CSH_Image f;
+ * while (client.Receive(f, 100)) {
+ *     const CFrameMeta* m = GetFrameMeta(f);   // m->planes[i].dmabuf_fd: import into EGL/VA-API
+ *     encode(f);
+ * }                                            // last release of f returns the buffer
+ * @endcode
+ *
+ * @note Linux only. Views are mapped read-only; writing through them faults.
+ */
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <linux/dma-buf.h>
+
+#include "IFrameGrabImpl.h"
+#include "CGrabberFrame.h"
+#include "CSH_Log.h"
+
+namespace dmabuf_detail {
+
+    constexpr uint32_t kMagic = 0x46424D44;   // 'DMBF'
+    constexpr uint32_t kMsgFrame = 1;
+    constexpr uint32_t kMsgRelease = 2;
+
+    struct PlaneWire {
+        int32_t  fd_index;                    ///< Index into the SCM_RIGHTS fd array.
+        uint32_t offset;                      ///< Byte offset inside the fd.
+        uint64_t bytes;
+        uint32_t bytes_per_line, width, height, view_width;
+        uint32_t format, pattern, memory_bit, original_bit, role;
+    };
+
+    struct FrameWire {
+        uint32_t magic, type;
+        uint64_t frame_id;
+        uint64_t sequence;
+        int64_t  timestamp_ns;
+        uint32_t camera_id, fourcc, flags, bytes_used;
+        uint32_t num_planes, num_fds;
+        PlaneWire planes[kMaxFramePlanes];
+    };
+
+    struct ReleaseWire {
+        uint32_t magic, type;
+        uint64_t frame_id;
+    };
+
+    inline std::wstring wstr(const std::string& s) { return std::wstring(s.begin(), s.end()); }
+
+    inline bool makeAddr(const std::string& path, sockaddr_un& addr) {
+        addr = sockaddr_un{};
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+        std::memcpy(addr.sun_path, path.c_str(), path.size());
+        return true;
+    }
+
+} // namespace dmabuf_detail
+
+/**
+ * @class CMemfdFramePool
+ * @brief Fixed pool of memfd buffers that stand in for dma-bufs (fd-passable shared memory).
+ *
+ * @ref Wrap copies a frame into a free buffer and returns a pooled view whose @ref CFrameMeta
+ * carries the memfd as plane 0's dma-buf fd. Buffers return to the pool when the view is released.
+ *
+ * @thread_safety @ref Wrap is thread-safe.
+ */
+class CMemfdFramePool {
+public:
+    /**
+     * @param bytes Capacity of one buffer.
+     * @param count Number of buffers.
+     */
+    CMemfdFramePool(std::size_t bytes, uint32_t count) : state_(std::make_shared<State_>()) {
+        state_->bytes = bytes;
+        state_->bufs.resize(count);
+        for (Buffer_& b : state_->bufs) {
+            b.fd = ::memfd_create("csh-frame", MFD_CLOEXEC);
+            if (b.fd < 0 || ::ftruncate(b.fd, static_cast<off_t>(bytes)) != 0) {
+                LOG_WRITE(cshlog::LogLevel::Error, L"memfd pool: memfd_create/ftruncate failed: errno=%d", errno);
+                state_->bufs.clear();
+                return;
+            }
+            void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, b.fd, 0);
+            if (p == MAP_FAILED) {
+                LOG_WRITE(cshlog::LogLevel::Error, L"memfd pool: mmap failed: errno=%d", errno);
+                state_->bufs.clear();
+                return;
+            }
+            b.data = static_cast<uint8_t*>(p);
+        }
+    }
+
+    CMemfdFramePool(const CMemfdFramePool&) = delete;
+    CMemfdFramePool& operator=(const CMemfdFramePool&) = delete;
+
+    /// @return True if every buffer was allocated.
+    bool isOpen() const { return !state_->bufs.empty(); }
+
+    /// @return Capacity of one buffer in bytes.
+    std::size_t bufferBytes() const { return state_->bytes; }
+
+    /**
+     * @brief Copy @p src into a free buffer.
+     * @return false if @p src is empty or too large, or every buffer is in use.
+     */
+    bool Wrap(const csh_img::CSH_Image& src, csh_img::CSH_Image& out) {
+        const auto* p = src.data();
+        if (!p || src.buffer_size == 0 || src.buffer_size > state_->bytes) return false;
+        std::shared_ptr<State_> st = state_;
+        uint32_t idx = 0;
+        {
+            std::lock_guard<std::mutex> lk(st->mtx);
+            while (idx < st->bufs.size() && st->bufs[idx].busy) ++idx;
+            if (idx == st->bufs.size()) return false;
+            st->bufs[idx].busy = true;
+        }
+        Buffer_& b = st->bufs[idx];
+        std::memcpy(b.data, p, src.buffer_size);
+
+        const CFrameMeta* in = GetFrameMeta(src);
+        CFrameMeta meta;
+        if (in) {
+            meta.sequence = in->sequence;
+            meta.timestamp_ns = in->timestamp_ns;
+            meta.dequeue_ns = in->dequeue_ns;
+            meta.flags = in->flags;
+            meta.fourcc = in->fourcc;
+        } else {
+            meta.timestamp_ns = meta.dequeue_ns = GrabberNowNs();
+        }
+        meta.buffer_index = idx;
+        meta.dmabuf_fd = b.fd;
+        meta.bytes_used = static_cast<uint32_t>(src.buffer_size);
+        meta.num_planes = 1;
+        CFramePlaneDesc& d = meta.planes[0];
+        d.data = b.data;
+        d.bytes = src.buffer_size;
+        d.bytes_per_line = src.height ? static_cast<uint32_t>(src.buffer_size / src.height) : 0;
+        d.width = d.view_width = src.width;
+        d.height = src.height;
+        d.format = src.format;
+        d.pattern = src.pattern;
+        d.memory_bit = src.memory_bit;
+        d.original_bit = src.original_bit;
+        d.dmabuf_fd = b.fd;
+
+        out = csh_img::CSH_Image();
+        SetFrameView(out, MakePooledBuffer(b.data, meta, [st, idx] {
+            std::lock_guard<std::mutex> lk(st->mtx);
+            st->bufs[idx].busy = false;
+        }), src.buffer_size, src.width, src.height, src.format, src.pattern, src.memory_bit, src.original_bit);
+        out.camera_id = src.camera_id;
+        return true;
+    }
+
+private:
+    struct Buffer_ {
+        int fd = -1;
+        uint8_t* data = nullptr;
+        bool busy = false;
+    };
+
+    /// Shared with outstanding views so buffers outlive the pool object.
+    struct State_ {
+        std::mutex mtx;
+        std::size_t bytes = 0;
+        std::vector<Buffer_> bufs;
+        ~State_() {
+            for (Buffer_& b : bufs) {
+                if (b.data) ::munmap(b.data, bytes);
+                if (b.fd >= 0) ::close(b.fd);
+            }
+        }
+    };
+
+    std::shared_ptr<State_> state_;
+};
+
+/**
+ * @class CDmabufServer
+ * @brief Publishes frames as dma-buf fds to local clients and tracks their returns.
+ *
+ * @thread_safety @ref Publish may be called from one producer thread; the other public
+ * methods are thread-safe. Client I/O runs on an internal thread.
+ */
+class CDmabufServer {
+public:
+    /// Counters (snapshot).
+    struct Stats {
+        uint32_t clients = 0;      ///< Connected clients.
+        uint64_t sent = 0;         ///< Frame messages sent (all clients).
+        uint64_t released = 0;     ///< Frames returned by clients.
+        uint64_t skipped = 0;      ///< Frames not sent because a client held max_inflight frames or its socket was full.
+        uint64_t copied = 0;       ///< Frames copied into the memfd pool (no dma-buf fd).
+        uint32_t inflight = 0;     ///< Frames currently held by clients.
+    };
+
+    /**
+     * @param socketPath   Filesystem path of the listening socket (replaced if it exists).
+     * @param maxInflight  Frames one client may hold before frames are skipped for it.
+     * @param memfdBuffers Size of the fallback memfd pool (0: only send frames that carry dma-buf fds).
+     */
+    explicit CDmabufServer(std::string socketPath, uint32_t maxInflight = 2, uint32_t memfdBuffers = 4)
+        : path_(std::move(socketPath)), maxInflight_(std::max<uint32_t>(1, maxInflight)), memfdBuffers_(memfdBuffers) {}
+
+    ~CDmabufServer() { Stop(); }
+
+    CDmabufServer(const CDmabufServer&) = delete;
+    CDmabufServer& operator=(const CDmabufServer&) = delete;
+
+    /**
+     * @brief Bind, listen and start the client I/O thread.
+     * @return false if the socket cannot be created or bound.
+     */
+    bool Start() {
+        if (running_) return true;
+        sockaddr_un addr;
+        if (!dmabuf_detail::makeAddr(path_, addr)) return false;
+        listenFd_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        ::unlink(path_.c_str());
+        if (listenFd_ < 0 || ::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listenFd_, 8) != 0) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"dmabuf server %ls: bind/listen failed: errno=%d", dmabuf_detail::wstr(path_).c_str(), errno);
+            closeFd_(listenFd_);
+            return false;
+        }
+        wakeFd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        running_ = true;
+        thread_ = std::thread([this] { loop_(); });
+        return true;
+    }
+
+    /// @brief Disconnect every client (releasing their frames) and remove the socket.
+    void Stop() {
+        if (!running_) return;
+        running_ = false;
+        const uint64_t one = 1;
+        if (::write(wakeFd_, &one, sizeof(one)) < 0) {}
+        if (thread_.joinable()) thread_.join();
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            for (auto& c : clients_) ::close(c.first);
+            clients_.clear();
+        }
+        closeFd_(listenFd_);
+        closeFd_(wakeFd_);
+        ::unlink(path_.c_str());
+    }
+
+    /**
+     * @brief Send @p frame to every client with a free in-flight slot.
+     * @note Frames without dma-buf fds are copied into the memfd pool first (if enabled).
+     */
+    void Publish(const csh_img::CSH_Image& frame) {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (clients_.empty()) return;
+        }
+        csh_img::CSH_Image item = frame;
+        const CFrameMeta* meta = GetFrameMeta(frame);
+        if (!meta || !hasFds_(*meta)) {
+            if (!wrapMemfd_(frame, item)) {
+                skipped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            copied_.fetch_add(1, std::memory_order_relaxed);
+            meta = GetFrameMeta(item);
+        }
+
+        dmabuf_detail::FrameWire w{};
+        std::vector<int> fds;
+        buildWire_(item, *meta, w, fds);
+
+        std::lock_guard<std::mutex> lk(mtx_);
+        w.frame_id = ++nextId_;
+        for (auto it = clients_.begin(); it != clients_.end();) {
+            Client_& c = it->second;
+            if (c.inflight.size() >= maxInflight_) {
+                ++skipped_;
+                ++it;
+                continue;
+            }
+            const int r = sendFrame_(it->first, w, fds);
+            if (r > 0) {
+                c.inflight.emplace(w.frame_id, item);
+                ++sent_;
+            } else if (r == 0) {
+                ++skipped_;  // socket buffer full
+            } else {
+                ::close(it->first);
+                it = clients_.erase(it);
+                continue;
+            }
+            ++it;
+        }
+    }
+
+    /// @return Callback that publishes every frame; register it with any frame source.
+    FrameGrabCallbackProc Input() {
+        return [this](const csh_img::CSH_Image& f) { Publish(f); };
+    }
+
+    /// @return Counters.
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        Stats s;
+        s.clients = static_cast<uint32_t>(clients_.size());
+        s.sent = sent_;
+        s.released = released_;
+        s.skipped = skipped_.load();
+        s.copied = copied_.load();
+        for (const auto& c : clients_) s.inflight += static_cast<uint32_t>(c.second.inflight.size());
+        return s;
+    }
+
+private:
+    struct Client_ {
+        std::map<uint64_t, csh_img::CSH_Image> inflight;  ///< frame_id -> reference pinning the buffer.
+    };
+
+    static void closeFd_(int& fd) {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    static bool hasFds_(const CFrameMeta& m) {
+        if (m.num_planes == 0) return m.dmabuf_fd >= 0;
+        for (uint32_t p = 0; p < m.num_planes; ++p) {
+            if (m.planes[p].dmabuf_fd < 0) return false;
+        }
+        return true;
+    }
+
+    bool wrapMemfd_(const csh_img::CSH_Image& frame, csh_img::CSH_Image& out) {
+        if (!memfdBuffers_) return false;
+        if (!memfd_ || memfd_->bufferBytes() < frame.buffer_size) {
+            memfd_ = std::make_unique<CMemfdFramePool>(frame.buffer_size, memfdBuffers_);
+            if (!memfd_->isOpen()) return false;
+        }
+        return memfd_->Wrap(frame, out);
+    }
+
+    /// Plane layout + unique fd list (a buffer with several planes in one fd sends it once).
+    static void buildWire_(const csh_img::CSH_Image& img, const CFrameMeta& m, dmabuf_detail::FrameWire& w, std::vector<int>& fds) {
+        w.magic = dmabuf_detail::kMagic;
+        w.type = dmabuf_detail::kMsgFrame;
+        w.sequence = m.sequence;
+        w.timestamp_ns = m.timestamp_ns;
+        w.camera_id = img.camera_id;
+        w.fourcc = m.fourcc;
+        w.flags = m.flags;
+        w.bytes_used = m.bytes_used;
+
+        auto fdIndex = [&fds](int fd) {
+            auto it = std::find(fds.begin(), fds.end(), fd);
+            if (it != fds.end()) return static_cast<int32_t>(it - fds.begin());
+            fds.push_back(fd);
+            return static_cast<int32_t>(fds.size() - 1);
+        };
+        if (m.num_planes == 0) { // single view exported as a whole
+            dmabuf_detail::PlaneWire& p = w.planes[0];
+            p.fd_index = fdIndex(m.dmabuf_fd);
+            p.bytes = img.buffer_size;
+            p.bytes_per_line = img.height ? static_cast<uint32_t>(img.buffer_size / img.height) : 0;
+            p.width = p.view_width = img.width;
+            p.height = img.height;
+            p.format = static_cast<uint32_t>(img.format);
+            p.pattern = static_cast<uint32_t>(img.pattern);
+            p.memory_bit = img.memory_bit;
+            p.original_bit = img.original_bit;
+            w.num_planes = 1;
+        } else {
+            w.num_planes = std::min<uint32_t>(m.num_planes, kMaxFramePlanes);
+            for (uint32_t i = 0; i < w.num_planes; ++i) {
+                const CFramePlaneDesc& d = m.planes[i];
+                dmabuf_detail::PlaneWire& p = w.planes[i];
+                p.fd_index = fdIndex(d.dmabuf_fd);
+                p.offset = d.dmabuf_offset;
+                p.bytes = d.bytes;
+                p.bytes_per_line = d.bytes_per_line;
+                p.width = d.width;
+                p.height = d.height;
+                p.view_width = d.view_width;
+                p.format = static_cast<uint32_t>(d.format);
+                p.pattern = static_cast<uint32_t>(d.pattern);
+                p.memory_bit = d.memory_bit;
+                p.original_bit = d.original_bit;
+                p.role = static_cast<uint32_t>(d.role);
+            }
+        }
+        w.num_fds = static_cast<uint32_t>(fds.size());
+    }
+
+    /// @return 1 sent, 0 would block, -1 client gone.
+    static int sendFrame_(int sock, const dmabuf_detail::FrameWire& w, const std::vector<int>& fds) {
+        iovec iov{ const_cast<dmabuf_detail::FrameWire*>(&w), sizeof(w) };
+        alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int) * kMaxFramePlanes)] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctrl;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+        cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        std::memcpy(CMSG_DATA(cm), fds.data(), sizeof(int) * fds.size());
+        ssize_t r;
+        do { r = ::sendmsg(sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL); } while (r < 0 && errno == EINTR);
+        if (r >= 0) return 1;
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    void loop_() {
+        std::vector<pollfd> pfds;
+        while (running_) {
+            pfds.clear();
+            pfds.push_back({ wakeFd_, POLLIN, 0 });
+            pfds.push_back({ listenFd_, POLLIN, 0 });
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                for (const auto& c : clients_) pfds.push_back({ c.first, POLLIN, 0 });
+            }
+            if (::poll(pfds.data(), pfds.size(), 500) <= 0) continue;
+            if (pfds[1].revents & POLLIN) {
+                const int c = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+                if (c >= 0) {
+                    std::lock_guard<std::mutex> lk(mtx_);
+                    clients_[c];
+                }
+            }
+            for (std::size_t i = 2; i < pfds.size(); ++i) {
+                if (pfds[i].revents) serviceClient_(pfds[i].fd);
+            }
+        }
+    }
+
+    /// Drain RELEASE messages; drop the client (and its frames) on hang-up.
+    void serviceClient_(int fd) {
+        for (;;) {
+            dmabuf_detail::ReleaseWire rel{};
+            const ssize_t r = ::recv(fd, &rel, sizeof(rel), MSG_DONTWAIT);
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return;
+            // Declared before the lock: frames are released (buffers re-queued) after unlocking.
+            std::map<uint64_t, csh_img::CSH_Image> dropped;
+            std::map<uint64_t, csh_img::CSH_Image>::node_type returned;
+            std::lock_guard<std::mutex> lk(mtx_);
+            auto it = clients_.find(fd);
+            if (it == clients_.end()) return;
+            if (r <= 0) {
+                dropped.swap(it->second.inflight);
+                clients_.erase(it);
+                ::close(fd);
+                return;
+            }
+            if (r == sizeof(rel) && rel.magic == dmabuf_detail::kMagic && rel.type == dmabuf_detail::kMsgRelease) {
+                returned = it->second.inflight.extract(rel.frame_id);
+                if (returned) ++released_;
+            }
+        }
+    }
+
+    std::string path_;
+    uint32_t maxInflight_;
+    uint32_t memfdBuffers_;
+    std::unique_ptr<CMemfdFramePool> memfd_;   ///< Producer thread only.
+
+    int listenFd_ = -1;
+    int wakeFd_ = -1;
+    std::atomic<bool> running_{ false };
+    std::thread thread_;
+
+    mutable std::mutex mtx_;
+    std::map<int, Client_> clients_;
+    uint64_t nextId_ = 0;
+    uint64_t sent_ = 0;
+    uint64_t released_ = 0;
+    std::atomic<uint64_t> skipped_{ 0 };
+    std::atomic<uint64_t> copied_{ 0 };
+};
+
+/**
+ * @class CDmabufClient
+ * @brief Receives frames from a @ref CDmabufServer as zero-copy views on the passed fds.
+ *
+ * Each frame's @ref CFrameMeta lists the planes with this process's fds (valid while the view
+ * lives) and mapped addresses, so @ref GetFramePlane works as with a local backend.
+ *
+ * @thread_safety @ref Receive from one thread at a time; views may be released on any thread.
+ */
+class CDmabufClient {
+public:
+    /// @param socketPath Path the server listens on.
+    explicit CDmabufClient(const std::string& socketPath) {
+        sockaddr_un addr;
+        if (!dmabuf_detail::makeAddr(socketPath, addr)) return;
+        const int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"dmabuf client: connect(%ls) failed: errno=%d", dmabuf_detail::wstr(socketPath).c_str(), errno);
+            if (fd >= 0) ::close(fd);
+            return;
+        }
+        conn_ = std::make_shared<Conn_>();
+        conn_->fd = fd;
+    }
+
+    CDmabufClient(const CDmabufClient&) = delete;
+    CDmabufClient& operator=(const CDmabufClient&) = delete;
+
+    /// @return True while connected.
+    bool isConnected() const { return conn_ && !conn_->closed.load(); }
+
+    /**
+     * @brief Wait for the next frame and map it.
+     * @param out       Released first (so a receive loop does not pin its previous frame),
+     *                  then receives a view of plane 0.
+     * @param timeoutMs Maximum wait in milliseconds (-1: forever).
+     * @return false on timeout, disconnect or a malformed message.
+     * @note Releasing the last copy of @p out returns the buffer to the server.
+     */
+    bool Receive(csh_img::CSH_Image& out, int timeoutMs) {
+        out = csh_img::CSH_Image();
+        if (!isConnected()) return false;
+        pollfd pfd{ conn_->fd, POLLIN, 0 };
+        if (::poll(&pfd, 1, timeoutMs) <= 0) return false;
+
+        dmabuf_detail::FrameWire w{};
+        alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int) * kMaxFramePlanes)] = {};
+        iovec iov{ &w, sizeof(w) };
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+        ssize_t r;
+        do { r = ::recvmsg(conn_->fd, &msg, MSG_CMSG_CLOEXEC); } while (r < 0 && errno == EINTR);
+        if (r <= 0) {
+            conn_->closed.store(true);
+            return false;
+        }
+
+        auto frame = std::make_shared<Frame_>();
+        frame->conn = conn_;
+        frame->id = w.frame_id;
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+            const std::size_t n = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (std::size_t i = 0; i < n; ++i) {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(cm) + i * sizeof(int), sizeof(int));
+                frame->maps.push_back({ fd, nullptr, 0 });
+            }
+        }
+        if (r != sizeof(w) || w.magic != dmabuf_detail::kMagic || w.type != dmabuf_detail::kMsgFrame ||
+            w.num_planes == 0 || w.num_planes > kMaxFramePlanes || w.num_fds != frame->maps.size()) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"dmabuf client: malformed frame message");
+            return false; // frame dtor closes the fds and returns the id
+        }
+        for (Map_& m : frame->maps) {
+            const off_t size = ::lseek(m.fd, 0, SEEK_END);
+            void* p = size > 0 ? ::mmap(nullptr, static_cast<std::size_t>(size), PROT_READ, MAP_SHARED, m.fd, 0) : MAP_FAILED;
+            if (p == MAP_FAILED) {
+                LOG_WRITE(cshlog::LogLevel::Warn, L"dmabuf client: mmap failed: errno=%d", errno);
+                return false;
+            }
+            m.data = static_cast<uint8_t*>(p);
+            m.bytes = static_cast<std::size_t>(size);
+            dma_buf_sync sync{ DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ };
+            ::ioctl(m.fd, DMA_BUF_IOCTL_SYNC, &sync); // ENOTTY on memfd: fine
+        }
+
+        CFrameMeta meta;
+        meta.sequence = w.sequence;
+        meta.timestamp_ns = w.timestamp_ns;
+        meta.dequeue_ns = GrabberNowNs();
+        meta.flags = w.flags;
+        meta.fourcc = w.fourcc;
+        meta.bytes_used = w.bytes_used;
+        meta.num_planes = w.num_planes;
+        for (uint32_t i = 0; i < w.num_planes; ++i) {
+            const dmabuf_detail::PlaneWire& p = w.planes[i];
+            if (p.fd_index < 0 || static_cast<uint32_t>(p.fd_index) >= frame->maps.size()) return false;
+            const Map_& m = frame->maps[p.fd_index];
+            if (p.offset + p.bytes > m.bytes) return false;
+            CFramePlaneDesc& d = meta.planes[i];
+            d.data = m.data + p.offset;
+            d.bytes = static_cast<std::size_t>(p.bytes);
+            d.bytes_per_line = p.bytes_per_line;
+            d.width = p.width;
+            d.height = p.height;
+            d.view_width = p.view_width;
+            d.format = static_cast<csh_img::En_ImageFormat>(p.format);
+            d.pattern = static_cast<csh_img::En_ImagePattern>(p.pattern);
+            d.memory_bit = p.memory_bit;
+            d.original_bit = p.original_bit;
+            d.role = static_cast<CFramePlaneRole>(p.role);
+            d.dmabuf_fd = m.fd;
+            d.dmabuf_offset = p.offset;
+        }
+        meta.dmabuf_fd = meta.planes[0].dmabuf_fd;
+
+        const CFramePlaneDesc& d0 = meta.planes[0];
+        SetFrameView(out, MakePooledBuffer(d0.data, meta, [frame] {}), d0.bytes, d0.view_width, d0.height,
+            d0.format, d0.pattern, d0.memory_bit, d0.original_bit);
+        out.camera_id = w.camera_id;
+        ++received_;
+        return true;
+    }
+
+    /// @return Frames received.
+    uint64_t received() const { return received_; }
+
+private:
+    struct Conn_ {
+        int fd = -1;
+        std::atomic<bool> closed{ false };
+        std::mutex sendMtx;
+        ~Conn_() {
+            if (fd >= 0) ::close(fd);
+        }
+    };
+
+    struct Map_ {
+        int fd;
+        uint8_t* data;
+        std::size_t bytes;
+    };
+
+    /// One received frame; destruction unmaps, closes the fds and sends RELEASE.
+    struct Frame_ {
+        std::shared_ptr<Conn_> conn;
+        uint64_t id = 0;
+        std::vector<Map_> maps;
+        ~Frame_() {
+            for (Map_& m : maps) {
+                if (m.data) {
+                    dma_buf_sync sync{ DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ };
+                    ::ioctl(m.fd, DMA_BUF_IOCTL_SYNC, &sync);
+                    ::munmap(m.data, m.bytes);
+                }
+                ::close(m.fd);
+            }
+            if (!conn || conn->closed.load()) return;
+            const dmabuf_detail::ReleaseWire rel{ dmabuf_detail::kMagic, dmabuf_detail::kMsgRelease, id };
+            std::lock_guard<std::mutex> lk(conn->sendMtx);
+            ::send(conn->fd, &rel, sizeof(rel), MSG_NOSIGNAL);
+        }
+    };
+
+    std::shared_ptr<Conn_> conn_;
+    uint64_t received_ = 0;
+};
+
+#endif // __linux__
@@ -0,0 +1,465 @@
+#pragma once
+/**
+ * @file CFileReplay.h
+ * @brief Header-only grabber backend that replays CSH_Image TLV recordings (.ish).
+ *
+ * Runs the complete capture pipeline without a camera: recorded frames are delivered
+ * through the regular @ref IFrameGrabImpl callbacks.
+ *
+ * Sources (@ref CGrabberConfig::strVideo):
+ *  - A single .ish file. Files holding several images (image_count > 1) yield one frame
+ *    per image.
+ *  - A directory: every *.ish file in it, in lexicographic order (e.g., frame_000000.ish ...).
+ *
+ * Optional timestamp sidecar (written by CImageSaver):
+ *  - `<file>.ts` next to a single file, or `timestamps.txt` inside a directory.
+ *  - One line per frame: `<timestamp_ns>` or `<sequence> <timestamp_ns>`; `#` starts a comment.
+ *    A file that cannot be loaded is skipped and consumes one line (one frame per file, as
+ *    CImageSaver writes them).
+ *
+ * Pacing (@ref CFileReplay::Pacing):
+ *  - Original:    reproduce recorded inter-frame gaps (falls back to FixedFps without a sidecar).
+ *  - FixedFps:    deliver at @ref CGrabberConfig::fps.
+ *  - Unthrottled: deliver as fast as consumers accept frames (throughput benchmarks, CI).
+ *
+ * Files are read on a prefetch thread into a bounded queue, so delivery timing measures the
+ * pipeline rather than disk latency. @ref prefetchStalls counts frames the delivery thread
+ * had to wait for.
+ *
+ * Delivered frames are pooled views on the loaded image (no copy): shallow copies stay valid,
+ * and @ref GetFrameMeta reports the replay sequence, the recorded (or delivery) timestamp and
+ * the image index inside its file (@ref CFrameMeta::buffer_index).
+ *
+ * @code
+ * auto replay = std::make_unique<CFileReplay>();
+ * replay->setPacing(CFileReplay::Pacing::Unthrottled);
+ * replay->setLoop(true);
+ * CGrabberConfig cfg; cfg.strVideo = "/data/rec01";
+ * grab.SetBackend(std::move(replay));
+ * grab.SetConfig(&cfg);
+ * grab.Connect();
+ * grab.GrabFrames();
+ * @endcode
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IFrameGrabImpl.h"
+#include "CGrabberFrame.h"
+#include "CGrabberStats.h"
+#include "CSH_Log.h"
+
+/**
+ * @class CFileReplay
+ * @brief Replay backend for CSH_Image TLV files and sequences.
+ *
+ * @thread_safety Public methods follow @ref IFrameGrabImpl (serialized by CFrameGrabber).
+ * Pacing/loop/prefetch setters take effect on the next @ref GrabFrames.
+ */
+class CFileReplay : public IFrameGrabImpl, public IGrabberStatsSource {
+public:
+    /// Delivery pacing mode.
+    enum class Pacing : uint32_t {
+        Original = 0,   ///< Recorded timestamps (sidecar); FixedFps if none.
+        FixedFps,       ///< @ref CGrabberConfig::fps.
+        Unthrottled     ///< No sleeping between frames.
+    };
+
+    CFileReplay() = default;
+    ~CFileReplay() override {
+        StopGrabbing();
+        Disconnect();
+    }
+
+    CFileReplay(const CFileReplay&) = delete;
+    CFileReplay& operator=(const CFileReplay&) = delete;
+
+    /**
+     * @brief Report the configured source as the single "device".
+     * @note Name is "<path> (<n> files)"; zero devices if the source has no .ish files.
+     */
+    bool GetConnected(int& outDeviceCount, std::vector<std::string>& outModelNames) override {
+        outModelNames.clear();
+        std::vector<std::filesystem::path> files;
+        std::filesystem::path ts;
+        if (scanSource_(grabberConfig.strVideo, files, ts)) {
+            outModelNames.push_back(grabberConfig.strVideo + " (" + std::to_string(files.size()) + " files)");
+        }
+        outDeviceCount = static_cast<int>(outModelNames.size());
+        return true;
+    }
+
+    /**
+     * @brief Resolve the file list and read the timestamp sidecar (if present).
+     * @return false if the source has no .ish files.
+     */
+    bool Connect() override {
+        if (connected_) return true;
+        files_.clear();
+        timestamps_.clear();
+
+        std::filesystem::path tsPath;
+        if (!scanSource_(grabberConfig.strVideo, files_, tsPath)) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"replay source %ls has no .ish files",
+                wstr_(grabberConfig.strVideo).c_str());
+            return false;
+        }
+        if (!tsPath.empty()) loadTimestamps_(tsPath);
+
+        connected_ = true;
+        LOG_WRITE(cshlog::LogLevel::Info, L"replay %ls: %u files, %u timestamps",
+            wstr_(grabberConfig.strVideo).c_str(), static_cast<unsigned>(files_.size()),
+            static_cast<unsigned>(timestamps_.size()));
+        return true;
+    }
+
+    /// @brief Stop playback and forget the file list. Delivered frames stay valid.
+    void Disconnect() override {
+        StopGrabbing();
+        connected_ = false;
+        files_.clear();
+        timestamps_.clear();
+    }
+
+    /**
+     * @brief Store the configuration (source path in strVideo, fps for FixedFps pacing).
+     * @return false while grabbing or if @p cfg is null.
+     */
+    bool SetConfig(const CGrabberConfig* cfg) override {
+        if (!cfg || running_.load()) return false;
+        grabberConfig = *cfg;
+        if (connected_) {
+            Disconnect();
+            return Connect();
+        }
+        return true;
+    }
+
+    /// @brief Start the prefetch and delivery threads from the first frame.
+    bool GrabFrames() override {
+        if (running_.load()) return true;
+        if (!connected_) return false;
+
+        {
+            std::lock_guard<std::mutex> lk(qMtx_);
+            queue_.clear();
+            loaderDone_ = false;
+        }
+        finished_.store(false);
+        delivered_.store(0);
+        stalls_.store(0);
+        stats_.start(pacing_ == Pacing::Unthrottled ? 0.0 : grabberConfig.fps);
+        running_.store(true);
+        loader_ = std::thread([this] { loaderLoop_(); });
+        player_ = std::thread([this] { playerLoop_(); });
+        return true;
+    }
+
+    /// @brief Stop and join both threads; queued (undelivered) frames are dropped.
+    void StopGrabbing() override {
+        {
+            // Flip the flag under qMtx_ so a thread between its predicate check and the wait
+            // cannot miss the notification.
+            std::lock_guard<std::mutex> lk(qMtx_);
+            if (!running_.exchange(false)) return;
+        }
+        stats_.stop();
+        qCv_.notify_all();
+        if (loader_.joinable()) loader_.join();
+        if (player_.joinable()) player_.join();
+        std::lock_guard<std::mutex> lk(qMtx_);
+        queue_.clear();
+    }
+
+    void RegisterCallbackProcessor(FrameGrabCallbackProc cb) override {
+        std::lock_guard<std::mutex> lk(cbMtx_);
+        cbProc_ = std::move(cb);
+    }
+
+    void RegisterCallbackDisplayer(FrameGrabCallbackDisp cb) override {
+        std::lock_guard<std::mutex> lk(cbMtx_);
+        cbDisp_ = std::move(cb);
+    }
+
+    /// @brief Not applicable to recordings.
+    bool SetSensorRegister(uint32_t, uint32_t) override { return false; }
+    /// @brief Not applicable to recordings.
+    bool GetSensorRegister(uint32_t, uint32_t&) override { return false; }
+
+    // ---------------- Replay options ----------------
+
+    /// Select the pacing mode (default Original).
+    void setPacing(Pacing p) { pacing_ = p; }
+    Pacing pacing() const { return pacing_; }
+
+    /// Restart from the first file at end of stream instead of stopping (default false).
+    void setLoop(bool on) { loop_ = on; }
+    bool loop() const { return loop_; }
+
+    /// Maximum number of frames decoded ahead of delivery (default 8, minimum 1).
+    void setPrefetchDepth(uint32_t n) { prefetchDepth_ = std::max<uint32_t>(1, n); }
+    uint32_t prefetchDepth() const { return prefetchDepth_; }
+
+    // ---------------- Status ----------------
+
+    /// @return Number of source files resolved by @ref Connect.
+    std::size_t fileCount() const { return files_.size(); }
+
+    /// @return True once the last frame was delivered (never with @ref setLoop).
+    bool finished() const { return finished_.load(); }
+
+    /// @return Frames delivered since @ref GrabFrames.
+    uint64_t framesDelivered() const { return delivered_.load(std::memory_order_relaxed); }
+
+    /// @return Frames the delivery thread had to wait for (prefetch queue empty).
+    uint64_t prefetchStalls() const { return stalls_.load(std::memory_order_relaxed); }
+
+    /// @brief Health counters; "queued" is the prefetch queue length, "total" its depth.
+    CGrabberStats& stats() override { return stats_; }
+
+private:
+    /// One frame waiting in the prefetch queue.
+    struct Item_ {
+        std::shared_ptr<csh_img::CSH_Image> file; ///< Loaded file (owns the pixels).
+        uint32_t index = 0;                       ///< Image index inside @ref file.
+        int64_t  timestamp_ns = -1;               ///< Recorded timestamp, -1 if unknown.
+        bool     firstOfPass = false;             ///< First frame after (re)start: rebase pacing.
+    };
+
+    static std::wstring wstr_(const std::string& s) { return std::wstring(s.begin(), s.end()); }
+
+    static bool isIsh_(const std::filesystem::path& p) {
+        std::string ext = p.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return ext == ".ish";
+    }
+
+    static bool scanSource_(const std::string& src, std::vector<std::filesystem::path>& files,
+        std::filesystem::path& tsPath) {
+        namespace fs = std::filesystem;
+        files.clear();
+        tsPath.clear();
+        if (src.empty()) return false;
+
+        std::error_code ec;
+        const fs::path root(src);
+        if (fs::is_directory(root, ec)) {
+            for (const auto& e : fs::directory_iterator(root, ec)) {
+                if (e.is_regular_file(ec) && isIsh_(e.path())) files.push_back(e.path());
+            }
+            std::sort(files.begin(), files.end());
+            if (fs::is_regular_file(root / "timestamps.txt", ec)) tsPath = root / "timestamps.txt";
+        }
+        else if (fs::is_regular_file(root, ec)) {
+            files.push_back(root);
+            fs::path ts = root;
+            ts += ".ts";
+            if (fs::is_regular_file(ts, ec)) tsPath = ts;
+        }
+        return !files.empty();
+    }
+
+    void loadTimestamps_(const std::filesystem::path& p) {
+        std::ifstream in(p);
+        std::string line;
+        while (std::getline(in, line)) {
+            const auto hash = line.find('#');
+            if (hash != std::string::npos) line.erase(hash);
+            std::istringstream ss(line);
+            long long a = 0, b = 0;
+            if (!(ss >> a)) continue;
+            timestamps_.push_back(static_cast<int64_t>((ss >> b) ? b : a));
+        }
+    }
+
+    /// Prefetch thread: load files in order, split into frames, block while the queue is full.
+    void loaderLoop_() {
+        bool firstOfPass = true;
+        do {
+            std::size_t frameNo = 0;    // sidecar line of the next frame
+            bool loaded = false;
+            for (const auto& path : files_) {
+                auto img = std::make_shared<csh_img::CSH_Image>();
+                try {
+                    img->loadImage(path);
+                }
+                catch (const std::exception& e) {
+                    LOG_WRITE(cshlog::LogLevel::Warn, L"replay: skip %ls: %ls",
+                        wstr_(path.string()).c_str(), wstr_(e.what()).c_str());
+                    ++frameNo; // its sidecar line: keep later timestamps on their frames
+                    continue;
+                }
+                if (!img->buffer || img->buffer_size == 0) {
+                    ++frameNo;
+                    continue;
+                }
+                loaded = true;
+
+                for (uint32_t n = 0; n < img->image_count; ++n, ++frameNo) {
+                    Item_ it;
+                    it.file = img;
+                    it.index = n;
+                    it.timestamp_ns = frameNo < timestamps_.size() ? timestamps_[frameNo] : -1;
+                    it.firstOfPass = firstOfPass;
+                    firstOfPass = false;
+
+                    std::unique_lock<std::mutex> lk(qMtx_);
+                    qCv_.wait(lk, [&] { return !running_.load() || queue_.size() < prefetchDepth_; });
+                    if (!running_.load()) return;
+                    queue_.push_back(std::move(it));
+                    qCv_.notify_all();
+                }
+            }
+            firstOfPass = true;
+            if (!loaded) break; // nothing loadable; avoid spinning when looping
+        } while (loop_ && running_.load());
+
+        std::lock_guard<std::mutex> lk(qMtx_);
+        loaderDone_ = true;
+        qCv_.notify_all();
+    }
+
+    /// Delivery thread: pop, pace, publish.
+    void playerLoop_() {
+        using clock = std::chrono::steady_clock;
+        const bool useRecorded = pacing_ == Pacing::Original && !timestamps_.empty();
+        if (pacing_ == Pacing::Original && !useRecorded) {
+            LOG_WRITE(cshlog::LogLevel::Info, L"replay: no timestamps, pacing at %u fps", grabberConfig.fps);
+        }
+        const auto period = std::chrono::nanoseconds(grabberConfig.fps ? 1000000000LL / grabberConfig.fps : 0);
+
+        clock::time_point passStart{};
+        int64_t passFirstTs = 0;
+        uint64_t passFrame = 0;
+        uint64_t seq = 0;
+
+        while (running_.load(std::memory_order_relaxed)) {
+            Item_ it;
+            uint32_t queued = 0;
+            {
+                std::unique_lock<std::mutex> lk(qMtx_);
+                if (queue_.empty() && !loaderDone_) stalls_.fetch_add(1, std::memory_order_relaxed);
+                qCv_.wait(lk, [&] { return !running_.load() || !queue_.empty() || loaderDone_; });
+                if (!running_.load()) return;
+                if (queue_.empty()) break; // end of stream
+                it = std::move(queue_.front());
+                queue_.pop_front();
+                queued = static_cast<uint32_t>(queue_.size());
+                qCv_.notify_all();
+            }
+
+            if (it.firstOfPass) {
+                passStart = clock::now();
+                passFirstTs = it.timestamp_ns;
+                passFrame = 0;
+            }
+            if (pacing_ != Pacing::Unthrottled) {
+                clock::time_point due = passStart + period * passFrame;
+                if (useRecorded && it.timestamp_ns >= 0) {
+                    due = passStart + std::chrono::nanoseconds(it.timestamp_ns - passFirstTs);
+                }
+                std::unique_lock<std::mutex> lk(qMtx_); // interruptible by StopGrabbing
+                if (qCv_.wait_until(lk, due, [&] { return !running_.load(); })) return;
+            }
+            ++passFrame;
+
+            const uint64_t s = seq++;
+            const int64_t dq = GrabberNowNs();
+            csh_img::CSH_Image frame = makeFrame_(it, s, dq);
+            const int64_t cbStart = GrabberNowNs();
+            deliver_(frame);
+            const int64_t done = GrabberNowNs();
+            delivered_.fetch_add(1, std::memory_order_relaxed);
+            stats_.setOccupancy(queued, 0, prefetchDepth_);
+            stats_.onFrame(s, dq, cbStart, done);
+        }
+        if (running_.load()) {
+            finished_.store(true);
+            LOG_WRITE(cshlog::LogLevel::Info, L"replay: end of stream after %llu frames",
+                static_cast<unsigned long long>(delivered_.load()));
+        }
+    }
+
+    /// Zero-copy view of image @p it.index; the view keeps the loaded file alive.
+    static csh_img::CSH_Image makeFrame_(const Item_& it, uint64_t seq, int64_t dequeueNs) {
+        csh_img::CSH_Image& src = *it.file;
+        CFrameMeta meta;
+        meta.sequence = seq;
+        meta.dequeue_ns = dequeueNs;
+        meta.timestamp_ns = it.timestamp_ns >= 0 ? it.timestamp_ns : meta.dequeue_ns;
+        meta.buffer_index = it.index;
+        meta.bytes_used = static_cast<uint32_t>(src.buffer_size);
+
+        csh_img::CSH_Image frame;
+        SetFrameView(frame, MakePooledBuffer(src.getImagePtr(it.index), meta, [keep = it.file] {}),
+            src.buffer_size, src.width, src.height, src.format, src.pattern,
+            src.memory_bit, src.original_bit, src.memory_align);
+        frame.camera_id = src.camera_id;
+        return frame;
+    }
+
+    void deliver_(const csh_img::CSH_Image& frame) {
+        FrameGrabCallbackProc proc;
+        FrameGrabCallbackDisp disp;
+        {
+            std::lock_guard<std::mutex> lk(cbMtx_);
+            proc = cbProc_;
+            disp = cbDisp_;
+        }
+        try {
+            if (proc) proc(frame);
+            if (disp) disp(frame);
+        }
+        catch (const std::exception& e) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"frame callback threw: %ls", wstr_(e.what()).c_str());
+        }
+        catch (...) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"frame callback threw an unknown exception");
+        }
+    }
+
+    // Source
+    bool connected_ = false;
+    std::vector<std::filesystem::path> files_;
+    std::vector<int64_t> timestamps_;
+
+    // Options
+    Pacing   pacing_ = Pacing::Original;
+    bool     loop_ = false;
+    uint32_t prefetchDepth_ = 8;
+
+    // Threads + prefetch queue
+    std::thread loader_;
+    std::thread player_;
+    std::atomic<bool> running_{ false };
+    std::atomic<bool> finished_{ false };
+    std::mutex qMtx_;
+    std::condition_variable qCv_;
+    std::deque<Item_> queue_;
+    bool loaderDone_ = false;
+
+    // Stats
+    std::atomic<uint64_t> delivered_{ 0 };
+    std::atomic<uint64_t> stalls_{ 0 };
+    CGrabberStats stats_;
+
+    // Callbacks
+    std::mutex cbMtx_;
+    FrameGrabCallbackProc cbProc_;
+    FrameGrabCallbackDisp cbDisp_;
+};
@@ -0,0 +1,292 @@
+#pragma once
+/**
+ * @file CFrameFanout.h
+ * @brief Fan-out of grabbed frames to any number of subscribers, each on its own thread.
+ *
+ * Backends call the processor and displayer callbacks synchronously on the grabbing thread,
+ * so a slow consumer (deep copy under a mutex, processing) delays re-queuing the buffer to
+ * the driver. @ref CFrameFanout takes the processor callback slot of a @ref CFrameGrabber
+ * and only *publishes* on the grab thread:
+ *  - Each subscriber owns a bounded queue, a delivery thread and a @ref CFrameFanout::DropPolicy.
+ *  - Pooled (zero-copy) frames are queued as shallow copies; the driver buffer is re-queued
+ *    when the last subscriber releases it.
+ *  - Other frames (backends that reuse one buffer) are deep-copied once per publish and the
+ *    copy is shared by all subscribers.
+ *
+ * @code
+ * CFrameFanout fanout;
+ * fanout.Subscribe("ipm", [&](const csh_img::CSH_Image& f) { ipm0.onNewFrame(f); });
+ * fanout.Subscribe("view", onDisplay, { 1, CFrameFanout::DropPolicy::DropOldest });
+ * fanout.Attach(grab);   // grab.RegisterCallbackProcessor(...) under the hood
+ * grab.GrabFrames();
+ * @endcode
+ *
+ * @note Queued frames pin buffers: with pooled backends keep the sum of queue depths below
+ *       the driver buffer count (or use DropOldest/DropNewest), otherwise capture stalls.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CFrameGrabber.h"
+#include "CGrabberFrame.h"
+#include "CSH_Log.h"
+
+/**
+ * @class CFrameFanout
+ * @brief Bounded per-subscriber queues between the grab thread and consumers.
+ *
+ * @thread_safety All public methods are thread-safe. Subscriber callbacks run on the
+ * subscriber's delivery thread and must not call @ref Unsubscribe for themselves.
+ */
+class CFrameFanout {
+public:
+    /// What to do when a subscriber's queue is full.
+    enum class DropPolicy : uint32_t {
+        DropOldest = 0, ///< Discard the oldest queued frame (lowest latency).
+        DropNewest,     ///< Discard the incoming frame (keep order, skip ahead later).
+        Block           ///< Wait on the publishing thread until there is space (no drops; back-pressure).
+    };
+
+    /// Per-subscriber options.
+    struct Options {
+        uint32_t   queue_depth = 2;                    ///< Maximum queued frames (minimum 1).
+        DropPolicy policy = DropPolicy::DropOldest;    ///< Overflow behavior.
+    };
+
+    /// Per-subscriber counters (snapshot).
+    struct Stats {
+        uint64_t published = 0;   ///< Frames offered to the subscriber.
+        uint64_t delivered = 0;   ///< Frames handed to the callback.
+        uint64_t dropped = 0;     ///< Frames discarded by the drop policy.
+        uint32_t queued = 0;      ///< Current queue length.
+        uint32_t high_water = 0;  ///< Largest queue length observed.
+    };
+
+    /// Subscriber callback (same signature as @ref FrameGrabCallbackProc).
+    using Callback = std::function<void(const csh_img::CSH_Image&)>;
+
+    CFrameFanout() = default;
+    ~CFrameFanout() {
+        Detach();
+        Clear();
+    }
+
+    CFrameFanout(const CFrameFanout&) = delete;
+    CFrameFanout& operator=(const CFrameFanout&) = delete;
+
+    /**
+     * @brief Register as @p grab's processor callback.
+     * @note The displayer callback of @p grab is left untouched.
+     */
+    void Attach(CFrameGrabber& grab) {
+        Detach();
+        grab.RegisterCallbackProcessor(gate_.Wrap([this](const csh_img::CSH_Image& f) { Publish(f); }));
+        std::lock_guard<std::mutex> lk(mtx_);
+        grab_ = &grab;
+    }
+
+    /**
+     * @brief Clear the processor callback of the attached grabber (no-op if not attached).
+     * @note Returns only after a publish already running on the grab thread has finished, so
+     *       the fanout may be destroyed while the grabber keeps running. Do not call it from a
+     *       subscriber callback: a Block publish may be waiting for that subscriber.
+     */
+    void Detach() {
+        CFrameGrabber* g = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            std::swap(g, grab_);
+        }
+        if (g) g->RegisterCallbackProcessor(nullptr);
+        gate_.Close(); // backends call a copy of the callback outside their lock
+    }
+
+    /**
+     * @brief Add a subscriber and start its delivery thread.
+     * @param name Label used in logs.
+     * @param cb   Called on the subscriber's thread for every delivered frame.
+     * @param opt  Queue depth and drop policy.
+     * @return Subscriber id (> 0), or 0 if @p cb is empty.
+     */
+    uint32_t Subscribe(std::string name, Callback cb, Options opt) {
+        if (!cb) return 0;
+        auto s = std::make_shared<Sub_>();
+        s->name = std::move(name);
+        s->cb = std::move(cb);
+        s->opt = opt;
+        s->opt.queue_depth = std::max<uint32_t>(1, opt.queue_depth);
+
+        std::lock_guard<std::mutex> lk(mtx_);
+        s->id = ++nextId_;
+        Sub_* raw = s.get();
+        s->thread = std::thread([raw] { raw->run(); });
+        subs_.push_back(std::move(s));
+        return subs_.back()->id;
+    }
+
+    /// @brief Subscribe with default @ref Options (depth 2, DropOldest).
+    uint32_t Subscribe(std::string name, Callback cb) {
+        return Subscribe(std::move(name), std::move(cb), Options());
+    }
+
+    /**
+     * @brief Stop and remove subscriber @p id; frames still queued for it are dropped.
+     * @return false if @p id is unknown.
+     */
+    bool Unsubscribe(uint32_t id) {
+        std::shared_ptr<Sub_> s;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            auto it = std::find_if(subs_.begin(), subs_.end(), [id](const auto& p) { return p->id == id; });
+            if (it == subs_.end()) return false;
+            s = *it;
+            subs_.erase(it);
+        }
+        s->stop();
+        return true;
+    }
+
+    /// @brief Remove every subscriber.
+    void Clear() {
+        std::vector<std::shared_ptr<Sub_>> all;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            all.swap(subs_);
+        }
+        for (auto& s : all) s->stop();
+    }
+
+    /**
+     * @brief Offer @p frame to every subscriber (called on the grab thread when attached).
+     * @note Usable directly with any frame source (e.g., hub or replay callbacks).
+     */
+    void Publish(const csh_img::CSH_Image& frame) {
+        std::vector<std::shared_ptr<Sub_>> subs;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (subs_.empty()) return;
+            subs = subs_;
+        }
+        const csh_img::CSH_Image item = IsPooledFrame(frame) ? frame : DeepCopyFrame(frame);
+        if (!item.buffer) return;
+        for (auto& s : subs) s->push(item);
+    }
+
+    /// @return Number of subscribers.
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return subs_.size();
+    }
+
+    /**
+     * @brief Counters of subscriber @p id.
+     * @return false if @p id is unknown.
+     */
+    bool GetStats(uint32_t id, Stats& out) const {
+        std::shared_ptr<Sub_> s;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            auto it = std::find_if(subs_.begin(), subs_.end(), [id](const auto& p) { return p->id == id; });
+            if (it == subs_.end()) return false;
+            s = *it;
+        }
+        std::lock_guard<std::mutex> lk(s->mtx);
+        out = s->stats;
+        out.queued = static_cast<uint32_t>(s->queue.size());
+        return true;
+    }
+
+private:
+    struct Sub_ {
+        uint32_t id = 0;
+        std::string name;
+        Callback cb;
+        Options opt;
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<csh_img::CSH_Image> queue;
+        Stats stats;
+        bool stopping = false;
+        std::thread thread;
+
+        void push(const csh_img::CSH_Image& f) {
+            std::unique_lock<std::mutex> lk(mtx);
+            if (stopping) return;
+            ++stats.published;
+            if (queue.size() >= opt.queue_depth) {
+                switch (opt.policy) {
+                case DropPolicy::DropOldest:
+                    queue.pop_front();
+                    ++stats.dropped;
+                    break;
+                case DropPolicy::DropNewest:
+                    ++stats.dropped;
+                    return;
+                case DropPolicy::Block:
+                    cv.wait(lk, [&] { return stopping || queue.size() < opt.queue_depth; });
+                    if (stopping) return;
+                    break;
+                }
+            }
+            queue.push_back(f);
+            stats.high_water = std::max(stats.high_water, static_cast<uint32_t>(queue.size()));
+            cv.notify_all();
+        }
+
+        void run() {
+            for (;;) {
+                csh_img::CSH_Image f;
+                {
+                    std::unique_lock<std::mutex> lk(mtx);
+                    cv.wait(lk, [&] { return stopping || !queue.empty(); });
+                    if (stopping) return;
+                    f = std::move(queue.front());
+                    queue.pop_front();
+                    ++stats.delivered;
+                    cv.notify_all(); // wake a blocked publisher
+                }
+                try {
+                    cb(f);
+                }
+                catch (const std::exception& e) {
+                    LOG_WRITE(cshlog::LogLevel::Error, L"subscriber %ls threw: %ls",
+                        wstr_(name).c_str(), wstr_(e.what()).c_str());
+                }
+                catch (...) {
+                    LOG_WRITE(cshlog::LogLevel::Error, L"subscriber %ls threw an unknown exception",
+                        wstr_(name).c_str());
+                }
+            }
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lk(mtx);
+                stopping = true;
+                queue.clear();
+                cv.notify_all();
+            }
+            if (thread.joinable()) thread.join();
+        }
+    };
+
+    static std::wstring wstr_(const std::string& s) { return std::wstring(s.begin(), s.end()); }
+
+    mutable std::mutex mtx_;
+    std::vector<std::shared_ptr<Sub_>> subs_;
+    uint32_t nextId_ = 0;
+    CFrameGrabber* grab_ = nullptr;
+    GrabberCallbackGate gate_;
+};
@@ -4,6 +4,8 @@
 #include <string>
 #include <mutex>
 #include "IFrameGrabImpl.h"
+#include "CGrabberStats.h"
+#include "CSensorRegisters.h"
 
 // ---------------- Export macro ----------------
 #pragma once
@@ -54,6 +56,26 @@ public:
      */
     bool SetBackend(En_GrabberBackend be);
 
+    /**
+     * @brief Adopt an externally constructed backend (e.g., header-only @ref CV4L2Stream).
+     * @param[in] impl Backend instance; ownership is transferred to the façade.
+     * @return true if @p impl is non-null.
+     * @post Any previous backend instance is destroyed; connection/grab flags are reset.
+     */
+    bool SetBackend(std::unique_ptr<IFrameGrabImpl> impl) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        impl_ = std::move(impl);
+        isConnecting_ = false;
+        isGrabbing_ = false;
+        return impl_ != nullptr;
+    }
+
+    /**
+     * @brief Non-owning access to the active backend (nullptr if none).
+     * @note Use for backend-specific extensions; do not destroy or re-enter the façade from it.
+     */
+    IFrameGrabImpl* backend() const { return impl_.get(); }
+
     /**
      * @brief Probe for devices through the selected backend.
      * @param[out] outDeviceCount Number of devices found.
@@ -114,17 +136,73 @@ public:
     /**
      * @brief Write a sensor register via backend (if supported).
      * @return true on success, false if unsupported or failure.
-     * @note Current CUVC and CV4L2 return false (not implemented).
+     * @note Built-in CUVC and CV4L2 return false (not implemented); backends implementing
+     *       @ref ISensorRegisterSource write through their shadow cache.
      */
     bool SetSensorRegister(uint32_t address, uint32_t value);
 
     /**
      * @brief Read a sensor register via backend (if supported).
      * @return true on success, false if unsupported or failure.
-     * @note Current CUVC and CV4L2 return false (not implemented).
+     * @note Built-in CUVC and CV4L2 return false (not implemented); backends implementing
+     *       @ref ISensorRegisterSource read from their shadow cache.
      */
     bool GetSensorRegister(uint32_t address, uint32_t& outValue);
 
+    /**
+     * @brief Write a register group through the backend's shadow cache (see CSensorRegisters.h).
+     * @param regs            Registers in write order; values already in the shadow are skipped.
+     * @param atFrameBoundary true: stage the group; the backend applies it as one batch after
+     *                        the next dequeued frame (immediately when not grabbing).
+     *                        false: write now.
+     * @return false if the backend has no register cache (@ref ISensorRegisterSource) or
+     *         transport, or an immediate write failed.
+     * @note Takes the façade mutex (safe from an AE thread while grabbing); do not call it from
+     *       a frame callback.
+     */
+    bool SetSensorRegisters(const std::vector<CSensorRegWrite>& regs, bool atFrameBoundary = true) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto* src = dynamic_cast<ISensorRegisterSource*>(impl_.get());
+        if (!src || !src->registers().hasIO()) return false;
+        if (!atFrameBoundary) return src->registers().WriteBatch(regs);
+        src->registers().Stage(regs);
+        return isGrabbing_ ? true : src->registers().CommitPending();
+    }
+
+    /**
+     * @brief Snapshot of capture health counters.
+     * @param[out] out Counters (dropped frames, latency, callback time, occupancy, fps).
+     * @return false if no backend is set or it does not publish stats (@ref IGrabberStatsSource).
+     * @note Takes the façade mutex only to reach the backend (the counters themselves are
+     *       lock-free); safe to poll from any thread while grabbing, not from a frame callback.
+     */
+    bool GetStats(CGrabberStatsSnapshot& out) const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto* src = dynamic_cast<IGrabberStatsSource*>(impl_.get());
+        if (!src) return false;
+        out = src->stats().snapshot();
+        return true;
+    }
+
+    /**
+     * @brief Log through CSH_Log when delivery stalls for @p intervals frame intervals.
+     * @param intervals Threshold in frame intervals; 0 disables the watchdog.
+     * @return false if the backend does not publish stats.
+     */
+    bool SetStallWatchdog(uint32_t intervals) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto* src = dynamic_cast<IGrabberStatsSource*>(impl_.get());
+        if (!src) return false;
+        if (intervals == 0) {
+            src->stats().disableWatchdog();
+            return true;
+        }
+        const CGrabberConfig& cfg = impl_->Config();
+        src->stats().enableWatchdog(intervals,
+            !cfg.strGrabberName.empty() ? cfg.strGrabberName : !cfg.strVideo.empty() ? cfg.strVideo : "grabber");
+        return true;
+    }
+
     /// Last probed device count (cached from GetConnected()).
     int  deviceCount() const { return deviceCount_; }
 
@@ -150,5 +228,5 @@ private:
     bool isGrabbing_ = false;
 
     // Serialize public API; backends have their own internal sync.
-    std::mutex mtx_;
+    mutable std::mutex mtx_;
 };
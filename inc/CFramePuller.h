@@ -0,0 +1,182 @@
+#pragma once
+/**
+ * @file CFramePuller.h
+ * @brief Pull-style frame access: wait for the next frame, peek the latest, or get a future.
+ *
+ * Backends push frames through callbacks on their grab thread. Synchronous tools and control
+ * loops (AE, calibration, single-shot capture) would rather ask for a frame. @ref CFramePuller
+ * takes the processor callback of a @ref CFrameGrabber (or any callback slot, see
+ * @ref CFramePuller::Input) and keeps the latest frame:
+ *  - @ref CFramePuller::WaitNextFrame blocks until a frame newer than the last one taken
+ *    arrives, or the timeout expires.
+ *  - @ref CFramePuller::TryGetLatest returns the latest frame without blocking.
+ *  - @ref CFramePuller::NextFrameAsync returns a std::future fulfilled by the next frame.
+ *
+ * Frames are returned as @ref CFrameHandle (shared, immutable). Pooled (zero-copy) frames are
+ * held shallowly; frames from backends that reuse one buffer are copied once on arrival.
+ *
+ * @code
+ * CFramePuller puller;
+ * puller.Attach(grab);
+ * grab.GrabFrames();
+ * for (;;) {
+ *     CFrameHandle f = puller.WaitNextFrame(std::chrono::milliseconds(100));
+ *     if (!f) continue;               // timeout
+ *     ae.update(*f);                  // on this thread, not the grab thread
+ * }
+ * @endcode
+ *
+ * @note The latest frame pins one driver buffer of pooled backends until a newer frame
+ *       replaces it or @ref CFramePuller::Clear is called.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "CFrameGrabber.h"
+#include "CGrabberFrame.h"
+
+/// Ref-counted, immutable frame; nullptr means "no frame" (timeout, cancelled, cleared).
+using CFrameHandle = std::shared_ptr<const csh_img::CSH_Image>;
+
+/**
+ * @class CFramePuller
+ * @brief Latest-frame slot with blocking, polling and future-based readers.
+ *
+ * @thread_safety All public methods are thread-safe. "Newer than the last one taken" is
+ * tracked per puller: use one puller per consumer thread when several threads wait.
+ */
+class CFramePuller {
+public:
+    CFramePuller() = default;
+    ~CFramePuller() {
+        Detach();
+        Cancel();
+    }
+
+    CFramePuller(const CFramePuller&) = delete;
+    CFramePuller& operator=(const CFramePuller&) = delete;
+
+    /**
+     * @brief Register as @p grab's processor callback.
+     * @note The displayer callback of @p grab is left untouched.
+     */
+    void Attach(CFrameGrabber& grab) {
+        Detach();
+        grab.RegisterCallbackProcessor(gate_.Wrap(Input()));
+        std::lock_guard<std::mutex> lk(mtx_);
+        grab_ = &grab;
+    }
+
+    /**
+     * @brief Clear the processor callback of the attached grabber (no-op if not attached).
+     * @note Returns only after a push already running on the grab thread has finished, so the
+     *       puller may be destroyed while the grabber keeps running.
+     */
+    void Detach() {
+        CFrameGrabber* g = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            std::swap(g, grab_);
+        }
+        if (g) g->RegisterCallbackProcessor(nullptr);
+        gate_.Close(); // backends call a copy of the callback outside their lock
+    }
+
+    /// @return Callback that feeds this puller; register it with any frame source.
+    FrameGrabCallbackProc Input() {
+        return [this](const csh_img::CSH_Image& f) { Push(f); };
+    }
+
+    /**
+     * @brief Offer a frame (called on the producer's thread).
+     * @note Wakes @ref WaitNextFrame and fulfills every pending @ref NextFrameAsync.
+     */
+    void Push(const csh_img::CSH_Image& frame) {
+        CFrameHandle h = std::make_shared<const csh_img::CSH_Image>(IsPooledFrame(frame) ? frame : DeepCopyFrame(frame));
+        if (!h->buffer) return;
+
+        std::vector<std::promise<CFrameHandle>> waiters;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            latest_ = h;
+            ++published_;
+            waiters.swap(promises_);
+        }
+        cv_.notify_all();
+        for (auto& p : waiters) p.set_value(h);
+    }
+
+    /**
+     * @brief Block until a frame newer than the last one taken arrives.
+     * @param timeout Maximum wait.
+     * @return The frame, or nullptr on timeout. Returns immediately if a newer frame is
+     *         already waiting (frames in between are skipped: latest wins).
+     */
+    template <typename Rep, typename Period>
+    CFrameHandle WaitNextFrame(std::chrono::duration<Rep, Period> timeout) {
+        std::unique_lock<std::mutex> lk(mtx_);
+        if (!cv_.wait_for(lk, timeout, [&] { return published_ > taken_ && latest_; })) return nullptr;
+        taken_ = published_;
+        return latest_;
+    }
+
+    /**
+     * @brief Latest frame without blocking (marks it as taken).
+     * @return nullptr if no frame has arrived yet.
+     */
+    CFrameHandle TryGetLatest() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        taken_ = published_;
+        return latest_;
+    }
+
+    /**
+     * @brief Future fulfilled by the next frame pushed after this call.
+     * @note Fulfilled with nullptr by @ref Cancel (and on destruction).
+     */
+    std::future<CFrameHandle> NextFrameAsync() {
+        std::promise<CFrameHandle> p;
+        std::future<CFrameHandle> f = p.get_future();
+        std::lock_guard<std::mutex> lk(mtx_);
+        promises_.push_back(std::move(p));
+        return f;
+    }
+
+    /// @brief Fulfill every pending @ref NextFrameAsync future with nullptr.
+    void Cancel() {
+        std::vector<std::promise<CFrameHandle>> waiters;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            waiters.swap(promises_);
+        }
+        for (auto& p : waiters) p.set_value(nullptr);
+    }
+
+    /// @brief Release the latest frame (unpins its buffer).
+    void Clear() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        latest_.reset();
+    }
+
+    /// @return Frames pushed since construction.
+    uint64_t frameCount() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return published_;
+    }
+
+private:
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    CFrameHandle latest_;
+    uint64_t published_ = 0;    ///< Frames pushed.
+    uint64_t taken_ = 0;        ///< Value of published_ when a frame was last taken.
+    std::vector<std::promise<CFrameHandle>> promises_;
+    CFrameGrabber* grab_ = nullptr;
+    GrabberCallbackGate gate_;
+};
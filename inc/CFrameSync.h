@@ -0,0 +1,256 @@
+#pragma once
+/**
+ * @file CFrameSync.h
+ * @brief Synchronized capture groups: match frames of several grabbers by capture timestamp.
+ *
+ * Stereo and surround rigs need one set of frames taken at (nearly) the same instant.
+ * @ref CFrameSyncGroup collects frames from N inputs (one per grabber), matches them within a
+ * tolerance and emits a single @ref CFrameBundle to one callback:
+ *  - Timestamps come from @ref GetFrameMeta (driver capture time on the steady clock); frames
+ *    without metadata use their arrival time.
+ *  - Each input keeps a short queue. Whenever every input has a frame, heads older than the
+ *    newest head minus the tolerance can never match and are dropped (counted per input).
+ *  - Pooled frames are held shallowly; frames from backends that reuse one buffer are copied.
+ *
+ * @code
+ * CFrameSyncGroup sync(2, 2'000'000);           // 2 inputs, +-2 ms
+ * sync.SetCallback([&](const CFrameBundle& b) { stereo.process(b.frames[0], b.frames[1]); });
+ * sync.Attach(0, grabLeft);
+ * sync.Attach(1, grabRight);
+ * @endcode
+ *
+ * @note The bundle callback runs on the grab thread that completed the match, serialized
+ *       across inputs; keep it short (or publish into a @ref CFrameFanout).
+ * @note Per-input timestamps must be monotonic and on a common clock (CLOCK_MONOTONIC for V4L2).
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CFrameGrabber.h"
+#include "CGrabberFrame.h"
+#include "CSH_Log.h"
+
+/**
+ * @brief One matched set of frames (index i = input i).
+ */
+struct CFrameBundle {
+    std::vector<csh_img::CSH_Image> frames; ///< One frame per input (shallow; retain freely).
+    std::vector<int64_t> timestamps_ns;     ///< Capture timestamp used for matching, per input.
+    int64_t  timestamp_ns = 0;              ///< Earliest timestamp in the bundle.
+    int64_t  skew_ns = 0;                   ///< Latest minus earliest timestamp.
+    uint64_t index = 0;                     ///< Bundle counter since construction / @ref CFrameSyncGroup::Reset.
+};
+
+/**
+ * @class CFrameSyncGroup
+ * @brief Timestamp matcher over N frame inputs.
+ *
+ * @thread_safety Inputs may be fed concurrently from different grab threads.
+ */
+class CFrameSyncGroup {
+public:
+    /// Bundle callback.
+    using Callback = std::function<void(const CFrameBundle&)>;
+
+    /// Counters (snapshot).
+    struct Stats {
+        uint64_t bundles = 0;                ///< Bundles emitted.
+        std::vector<uint64_t> received;      ///< Frames received per input.
+        std::vector<uint64_t> dropped;       ///< Unmatched frames dropped per input.
+        int64_t  max_skew_ns = 0;            ///< Largest skew among emitted bundles.
+    };
+
+    /**
+     * @param inputs      Number of inputs (cameras), at least 2.
+     * @param toleranceNs Maximum timestamp spread within a bundle.
+     * @param queueDepth  Frames kept per input while waiting for partners (minimum 1).
+     */
+    explicit CFrameSyncGroup(uint32_t inputs, int64_t toleranceNs = 1000000, uint32_t queueDepth = 4)
+        : tolerance_(std::max<int64_t>(0, toleranceNs)),
+          depth_(std::max<uint32_t>(1, queueDepth)),
+          queues_(std::max<uint32_t>(2, inputs)),
+          received_(queues_.size(), 0),
+          dropped_(queues_.size(), 0) {}
+
+    ~CFrameSyncGroup() { DetachAll(); }
+
+    CFrameSyncGroup(const CFrameSyncGroup&) = delete;
+    CFrameSyncGroup& operator=(const CFrameSyncGroup&) = delete;
+
+    /// @brief Set the bundle callback (empty to clear).
+    void SetCallback(Callback cb) {
+        std::lock_guard<std::mutex> lk(emitMtx_);
+        cb_ = std::move(cb);
+    }
+
+    /// @brief Change the matching tolerance (applies to the next match).
+    void SetTolerance(int64_t toleranceNs) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        tolerance_ = std::max<int64_t>(0, toleranceNs);
+    }
+
+    /**
+     * @brief Callback that feeds input @p idx; register it with any frame source.
+     * @return Empty function if @p idx is out of range.
+     */
+    FrameGrabCallbackProc Input(uint32_t idx) {
+        if (idx >= queues_.size()) return {};
+        return [this, idx](const csh_img::CSH_Image& f) { Push(idx, f); };
+    }
+
+    /**
+     * @brief Feed input @p idx from @p grab's processor callback.
+     * @return false if @p idx is out of range.
+     */
+    bool Attach(uint32_t idx, CFrameGrabber& grab) {
+        if (idx >= queues_.size()) return false;
+        grab.RegisterCallbackProcessor(gate_.Wrap(Input(idx)));
+        std::lock_guard<std::mutex> lk(mtx_);
+        attached_.push_back(&grab);
+        return true;
+    }
+
+    /**
+     * @brief Clear the processor callbacks registered by @ref Attach.
+     * @note Returns only after pushes already running on the grab threads (and the bundle
+     *       callbacks they emit) have finished. Do not call it from the bundle callback.
+     */
+    void DetachAll() {
+        std::vector<CFrameGrabber*> all;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            all.swap(attached_);
+        }
+        for (CFrameGrabber* g : all) g->RegisterCallbackProcessor(nullptr);
+        gate_.Close(); // backends call a copy of the callback outside their lock
+    }
+
+    /**
+     * @brief Offer a frame of input @p idx; emits a bundle if this completes a match.
+     */
+    void Push(uint32_t idx, const csh_img::CSH_Image& frame) {
+        if (idx >= queues_.size()) return;
+        const CFrameMeta* meta = GetFrameMeta(frame);
+        Entry_ e{ meta ? frame : DeepCopyFrame(frame), meta ? meta->timestamp_ns : GrabberNowNs() };
+        if (!e.frame.buffer) return;
+
+        std::unique_lock<std::mutex> lk(mtx_);
+        auto& q = queues_[idx];
+        ++received_[idx];
+        q.push_back(std::move(e));
+        if (q.size() > depth_) {
+            q.pop_front();
+            ++dropped_[idx];
+        }
+
+        CFrameBundle bundle;
+        if (!match_(bundle)) return;
+
+        // Keep emission order: take the emit lock before releasing the queues.
+        std::unique_lock<std::mutex> elk(emitMtx_);
+        lk.unlock();
+        if (!cb_) return;
+        try {
+            cb_(bundle);
+        }
+        catch (const std::exception& ex) {
+            const std::string w = ex.what();
+            LOG_WRITE(cshlog::LogLevel::Error, L"sync bundle callback threw: %ls", std::wstring(w.begin(), w.end()).c_str());
+        }
+        catch (...) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"sync bundle callback threw an unknown exception");
+        }
+    }
+
+    /// @brief Drop every queued frame and reset the counters.
+    void Reset() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (auto& q : queues_) q.clear();
+        std::fill(received_.begin(), received_.end(), 0);
+        std::fill(dropped_.begin(), dropped_.end(), 0);
+        bundles_ = 0;
+        maxSkew_ = 0;
+    }
+
+    /// @return Counters.
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        Stats s;
+        s.bundles = bundles_;
+        s.received = received_;
+        s.dropped = dropped_;
+        s.max_skew_ns = maxSkew_;
+        return s;
+    }
+
+    /// @return Number of inputs.
+    uint32_t inputCount() const { return static_cast<uint32_t>(queues_.size()); }
+
+private:
+    struct Entry_ {
+        csh_img::CSH_Image frame;
+        int64_t ts = 0;
+    };
+
+    /// Drop heads that can no longer match; fill @p out if all heads agree. Caller holds mtx_.
+    bool match_(CFrameBundle& out) {
+        for (;;) {
+            int64_t newest = std::numeric_limits<int64_t>::min();
+            for (const auto& q : queues_) {
+                if (q.empty()) return false;
+                newest = std::max(newest, q.front().ts);
+            }
+
+            bool droppedAny = false;
+            for (std::size_t i = 0; i < queues_.size(); ++i) {
+                auto& q = queues_[i];
+                while (!q.empty() && q.front().ts < newest - tolerance_) {
+                    q.pop_front();
+                    ++dropped_[i];
+                    droppedAny = true;
+                }
+            }
+            if (droppedAny) continue; // re-evaluate with the new heads (or wait for more)
+
+            int64_t oldest = newest;
+            for (const auto& q : queues_) oldest = std::min(oldest, q.front().ts);
+
+            out.frames.clear();
+            out.timestamps_ns.clear();
+            out.frames.reserve(queues_.size());
+            out.timestamps_ns.reserve(queues_.size());
+            for (auto& q : queues_) {
+                out.frames.push_back(std::move(q.front().frame));
+                out.timestamps_ns.push_back(q.front().ts);
+                q.pop_front();
+            }
+            out.timestamp_ns = oldest;
+            out.skew_ns = newest - oldest;
+            out.index = bundles_++;
+            maxSkew_ = std::max(maxSkew_, out.skew_ns);
+            return true;
+        }
+    }
+
+    mutable std::mutex mtx_;        ///< Queues and counters.
+    std::mutex emitMtx_;            ///< Serializes the bundle callback.
+    Callback cb_;
+
+    int64_t tolerance_;
+    uint32_t depth_;
+    std::vector<std::deque<Entry_>> queues_;
+    std::vector<uint64_t> received_;
+    std::vector<uint64_t> dropped_;
+    uint64_t bundles_ = 0;
+    int64_t maxSkew_ = 0;
+    std::vector<CFrameGrabber*> attached_;
+    GrabberCallbackGate gate_;
+};
@@ -23,12 +23,15 @@ struct CGrabberConfig {
      * pick the closest supported format.
      */
     enum class PixelFormat : uint32_t {
-        UNKNOWN = 0,  ///< Unspecified; backend chooses default.
+        UNKNOWN = 0,  ///< Unspecified; backend chooses (CV4L2Stream: lowest-bandwidth mode reaching width/height/fps).
         GRAY8,        ///< 8-bit grayscale (Y only).
         RGB24,        ///< Interleaved RGB888 (R,G,B order).
         BGR24,        ///< Interleaved BGR888 (B,G,R order).
         YUYV422,      ///< Packed YUV 4:2:2 as Y0 U Y1 V ...
-        UYVY422       ///< Packed YUV 4:2:2 as U Y0 V Y1 ...
+        UYVY422,      ///< Packed YUV 4:2:2 as U Y0 V Y1 ...
+        NV12,         ///< Semi-planar YUV 4:2:0 (Y plane + interleaved CbCr plane).
+        NV16,         ///< Semi-planar YUV 4:2:2 (Y plane + interleaved CbCr plane).
+        YUV420        ///< Fully planar YUV 4:2:0 (Y, Cb, Cr planes).
     };
 
     /**
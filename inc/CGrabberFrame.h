@@ -0,0 +1,281 @@
+#pragma once
+/**
+ * @file CGrabberFrame.h
+ * @brief Per-frame capture metadata and pooled (zero-copy) frame views for grabber backends.
+ *
+ * Streaming backends hand out @ref csh_img::CSH_Image objects whose `buffer` points straight
+ * into driver memory. The buffer's shared_ptr carries a @ref CFrameReleaser deleter that
+ * holds the capture metadata and returns the driver buffer to its pool when the last
+ * reference (including shallow copies) is released.
+ *
+ * - No layout change to @ref csh_img::CSH_Image: metadata travels in the shared_ptr control block.
+ * - Consumers query metadata with @ref GetFrameMeta; deep copies do not carry it.
+ * - Plane views created with the shared_ptr aliasing constructor share the same release token.
+ * - Multi-planar frames (NV12, YUV420, packed raw + embedded data, ...) describe every plane
+ *   in @ref CFrameMeta::planes; the callback image is plane 0 and @ref GetFramePlane returns
+ *   zero-copy views of the others.
+ */
+
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "CSH_Image.h"
+
+/// Maximum number of planes described per frame.
+inline constexpr uint32_t kMaxFramePlanes = 4;
+
+/**
+ * @brief Semantic role of a frame plane.
+ */
+enum class CFramePlaneRole : uint32_t {
+    Pixels = 0,     ///< Packed/interleaved pixel data (single-plane formats, packed raw).
+    Luma,           ///< Y plane of a planar/semi-planar YUV format.
+    Chroma,         ///< Interleaved CbCr / CrCb plane (NV12/NV21/NV16/NV61).
+    ChromaU,        ///< Cb plane of a fully planar YUV format.
+    ChromaV,        ///< Cr plane of a fully planar YUV format.
+    EmbeddedData    ///< Sensor embedded data / statistics carried next to the image.
+};
+
+/**
+ * @brief Zero-copy description of one plane of a pooled frame.
+ *
+ * @ref view_width is the width of the CSH_Image view returned by @ref GetFramePlane.
+ * It equals @ref width unless the driver pads rows, in which case the view spans the
+ * full stride and callers crop to @ref width.
+ */
+struct CFramePlaneDesc {
+    csh_img::CSH_Image::byte* data = nullptr;   ///< First byte of the plane (driver memory).
+    std::size_t bytes = 0;                      ///< Plane size in bytes (bytes_per_line * height).
+    uint32_t bytes_per_line = 0;                ///< Row stride in bytes.
+    uint32_t width = 0;                         ///< Visible width in pixels (samples for chroma).
+    uint32_t height = 0;                        ///< Rows.
+    uint32_t view_width = 0;                    ///< Width of the CSH_Image view (stride-wide if padded).
+    csh_img::En_ImageFormat format = csh_img::En_ImageFormat::Gray8; ///< Container format of the view.
+    csh_img::En_ImagePattern pattern = csh_img::En_ImagePattern::RGGB; ///< CFA / component order.
+    uint32_t memory_bit = 8;                    ///< Bits per sample in memory (10/12 for CSI-2 packed raw).
+    uint32_t original_bit = 8;                  ///< Significant bits per sample.
+    CFramePlaneRole role = CFramePlaneRole::Pixels; ///< What the plane carries.
+    int dmabuf_fd = -1;                         ///< dma-buf fd holding the plane, -1 if not exported.
+    uint32_t dmabuf_offset = 0;                 ///< Byte offset of the plane inside @ref dmabuf_fd.
+};
+
+/**
+ * @brief Capture metadata attached to a pooled frame.
+ * @note Timestamps are on the steady (CLOCK_MONOTONIC) clock in nanoseconds.
+ */
+struct CFrameMeta {
+    uint64_t sequence = 0;      ///< Driver sequence number (V4L2 `sequence`) or backend counter.
+    int64_t  timestamp_ns = 0;  ///< Capture timestamp (driver time when available).
+    int64_t  dequeue_ns = 0;    ///< Time the backend dequeued the buffer.
+    uint32_t buffer_index = 0;  ///< Driver buffer index inside the pool.
+    int      dmabuf_fd = -1;    ///< Exported dma-buf fd (first plane), -1 if not exported.
+    uint32_t flags = 0;         ///< Backend-specific flags (e.g., V4L2_BUF_FLAG_*).
+    uint32_t bytes_used = 0;    ///< Payload bytes reported by the driver (first plane).
+    uint32_t fourcc = 0;        ///< Driver pixel format code (0 if not applicable).
+    uint32_t num_planes = 0;    ///< Valid entries in @ref planes (0 for single-view frames).
+    std::array<CFramePlaneDesc, kMaxFramePlanes> planes{}; ///< Plane layout; planes[0] is the callback image.
+};
+
+/**
+ * @brief shared_ptr deleter that owns frame metadata and recycles the underlying buffer.
+ *
+ * The pointer passed to operator() is never freed here; @ref recycle decides what to do
+ * (re-queue to the driver, return to a free list, or nothing for foreign memory).
+ */
+struct CFrameReleaser {
+    CFrameMeta meta{};                 ///< Metadata published with the frame.
+    std::function<void()> recycle;     ///< Invoked once when the last reference drops.
+
+    void operator()(csh_img::CSH_Image::byte*) const {
+        if (recycle) recycle();
+    }
+};
+
+/**
+ * @brief Steady-clock "now" in nanoseconds (same time base as @ref CFrameMeta).
+ */
+inline int64_t GrabberNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Return the capture metadata of a pooled frame.
+ * @param img Image delivered by a streaming backend (or any shallow copy of it).
+ * @return Pointer to metadata owned by the buffer's control block, or nullptr if
+ *         @p img does not reference a pooled buffer.
+ * @note The pointer stays valid as long as any reference to the buffer is alive.
+ */
+inline const CFrameMeta* GetFrameMeta(const csh_img::CSH_Image& img) {
+    if (!img.buffer) return nullptr;
+    const auto* rel = std::get_deleter<CFrameReleaser>(img.buffer);
+    return rel ? &rel->meta : nullptr;
+}
+
+/**
+ * @brief True when @p img references a pooled buffer that is safe to retain shallowly.
+ */
+inline bool IsPooledFrame(const csh_img::CSH_Image& img) {
+    return GetFrameMeta(img) != nullptr;
+}
+
+/**
+ * @brief Wrap foreign memory as a pooled buffer pointer.
+ * @param data    First byte of the frame (not owned).
+ * @param meta    Metadata to publish with the frame.
+ * @param recycle Called once when the last reference is released.
+ * @return Buffer pointer suitable for @ref csh_img::CSH_Image::buffer.
+ */
+inline std::shared_ptr<csh_img::CSH_Image::byte[]> MakePooledBuffer(
+    csh_img::CSH_Image::byte* data, const CFrameMeta& meta, std::function<void()> recycle) {
+    return std::shared_ptr<csh_img::CSH_Image::byte[]>(data, CFrameReleaser{ meta, std::move(recycle) });
+}
+
+/**
+ * @brief Fill the public metadata of @p img so it views @p bytes bytes at @p buffer.
+ *
+ * Sets a single packed image (image_count = 1, sel_image = 0) without allocating.
+ * The caller provides a pooled or aliased @p buffer.
+ * @warning @p img must be freshly constructed (its private view offset must be zero).
+ */
+inline void SetFrameView(csh_img::CSH_Image& img,
+    std::shared_ptr<csh_img::CSH_Image::byte[]> buffer, std::size_t bytes,
+    uint32_t width, uint32_t height,
+    csh_img::En_ImageFormat fmt, csh_img::En_ImagePattern pat,
+    uint32_t memoryBit, uint32_t originalBit,
+    csh_img::En_ImageMemoryAlign align = csh_img::En_ImageMemoryAlign::Packed) {
+    img.width = width;
+    img.height = height;
+    img.format = fmt;
+    img.pattern = pat;
+    img.memory_bit = memoryBit;
+    img.original_bit = originalBit;
+    img.memory_align = align;
+    img.buffer_size = bytes;
+    img.image_count = 1;
+    img.sel_image = 0;
+    img.buffer = std::move(buffer);
+    img.bEnable = true;
+}
+
+/**
+ * @brief Packed heap copy of the current view of @p src (metadata preserved, pool link dropped).
+ * @return Disabled empty image if @p src has no data.
+ * @note Use to retain frames from backends that reuse a single buffer.
+ */
+inline csh_img::CSH_Image DeepCopyFrame(const csh_img::CSH_Image& src) {
+    csh_img::CSH_Image out;
+    const auto* p = src.data();
+    if (!p || src.buffer_size == 0) return out;
+    std::shared_ptr<csh_img::CSH_Image::byte[]> buf(new csh_img::CSH_Image::byte[src.buffer_size]);
+    std::memcpy(buf.get(), p, src.buffer_size);
+    SetFrameView(out, std::move(buf), src.buffer_size, src.width, src.height, src.format, src.pattern,
+        src.memory_bit, src.original_bit, src.memory_align);
+    out.camera_id = src.camera_id;
+    return out;
+}
+
+/**
+ * @brief Number of planes described for a pooled frame (0 if @p img is not pooled or single-view).
+ */
+inline uint32_t GetFramePlaneCount(const csh_img::CSH_Image& img) {
+    const CFrameMeta* m = GetFrameMeta(img);
+    return m ? m->num_planes : 0u;
+}
+
+/**
+ * @brief Zero-copy CSH_Image view of plane @p p of a pooled frame.
+ * @param img Callback image (or any shallow copy of it).
+ * @param p   Plane index, `< GetFramePlaneCount(img)`.
+ * @return A view that shares ownership with @p img (the driver buffer stays queued out
+ *         while it lives), or a disabled empty image if the plane does not exist.
+ */
+inline csh_img::CSH_Image GetFramePlane(const csh_img::CSH_Image& img, uint32_t p) {
+    csh_img::CSH_Image out;
+    const CFrameMeta* m = GetFrameMeta(img);
+    if (!m || p >= m->num_planes || !m->planes[p].data) return out;
+
+    const CFramePlaneDesc& d = m->planes[p];
+    std::shared_ptr<csh_img::CSH_Image::byte[]> alias(img.buffer, d.data);
+    SetFrameView(out, std::move(alias), d.bytes, d.view_width, d.height,
+        d.format, d.pattern, d.memory_bit, d.original_bit);
+    out.camera_id = img.camera_id;
+    return out;
+}
+
+/**
+ * @brief Callback wrapper that lets an attacher wait for calls already in flight.
+ *
+ * Backends copy the registered callback and invoke it outside their lock, so clearing the
+ * registration does not stop a call that has already started. Register callbacks made by
+ * @ref Wrap and, after clearing the registration, call @ref Close: it waits until every call
+ * through those wrappers has returned and turns later calls into no-ops, so the owner can
+ * be destroyed afterwards.
+ *
+ * @warning Do not call @ref Close from inside a wrapped callback (it would wait for itself).
+ */
+class GrabberCallbackGate {
+public:
+    using Fn = std::function<void(const csh_img::CSH_Image&)>;
+
+    GrabberCallbackGate() = default;
+    ~GrabberCallbackGate() { Close(); }
+
+    GrabberCallbackGate(const GrabberCallbackGate&) = delete;
+    GrabberCallbackGate& operator=(const GrabberCallbackGate&) = delete;
+
+    /// @brief @p fn wrapped in the current generation (a new one after @ref Close).
+    Fn Wrap(Fn fn) {
+        std::shared_ptr<State_> st;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (!st_) st_ = std::make_shared<State_>();
+            st = st_;
+        }
+        return [st, fn = std::move(fn)](const csh_img::CSH_Image& f) {
+            {
+                std::lock_guard<std::mutex> lk(st->mtx);
+                if (st->closed) return;
+                ++st->inflight;
+            }
+            struct Leave_ {
+                State_& s;
+                ~Leave_() {
+                    std::lock_guard<std::mutex> lk(s.mtx);
+                    if (--s.inflight == 0) s.cv.notify_all();
+                }
+            } leave{ *st };
+            fn(f);
+        };
+    }
+
+    /// @brief Reject further calls through the current wrappers and wait for calls in flight.
+    void Close() {
+        std::shared_ptr<State_> st;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            st.swap(st_);
+        }
+        if (!st) return;
+        std::unique_lock<std::mutex> lk(st->mtx);
+        st->closed = true;
+        st->cv.wait(lk, [&] { return st->inflight == 0; });
+    }
+
+private:
+    struct State_ {
+        std::mutex mtx;
+        std::condition_variable cv;
+        uint32_t inflight = 0;
+        bool closed = false;
+    };
+
+    std::mutex mtx_;
+    std::shared_ptr<State_> st_;
+};
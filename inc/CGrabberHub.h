@@ -0,0 +1,274 @@
+#pragma once
+/**
+ * @file CGrabberHub.h
+ * @brief Single-threaded epoll event loop driving many @ref CV4L2Stream devices.
+ *
+ * Each @ref CV4L2Stream normally owns a dequeue thread. With a dozen cameras that means a
+ * dozen threads waking per frame. The hub replaces them with one thread:
+ *  - Every attached stream is switched to an external pump (@ref CV4L2Stream::setExternalPump)
+ *    and its device fd is registered with one epoll instance (EPOLLIN).
+ *  - On readiness the hub calls @ref CV4L2Stream::serviceReady, which drains all ready
+ *    buffers and runs that stream's registered callbacks on the hub thread.
+ *  - An eventfd wakes the loop for Stop() and for attach/detach while running.
+ *  - vb2 reports EPOLLERR for a queue that is not streaming. Such a stream is parked
+ *    (removed from epoll, still attached) and re-armed once it streams again, so
+ *    Attach before GrabFrames and Stop/restart cycles are fine. A stream is detached
+ *    only when EPOLLERR persists while it streams (device error or unplug, e.g. ENODEV).
+ *  - The hub removes the fd it registered, not the stream's current fd(), so a
+ *    Disconnect/Connect on the application thread cannot leave a stale fd in epoll.
+ *
+ * Per-device delivery is unchanged: frames go to the callbacks registered on each stream
+ * (or on the @ref CFrameGrabber façade that owns it), with the usual pooled-frame semantics.
+ *
+ * @code
+ * CV4L2Stream camA, camB;            // configured and connected
+ * CGrabberHub hub;
+ * hub.Attach(camA); hub.Attach(camB);
+ * hub.Start();
+ * camA.GrabFrames(); camB.GrabFrames();
+ * ...
+ * hub.Stop();                        // streams keep streaming with no pump until detached
+ * @endcode
+ *
+ * @note Linux only. Callbacks run on the hub thread and are serialized across devices; a
+ *       slow callback delays every other device, so hand heavy work to another thread.
+ * @warning Do not call Attach/Detach/Stop from inside a frame callback.
+ * @note Detach (or destroy the hub) before destroying an attached stream.
+ */
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "CV4L2Stream.h"
+#include "CSH_Log.h"
+
+class CGrabberHub {
+public:
+    CGrabberHub() {
+        epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        wakefd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epfd_ < 0 || wakefd_ < 0) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"CGrabberHub: epoll/eventfd setup failed: errno=%d", errno);
+            return;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr; // nullptr marks the wakeup fd
+        ::epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+    }
+
+    ~CGrabberHub() {
+        Stop();
+        std::vector<Entry_> all;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            all.swap(entries_);
+        }
+        for (const Entry_& e : all) e.stream->setExternalPump(false);
+        if (wakefd_ >= 0) ::close(wakefd_);
+        if (epfd_ >= 0) ::close(epfd_);
+    }
+
+    CGrabberHub(const CGrabberHub&) = delete;
+    CGrabberHub& operator=(const CGrabberHub&) = delete;
+
+    /**
+     * @brief Drive @p stream from the hub thread.
+     * @return false if the stream is not connected, already attached, or epoll refused the fd.
+     * @note The stream may already be grabbing (its own worker is stopped) or start later;
+     *       it is registered with epoll only while it streams.
+     */
+    bool Attach(CV4L2Stream& stream) {
+        if (epfd_ < 0 || stream.fd() < 0) return false;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (find_(&stream) != entries_.end()) return false;
+
+            stream.setExternalPump(true);
+            entries_.push_back(Entry_{ &stream, -1 }); // parked: armed by the loop once streaming
+        }
+        wake_();
+        return true;
+    }
+
+    /**
+     * @brief Return @p stream to its own dequeue worker.
+     * @return false if the stream was not attached.
+     */
+    bool Detach(CV4L2Stream& stream) {
+        wake_();
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it = find_(&stream);
+        if (it == entries_.end()) return false;
+        park_(*it);
+        entries_.erase(it);
+        stream.setExternalPump(false);
+        return true;
+    }
+
+    /// @brief Start the hub thread.
+    bool Start() {
+        if (epfd_ < 0) return false;
+        if (running_.exchange(true)) return true;
+        thread_ = std::thread([this] { loop_(); });
+        return true;
+    }
+
+    /// @brief Stop and join the hub thread. Attached streams stay attached (unpumped).
+    void Stop() {
+        if (!running_.exchange(false)) return;
+        wake_();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    /// @return Number of attached streams.
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return entries_.size();
+    }
+
+    /// @return True while the hub thread runs.
+    bool isRunning() const { return running_.load(); }
+
+    /// @return Number of epoll_wait returns with at least one ready device.
+    uint64_t wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+
+    /// @return Total frames delivered through the hub.
+    uint64_t framesDelivered() const { return frames_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int kMaxEvents = 32;
+    static constexpr int kParkedPollMs = 10; ///< Re-arm latency for parked (not streaming) streams.
+
+    /// One attached stream and the fd it is registered with.
+    struct Entry_ {
+        CV4L2Stream* stream = nullptr;
+        int fd = -1;    ///< fd added to epoll; -1 while parked. Not re-read from the stream,
+                        ///< whose fd() changes (or goes to -1) on Disconnect/Connect.
+    };
+
+    std::vector<Entry_>::iterator find_(const CV4L2Stream* s) {
+        return std::find_if(entries_.begin(), entries_.end(), [s](const Entry_& e) { return e.stream == s; });
+    }
+
+    void wake_() {
+        if (wakefd_ < 0) return;
+        uint64_t one = 1;
+        ssize_t r = ::write(wakefd_, &one, sizeof(one));
+        (void)r;
+    }
+
+    /// Register parked streams that are streaming again. Caller holds mtx_.
+    /// @return True if some stream is still parked.
+    bool armParked_() {
+        bool waiting = false;
+        for (Entry_& e : entries_) {
+            if (e.fd >= 0) continue;
+            const int fd = e.stream->streamingFd();
+            if (fd < 0) { waiting = true; continue; }
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = e.stream;
+            if (::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) != 0 && errno != EEXIST) {
+                LOG_WRITE(cshlog::LogLevel::Error, L"CGrabberHub: EPOLL_CTL_ADD fd=%d failed: errno=%d", fd, errno);
+                waiting = true;
+                continue;
+            }
+            e.fd = fd;
+        }
+        return waiting;
+    }
+
+    /// Take @p e out of epoll until it streams again. Caller holds mtx_.
+    void park_(Entry_& e) {
+        if (e.fd < 0) return;
+        // A closed fd has already left epoll and its number may now be another entry's
+        // registration: only remove it when no other entry holds that number.
+        const int fd = e.fd;
+        e.fd = -1;
+        const bool reused = std::any_of(entries_.begin(), entries_.end(), [fd](const Entry_& o) { return o.fd == fd; });
+        if (!reused) ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    /// EPOLLERR that still holds on a streaming queue: a real device error, not "not streaming".
+    static bool persistentError_(int fd) {
+        pollfd p{ fd, POLLIN, 0 };
+        return ::poll(&p, 1, 0) > 0 && (p.revents & (POLLERR | POLLNVAL));
+    }
+
+    void loop_() {
+        epoll_event evs[kMaxEvents];
+        while (running_.load(std::memory_order_relaxed)) {
+            bool waiting = false;
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                waiting = armParked_();
+            }
+            int n = ::epoll_wait(epfd_, evs, kMaxEvents, waiting ? kParkedPollMs : 100);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                LOG_WRITE(cshlog::LogLevel::Error, L"CGrabberHub: epoll_wait failed: errno=%d", errno);
+                break;
+            }
+            if (n == 0) continue;
+
+            bool any = false;
+            std::lock_guard<std::mutex> lk(mtx_);
+            for (int i = 0; i < n; ++i) {
+                auto* s = static_cast<CV4L2Stream*>(evs[i].data.ptr);
+                if (!s) {
+                    uint64_t v;
+                    while (::read(wakefd_, &v, sizeof(v)) > 0) {}
+                    continue;
+                }
+                // Events may be stale if the stream was detached or parked between wait and lock.
+                auto it = find_(s);
+                if (it == entries_.end() || it->fd < 0) continue;
+
+                // Stopped, disconnected or reconnected (new fd) on the app thread: drop the
+                // registered fd; the stream is re-armed with its current fd once it streams.
+                if (s->streamingFd() != it->fd) {
+                    park_(*it);
+                    continue;
+                }
+                if (evs[i].events & EPOLLERR) {
+                    if (!persistentError_(it->fd)) {
+                        park_(*it); // stopping: vb2 polls EPOLLERR once STREAMOFF is issued
+                        continue;
+                    }
+                    LOG_WRITE(cshlog::LogLevel::Warn, L"CGrabberHub: device error on fd=%d, detaching", it->fd);
+                    park_(*it);
+                    entries_.erase(it);
+                    s->setExternalPump(false); // its own worker reports further errors
+                    continue;
+                }
+                any = true;
+                frames_.fetch_add(s->serviceReady(), std::memory_order_relaxed);
+            }
+            if (any) wakeups_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    int epfd_ = -1;
+    int wakefd_ = -1;
+    std::thread thread_;
+    std::atomic<bool> running_{ false };
+    mutable std::mutex mtx_;
+    std::vector<Entry_> entries_;        ///< Attached streams (parked ones have fd -1).
+    std::atomic<uint64_t> wakeups_{ 0 };
+    std::atomic<uint64_t> frames_{ 0 };
+};
+
+#endif // __linux__
@@ -0,0 +1,272 @@
+#pragma once
+/**
+ * @file CGrabberStats.h
+ * @brief Capture health counters with a lock-free snapshot and an optional stall watchdog.
+ *
+ * Backends that implement @ref IGrabberStatsSource update a @ref CGrabberStats from their
+ * grab thread (single writer, relaxed atomics only). Any thread may read a
+ * @ref CGrabberStatsSnapshot at any time without blocking capture:
+ *  - Dropped frames from driver sequence gaps.
+ *  - Dequeue-to-callback latency and callback duration (last / average / max).
+ *  - Driver queue occupancy (queued / held by consumers / total buffers).
+ *  - Measured fps (smoothed) against the requested fps.
+ *
+ * The watchdog (@ref CGrabberStats::enableWatchdog) logs through CSH_Log when no frame was
+ * delivered for N frame intervals while grabbing, and again when delivery resumes.
+ *
+ * @code
+ * CGrabberStatsSnapshot s;           // CFrameGrabber::GetStats, backends implementing IGrabberStatsSource
+ * if (grab.GetStats(s))
+ *     printf("%.1f/%.1f fps, dropped %llu\n", s.measured_fps, s.requested_fps, s.dropped);
+ * @endcode
+ *
+ * @note Fields are read individually; a snapshot is not an atomic cut across all counters.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "CGrabberFrame.h"
+#include "CSH_Log.h"
+
+/**
+ * @brief Point-in-time copy of @ref CGrabberStats.
+ * @note Durations are in nanoseconds; 0 when nothing was measured yet.
+ */
+struct CGrabberStatsSnapshot {
+    uint64_t frames = 0;            ///< Frames delivered since start.
+    uint64_t dropped = 0;           ///< Frames missing from the driver sequence.
+    uint64_t gap_events = 0;        ///< Number of sequence discontinuities.
+    uint64_t last_sequence = 0;     ///< Sequence of the last frame.
+    int64_t  last_frame_ns = 0;     ///< Steady-clock time of the last delivery.
+
+    double   requested_fps = 0.0;   ///< Rate requested in the configuration.
+    double   measured_fps = 0.0;    ///< Smoothed delivery rate.
+
+    int64_t  latency_last_ns = 0;   ///< Dequeue to callback start, last frame.
+    int64_t  latency_avg_ns = 0;    ///< Dequeue to callback start, average.
+    int64_t  latency_max_ns = 0;    ///< Dequeue to callback start, maximum.
+    int64_t  callback_last_ns = 0;  ///< Callback duration, last frame.
+    int64_t  callback_avg_ns = 0;   ///< Callback duration, average.
+    int64_t  callback_max_ns = 0;   ///< Callback duration, maximum.
+
+    uint32_t queued_buffers = 0;    ///< Buffers owned by the driver (ready to be filled).
+    uint32_t held_buffers = 0;      ///< Buffers held by consumers.
+    uint32_t total_buffers = 0;     ///< Buffers in the pool.
+
+    uint64_t stalls = 0;            ///< Watchdog stall episodes.
+    bool     stalled = false;       ///< True while the watchdog considers delivery stalled.
+};
+
+/**
+ * @class CGrabberStats
+ * @brief Single-writer capture counters (see file description).
+ */
+class CGrabberStats {
+public:
+    CGrabberStats() = default;
+    ~CGrabberStats() { disableWatchdog(); }
+
+    CGrabberStats(const CGrabberStats&) = delete;
+    CGrabberStats& operator=(const CGrabberStats&) = delete;
+
+    // ---------------- Writer side (grab thread) ----------------
+
+    /// @brief Reset the counters and arm the watchdog; called by the backend when grabbing starts.
+    void start(double requestedFps) {
+        frames_.store(0, std::memory_order_relaxed);
+        dropped_.store(0, std::memory_order_relaxed);
+        gaps_.store(0, std::memory_order_relaxed);
+        lastSeq_.store(0, std::memory_order_relaxed);
+        intervalEwma_.store(0, std::memory_order_relaxed);
+        latSum_.store(0, std::memory_order_relaxed);
+        latMax_.store(0, std::memory_order_relaxed);
+        latLast_.store(0, std::memory_order_relaxed);
+        cbSum_.store(0, std::memory_order_relaxed);
+        cbMax_.store(0, std::memory_order_relaxed);
+        cbLast_.store(0, std::memory_order_relaxed);
+        stalls_.store(0, std::memory_order_relaxed);
+        stalled_.store(false, std::memory_order_relaxed);
+        requestedFps_.store(requestedFps, std::memory_order_relaxed);
+        lastFrame_.store(GrabberNowNs(), std::memory_order_relaxed);
+        armed_.store(true, std::memory_order_release);
+    }
+
+    /// @brief Disarm the watchdog; called by the backend when grabbing stops.
+    void stop() { armed_.store(false, std::memory_order_release); }
+
+    /**
+     * @brief Record one delivered frame.
+     * @param sequence     Driver/backend sequence number.
+     * @param dequeueNs    Time the frame was dequeued.
+     * @param callbackNs   Time the callbacks started.
+     * @param doneNs       Time the callbacks returned.
+     */
+    void onFrame(uint64_t sequence, int64_t dequeueNs, int64_t callbackNs, int64_t doneNs) {
+        const uint64_t n = frames_.load(std::memory_order_relaxed);
+        if (n > 0) {
+            const uint64_t prev = lastSeq_.load(std::memory_order_relaxed);
+            if (sequence > prev + 1) {
+                dropped_.store(dropped_.load(std::memory_order_relaxed) + (sequence - prev - 1), std::memory_order_relaxed);
+                gaps_.store(gaps_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+            const int64_t dt = dequeueNs - prevDequeue_;
+            if (dt > 0) {
+                const int64_t e = intervalEwma_.load(std::memory_order_relaxed);
+                intervalEwma_.store(e == 0 ? dt : e + (dt - e) / 8, std::memory_order_relaxed);
+            }
+        }
+        prevDequeue_ = dequeueNs;
+        lastSeq_.store(sequence, std::memory_order_relaxed);
+
+        const int64_t lat = std::max<int64_t>(0, callbackNs - dequeueNs);
+        const int64_t cb = std::max<int64_t>(0, doneNs - callbackNs);
+        latLast_.store(lat, std::memory_order_relaxed);
+        latSum_.store(latSum_.load(std::memory_order_relaxed) + lat, std::memory_order_relaxed);
+        if (lat > latMax_.load(std::memory_order_relaxed)) latMax_.store(lat, std::memory_order_relaxed);
+        cbLast_.store(cb, std::memory_order_relaxed);
+        cbSum_.store(cbSum_.load(std::memory_order_relaxed) + cb, std::memory_order_relaxed);
+        if (cb > cbMax_.load(std::memory_order_relaxed)) cbMax_.store(cb, std::memory_order_relaxed);
+
+        lastFrame_.store(doneNs, std::memory_order_relaxed);
+        frames_.store(n + 1, std::memory_order_release);
+    }
+
+    /// @brief Record buffer pool occupancy.
+    void setOccupancy(uint32_t queued, uint32_t held, uint32_t total) {
+        queued_.store(queued, std::memory_order_relaxed);
+        held_.store(held, std::memory_order_relaxed);
+        total_.store(total, std::memory_order_relaxed);
+    }
+
+    // ---------------- Reader side (any thread) ----------------
+
+    /// @return Current counters (wait-free).
+    CGrabberStatsSnapshot snapshot() const {
+        CGrabberStatsSnapshot s;
+        s.frames = frames_.load(std::memory_order_acquire);
+        s.dropped = dropped_.load(std::memory_order_relaxed);
+        s.gap_events = gaps_.load(std::memory_order_relaxed);
+        s.last_sequence = lastSeq_.load(std::memory_order_relaxed);
+        s.last_frame_ns = lastFrame_.load(std::memory_order_relaxed);
+        s.requested_fps = requestedFps_.load(std::memory_order_relaxed);
+        const int64_t e = intervalEwma_.load(std::memory_order_relaxed);
+        s.measured_fps = e > 0 ? 1e9 / static_cast<double>(e) : 0.0;
+        s.latency_last_ns = latLast_.load(std::memory_order_relaxed);
+        s.latency_max_ns = latMax_.load(std::memory_order_relaxed);
+        s.callback_last_ns = cbLast_.load(std::memory_order_relaxed);
+        s.callback_max_ns = cbMax_.load(std::memory_order_relaxed);
+        if (s.frames) {
+            s.latency_avg_ns = latSum_.load(std::memory_order_relaxed) / static_cast<int64_t>(s.frames);
+            s.callback_avg_ns = cbSum_.load(std::memory_order_relaxed) / static_cast<int64_t>(s.frames);
+        }
+        s.queued_buffers = queued_.load(std::memory_order_relaxed);
+        s.held_buffers = held_.load(std::memory_order_relaxed);
+        s.total_buffers = total_.load(std::memory_order_relaxed);
+        s.stalls = stalls_.load(std::memory_order_relaxed);
+        s.stalled = stalled_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // ---------------- Watchdog ----------------
+
+    /**
+     * @brief Log a warning when no frame arrives for @p intervals frame periods while grabbing.
+     * @param intervals Stall threshold in frame intervals (minimum 1).
+     * @param name      Label used in log lines (e.g., device path).
+     * @note The period comes from the requested fps (measured fps if none was requested).
+     */
+    void enableWatchdog(uint32_t intervals, const std::string& name = "grabber") {
+        disableWatchdog();
+        wdIntervals_ = std::max<uint32_t>(1, intervals);
+        wdName_ = std::wstring(name.begin(), name.end());
+        {
+            std::lock_guard<std::mutex> lk(wdMtx_);
+            wdStop_ = false;
+        }
+        wd_ = std::thread([this] { watchdogLoop_(); });
+    }
+
+    /// @brief Stop the watchdog thread (no-op if not enabled).
+    void disableWatchdog() {
+        {
+            std::lock_guard<std::mutex> lk(wdMtx_);
+            wdStop_ = true;
+        }
+        wdCv_.notify_all();
+        if (wd_.joinable()) wd_.join();
+    }
+
+private:
+    int64_t periodNs_() const {
+        const double fps = requestedFps_.load(std::memory_order_relaxed);
+        if (fps > 0.0) return static_cast<int64_t>(1e9 / fps);
+        return intervalEwma_.load(std::memory_order_relaxed);
+    }
+
+    void watchdogLoop_() {
+        std::unique_lock<std::mutex> lk(wdMtx_);
+        for (;;) {
+            const int64_t period = periodNs_();
+            const auto tick = std::chrono::nanoseconds(period > 0 ? std::max<int64_t>(period, 1000000) : 100000000);
+            if (wdCv_.wait_for(lk, tick, [&] { return wdStop_; })) return;
+            if (!armed_.load(std::memory_order_acquire) || period <= 0) continue;
+
+            const int64_t idle = GrabberNowNs() - lastFrame_.load(std::memory_order_relaxed);
+            const bool stall = idle > period * static_cast<int64_t>(wdIntervals_);
+            if (stall && !stalled_.load(std::memory_order_relaxed)) {
+                stalled_.store(true, std::memory_order_relaxed);
+                stalls_.fetch_add(1, std::memory_order_relaxed);
+                LOG_WRITE(cshlog::LogLevel::Warn, L"%ls: no frame for %lld ms (%u intervals), held buffers %u/%u",
+                    wdName_.c_str(), static_cast<long long>(idle / 1000000), wdIntervals_,
+                    held_.load(std::memory_order_relaxed), total_.load(std::memory_order_relaxed));
+            }
+            else if (!stall && stalled_.load(std::memory_order_relaxed)) {
+                stalled_.store(false, std::memory_order_relaxed);
+                LOG_WRITE(cshlog::LogLevel::Info, L"%ls: delivery resumed", wdName_.c_str());
+            }
+        }
+    }
+
+    // Counters (written by the grab thread only)
+    std::atomic<uint64_t> frames_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<uint64_t> gaps_{ 0 };
+    std::atomic<uint64_t> lastSeq_{ 0 };
+    std::atomic<int64_t>  lastFrame_{ 0 };
+    std::atomic<int64_t>  intervalEwma_{ 0 };
+    std::atomic<int64_t>  latSum_{ 0 }, latMax_{ 0 }, latLast_{ 0 };
+    std::atomic<int64_t>  cbSum_{ 0 }, cbMax_{ 0 }, cbLast_{ 0 };
+    std::atomic<uint32_t> queued_{ 0 }, held_{ 0 }, total_{ 0 };
+    std::atomic<double>   requestedFps_{ 0.0 };
+    std::atomic<bool>     armed_{ false };
+    int64_t prevDequeue_ = 0;
+
+    // Watchdog
+    std::atomic<uint64_t> stalls_{ 0 };
+    std::atomic<bool>     stalled_{ false };
+    std::thread wd_;
+    std::mutex wdMtx_;
+    std::condition_variable wdCv_;
+    bool wdStop_ = false;
+    uint32_t wdIntervals_ = 3;
+    std::wstring wdName_;
+};
+
+/**
+ * @brief Implemented by backends that publish @ref CGrabberStats.
+ * @see CFrameGrabber::GetStats
+ */
+class IGrabberStatsSource {
+public:
+    virtual ~IGrabberStatsSource() = default;
+
+    /// @return Counters of this backend (lives as long as the backend).
+    virtual CGrabberStats& stats() = 0;
+};
@@ -85,6 +85,14 @@ extern "C" {
     /** @brief Opaque instance handle for the displayer. */
     typedef struct CImageDisplayerHandle_t* CImageDisplayerHandle;
 
+    /** @brief Pixel rectangle (x,y = top-left). */
+    typedef struct {
+        int32_t x, y, width, height;
+    } CImageRect;
+
+    /** @brief Maximum number of dirty rectangles per image (see @c CImageDisplayerCPP::dirtyRects). */
+#define CIMG_MAX_DIRTY_RECTS 16
+
     /**
      * @brief Upload descriptor (C layout) matching the C++ @c UploadDescriptor.
      * @note @c data may be NULL for MetaOnly copies.
@@ -207,6 +215,38 @@ extern "C" {
      */
     CIMAGE_C_API void cimgTriStrip3D_XYUV_ObjectSpace(float* out4x4 /*[4][4]*/);
 
+    // ----- batched render state -----
+
+    /**
+     * @brief All per-frame render state in one struct.
+     * @note Change tracking lives in the C++ wrapper (@c cimage::RenderState adds versions).
+     */
+    typedef struct {
+        float    model2D[9];    ///< 2D model, row-major 3×3.
+        float    strip2D[16];   ///< Transformed 2D quad, {x,y,u,v} per vertex (TL,TR,BL,BR).
+        float    model3D[16];   ///< 3D model, column-major 4×4.
+        float    view3D[16];    ///< 3D view, column-major 4×4.
+        float    proj[16];      ///< Projection, column-major 4×4.
+        float    mvp3D[16];     ///< P*V*M, column-major 4×4.
+    } CImageRenderState;
+
+    /**
+     * @brief Fill a @ref CImageRenderState from the individual getters.
+     * @param h   Instance handle.
+     * @param out Output struct (must not be NULL).
+     * @note Convenience only: header-inline over the six exported getters (the library has no
+     *       batched entry point), so it saves no calls. C code that wants to skip unchanged
+     *       state must compare the returned contents itself.
+     */
+    static inline void cimgGetRenderState(CImageDisplayerHandle h, CImageRenderState* out) {
+        cimgGetModel2D_3x3(h, out->model2D);
+        cimgTriStrip2D_XYUV(h, out->strip2D);
+        cimgGetModel3D_4x4(h, out->model3D);
+        cimgGetView3D_4x4(h, out->view3D);
+        cimgGetProj_4x4(h, out->proj);
+        cimgGetMVP3D_4x4(h, out->mvp3D);
+    }
+
     // ----- upload descriptor -----
 
     /**
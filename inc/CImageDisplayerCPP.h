@@ -8,6 +8,8 @@
 #include "CSH_Image.h"
 #include <stdexcept>
 #include <cstring>
+#include <algorithm>
+#include <vector>
 
 /**
  * @file CImageDisplayerCPP.h
@@ -88,12 +90,26 @@ namespace cimage {
     constexpr MouseButton    from_c_btns(int bits) { return static_cast<MouseButton>(bits); }
     ///@}
 
+    /**
+     * @brief @ref CImageRenderState plus the wrapper's change versions
+     *        (see @ref CImageDisplayerCPP::renderState).
+     */
+    struct RenderState : CImageRenderState {
+        uint64_t version2D = 0; ///< Advances whenever model2D / strip2D may have changed.
+        uint64_t version3D = 0; ///< Advances whenever model3D / view3D / proj / mvp3D may have changed.
+    };
+
     /**
      * @class CImageDisplayerCPP
      * @brief RAII C++ wrapper around the C ABI. No rendering; forwards to C API.
      *
      * This wrapper creates/destroys the underlying C instance and offers typed
      * helpers. ABI remains stable because the boundary stays in C.
+     *
+     * Matrices and the 2D quad are cached: every setter / input hook advances a 2D or 3D
+     * version, and @ref renderState (and the individual getters) refetch a group from the
+     * library only when its version moved. Call @ref invalidateRenderState after mutating
+     * the instance through @ref raw.
      */
     class CImageDisplayerCPP {
     public:
@@ -110,10 +126,11 @@ namespace cimage {
         CImageDisplayerCPP& operator=(const CImageDisplayerCPP&) = delete;
 
         /// @brief Move construct, transferring ownership.
-        CImageDisplayerCPP(CImageDisplayerCPP&& o) noexcept : h_(o.h_) { o.h_ = nullptr; }
+        CImageDisplayerCPP(CImageDisplayerCPP&& o) noexcept
+            : h_(o.h_), dirty_(std::move(o.dirty_)), rs_(o.rs_) { o.h_ = nullptr; }
         /// @brief Move assign, destroying any currently owned handle.
         CImageDisplayerCPP& operator=(CImageDisplayerCPP&& o) noexcept {
-            if (this != &o) { cimgDestroy(h_); h_ = o.h_; o.h_ = nullptr; }
+            if (this != &o) { cimgDestroy(h_); h_ = o.h_; o.h_ = nullptr; dirty_ = std::move(o.dirty_); rs_ = o.rs_; }
             return *this;
         }
 
@@ -135,6 +152,21 @@ namespace cimage {
             }
             cimgSetImageRaw(h_, img.getWidth(), img.getHeight(), fmt, pat, alg, data, bytes,
                 static_cast<CImgCopyMode>(static_cast<uint32_t>(mode)));
+            dirty_.clear();
+            touchImageSize_(img.getWidth(), img.getHeight());
+        }
+
+        /**
+         * @brief Set image with a hint of which regions changed since the previous image.
+         * @param img    Source image.
+         * @param mode   Copy mode.
+         * @param dirty  Changed rectangles in pixels (from frame-diff or the pipeline).
+         * @param count  Number of rectangles; 0 or more than @c CIMG_MAX_DIRTY_RECTS means the whole image.
+         * @note The hint is reported by @ref dirtyRects until the next setImage/setImageRaw.
+         */
+        void setImage(const csh_img::CSH_Image& img, csh_img::CopyMode mode, const CImageRect* dirty, int count) {
+            setImage(img, mode);
+            setDirtyRects(dirty, count);
         }
 
         /**
@@ -151,71 +183,90 @@ namespace cimage {
             CImgFormat fmt, CImgPattern pat, CImgAlign align,
             const void* pixels, size_t bytes, CImgCopyMode mode) {
             cimgSetImageRaw(h_, w, h, fmt, pat, align, pixels, bytes, mode);
+            dirty_.clear();
+            touchImageSize_(w, h);
         }
 
+        /**
+         * @brief Replace the dirty-rectangle hint for the current image.
+         * @param dirty Changed rectangles in pixels (clamped to the image; empty ones dropped).
+         * @param count 0 or more than @c CIMG_MAX_DIRTY_RECTS means the whole image.
+         */
+        void setDirtyRects(const CImageRect* dirty, int count) {
+            dirty_.clear();
+            if (!dirty || count <= 0 || count > CIMG_MAX_DIRTY_RECTS) return;
+            dirty_.assign(dirty, dirty + count);
+        }
+        /// @brief Drop the hint (the whole image is reported as changed).
+        void clearDirtyRects() { dirty_.clear(); }
+
         // Viewport / fit / mode
 
         /// @brief Set viewport size in pixels.
-        void setViewport(int w, int h) { cimgSetViewport(h_, w, h); }
+        void setViewport(int w, int h) {
+            cimgSetViewport(h_, w, h);
+            if (w == rs_.vpW && h == rs_.vpH) return;
+            rs_.vpW = w; rs_.vpH = h; touch2D_(); touch3D_();
+        }
         /// @brief Set fit strategy (None/Fit/Fill/Stretch).
-        void setFitMode(FitMode m) { cimgSetFitMode(h_, to_c(m)); }
+        void setFitMode(FitMode m) { cimgSetFitMode(h_, to_c(m)); touch2D_(); }
         /// @brief Switch between 2D and 3D modes.
-        void setDimensionality(Dimensionality d) { cimgSetDimensionality(h_, to_c(d)); }
+        void setDimensionality(Dimensionality d) { cimgSetDimensionality(h_, to_c(d)); touch2D_(); touch3D_(); }
 
         // 2D
 
         /// @brief Set normalized anchor inside image rect [0..1]².
-        void set2DAnchor(float ax, float ay) { cimg2D_SetAnchor(h_, ax, ay); }
+        void set2DAnchor(float ax, float ay) { cimg2D_SetAnchor(h_, ax, ay); touch2D_(); }
         /// @brief Set 2D translation in viewport pixels.
-        void set2DTranslation(float tx, float ty) { cimg2D_SetTranslation(h_, tx, ty); }
+        void set2DTranslation(float tx, float ty) { cimg2D_SetTranslation(h_, tx, ty); touch2D_(); }
         /// @brief Set 2D scale factors.
-        void set2DScale(float sx, float sy) { cimg2D_SetScale(h_, sx, sy); }
+        void set2DScale(float sx, float sy) { cimg2D_SetScale(h_, sx, sy); touch2D_(); }
         /// @brief Set rotation in degrees (CCW).
-        void set2DRotationDeg(float deg) { cimg2D_SetRotationDeg(h_, deg); }
+        void set2DRotationDeg(float deg) { cimg2D_SetRotationDeg(h_, deg); touch2D_(); }
         /// @brief Reset 2D transform to identity.
-        void reset2D() { cimg2D_Reset(h_); }
+        void reset2D() { cimg2D_Reset(h_); touch2D_(); }
 
         // 3D
 
         /// @brief Set model translation.
-        void set3DModelTranslate(float x, float y, float z) { cimg3D_SetModelTranslate(h_, x, y, z); }
+        void set3DModelTranslate(float x, float y, float z) { cimg3D_SetModelTranslate(h_, x, y, z); touch3D_(); }
         /// @brief Set model scale.
-        void set3DModelScale(float x, float y, float z) { cimg3D_SetModelScale(h_, x, y, z); }
+        void set3DModelScale(float x, float y, float z) { cimg3D_SetModelScale(h_, x, y, z); touch3D_(); }
         /// @brief Set model rotation (quaternion).
-        void set3DModelRotationQuat(float w, float x, float y, float z) { cimg3D_SetModelRotationQuat(h_, w, x, y, z); }
+        void set3DModelRotationQuat(float w, float x, float y, float z) { cimg3D_SetModelRotationQuat(h_, w, x, y, z); touch3D_(); }
         /// @brief Reset model transform to identity.
-        void reset3DModel() { cimg3D_ResetModel(h_); }
+        void reset3DModel() { cimg3D_ResetModel(h_); touch3D_(); }
         /// @brief Set look-at target.
-        void set3DTarget(float x, float y, float z) { cimg3D_SetTarget(h_, x, y, z); }
+        void set3DTarget(float x, float y, float z) { cimg3D_SetTarget(h_, x, y, z); touch3D_(); }
         /// @brief Set camera eye.
-        void set3DEye(float x, float y, float z) { cimg3D_SetEye(h_, x, y, z); }
+        void set3DEye(float x, float y, float z) { cimg3D_SetEye(h_, x, y, z); touch3D_(); }
         /// @brief Set camera up vector.
-        void set3DUp(float x, float y, float z) { cimg3D_SetUp(h_, x, y, z); }
+        void set3DUp(float x, float y, float z) { cimg3D_SetUp(h_, x, y, z); touch3D_(); }
         /// @brief Set orbit interaction style.
-        void set3DOrbitStyle(CImgOrbitStyle s) { cimg3D_SetOrbitStyle(h_, s); }
+        void set3DOrbitStyle(CImgOrbitStyle s) { cimg3D_SetOrbitStyle(h_, s); touch3D_(); }
 
         /// @brief Set orthographic projection.
-        void setOrtho(float l, float r, float b, float t, float n, float f) { cimgProj_SetOrtho(h_, l, r, b, t, n, f); }
+        void setOrtho(float l, float r, float b, float t, float n, float f) { cimgProj_SetOrtho(h_, l, r, b, t, n, f); touch3D_(); }
         /// @brief Set perspective projection (fovy in degrees).
-        void setPerspective(float fovyDeg, float aspect, float zNear, float zFar) { cimgProj_SetPerspective(h_, fovyDeg, aspect, zNear, zFar); }
+        void setPerspective(float fovyDeg, float aspect, float zNear, float zFar) { cimgProj_SetPerspective(h_, fovyDeg, aspect, zNear, zFar); touch3D_(); }
 
         // Matrices
 
         /// @brief Fetch current 2D model (row-major 3×3).
-        void model2D_3x3(float outRowMajor3x3[9]) const { cimgGetModel2D_3x3(h_, outRowMajor3x3); }
+        void model2D_3x3(float outRowMajor3x3[9]) const { std::memcpy(outRowMajor3x3, renderState().model2D, sizeof(float) * 9); }
         /// @brief Fetch current 3D model (column-major 4×4).
-        void model3D_4x4(float outColMajor4x4[16]) const { cimgGetModel3D_4x4(h_, outColMajor4x4); }
+        void model3D_4x4(float outColMajor4x4[16]) const { std::memcpy(outColMajor4x4, renderState().model3D, sizeof(float) * 16); }
         /// @brief Fetch current 3D view (column-major 4×4).
-        void view3D_4x4(float outColMajor4x4[16])  const { cimgGetView3D_4x4(h_, outColMajor4x4); }
+        void view3D_4x4(float outColMajor4x4[16])  const { std::memcpy(outColMajor4x4, renderState().view3D, sizeof(float) * 16); }
         /// @brief Fetch current projection (column-major 4×4).
-        void proj_4x4(float outColMajor4x4[16])    const { cimgGetProj_4x4(h_, outColMajor4x4); }
+        void proj_4x4(float outColMajor4x4[16])    const { std::memcpy(outColMajor4x4, renderState().proj, sizeof(float) * 16); }
         /// @brief Fetch current MVP = P*V*M (column-major 4×4).
-        void mvp3D_4x4(float outColMajor4x4[16])   const { cimgGetMVP3D_4x4(h_, outColMajor4x4); }
+        void mvp3D_4x4(float outColMajor4x4[16])   const { std::memcpy(outColMajor4x4, renderState().mvp3D, sizeof(float) * 16); }
 
         // Geometry
 
         /// @brief Transformed quad as 2D tri-strip with UVs ({x,y,u,v} per vertex).
-        void triStrip2D_XYUV(float out4x4[16]) const { cimgTriStrip2D_XYUV(h_, out4x4); }
+        void triStrip2D_XYUV(float out4x4[16]) const { std::memcpy(out4x4, renderState().strip2D, sizeof(float) * 16); }
         /// @brief Unit quad in object space for 3D pipelines ({x,y,u,v} per vertex).
         static void triStrip3D_XYUV_ObjectSpace(float out4x4[16]) { cimgTriStrip3D_XYUV_ObjectSpace(out4x4); }
 
@@ -224,31 +275,100 @@ namespace cimage {
         /// @brief Current upload descriptor (pointer/size/stride/layout).
         CImageUploadDesc uploadDesc() const { CImageUploadDesc d{}; cimgGetUploadDesc(h_, &d); return d; }
 
+        /**
+         * @brief Dirty-rectangle hint of the current image, clamped to it (empty ones dropped).
+         * @param out Receives up to @c CIMG_MAX_DIRTY_RECTS rectangles in pixels.
+         * @return Number of rectangles written; 0 means the whole image.
+         * @note Kept in the wrapper so @c CImageUploadDesc keeps the library's layout.
+         */
+        int dirtyRects(CImageRect out[CIMG_MAX_DIRTY_RECTS]) const {
+            if (dirty_.empty()) return 0;
+            const CImageUploadDesc d = uploadDesc();
+            int n = 0;
+            for (const CImageRect& r : dirty_) {
+                const int32_t x0 = std::max(0, r.x), y0 = std::max(0, r.y);
+                const int32_t x1 = std::min(d.width, r.x + r.width), y1 = std::min(d.height, r.y + r.height);
+                if (x1 > x0 && y1 > y0) out[n++] = CImageRect{ x0, y0, x1 - x0, y1 - y0 };
+            }
+            return n;
+        }
+
         // Input hooks
 
         /// @brief Begin a pointer interaction.
-        void beginPointer(float x, float y, MouseButton btn, KeyMod keyMods) { cimgBeginPointer(h_, x, y, to_c(btn), to_c(keyMods)); }
+        void beginPointer(float x, float y, MouseButton btn, KeyMod keyMods) {
+            cimgBeginPointer(h_, x, y, to_c(btn), to_c(keyMods)); rs_.pointerActive = true; touch2D_(); touch3D_();
+        }
         /// @brief Update pointer position during active interaction.
-        void updatePointer(float x, float y) { cimgUpdatePointer(h_, x, y); }
+        /// @note Hover moves (no interaction active) leave the cached render state valid.
+        void updatePointer(float x, float y) {
+            cimgUpdatePointer(h_, x, y);
+            if (rs_.pointerActive) { touch2D_(); touch3D_(); }
+        }
         /// @brief End current pointer interaction.
-        void endPointer() { cimgEndPointer(h_); }
+        void endPointer() { cimgEndPointer(h_); rs_.pointerActive = false; touch2D_(); touch3D_(); }
         /**
          * @brief Mouse wheel / trackpad zoom or dolly.
          * @param delta   Positive for zoom/dolly in.
          * @param cx,cy   Cursor at event time (pixels).
          */
-        void wheelScroll(float delta, float cx, float cy) { cimgWheelScroll(h_, delta, cx, cy); }
+        void wheelScroll(float delta, float cx, float cy) { cimgWheelScroll(h_, delta, cx, cy); touch2D_(); touch3D_(); }
 
         /// @brief Keyboard panning in 2D mode (pixels).
-        void keyPan2D(float dx, float dy) { cimgKeyPan2D(h_, dx, dy); }
+        void keyPan2D(float dx, float dy) { cimgKeyPan2D(h_, dx, dy); touch2D_(); }
         /// @brief Keyboard dolly in 3D mode (world units along view).
-        void keyDolly3D(float amount) { cimgKeyDolly3D(h_, amount); }
+        void keyDolly3D(float amount) { cimgKeyDolly3D(h_, amount); touch3D_(); }
+
+        // Render state
+
+        /**
+         * @brief All matrices and the 2D quad in one call, refetched only after a change.
+         * @return Cached state. Compare @c version2D / @c version3D with the last values seen
+         *         to skip re-uploading unchanged uniforms/geometry.
+         */
+        const RenderState& renderState() const {
+            if (rs_.fetched2D != rs_.v2D) {
+                cimgGetModel2D_3x3(h_, rs_.state.model2D);
+                cimgTriStrip2D_XYUV(h_, rs_.state.strip2D);
+                rs_.fetched2D = rs_.state.version2D = rs_.v2D;
+            }
+            if (rs_.fetched3D != rs_.v3D) {
+                cimgGetModel3D_4x4(h_, rs_.state.model3D);
+                cimgGetView3D_4x4(h_, rs_.state.view3D);
+                cimgGetProj_4x4(h_, rs_.state.proj);
+                cimgGetMVP3D_4x4(h_, rs_.state.mvp3D);
+                rs_.fetched3D = rs_.state.version3D = rs_.v3D;
+            }
+            return rs_.state;
+        }
+        /// @brief Force the next @ref renderState to refetch everything (e.g., after using @ref raw).
+        void invalidateRenderState() { touch2D_(); touch3D_(); }
 
         /// @brief Expose raw C handle for low-level interop.
         CImageDisplayerHandle raw() const noexcept { return h_; }
 
     private:
+        /// Versioned cache of the render state (see @ref renderState).
+        struct RenderCache {
+            RenderState state{};
+            uint64_t v2D = 1, v3D = 1;             ///< Current versions (advanced by setters/input).
+            uint64_t fetched2D = 0, fetched3D = 0; ///< Versions held in @c state.
+            int      vpW = -1, vpH = -1;           ///< Last viewport (re-setting the same size keeps the cache).
+            uint32_t imgW = 0, imgH = 0;           ///< Last image size (fit depends on it).
+            bool     pointerActive = false;
+        };
+
+        void touch2D_() { ++rs_.v2D; }
+        void touch3D_() { ++rs_.v3D; }
+        void touchImageSize_(uint32_t w, uint32_t h) {
+            if (w == rs_.imgW && h == rs_.imgH) return; // same-size frames keep the cache
+            rs_.imgW = w; rs_.imgH = h;
+            touch2D_(); touch3D_();
+        }
+
         CImageDisplayerHandle h_{ nullptr }; ///< Owned C handle.
+        std::vector<CImageRect> dirty_;      ///< Dirty-rectangle hint for the current image (empty = whole image).
+        mutable RenderCache rs_;             ///< Cached matrices/geometry.
     };
 
 } // namespace cimage
@@ -0,0 +1,412 @@
+#pragma once
+//
+// CImageDisplayerGpu.h  —  GPU upload descriptors + reference GLSL ES shaders
+// - Maps a csh_img::CSH_Image to the texture to upload and the shader that decodes it
+// - YUV422 / 16-bit gray / Bayer are converted in the fragment shader (no CPU pass)
+// - Header-only; no GL headers needed (GL enum values are spelled out)
+//
+// C++17
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "CSH_Image.h"
+
+/**
+ * @file CImageDisplayerGpu.h
+ * @brief Zero-CPU-conversion display path for CImageDisplayer renderers.
+ *
+ * @ref cimage::MakeGpuUploadDesc describes how to upload a frame as-is and which reference
+ * fragment shader (@ref cimage::GpuShader) turns the texels into RGB:
+ *
+ * | Format               | Texture                        | Shader                              |
+ * |----------------------|--------------------------------|-------------------------------------|
+ * | Gray8                | R8 (swizzled to gray)          | Passthrough                         |
+ * | RGB888 / BGR888      | RGB8 (BGR swizzled)            | Passthrough                         |
+ * | RGB565               | RGB565                         | Passthrough                         |
+ * | YUV422 (4 orders)    | RGBA8, half width (1 texel = 2 px) | Yuv422 (BT.601)                 |
+ * | Gray10..16           | R16UI                          | Gray16 (window/level)               |
+ * | Bayer8               | R8                             | Bayer8 (bilinear demosaic)          |
+ * | Bayer10..16          | R16UI                          | Bayer16 (demosaic + window/level)   |
+ *
+ * All shaders share the vertex stage of the renderer (`vUV` in, `FragColor` out) and use
+ * the uniforms listed in @ref cimage::GpuUploadDesc. 16-bit data uses integer textures
+ * (core in OpenGL ES 3.0), so no normalized 16-bit texture extension is required.
+ *
+ * Typical use (GL ES 3):
+ * @code
+ * auto g = cimage::MakeGpuUploadDesc(img, { window, level });
+ * glUseProgram(programFor[g.shader]);            // compiled from GpuFragmentShader(g.shader)
+ * glPixelStorei(GL_UNPACK_ROW_LENGTH, g.rowLength);
+ * glTexImage2D(GL_TEXTURE_2D, 0, g.glInternalFormat, g.texWidth, g.texHeight, 0, g.glFormat, g.glType, g.data);
+ * cimage::ApplyGpuUniforms(g, glGetUniformLocation...);  // or set them directly
+ * @endcode
+ */
+namespace cimage {
+
+    /// Reference fragment shader that decodes a @ref GpuUploadDesc texture.
+    enum class GpuShader : uint32_t {
+        None = 0,      ///< Unsupported frame (nothing to upload).
+        Passthrough,   ///< Sample RGB(A) as is (texture swizzle does gray/BGR).
+        Yuv422,        ///< Packed YUV 4:2:2 in an RGBA8 texture of half width.
+        Gray16,        ///< 16-bit gray in R16UI with window/level.
+        Bayer8,        ///< 8-bit Bayer in R8, bilinear demosaic.
+        Bayer16,       ///< 10..16-bit Bayer in R16UI, bilinear demosaic with window/level.
+        Count
+    };
+
+    /// Display parameters for 16-bit data and Bayer frames.
+    struct GpuViewParams {
+        float window = 0.f;     ///< Raw-value range shown black..white (0 = full range of original_bit).
+        float level = 0.f;      ///< Raw value at mid-gray (used when window > 0).
+        bool  demosaic = true;  ///< Bayer: demosaic (false = show the mosaic as gray).
+    };
+
+    /// Rectangle of a partial upload (x,y = top-left); same layout as the C ABI's @c CImageRect.
+    struct GpuRect { int x = 0, y = 0, width = 0, height = 0; };
+
+    /// Maximum dirty rectangles per upload (matches @c CIMG_MAX_DIRTY_RECTS).
+    inline constexpr int kGpuMaxDirtyRects = 16;
+#ifdef CIMG_MAX_DIRTY_RECTS
+    static_assert(kGpuMaxDirtyRects == CIMG_MAX_DIRTY_RECTS, "dirty-rectangle limits must match");
+#endif
+
+    /**
+     * @brief What to upload and how to decode it.
+     * @note GL values are OpenGL ES 3 enums (e.g., 0x8229 = GL_R8) so this header needs no GL include.
+     */
+    struct GpuUploadDesc {
+        GpuShader shader = GpuShader::None;
+        const std::uint8_t* data = nullptr;  ///< First byte to upload.
+        int imageWidth = 0, imageHeight = 0; ///< Displayed pixels (uniform uImageSize).
+        int texWidth = 0, texHeight = 0;     ///< Texels to upload.
+        int rowLength = 0;                   ///< GL_UNPACK_ROW_LENGTH in texels (0 = tightly packed).
+        int texelBytes = 0;                  ///< Bytes per texel (row bytes = texWidth * texelBytes).
+        uint32_t glInternalFormat = 0;       ///< e.g., GL_R8, GL_RGBA8, GL_R16UI.
+        uint32_t glFormat = 0;               ///< e.g., GL_RED, GL_RGBA, GL_RED_INTEGER.
+        uint32_t glType = 0;                 ///< e.g., GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT.
+        bool integerTexture = false;         ///< Sample with NEAREST filtering (usampler2D).
+        bool nearest = false;                ///< Shader fetches exact texels; use NEAREST filtering.
+        uint32_t swizzle[4] = { 0x1903, 0x1904, 0x1905, 1 }; ///< GL_TEXTURE_SWIZZLE_R/G/B/A (Passthrough).
+        float ySel0[4] = {}, ySel1[4] = {};  ///< Yuv422: texel component of the even / odd pixel's Y (uYSel0/uYSel1).
+        float uSel[4] = {}, vSel[4] = {};    ///< Yuv422: texel component of U / V (uUSel/uVSel).
+        int   firstRed[2] = { 0, 0 };        ///< Bayer: red pixel position in the 2x2 tile (uFirstRed).
+        float low = 0.f;                     ///< Value shown black (uLow; raw units, or 0..1 for 8-bit).
+        float invRange = 1.f;                ///< 1 / (white - black) (uInvRange).
+        int   rectCount = 0;                 ///< Dirty texel rectangles in rects (0 = whole texture).
+        GpuRect rects[kGpuMaxDirtyRects];    ///< Upload with GL_UNPACK_SKIP_PIXELS/ROWS = x/y and glTexSubImage2D(x, y, w, h).
+    };
+
+    namespace gpu_detail {
+        constexpr uint32_t kR8 = 0x8229, kRGB8 = 0x8051, kRGBA8 = 0x8058, kRGB565 = 0x8D62, kR16UI = 0x8234;
+        constexpr uint32_t kRed = 0x1903, kGreen = 0x1904, kBlue = 0x1905, kAlpha = 0x1906, kRGB = 0x1907, kRGBA = 0x1908;
+        constexpr uint32_t kRedInteger = 0x8D94, kOne = 1;
+        constexpr uint32_t kUByte = 0x1401, kUShort = 0x1403, kUShort565 = 0x8363;
+
+        inline void sel(float* v, int i) { v[0] = v[1] = v[2] = v[3] = 0.f; v[i] = 1.f; }
+    } // namespace gpu_detail
+
+    /**
+     * @brief Describe the GPU upload of @p img's current view.
+     * @param strideBytes Row pitch of the data (0 = tightly packed).
+     * @return Descriptor with shader == @ref GpuShader::None for unsupported frames.
+     */
+    inline GpuUploadDesc MakeGpuUploadDesc(const csh_img::CSH_Image& img, const GpuViewParams& p = {},
+        int strideBytes = 0) {
+        using namespace gpu_detail;
+        using csh_img::En_ImageFormat;
+        using csh_img::En_ImagePattern;
+        GpuUploadDesc g;
+        g.data = img.data();
+        g.imageWidth = g.texWidth = static_cast<int>(img.getWidth());
+        g.imageHeight = g.texHeight = static_cast<int>(img.getHeight());
+        if (!g.data || img.getWidth() == 0 || img.getHeight() == 0 || img.getMemoryAlign() != csh_img::En_ImageMemoryAlign::Packed) return g;
+
+        const uint32_t fmt = static_cast<uint32_t>(img.getFormat());
+        const bool wide = fmt >= 200 && fmt < 300 && img.getFormat() != En_ImageFormat::YUV422 && img.getFormat() != En_ImageFormat::RGB565;
+        const bool bayer = img.getFormat() == En_ImageFormat::Bayer8 || (fmt >= 200 && fmt <= 203);
+        int texelBytes = 1;
+
+        if (img.getFormat() == En_ImageFormat::RGB888 || img.getFormat() == En_ImageFormat::BGR888) {
+            g.shader = GpuShader::Passthrough;
+            g.glInternalFormat = kRGB8; g.glFormat = kRGB; g.glType = kUByte;
+            if (img.getFormat() == En_ImageFormat::BGR888) { g.swizzle[0] = kBlue; g.swizzle[2] = kRed; }
+            texelBytes = 3;
+        }
+        else if (img.getFormat() == En_ImageFormat::RGB565) {
+            g.shader = GpuShader::Passthrough;
+            g.glInternalFormat = kRGB565; g.glFormat = kRGB; g.glType = kUShort565;
+            texelBytes = 2;
+        }
+        else if (img.getFormat() == En_ImageFormat::YUV422) {
+            if (img.getWidth() & 1) return g;
+            g.shader = GpuShader::Yuv422;
+            g.glInternalFormat = kRGBA8; g.glFormat = kRGBA; g.glType = kUByte;
+            g.texWidth = static_cast<int>(img.getWidth() / 2);
+            g.nearest = true;
+            g.swizzle[3] = kAlpha; // the 4th byte is Y or V, not opacity
+            texelBytes = 4;
+            int y0 = 0, u = 1, y1 = 2, v = 3;                                          // YUYV
+            if (img.getPattern() == En_ImagePattern::UYVY) { u = 0; y0 = 1; v = 2; y1 = 3; }
+            else if (img.getPattern() == En_ImagePattern::YVYU) { y0 = 0; v = 1; y1 = 2; u = 3; }
+            else if (img.getPattern() == En_ImagePattern::VYUY) { v = 0; y0 = 1; u = 2; y1 = 3; }
+            sel(g.ySel0, y0); sel(g.ySel1, y1); sel(g.uSel, u); sel(g.vSel, v);
+        }
+        else if (fmt < 200 && !(bayer && p.demosaic)) { // Gray8, or Bayer8 shown as mosaic
+            g.shader = GpuShader::Passthrough;
+            g.glInternalFormat = kR8; g.glFormat = kRed; g.glType = kUByte;
+            g.swizzle[0] = g.swizzle[1] = g.swizzle[2] = kRed;
+            g.swizzle[3] = kOne;
+        }
+        else if (fmt < 200) {                            // Bayer8
+            g.shader = GpuShader::Bayer8;
+            g.glInternalFormat = kR8; g.glFormat = kRed; g.glType = kUByte;
+            g.nearest = true;
+        }
+        else if (wide) {                                 // 10..16 bit in 16-bit containers
+            g.shader = bayer && p.demosaic ? GpuShader::Bayer16 : GpuShader::Gray16;
+            g.glInternalFormat = kR16UI; g.glFormat = kRedInteger; g.glType = kUShort;
+            g.integerTexture = g.nearest = true;
+            texelBytes = 2;
+        }
+        else {
+            return g;                                    // 24-bit YUYV444 and others: no reference path
+        }
+
+        if (bayer) {
+            switch (img.getPattern()) {
+            case En_ImagePattern::GRBG: g.firstRed[0] = 1; g.firstRed[1] = 0; break;
+            case En_ImagePattern::GBRG: g.firstRed[0] = 0; g.firstRed[1] = 1; break;
+            case En_ImagePattern::BGGR: g.firstRed[0] = 1; g.firstRed[1] = 1; break;
+            default: break;                                                    // RGGB
+            }
+        }
+
+        // Window/level in raw units (16-bit) or normalized units (8-bit textures).
+        const uint32_t bits = wide ? (img.getOriginalBit() >= 8 && img.getOriginalBit() <= 16 ? img.getOriginalBit() : 16u) : 8u;
+        const float full = static_cast<float>((1u << bits) - 1u);
+        float lo = 0.f, hi = full;
+        if (p.window > 0.f) {
+            lo = p.level - p.window * 0.5f;
+            hi = p.level + p.window * 0.5f;
+        }
+        const float unit = g.integerTexture ? 1.f : 1.f / 255.f;
+        g.low = lo * unit;
+        g.invRange = hi > lo ? 1.f / ((hi - lo) * unit) : 1.f;
+
+        g.texelBytes = texelBytes;
+        if (strideBytes > 0 && strideBytes != g.texWidth * texelBytes) g.rowLength = strideBytes / texelBytes;
+        return g;
+    }
+
+    /**
+     * @brief Restrict @p g to the changed pixel rectangles.
+     * @tparam Rect Any {x, y, width, height} rectangle (@ref GpuRect, @c CImageRect from
+     *              @c CImageDisplayerCPP::dirtyRects, ...).
+     * @param count 0 keeps the whole-texture upload. Rectangles are converted to texels
+     *              (YUV422: two pixels per texel) and clamped.
+     */
+    template <class Rect>
+    inline void SetGpuDirtyRects(GpuUploadDesc& g, const Rect* rects, int count) {
+        g.rectCount = 0;
+        if (!rects || count <= 0 || count > kGpuMaxDirtyRects || g.imageWidth <= 0) return;
+        const int div = g.texWidth < g.imageWidth ? 2 : 1;
+        for (int i = 0; i < count; ++i) {
+            const int rx = static_cast<int>(rects[i].x), ry = static_cast<int>(rects[i].y);
+            const int rw = static_cast<int>(rects[i].width), rh = static_cast<int>(rects[i].height);
+            const int x0 = std::max(0, rx / div);
+            const int x1 = std::min(g.texWidth, (rx + rw + div - 1) / div);
+            const int y0 = std::max(0, ry);
+            const int y1 = std::min(g.texHeight, ry + rh);
+            if (x1 > x0 && y1 > y0) g.rects[g.rectCount++] = GpuRect{ x0, y0, x1 - x0, y1 - y0 };
+        }
+        if (g.rectCount == 0) {
+            // Nothing inside the texture: keep a zero-area upload rather than the whole texture.
+            g.rects[0] = GpuRect{};
+            g.rectCount = 1;
+        }
+    }
+
+    /**
+     * @brief Add the rectangles of a superseded upload @p older to @p g (same texture).
+     * @note A whole-texture upload on either side yields a whole-texture upload; overflow
+     *       collapses to the bounding rectangle.
+     */
+    inline void MergeGpuDirtyRects(GpuUploadDesc& g, const GpuUploadDesc& older) {
+        if (g.rectCount == 0) return;
+        if (older.rectCount == 0) { g.rectCount = 0; return; }
+        for (int i = 0; i < older.rectCount; ++i) {
+            if (g.rectCount < kGpuMaxDirtyRects) { g.rects[g.rectCount++] = older.rects[i]; continue; }
+            int x0 = older.rects[i].x, y0 = older.rects[i].y;
+            int x1 = x0 + older.rects[i].width, y1 = y0 + older.rects[i].height;
+            for (int k = 0; k < g.rectCount; ++k) {
+                x0 = std::min(x0, g.rects[k].x); y0 = std::min(y0, g.rects[k].y);
+                x1 = std::max(x1, g.rects[k].x + g.rects[k].width);
+                y1 = std::max(y1, g.rects[k].y + g.rects[k].height);
+            }
+            g.rects[0] = GpuRect{ x0, y0, x1 - x0, y1 - y0 };
+            g.rectCount = 1;
+        }
+    }
+
+    /**
+     * @brief Frame-diff: find the tiles of @p cur that differ from @p prev, merged into rectangles.
+     * @param strideBytes   Row pitch of both buffers (0 = width * bytesPerPixel).
+     * @param tile          Tile edge in pixels (e.g., 64).
+     * @param out,maxOut    Output rectangles in pixels.
+     * @return Number of rectangles (0 = identical). If more than @p maxOut are needed,
+     *         a single bounding rectangle is returned.
+     */
+    inline int FindDirtyRects(const std::uint8_t* prev, const std::uint8_t* cur, int width, int height,
+        int strideBytes, int bytesPerPixel, int tile, GpuRect* out, int maxOut) {
+        if (!prev || !cur || width <= 0 || height <= 0 || bytesPerPixel <= 0 || !out || maxOut <= 0) return 0;
+        tile = std::max(8, tile);
+        const std::size_t pitch = strideBytes > 0 ? static_cast<std::size_t>(strideBytes)
+            : static_cast<std::size_t>(width) * static_cast<std::size_t>(bytesPerPixel);
+        const int tilesX = (width + tile - 1) / tile;
+        std::vector<GpuRect> rects;
+        std::vector<char> dirty(static_cast<std::size_t>(tilesX));
+        std::size_t prevBand = 0; // first rectangle produced by the previous band
+
+        for (int y = 0; y < height; y += tile) {
+            const int bandH = std::min(tile, height - y);
+            std::fill(dirty.begin(), dirty.end(), 0);
+            for (int r = 0; r < bandH; ++r) {
+                const std::size_t off = pitch * static_cast<std::size_t>(y + r);
+                for (int tx = 0; tx < tilesX; ++tx) {
+                    if (dirty[static_cast<std::size_t>(tx)]) continue;
+                    const int x = tx * tile, w = std::min(tile, width - x);
+                    const std::size_t o = off + static_cast<std::size_t>(x) * static_cast<std::size_t>(bytesPerPixel);
+                    dirty[static_cast<std::size_t>(tx)] =
+                        std::memcmp(prev + o, cur + o, static_cast<std::size_t>(w) * static_cast<std::size_t>(bytesPerPixel)) != 0;
+                }
+            }
+            // Runs of dirty tiles; extend a rectangle of the previous band with the same span.
+            const std::size_t bandBegin = rects.size();
+            for (int tx = 0; tx < tilesX;) {
+                if (!dirty[static_cast<std::size_t>(tx)]) { ++tx; continue; }
+                const int t0 = tx;
+                while (tx < tilesX && dirty[static_cast<std::size_t>(tx)]) ++tx;
+                const int x0 = t0 * tile, x1 = std::min(width, tx * tile);
+                bool merged = false;
+                for (std::size_t k = prevBand; k < bandBegin; ++k) {
+                    GpuRect& p = rects[k];
+                    if (p.x == x0 && p.width == x1 - x0 && p.y + p.height == y) { p.height += bandH; merged = true; break; }
+                }
+                if (!merged) rects.push_back(GpuRect{ x0, y, x1 - x0, bandH });
+            }
+            // Rectangles extended in this band stay candidates for the next one.
+            std::size_t keep = prevBand;
+            while (keep < bandBegin && rects[keep].y + rects[keep].height != y + bandH) ++keep;
+            prevBand = keep;
+        }
+
+        if (rects.size() <= static_cast<std::size_t>(maxOut)) {
+            std::copy(rects.begin(), rects.end(), out);
+            return static_cast<int>(rects.size());
+        }
+        int x0 = width, y0 = height, x1 = 0, y1 = 0;
+        for (const GpuRect& r : rects) {
+            x0 = std::min(x0, r.x); y0 = std::min(y0, r.y);
+            x1 = std::max(x1, r.x + r.width); y1 = std::max(y1, r.y + r.height);
+        }
+        out[0] = GpuRect{ x0, y0, x1 - x0, y1 - y0 };
+        return 1;
+    }
+
+    // ---------------- Reference fragment shaders (GLSL ES 3.10, like the sample renderer) ----------------
+
+#define CIMG_GPU_FS_HEADER \
+    "#version 310 es\n" \
+    "precision highp float;\n" \
+    "precision highp int;\n" \
+    "in vec2 vUV;\n" \
+    "out vec4 FragColor;\n" \
+    "uniform ivec2 uImageSize;\n" \
+    "uniform float uLow;\n" \
+    "uniform float uInvRange;\n" \
+    "ivec2 pixelAt(vec2 uv){ return clamp(ivec2(uv * vec2(uImageSize)), ivec2(0), uImageSize - 1); }\n"
+
+#define CIMG_GPU_FS_BAYER_BODY \
+    "uniform ivec2 uFirstRed;\n" \
+    "float px(ivec2 p){ return clamp((fetchRaw(clamp(p, ivec2(0), uImageSize - 1)) - uLow) * uInvRange, 0.0, 1.0); }\n" \
+    "void main(){\n" \
+    "    ivec2 p = pixelAt(vUV);\n" \
+    "    float c = px(p);\n" \
+    "    float cross4 = 0.25 * (px(p + ivec2(-1, 0)) + px(p + ivec2(1, 0)) + px(p + ivec2(0, -1)) + px(p + ivec2(0, 1)));\n" \
+    "    float diag4  = 0.25 * (px(p + ivec2(-1, -1)) + px(p + ivec2(1, -1)) + px(p + ivec2(-1, 1)) + px(p + ivec2(1, 1)));\n" \
+    "    float horiz  = 0.5 * (px(p + ivec2(-1, 0)) + px(p + ivec2(1, 0)));\n" \
+    "    float vert   = 0.5 * (px(p + ivec2(0, -1)) + px(p + ivec2(0, 1)));\n" \
+    "    ivec2 q = (p + uFirstRed) & 1;\n" \
+    "    vec3 rgb;\n" \
+    "    if (q.x == 0 && q.y == 0)      rgb = vec3(c, cross4, diag4);\n" \
+    "    else if (q.x == 1 && q.y == 1) rgb = vec3(diag4, cross4, c);\n" \
+    "    else if (q.y == 0)             rgb = vec3(horiz, c, vert);\n" \
+    "    else                           rgb = vec3(vert, c, horiz);\n" \
+    "    FragColor = vec4(rgb, 1.0);\n" \
+    "}\n"
+
+    /// Passthrough: the renderer's plain textured quad (swizzle handled by sampler state).
+    inline constexpr const char* kGpuFsPassthrough =
+        CIMG_GPU_FS_HEADER
+        "uniform sampler2D uTex;\n"
+        "void main(){ FragColor = texture(uTex, vUV); }\n";
+
+    /// Packed YUV 4:2:2: one RGBA8 texel holds two pixels; BT.601 limited range to RGB.
+    inline constexpr const char* kGpuFsYuv422 =
+        CIMG_GPU_FS_HEADER
+        "uniform sampler2D uTex;\n"
+        "uniform vec4 uYSel0, uYSel1, uUSel, uVSel;\n"
+        "void main(){\n"
+        "    ivec2 p = pixelAt(vUV);\n"
+        "    vec4 t = texelFetch(uTex, ivec2(p.x >> 1, p.y), 0);\n"
+        "    float y = dot(t, (p.x & 1) == 0 ? uYSel0 : uYSel1);\n"
+        "    float u = dot(t, uUSel) - 0.5;\n"
+        "    float v = dot(t, uVSel) - 0.5;\n"
+        "    y = 1.164 * (y - 0.0625);\n"
+        "    FragColor = vec4(clamp(vec3(y + 1.596 * v, y - 0.392 * u - 0.813 * v, y + 2.017 * u), 0.0, 1.0), 1.0);\n"
+        "}\n";
+
+    /// 16-bit gray with window/level.
+    inline constexpr const char* kGpuFsGray16 =
+        CIMG_GPU_FS_HEADER
+        "uniform highp usampler2D uTexU;\n"
+        "void main(){\n"
+        "    float v = float(texelFetch(uTexU, pixelAt(vUV), 0).r);\n"
+        "    FragColor = vec4(vec3(clamp((v - uLow) * uInvRange, 0.0, 1.0)), 1.0);\n"
+        "}\n";
+
+    /// 8-bit Bayer, bilinear demosaic.
+    inline constexpr const char* kGpuFsBayer8 =
+        CIMG_GPU_FS_HEADER
+        "uniform sampler2D uTex;\n"
+        "float fetchRaw(ivec2 p){ return texelFetch(uTex, p, 0).r; }\n"
+        CIMG_GPU_FS_BAYER_BODY;
+
+    /// 10..16-bit Bayer, bilinear demosaic with window/level.
+    inline constexpr const char* kGpuFsBayer16 =
+        CIMG_GPU_FS_HEADER
+        "uniform highp usampler2D uTexU;\n"
+        "float fetchRaw(ivec2 p){ return float(texelFetch(uTexU, p, 0).r); }\n"
+        CIMG_GPU_FS_BAYER_BODY;
+
+#undef CIMG_GPU_FS_BAYER_BODY
+#undef CIMG_GPU_FS_HEADER
+
+    /// @return Fragment shader source for @p s (nullptr for None).
+    inline const char* GpuFragmentShader(GpuShader s) {
+        switch (s) {
+        case GpuShader::Passthrough: return kGpuFsPassthrough;
+        case GpuShader::Yuv422:      return kGpuFsYuv422;
+        case GpuShader::Gray16:      return kGpuFsGray16;
+        case GpuShader::Bayer8:      return kGpuFsBayer8;
+        case GpuShader::Bayer16:     return kGpuFsBayer16;
+        default:                     return nullptr;
+        }
+    }
+
+} // namespace cimage
@@ -0,0 +1,478 @@
+#pragma once
+//
+// CImageMosaic.h  —  N image streams in one view (grid of tiles)
+// - One CImageDisplayerCPP per tile: own fit and 2D transform, input routed by cursor
+// - All tiles packed into one texture atlas: one upload list, one draw (GL_TRIANGLES)
+// - Each cell has a gutter of replicated edge texels, so filtering and demosaic stay in the cell
+// - Tile quads are clipped to their tile on the CPU, so no per-tile scissor is needed
+// - Header-only; framework agnostic like CImageDisplayer
+//
+// C++17
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "CImageDisplayerCPP.h"
+#include "CImageDisplayerGpu.h"
+
+/**
+ * @file CImageMosaic.h
+ * @brief Multi-view mosaic on top of @ref cimage::CImageDisplayerCPP.
+ *
+ * The viewport is split into a grid of tiles. Each tile owns a @ref cimage::CImageDisplayerCPP
+ * (fit mode, pan/zoom/rotate) whose viewport is the tile. Images are packed into an atlas of
+ * equally sized cells, laid out in the same grid, so every stream lands in one texture:
+ *
+ * @code
+ * cimage::CImageMosaic mosaic(4);                 // 2x2
+ * mosaic.setViewport(fbW, fbH);
+ *
+ * // render thread, once per frame: the newest frame of every stream (e.g. from a CFramePuller each)
+ * for (int cam = 0; cam < 4; ++cam) mosaic.setImage(cam, latest[cam]);
+ *
+ * const cimage::GpuUploadDesc a = mosaic.atlasDesc(); // format, shader, uniforms (uImageSize = atlas)
+ * if (mosaic.atlasVersion() != texVersion)        // (re)allocate the atlas texture
+ *     glTexImage2D(GL_TEXTURE_2D, 0, a.glInternalFormat, a.texWidth, a.texHeight, 0, a.glFormat, a.glType, nullptr);
+ * for (const auto& u : mosaic.uploads())          // changed tiles: image (or dirty rects) + gutter
+ *     for (const auto& b : u.blits) {
+ *         glPixelStorei(GL_UNPACK_ROW_LENGTH, b.rowLength);
+ *         glTexSubImage2D(GL_TEXTURE_2D, 0, b.x, b.y, b.width, b.height, a.glFormat, a.glType, b.data);
+ *     }
+ * std::vector<float> tris;                        // {x,y,u,v} per vertex, viewport pixels + atlas UVs
+ * mosaic.triangles(tris);
+ * glDrawArrays(GL_TRIANGLES, 0, GLsizei(tris.size() / 4));
+ * @endcode
+ *
+ * Pointer and wheel events go to the tile under the cursor (a drag stays with the tile it
+ * started in); keyboard panning goes to the focused tile (last clicked or scrolled).
+ *
+ * @note All tiles in the atlas must share one pixel format (a single texture format and
+ *       decode shader). Tiles whose format differs from the first populated tile are
+ *       left out of @ref uploads and @ref triangles.
+ * @note Atlas cells are even-sized and even-aligned, so YUV422 texel pairs and Bayer CFA
+ *       parity are preserved inside the atlas. Each image sits inside a gutter of
+ *       @ref CImageMosaic::kGutter pixels whose inner ring repeats the image's edge texels, so
+ *       linear filtering and the Bayer/Gray16 neighbour fetches of the reference shaders read
+ *       what a standalone texture (clamped to its edge) would, never a neighbouring cell.
+ * @note 2D only. Threading: like @ref cimage::CImageDisplayerCPP, everything (including
+ *       @ref setImage) is called from one thread, normally the render thread; capture
+ *       callbacks hand their frames over to it instead of calling the mosaic.
+ */
+namespace cimage {
+
+    /// Rectangle in viewport pixels (x,y = top-left).
+    struct MosaicRect { int x = 0, y = 0, width = 0, height = 0; };
+
+    /// Mosaic layout options.
+    struct MosaicOptions {
+        int columns = 0;   ///< Grid columns (0 = near-square for the tile count).
+        int gap = 2;       ///< Gap between tiles in viewport pixels.
+    };
+
+    /// One glTexSubImage2D into the atlas (atlas texels, format of @ref CImageMosaic::atlasDesc).
+    struct MosaicBlit {
+        const std::uint8_t* data = nullptr;  ///< First source texel.
+        int rowLength = 0;                   ///< GL_UNPACK_ROW_LENGTH in texels (0 = tightly packed; alignment 1).
+        int x = 0, y = 0;                    ///< Destination texel.
+        int width = 0, height = 0;           ///< Texels.
+    };
+
+    /// Where one tile's image goes in the atlas.
+    struct MosaicUpload {
+        int tile = 0;                ///< Tile index.
+        int atlasX = 0, atlasY = 0;  ///< Image offset in the atlas, pixels (even).
+        int texelX = 0, texelY = 0;  ///< Image offset in the atlas, texels (atlasX / 2 for YUV422).
+        CImageUploadDesc desc{};     ///< Source image (data/stride/format).
+        GpuUploadDesc gpu;           ///< Source image as texels, with the tile's dirty rectangles.
+        /// What to upload, in order: the image (or its dirty rectangles), then the gutter ring.
+        /// Empty for formats without a reference shader (@ref GpuShader::None).
+        std::vector<MosaicBlit> blits;
+    };
+
+    class CImageMosaic {
+    public:
+        /// Gutter around each image in its atlas cell, pixels (even: keeps YUV/Bayer parity).
+        static constexpr int kGutter = 2;
+
+        /// @param tiles Number of streams (>= 1).
+        explicit CImageMosaic(int tiles, MosaicOptions o = {}) : opt_(o) {
+            const int n = std::max(1, tiles);
+            cols_ = opt_.columns > 0 ? std::min(opt_.columns, n)
+                : static_cast<int>(std::ceil(std::sqrt(static_cast<double>(n))));
+            rows_ = (n + cols_ - 1) / cols_;
+            tiles_.resize(static_cast<size_t>(n));
+            for (auto& t : tiles_) {
+                t.view = std::make_unique<CImageDisplayerCPP>();
+                t.view->setDimensionality(Dimensionality::_2D);
+                t.view->setFitMode(FitMode::Fit);
+            }
+        }
+
+        /// @return Number of tiles.
+        int tileCount() const noexcept { return static_cast<int>(tiles_.size()); }
+        /// @return Grid columns / rows.
+        int columns() const noexcept { return cols_; }
+        int rows() const noexcept { return rows_; }
+
+        /// @brief Per-tile view (fit mode, 2D transform, dirty hints...).
+        CImageDisplayerCPP& view(int i) { return *tiles_.at(static_cast<size_t>(i)).view; }
+        const CImageDisplayerCPP& view(int i) const { return *tiles_.at(static_cast<size_t>(i)).view; }
+
+        // ---- layout ----
+
+        /// @brief Set the full viewport and lay the tiles out in the grid.
+        void setViewport(int w, int h) {
+            if (w == vpW_ && h == vpH_) return;
+            vpW_ = std::max(0, w); vpH_ = std::max(0, h);
+            const int g = std::max(0, opt_.gap);
+            for (int i = 0; i < tileCount(); ++i) {
+                const int c = i % cols_, r = i / cols_;
+                const int x0 = (vpW_ + g) * c / cols_, x1 = (vpW_ + g) * (c + 1) / cols_ - g;
+                const int y0 = (vpH_ + g) * r / rows_, y1 = (vpH_ + g) * (r + 1) / rows_ - g;
+                Tile& t = tiles_[static_cast<size_t>(i)];
+                t.rect = MosaicRect{ x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0) };
+                t.view->setViewport(t.rect.width, t.rect.height);
+            }
+            ++layoutVersion_;
+        }
+
+        /// @return Tile rectangle in viewport pixels.
+        const MosaicRect& tileRect(int i) const { return tiles_.at(static_cast<size_t>(i)).rect; }
+
+        /// @return Tile under viewport point (x,y), or -1 (gap/outside).
+        int tileAt(float x, float y) const {
+            for (int i = 0; i < tileCount(); ++i) {
+                const MosaicRect& r = tiles_[static_cast<size_t>(i)].rect;
+                if (x >= r.x && x < r.x + r.width && y >= r.y && y < r.y + r.height) return i;
+            }
+            return -1;
+        }
+
+        /// @return Tile receiving keyboard input (-1 = none yet).
+        int focusedTile() const noexcept { return focus_; }
+        void setFocusedTile(int i) { focus_ = (i >= 0 && i < tileCount()) ? i : -1; }
+
+        // ---- images ----
+
+        /**
+         * @brief Set tile @p i's image (see @ref CImageDisplayerCPP::setImage).
+         * @note Shallow references @p img's buffer; keep it alive until it has been uploaded.
+         */
+        void setImage(int i, const csh_img::CSH_Image& img, csh_img::CopyMode mode = csh_img::CopyMode::Shallow) {
+            setImage(i, img, mode, nullptr, 0);
+        }
+
+        /**
+         * @brief Set tile @p i's image with a dirty-rectangle hint (changes since its previous image).
+         * @note The hint is used only if this is the tile's only image since the last @ref uploads;
+         *       otherwise the whole image is uploaded.
+         */
+        void setImage(int i, const csh_img::CSH_Image& img, csh_img::CopyMode mode, const CImageRect* dirty, int count) {
+            Tile& t = tiles_.at(static_cast<size_t>(i));
+            t.view->setImage(img, mode, dirty, count);
+            ++t.pending;
+            const CImageUploadDesc d = t.view->uploadDesc();
+            t.gpu = MakeGpuUploadDesc(img, params_, d.strideBytes);
+            t.gpu.data = d.data; // the view's buffer (its own copy for CopyMode::Deep)
+            const uint32_t w = img.getWidth(), h = img.getHeight();
+            const uint64_t key = (static_cast<uint64_t>(img.getFormat()) << 32) | static_cast<uint32_t>(img.getPattern());
+            if (!t.hasImage || w != t.imgW || h != t.imgH || key != t.formatKey) {
+                t.imgW = w; t.imgH = h; t.formatKey = key; t.hasImage = true;
+                relayoutAtlas_();
+            }
+        }
+
+        /// @brief Window/level and demosaic for the atlas; applies from each tile's next @ref setImage.
+        void setViewParams(const GpuViewParams& p) { params_ = p; }
+
+        // ---- atlas / uploads ----
+
+        /**
+         * @brief Atlas texture size in pixels (cells of the largest image plus its gutter, even).
+         * @return false while no tile has an image.
+         */
+        bool atlasSize(int& w, int& h) const {
+            w = cellW_ * cols_; h = cellH_ * rows_;
+            return cellW_ > 0 && cellH_ > 0;
+        }
+        /// @return Atlas offset of tile @p i's image (inside its cell's gutter) in pixels.
+        void atlasOrigin(int i, int& x, int& y) const {
+            x = (i % cols_) * cellW_ + kGutter; y = (i / cols_) * cellH_ + kGutter;
+        }
+
+        /**
+         * @brief The atlas as one texture: format, shader and uniforms of the shared format.
+         * @return imageWidth/imageHeight = atlas pixels (uniform uImageSize), texWidth/texHeight =
+         *         atlas texels, data = nullptr; shader None while no tile has a supported image.
+         */
+        GpuUploadDesc atlasDesc() const {
+            int aw = 0, ah = 0;
+            if (!atlasSize(aw, ah)) return {};
+            for (int i = 0; i < tileCount(); ++i) {
+                if (!inAtlas_(i) || tiles_[static_cast<size_t>(i)].gpu.shader == GpuShader::None) continue;
+                GpuUploadDesc g = tiles_[static_cast<size_t>(i)].gpu;
+                const int div = texelDiv_(g);
+                g.data = nullptr;
+                g.imageWidth = aw; g.imageHeight = ah;
+                g.texWidth = aw / div; g.texHeight = ah;
+                g.rowLength = 0;
+                g.rectCount = 0;
+                return g;
+            }
+            return {};
+        }
+
+        /**
+         * @return Upload list: one entry per tile in the shared format whose image changed since
+         *         the previous call. After an atlas change (@ref atlasVersion) every tile is
+         *         listed with its whole image, since the caller reallocates the texture.
+         * @note Upload everything returned: a listed tile is not listed again until its next
+         *       @ref setImage. Gutter columns are staged in the mosaic; their pointers stay valid
+         *       until the next call or @ref setImage of that tile.
+         */
+        std::vector<MosaicUpload> uploads() {
+            std::vector<MosaicUpload> out;
+            for (int i = 0; i < tileCount(); ++i) {
+                if (!inAtlas_(i)) continue;
+                Tile& t = tiles_[static_cast<size_t>(i)];
+                const bool whole = t.uploadedAtlas != atlasVersion_; // fresh texture or moved cell
+                if (!whole && t.pending == 0) continue;
+                MosaicUpload u;
+                u.tile = i;
+                atlasOrigin(i, u.atlasX, u.atlasY);
+                u.desc = t.view->uploadDesc();
+                if (!u.desc.data) continue;
+                u.gpu = t.gpu;
+                u.texelX = u.atlasX / texelDiv_(u.gpu);
+                u.texelY = u.atlasY;
+                if (!whole && t.pending == 1) { // the hint covers exactly one frame's changes
+                    CImageRect dirty[CIMG_MAX_DIRTY_RECTS];
+                    SetGpuDirtyRects(u.gpu, dirty, t.view->dirtyRects(dirty));
+                }
+                addBlits_(t, u);
+                t.pending = 0;
+                t.uploadedAtlas = atlasVersion_;
+                out.push_back(std::move(u));
+            }
+            return out;
+        }
+
+        // ---- geometry ----
+
+        /**
+         * @brief Triangles for all tiles in one draw.
+         * @param out Replaced with {x,y,u,v} per vertex (viewport pixels, atlas UVs), GL_TRIANGLES.
+         * @return Vertex count.
+         * @note Each tile's transformed quad is clipped to its tile rectangle, so a zoomed or
+         *       panned image never draws over its neighbours.
+         */
+        size_t triangles(std::vector<float>& out) const {
+            out.clear();
+            int aw = 0, ah = 0;
+            if (!atlasSize(aw, ah)) return 0;
+            for (int i = 0; i < tileCount(); ++i) {
+                if (!inAtlas_(i)) continue;
+                const Tile& t = tiles_[static_cast<size_t>(i)];
+                if (t.rect.width <= 0 || t.rect.height <= 0) continue;
+                const RenderState& rs = t.view->renderState();
+                int ax = 0, ay = 0;
+                atlasOrigin(i, ax, ay);
+                const float su = static_cast<float>(t.imgW) / static_cast<float>(aw);
+                const float sv = static_cast<float>(t.imgH) / static_cast<float>(ah);
+                const float ou = static_cast<float>(ax) / static_cast<float>(aw);
+                const float ov = static_cast<float>(ay) / static_cast<float>(ah);
+
+                // Strip order is TL,TR,BL,BR; polygon order TL,TR,BR,BL.
+                static constexpr int kOrder[4] = { 0, 1, 3, 2 };
+                Vtx poly[kMaxPoly];
+                int n = 4;
+                for (int k = 0; k < 4; ++k) {
+                    const float* v = rs.strip2D + 4 * kOrder[k];
+                    poly[k] = Vtx{ v[0] + static_cast<float>(t.rect.x), v[1] + static_cast<float>(t.rect.y),
+                                   ou + v[2] * su, ov + v[3] * sv };
+                }
+                n = clip_(poly, n, t.rect);
+                for (int k = 1; k + 1 < n; ++k) { // fan
+                    for (const Vtx* v : { &poly[0], &poly[k], &poly[k + 1] }) {
+                        out.insert(out.end(), { v->x, v->y, v->u, v->v });
+                    }
+                }
+            }
+            return out.size() / 4;
+        }
+
+        /**
+         * @brief Changes whenever @ref triangles would return different geometry
+         *        (layout, atlas layout, or any tile's 2D state).
+         */
+        uint64_t geometryVersion() const {
+            uint64_t v = layoutVersion_ + atlasVersion_;
+            for (const auto& t : tiles_) v += t.view->renderState().version2D;
+            return v;
+        }
+        /// @brief Changes whenever @ref atlasSize or the cell layout changes (reallocate the texture).
+        uint64_t atlasVersion() const noexcept { return atlasVersion_; }
+
+        // ---- input routing (viewport pixels) ----
+
+        /// @brief Start a drag on the tile under (x,y); that tile keeps the drag until @ref endPointer.
+        void beginPointer(float x, float y, MouseButton btn, KeyMod mods) {
+            capture_ = tileAt(x, y);
+            if (capture_ < 0) return;
+            focus_ = capture_;
+            const MosaicRect& r = tileRect(capture_);
+            view(capture_).beginPointer(x - static_cast<float>(r.x), y - static_cast<float>(r.y), btn, mods);
+        }
+        /// @brief Forward to the dragging tile, or the hovered tile when no drag is active.
+        void updatePointer(float x, float y) {
+            const int i = capture_ >= 0 ? capture_ : tileAt(x, y);
+            if (i < 0) return;
+            const MosaicRect& r = tileRect(i);
+            view(i).updatePointer(x - static_cast<float>(r.x), y - static_cast<float>(r.y));
+        }
+        void endPointer() {
+            if (capture_ >= 0) view(capture_).endPointer();
+            capture_ = -1;
+        }
+        /// @brief Zoom the tile under the cursor.
+        void wheelScroll(float delta, float x, float y) {
+            const int i = tileAt(x, y);
+            if (i < 0) return;
+            focus_ = i;
+            const MosaicRect& r = tileRect(i);
+            view(i).wheelScroll(delta, x - static_cast<float>(r.x), y - static_cast<float>(r.y));
+        }
+        /// @brief Pan the focused tile.
+        void keyPan2D(float dx, float dy) {
+            if (focus_ >= 0) view(focus_).keyPan2D(dx, dy);
+        }
+        /// @brief Reset every tile's 2D transform.
+        void reset2D() {
+            for (auto& t : tiles_) t.view->reset2D();
+        }
+
+    private:
+        struct Tile {
+            std::unique_ptr<CImageDisplayerCPP> view;
+            MosaicRect rect;
+            uint32_t imgW = 0, imgH = 0;
+            uint64_t formatKey = 0;    // format << 32 | pattern
+            bool hasImage = false;
+            int pending = 0;           // setImage calls since the tile was last listed by uploads()
+            uint64_t uploadedAtlas = kNoKey; // atlasVersion_ of the last listing (whole image sent)
+            GpuUploadDesc gpu;         // current image as texels (data = the image's buffer)
+            std::vector<std::uint8_t> edges; // staged left and right gutter columns
+        };
+        struct Vtx { float x, y, u, v; };
+        static constexpr int kMaxPoly = 8; // quad clipped by 4 edges
+        static constexpr uint64_t kNoKey = ~uint64_t(0);
+
+        bool inAtlas_(int i) const {
+            const Tile& t = tiles_[static_cast<size_t>(i)];
+            return t.hasImage && t.formatKey == atlasKey_ && t.imgW > 0 && t.imgH > 0;
+        }
+
+        // Pixels per texel column (2 for YUV422, whose texels hold two pixels).
+        static int texelDiv_(const GpuUploadDesc& g) { return g.texWidth < g.imageWidth ? 2 : 1; }
+
+        // Image (or its dirty rectangles) plus the gutter ring. The ring is re-sent whenever the
+        // whole image or a rectangle touching its border changes; corners ride on the columns.
+        void addBlits_(Tile& t, MosaicUpload& u) {
+            const GpuUploadDesc& g = u.gpu;
+            if (g.shader == GpuShader::None || !g.data || g.texWidth <= 0 || g.texHeight <= 0) return;
+            const int tw = g.texWidth, th = g.texHeight;
+            const std::size_t tb = static_cast<std::size_t>(g.texelBytes);
+            const int rl = g.rowLength > 0 ? g.rowLength : tw;
+            auto src = [&](int x, int y) { return g.data + (static_cast<std::size_t>(y) * rl + x) * tb; };
+
+            bool edges = g.rectCount == 0;
+            if (g.rectCount == 0) u.blits.push_back(MosaicBlit{ g.data, g.rowLength, u.texelX, u.texelY, tw, th });
+            for (int k = 0; k < g.rectCount; ++k) {
+                const GpuRect& r = g.rects[k];
+                if (r.width <= 0 || r.height <= 0) continue;
+                u.blits.push_back(MosaicBlit{ src(r.x, r.y), rl, u.texelX + r.x, u.texelY + r.y, r.width, r.height });
+                edges = edges || r.x == 0 || r.y == 0 || r.x + r.width == tw || r.y + r.height == th;
+            }
+            if (!edges) return;
+
+            u.blits.push_back(MosaicBlit{ src(0, 0), rl, u.texelX, u.texelY - 1, tw, 1 });
+            u.blits.push_back(MosaicBlit{ src(0, th - 1), rl, u.texelX, u.texelY + th, tw, 1 });
+            const std::size_t col = static_cast<std::size_t>(th + 2) * tb;
+            t.edges.resize(2 * col);
+            std::uint8_t* left = t.edges.data();
+            std::uint8_t* right = left + col;
+            for (int y = -1; y <= th; ++y) {
+                const int sy = std::min(std::max(y, 0), th - 1);
+                std::memcpy(left + static_cast<std::size_t>(y + 1) * tb, src(0, sy), tb);
+                std::memcpy(right + static_cast<std::size_t>(y + 1) * tb, src(tw - 1, sy), tb);
+            }
+            u.blits.push_back(MosaicBlit{ left, 1, u.texelX - 1, u.texelY - 1, 1, th + 2 });
+            u.blits.push_back(MosaicBlit{ right, 1, u.texelX + tw, u.texelY - 1, 1, th + 2 });
+        }
+
+        void relayoutAtlas_() {
+            atlasKey_ = kNoKey;
+            uint32_t w = 0, h = 0;
+            for (const auto& t : tiles_) {
+                if (!t.hasImage) continue;
+                if (atlasKey_ == kNoKey) atlasKey_ = t.formatKey;
+                if (t.formatKey != atlasKey_) continue;
+                w = std::max(w, t.imgW); h = std::max(h, t.imgH);
+            }
+            const int cw = w ? static_cast<int>((w + 1u) & ~1u) + 2 * kGutter : 0;
+            const int ch = h ? static_cast<int>((h + 1u) & ~1u) + 2 * kGutter : 0;
+            // Cells only grow, so a smaller frame does not force a reallocation.
+            if (atlasKey_ != lastKey_) { cellW_ = cw; cellH_ = ch; lastKey_ = atlasKey_; }
+            else { cellW_ = std::max(cellW_, cw); cellH_ = std::max(cellH_, ch); }
+            ++atlasVersion_; // UV scale of the changed tile moved either way
+        }
+
+        // Sutherland-Hodgman against the tile rectangle; (u,v) interpolate linearly (affine transform).
+        static int clip_(Vtx* poly, int n, const MosaicRect& r) {
+            const float x0 = static_cast<float>(r.x), x1 = static_cast<float>(r.x + r.width);
+            const float y0 = static_cast<float>(r.y), y1 = static_cast<float>(r.y + r.height);
+            for (int edge = 0; edge < 4 && n > 0; ++edge) {
+                auto dist = [&](const Vtx& p) {
+                    switch (edge) {
+                    case 0:  return p.x - x0;
+                    case 1:  return x1 - p.x;
+                    case 2:  return p.y - y0;
+                    default: return y1 - p.y;
+                    }
+                };
+                Vtx in[kMaxPoly];
+                std::copy(poly, poly + n, in);
+                int m = 0;
+                for (int k = 0; k < n; ++k) {
+                    const Vtx& a = in[k];
+                    const Vtx& b = in[(k + 1) % n];
+                    const float da = dist(a), db = dist(b);
+                    if (da >= 0.f && m < kMaxPoly) poly[m++] = a;
+                    if ((da >= 0.f) != (db >= 0.f) && m < kMaxPoly) {
+                        const float t = da / (da - db);
+                        poly[m++] = Vtx{ a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t,
+                                         a.u + (b.u - a.u) * t, a.v + (b.v - a.v) * t };
+                    }
+                }
+                n = m;
+            }
+            return n;
+        }
+
+        MosaicOptions opt_;
+        GpuViewParams params_;
+        int cols_ = 1, rows_ = 1;
+        std::vector<Tile> tiles_;
+        int vpW_ = -1, vpH_ = -1;
+        int focus_ = -1, capture_ = -1;
+        int cellW_ = 0, cellH_ = 0;
+        uint64_t atlasKey_ = kNoKey, lastKey_ = kNoKey;
+        uint64_t layoutVersion_ = 0, atlasVersion_ = 0;
+    };
+
+} // namespace cimage
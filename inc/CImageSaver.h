@@ -0,0 +1,641 @@
+#pragma once
+/**
+ * @file CImageSaver.h
+ * @brief Asynchronous frame recorder: preallocated ring on the pipeline thread, one writer thread to disk.
+ *
+ * Recording must never stall capture. @ref CImageSaver::Push (called on the grab or fan-out
+ * thread) only claims a free slot of a ring allocated up front and copies the frame into it
+ * (or keeps a reference to a pooled frame, see @ref CImageSaver::Options::ref_pooled). A
+ * dedicated writer thread streams slots to disk through @ref CAsyncFileWriter: large aligned
+ * writes, several in flight (io_uring, or batched pwritev where io_uring is unavailable),
+ * optionally O_DIRECT to bypass the page cache. Ring slots are registered with io_uring and
+ * written in place when the layout allows. When the disk falls behind and the ring is full,
+ * frames are dropped and counted; the pipeline thread never waits for I/O.
+ *
+ * Formats (@ref CImageSaver::Format):
+ *  - TlvSequence: @p path is a directory of segment files `rec_000000.ish`, ... Each segment is
+ *    a regular CSH_Image TLV file (see @ref csh_img::CSH_Image::saveImage) holding N frames as
+ *    one multi-image buffer (`image_count = N`), so @ref csh_img::CSH_Image::loadImage and
+ *    @ref CFileReplay read it unchanged. A new segment starts when the frame geometry changes or
+ *    the segment would exceed @ref CImageSaver::Options::segment_bytes.
+ *  - Raw: @p path is one file of concatenated frame bytes (no headers).
+ *
+ * Timestamp sidecar (read by @ref CFileReplay): `timestamps.txt` in the directory (TlvSequence)
+ * or `<path>.ts` (Raw), one `<sequence> <timestamp_ns>` line per recorded frame, taken from
+ * @ref CFrameMeta when available.
+ *
+ * @code
+ * CImageSaver rec;
+ * CImageSaver::Options opt;
+ * opt.slot_count = 16;                       // ~0.5 s of 1080p30 YUV422 in flight to disk
+ * opt.direct_io = true;
+ * rec.Start("/data/rec01", opt);
+ * fanout.Subscribe("recorder", rec.Input());
+ * ...
+ * rec.Stop();                                // drains the ring, finalizes the last segment
+ * auto s = rec.GetStats();                   // s.dropped, s.backlog_peak, s.mb_per_s
+ * @endcode
+ *
+ * @ref SaveImageTlv writes a single image in the @ref csh_img::CSH_Image::saveImage format
+ * through the same writer, for large stills.
+ *
+ * @note Ring memory is @ref CImageSaver::Options::slot_count * slot bytes (the first frame's
+ *       size, rounded up to 4 KiB, unless @ref CImageSaver::Options::slot_bytes is set), plus
+ *       `queue_depth` staging chunks of `write_bytes`.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CAsyncFileWriter.h"
+#include "CFrameGrabber.h"
+#include "CGrabberFrame.h"
+#include "CSH_Log.h"
+
+namespace saver_detail {
+
+    constexpr uint64_t kMaxSegmentBytes = 0xFFFFFFFFull; // TLV buffer length field is 32-bit
+
+    inline std::wstring wstr(const std::string& s) { return std::wstring(s.begin(), s.end()); }
+
+    /**
+     * @brief CSH_Image TLV header for a linear multi-image buffer, byte-compatible with saveImage.
+     *
+     * Layout (native little-endian): magic, version, field count, then per field
+     * `u32 id, u32 length, value`. The pixel field (id 100) is last and omitted for images
+     * without pixels; a recorder patches its length and the image count when a segment closes.
+     */
+    struct TlvHeader {
+        static constexpr uint32_t kMagic = 0x43485349; // 'CHSI'
+        static constexpr uint32_t kVersion = 1;
+        enum : uint32_t {
+            F_WIDTH = 1, F_HEIGHT = 2, F_BENABLE = 3, F_CAMERA_ID = 4, F_FORMAT = 5, F_MEMORY_BIT = 6,
+            F_ORIGINAL_BIT = 7, F_PATTERN = 8, F_MEM_ALIGN = 9, F_BUFFER_SIZE = 10,
+            F_IMAGE_COUNT = 11, F_SEL_IMAGE = 12, F_BUFFER_OFF = 13, F_BUFFER_BYTES = 100
+        };
+
+        std::vector<uint8_t> bytes;
+        std::size_t countAt = 0;    ///< Offset of the F_IMAGE_COUNT value.
+        std::size_t lengthAt = 0;   ///< Offset of the F_BUFFER_BYTES length.
+
+        void Build(const csh_img::CSH_Image& f, uint32_t imageCount, uint32_t selImage, uint64_t bufferOffset, bool withPixels) {
+            bytes.clear();
+            u32_(kMagic);
+            u32_(kVersion);
+            u32_(withPixels ? 14 : 13);
+            field32_(F_WIDTH, f.width);
+            field32_(F_HEIGHT, f.height);
+            field32_(F_BENABLE, f.isEnabled() ? 1 : 0);
+            field32_(F_CAMERA_ID, f.camera_id);
+            field32_(F_FORMAT, static_cast<uint32_t>(f.format));
+            field32_(F_MEMORY_BIT, f.memory_bit);
+            field32_(F_ORIGINAL_BIT, f.original_bit);
+            field32_(F_PATTERN, static_cast<uint32_t>(f.pattern));
+            field32_(F_MEM_ALIGN, static_cast<uint32_t>(f.memory_align));
+            field64_(F_BUFFER_SIZE, f.buffer_size);
+            countAt = field32_(F_IMAGE_COUNT, imageCount);
+            field32_(F_SEL_IMAGE, selImage);
+            field64_(F_BUFFER_OFF, bufferOffset);
+            if (!withPixels) return;
+            u32_(F_BUFFER_BYTES);
+            lengthAt = u32_(static_cast<uint32_t>(f.buffer_size * imageCount));
+        }
+
+        void Patch(uint32_t imageCount, uint32_t bufferBytes) {
+            std::memcpy(bytes.data() + countAt, &imageCount, 4);
+            std::memcpy(bytes.data() + lengthAt, &bufferBytes, 4);
+        }
+
+    private:
+        std::size_t u32_(uint32_t v) {
+            const std::size_t at = bytes.size();
+            bytes.resize(at + 4);
+            std::memcpy(bytes.data() + at, &v, 4);
+            return at;
+        }
+        std::size_t field32_(uint32_t id, uint32_t v) {
+            u32_(id);
+            u32_(4);
+            return u32_(v);
+        }
+        void field64_(uint32_t id, uint64_t v) {
+            u32_(id);
+            u32_(8);
+            const std::size_t at = bytes.size();
+            bytes.resize(at + 8);
+            std::memcpy(bytes.data() + at, &v, 8);
+        }
+    };
+
+} // namespace saver_detail
+
+/**
+ * @brief Write @p img in the @ref csh_img::CSH_Image::saveImage TLV format through @ref CAsyncFileWriter.
+ *
+ * Same bytes as saveImage (the whole allocation, `image_count` images, current selection),
+ * but the pixels are written in place as large writes with several in flight, optionally
+ * O_DIRECT. Intended for large stills (e.g. 4K Bayer16) on fast storage.
+ * @return false on I/O errors (logged), unlike saveImage which throws.
+ */
+inline bool SaveImageTlv(const csh_img::CSH_Image& img, const std::string& path,
+    const CAsyncFileWriter::Options& opt = CAsyncFileWriter::Options()) {
+    const std::size_t bytes = img.buffer ? img.totalBytes() : 0;
+    const auto* base = img.buffer.get();
+    saver_detail::TlvHeader h;
+    h.Build(img, img.image_count, img.getSelectedImage(), img.data() ? static_cast<uint64_t>(img.data() - base) : 0, bytes > 0);
+
+    CAsyncFileWriter w;
+    if (!w.Init(opt) || !w.Open(path)) {
+        LOG_WRITE(cshlog::LogLevel::Error, L"SaveImageTlv: cannot create %ls (errno=%d)", saver_detail::wstr(path).c_str(), errno);
+        return false;
+    }
+    bool ok = w.Append(h.bytes.data(), h.bytes.size());
+    if (ok && bytes) ok = w.AppendRetained(base, bytes, nullptr);
+    return w.Close() && ok;
+}
+
+/**
+ * @class CImageSaver
+ * @brief Records frames to disk without blocking the thread that pushes them.
+ *
+ * @thread_safety @ref Push may be called from any thread (usually one producer). @ref Start,
+ * @ref Stop, @ref GetStats and @ref Attach / @ref Detach are thread-safe.
+ */
+class CImageSaver {
+public:
+    /// On-disk layout.
+    enum class Format : uint32_t {
+        TlvSequence = 0, ///< Directory of multi-image CSH_Image TLV segments (.ish).
+        Raw              ///< One file of concatenated frame bytes.
+    };
+
+    /// Recording options (fixed for one recording).
+    struct Options {
+        Format      format = Format::TlvSequence;
+        uint32_t    slot_count = 8;             ///< Ring depth: frames that may wait for the disk (minimum 2).
+        std::size_t slot_bytes = 0;             ///< Bytes per slot; 0 = size of the first frame.
+        bool        ref_pooled = false;         ///< Hold pooled frames instead of copying them (pins driver buffers until written).
+        bool        direct_io = false;          ///< O_DIRECT (Linux); buffered I/O if the file system refuses it.
+        std::size_t write_bytes = 4u << 20;     ///< Size of one staged disk write (rounded up to 4 KiB).
+        CAsyncFileWriter::Backend io_backend = CAsyncFileWriter::Backend::Auto; ///< io_uring or batched pwritev.
+        uint32_t    queue_depth = 4;            ///< Disk writes in flight.
+        uint64_t    segment_bytes = 1ull << 30; ///< TlvSequence: maximum segment file size (< 4 GiB).
+        bool        timestamps = true;          ///< Write the timestamp sidecar.
+    };
+
+    /// Counters (snapshot).
+    struct Stats {
+        uint64_t pushed = 0;          ///< Frames offered while recording.
+        uint64_t recorded = 0;        ///< Frames written to disk.
+        uint64_t dropped = 0;         ///< Frames discarded (ring full, larger than a slot, or after a write error).
+        uint64_t bytes_written = 0;   ///< Bytes written, headers included.
+        uint32_t backlog = 0;         ///< Frames waiting for the writer now.
+        uint32_t backlog_peak = 0;    ///< Largest backlog observed.
+        uint32_t files = 0;           ///< Files created (segments for TlvSequence).
+        double   mb_per_s = 0.0;      ///< Sustained write rate since @ref Start (MB = 10^6 bytes).
+        bool     direct_io = false;   ///< O_DIRECT is in effect for the current file.
+        CAsyncFileWriter::Backend io_backend = CAsyncFileWriter::Backend::Pwritev; ///< Backend in use.
+        uint32_t writes_in_flight_peak = 0; ///< Largest number of outstanding disk writes.
+        bool     failed = false;      ///< A write failed; recording stopped accepting frames.
+    };
+
+    CImageSaver() = default;
+    ~CImageSaver() {
+        Detach();
+        Stop();
+    }
+
+    CImageSaver(const CImageSaver&) = delete;
+    CImageSaver& operator=(const CImageSaver&) = delete;
+
+    /**
+     * @brief Allocate the ring, open the output and start the writer thread.
+     * @param path Directory (TlvSequence, created if missing) or file (Raw).
+     * @return false if already recording or the output cannot be created.
+     */
+    bool Start(const std::string& path, const Options& opt) {
+        namespace fs = std::filesystem;
+        std::lock_guard<std::mutex> ctl(ctlMtx_);
+        if (writer_.joinable()) return false;
+
+        opt_ = opt;
+        opt_.slot_count = std::max<uint32_t>(2, opt.slot_count);
+        opt_.write_bytes = afw_detail::alignUp(std::max(opt.write_bytes, afw_detail::kIoAlign), afw_detail::kIoAlign);
+        opt_.segment_bytes = std::min(std::max<uint64_t>(opt.segment_bytes, opt_.write_bytes), saver_detail::kMaxSegmentBytes);
+        path_ = path;
+
+        std::error_code ec;
+        std::string tsPath;
+        if (opt_.format == Format::TlvSequence) {
+            fs::create_directories(path_, ec);
+            if (!fs::is_directory(path_, ec)) {
+                LOG_WRITE(cshlog::LogLevel::Error, L"recorder: cannot create %ls", saver_detail::wstr(path_).c_str());
+                return false;
+            }
+            tsPath = (fs::path(path_) / "timestamps.txt").string();
+        }
+        else {
+            tsPath = path_ + ".ts";
+        }
+
+        CAsyncFileWriter::Options wo;
+        wo.backend = opt_.io_backend;
+        wo.queue_depth = opt_.queue_depth;
+        wo.chunk_bytes = opt_.write_bytes;
+        wo.direct_io = opt_.direct_io;
+        if (!io_.Init(wo)) return false;
+        registeredBytes_ = 0;
+        segIndex_ = 0;
+
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            slots_.clear();
+            slots_.resize(opt_.slot_count);
+            free_.clear();
+            for (uint32_t i = opt_.slot_count; i-- > 0;) free_.push_back(i);
+            ready_.assign(opt_.slot_count, 0);
+            readyHead_ = readyCount_ = 0;
+            slotBytes_ = 0;
+            filling_ = 0;
+            stopping_ = false;
+            failed_ = false;
+            stats_ = Stats();
+            stats_.io_backend = io_.backend();
+            if (opt_.slot_bytes) allocSlots_(opt_.slot_bytes);
+            if (failed_) return false;
+        }
+        recorded_.store(0);
+        bytesWritten_.store(0);
+
+        if (opt_.format == Format::Raw && !openFile_(path_)) return false;
+        if (opt_.timestamps) {
+            ts_ = std::fopen(tsPath.c_str(), "w");
+            if (!ts_) LOG_WRITE(cshlog::LogLevel::Warn, L"recorder: cannot write %ls", saver_detail::wstr(tsPath).c_str());
+        }
+
+        startNs_.store(GrabberNowNs());
+        stopNs_.store(0);
+        recording_.store(true, std::memory_order_release);
+        writer_ = std::thread([this] { writerLoop_(); });
+        return true;
+    }
+
+    /**
+     * @brief Stop accepting frames, write everything still in the ring and close the output.
+     * @note Blocks until the backlog is on disk. No-op when not recording.
+     */
+    void Stop() {
+        std::lock_guard<std::mutex> ctl(ctlMtx_);
+        if (!writer_.joinable()) return;
+        recording_.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        freeCv_.notify_all();
+        writer_.join();
+        stopNs_.store(GrabberNowNs());
+    }
+
+    /// @return true between @ref Start and @ref Stop (false after a write error).
+    bool isRecording() const { return recording_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Register as @p grab's processor callback.
+     * @note The displayer callback of @p grab is left untouched.
+     */
+    void Attach(CFrameGrabber& grab) {
+        Detach();
+        grab.RegisterCallbackProcessor(gate_.Wrap(Input()));
+        std::lock_guard<std::mutex> lk(mtx_);
+        grab_ = &grab;
+    }
+
+    /**
+     * @brief Clear the processor callback of the attached grabber (no-op if not attached).
+     * @note Returns only after a push already running on the grab thread has finished, so the
+     *       recorder may be destroyed while the grabber keeps running.
+     */
+    void Detach() {
+        CFrameGrabber* g = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            std::swap(g, grab_);
+        }
+        if (g) g->RegisterCallbackProcessor(nullptr);
+        gate_.Close(); // backends call a copy of the callback outside their lock
+    }
+
+    /// @return Callback that feeds this recorder; register it with any frame source.
+    FrameGrabCallbackProc Input() {
+        return [this](const csh_img::CSH_Image& f) { Push(f); };
+    }
+
+    /**
+     * @brief Queue a frame for writing (called on the producer's thread; never waits for I/O).
+     * @note Dropped and counted when no slot is free, the frame is larger than a slot, or a
+     *       previous write failed. The first frame sizes the ring when `slot_bytes` is 0.
+     */
+    void Push(const csh_img::CSH_Image& frame) {
+        push_(frame, nullptr);
+    }
+
+    /**
+     * @brief Queue a frame, waiting up to @p timeout for a free slot (back-pressure).
+     *
+     * For producers that may wait for the disk, such as flushing a pre-trigger buffer or
+     * converting files; capture callbacks should use @ref Push.
+     * @return true if the frame was queued; false on timeout, when not recording, or if the
+     *         frame does not fit a slot (counted as dropped).
+     */
+    template <typename Rep, typename Period>
+    bool Enqueue(const csh_img::CSH_Image& frame, std::chrono::duration<Rep, Period> timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        return push_(frame, &deadline);
+    }
+
+    /// @return Counter snapshot (valid during and after recording).
+    Stats GetStats() const {
+        Stats s;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            s = stats_;
+            s.backlog = readyCount_;
+        }
+        s.recorded = recorded_.load();
+        s.bytes_written = bytesWritten_.load();
+        s.writes_in_flight_peak = inflightPeak_.load();
+        const int64_t end = stopNs_.load() ? stopNs_.load() : GrabberNowNs();
+        const double sec = (end - startNs_.load()) * 1e-9;
+        s.mb_per_s = sec > 0.0 ? s.bytes_written / sec / 1e6 : 0.0;
+        return s;
+    }
+
+private:
+    struct Slot_ {
+        afw_detail::AlignedBuffer storage;   ///< Copy target (slot_bytes, 4 KiB aligned).
+        csh_img::CSH_Image view;             ///< Geometry of the copied frame (no buffer).
+        csh_img::CSH_Image ref;              ///< Referenced pooled frame (ref_pooled).
+        uint64_t sequence = 0;
+        int64_t  timestamp_ns = 0;
+    };
+
+    /// Claim a slot (waiting until @p deadline if given), fill it and queue it for the writer.
+    bool push_(const csh_img::CSH_Image& frame, const std::chrono::steady_clock::time_point* deadline) {
+        if (!recording_.load(std::memory_order_acquire)) return false;
+        const auto* src = frame.data();
+        const std::size_t bytes = frame.buffer_size;
+        if (!src || bytes == 0) return false;
+        const CFrameMeta* meta = GetFrameMeta(frame);
+        const bool ref = opt_.ref_pooled && meta;
+
+        uint32_t idx = 0;
+        uint64_t seq = 0;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            ++stats_.pushed;
+            if (slotBytes_ == 0 && !ref && !stopping_) allocSlots_(bytes);
+            if (deadline) {
+                freeCv_.wait_until(lk, *deadline, [&] { return !free_.empty() || stopping_ || failed_; });
+            }
+            if (stopping_ || failed_ || free_.empty() || (!ref && bytes > slotBytes_)) {
+                ++stats_.dropped;
+                return false;
+            }
+            idx = free_.back();
+            free_.pop_back();
+            ++filling_;
+            seq = pushSeq_++;
+        }
+
+        Slot_& s = slots_[idx];
+        if (ref) {
+            s.ref = frame;
+        }
+        else {
+            std::memcpy(s.storage.get(), src, bytes);
+            SetFrameView(s.view, std::shared_ptr<csh_img::CSH_Image::byte[]>(), bytes, frame.width, frame.height,
+                frame.format, frame.pattern, frame.memory_bit, frame.original_bit, frame.memory_align);
+            s.view.camera_id = frame.camera_id;
+        }
+        s.sequence = meta ? meta->sequence : seq;
+        s.timestamp_ns = meta ? meta->timestamp_ns : GrabberNowNs();
+
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            ready_[(readyHead_ + readyCount_) % ready_.size()] = idx;
+            ++readyCount_;
+            stats_.backlog_peak = std::max(stats_.backlog_peak, readyCount_);
+            --filling_;
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    /// Caller holds mtx_.
+    void allocSlots_(std::size_t bytes) {
+        slotBytes_ = afw_detail::alignUp(bytes, afw_detail::kIoAlign);
+        for (auto& s : slots_) {
+            s.storage = afw_detail::allocAligned(slotBytes_);
+            if (!s.storage) {
+                LOG_WRITE(cshlog::LogLevel::Error, L"recorder: cannot allocate %u x %zu bytes", opt_.slot_count, slotBytes_);
+                failed_ = true;
+                return;
+            }
+        }
+        LOG_WRITE(cshlog::LogLevel::Info, L"recorder: ring of %u x %zu bytes", opt_.slot_count, slotBytes_);
+    }
+
+    void writerLoop_() {
+        for (;;) {
+            uint32_t idx = 0;
+            bool failed = false;
+            std::size_t slotBytes = 0;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                if (readyCount_ == 0 && io_.inflight() > 0) {
+                    // Idle: retire batched writes so their slots (and pinned frames) come back.
+                    lk.unlock();
+                    io_.Flush();
+                    bytesWritten_.store(io_.bytesWritten());
+                    continue;
+                }
+                cv_.wait(lk, [&] { return readyCount_ > 0 || (stopping_ && filling_ == 0); });
+                if (readyCount_ == 0) break;
+                idx = ready_[readyHead_];
+                readyHead_ = (readyHead_ + 1) % static_cast<uint32_t>(ready_.size());
+                --readyCount_;
+                failed = failed_;
+                slotBytes = slotBytes_;
+            }
+
+            if (slotBytes != registeredBytes_) {
+                // Ring allocated by the first frame: let io_uring write slots as fixed buffers.
+                std::vector<std::pair<const void*, std::size_t>> bufs;
+                for (auto& s : slots_) bufs.emplace_back(s.storage.get(), slotBytes);
+                io_.SetExternalBuffers(std::move(bufs));
+                registeredBytes_ = slotBytes;
+            }
+
+            if (failed) {
+                releaseSlot_(idx, false);
+            }
+            else if (!writeFrame_(idx)) {
+                std::lock_guard<std::mutex> lk(mtx_);
+                if (!failed_) failWrite_();
+            }
+            bytesWritten_.store(io_.bytesWritten());
+            inflightPeak_.store(io_.inflightPeak());
+        }
+
+        const bool ok = closeFile_();
+        bytesWritten_.store(io_.bytesWritten());
+        if (ts_) {
+            std::fclose(ts_);
+            ts_ = nullptr;
+        }
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!ok && !failed_) failWrite_();
+    }
+
+    /// Writer thread: the disk write of slot @p idx completed (or failed, or was never issued).
+    void releaseSlot_(uint32_t idx, bool ok) {
+        slots_[idx].ref = csh_img::CSH_Image(); // unpin outside the lock
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (ok) recorded_.fetch_add(1);
+            else ++stats_.dropped;
+            free_.push_back(idx);
+        }
+        freeCv_.notify_one();
+    }
+
+    /// Caller holds mtx_.
+    void failWrite_() {
+        failed_ = true;
+        stats_.failed = true;
+        recording_.store(false, std::memory_order_release);
+        freeCv_.notify_all();
+        LOG_WRITE(cshlog::LogLevel::Error, L"recorder: write to %ls failed (errno=%d); recording stopped",
+            saver_detail::wstr(path_).c_str(), errno);
+    }
+
+    /// Writer thread: append slot @p idx (starting a new segment when needed); the slot is released on completion.
+    bool writeFrame_(uint32_t idx) {
+        Slot_& s = slots_[idx];
+        const csh_img::CSH_Image& f = s.ref.buffer ? s.ref : s.view;
+        const uint8_t* data = s.ref.buffer ? s.ref.data() : s.storage.get();
+        const std::size_t bytes = f.buffer_size;
+        auto release = [this, idx](bool ok) { releaseSlot_(idx, ok); };
+
+        if (opt_.format == Format::TlvSequence) {
+            const bool sameGeometry = io_.isOpen() && f.buffer_size == segFrame_.buffer_size &&
+                f.width == segFrame_.width && f.height == segFrame_.height && f.format == segFrame_.format &&
+                f.pattern == segFrame_.pattern && f.memory_bit == segFrame_.memory_bit &&
+                f.original_bit == segFrame_.original_bit && f.memory_align == segFrame_.memory_align &&
+                f.camera_id == segFrame_.camera_id;
+            if (!sameGeometry || segPayload_ + bytes + header_.bytes.size() > opt_.segment_bytes) {
+                char name[32];
+                std::snprintf(name, sizeof(name), "rec_%06u.ish", segIndex_++);
+                if (!closeFile_() || !openFile_((std::filesystem::path(path_) / name).string())) {
+                    release(false);
+                    return false;
+                }
+                segFrame_ = f;
+                segFrame_.buffer.reset();
+                header_.Build(f, 0, 0, 0, true);
+                if (!io_.Append(header_.bytes.data(), header_.bytes.size())) {
+                    release(false);
+                    return false;
+                }
+            }
+            segPayload_ += bytes;
+            ++segFrames_;
+        }
+        // The slot may be reused once release runs (possibly inside AppendRetained): copy first.
+        const unsigned long long seq = s.sequence;
+        const long long ts = s.timestamp_ns;
+        if (!io_.AppendRetained(data, bytes, release)) return false;
+        if (ts_) std::fprintf(ts_, "%llu %lld\n", seq, ts); // only frames that reached the file
+        return true;
+    }
+
+    bool openFile_(const std::string& file) {
+        if (!io_.Open(file)) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"recorder: cannot create %ls (errno=%d)", saver_detail::wstr(file).c_str(), errno);
+            return false;
+        }
+        if (opt_.direct_io && !io_.isDirect()) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"recorder: O_DIRECT not supported for %ls, using buffered I/O", saver_detail::wstr(file).c_str());
+        }
+        segPayload_ = 0;
+        segFrames_ = 0;
+        std::lock_guard<std::mutex> lk(mtx_);
+        ++stats_.files;
+        stats_.direct_io = io_.isDirect();
+        return true;
+    }
+
+    /// Writer thread: wait for outstanding writes, patch the segment header, close.
+    bool closeFile_() {
+        if (!io_.isOpen()) return true;
+        if (opt_.format != Format::TlvSequence) return io_.Close();
+        header_.Patch(segFrames_, static_cast<uint32_t>(segPayload_));
+        return io_.Close(header_.bytes.data(), header_.bytes.size());
+    }
+
+    // Configuration (set by Start, read-only while recording).
+    Options opt_;
+    std::string path_;
+
+    // Ring (guarded by mtx_; slot contents are owned by whoever took the index).
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;        ///< Writer: slots ready.
+    std::condition_variable freeCv_;    ///< Enqueue: a slot was released.
+    std::vector<Slot_> slots_;
+    std::vector<uint32_t> free_;
+    std::vector<uint32_t> ready_;       ///< FIFO of filled slots (capacity slot_count).
+    uint32_t readyHead_ = 0;
+    uint32_t readyCount_ = 0;
+    uint32_t filling_ = 0;              ///< Slots claimed by Push and not yet queued.
+    std::size_t slotBytes_ = 0;
+    bool stopping_ = false;
+    bool failed_ = false;
+    Stats stats_;
+    uint64_t pushSeq_ = 0;
+    CFrameGrabber* grab_ = nullptr;
+    GrabberCallbackGate gate_;
+
+    std::atomic<bool> recording_{ false };
+    std::atomic<uint64_t> recorded_{ 0 };
+    std::atomic<uint64_t> bytesWritten_{ 0 };
+    std::atomic<uint32_t> inflightPeak_{ 0 };
+    std::atomic<int64_t> startNs_{ 0 };
+    std::atomic<int64_t> stopNs_{ 0 };
+
+    std::mutex ctlMtx_;                 ///< Serializes Start/Stop.
+    std::thread writer_;
+
+    // Writer thread state.
+    CAsyncFileWriter io_;
+    std::size_t registeredBytes_ = 0;   ///< Slot size registered with io_.
+    saver_detail::TlvHeader header_;
+    csh_img::CSH_Image segFrame_;       ///< Geometry of the current segment.
+    uint64_t segPayload_ = 0;
+    uint32_t segFrames_ = 0;
+    uint32_t segIndex_ = 0;
+    std::FILE* ts_ = nullptr;
+};
@@ -0,0 +1,392 @@
+#pragma once
+/**
+ * @file CPreTriggerRing.h
+ * @brief Pre-trigger ("black box") capture: keep the last N frames in RAM, flush them to a recorder on trigger.
+ *
+ * Event-triggered inspection needs the seconds *before* the event, but recording everything
+ * continuously wastes disk bandwidth. @ref CPreTriggerRing keeps the most recent frames in
+ * RAM and, on @ref CPreTriggerRing::Trigger, hands them (oldest first) to a @ref CImageSaver
+ * on its own flush thread, followed by an optional post-trigger window of live frames.
+ * Capture continues undisturbed while the flush runs.
+ *
+ * Memory is bounded exactly by configuration: `frames` buffers of `frame_bytes` each are
+ * allocated once (at construction, or at the first frame when `frame_bytes` is 0) and never
+ * grown. Each incoming frame is copied once into a free buffer; the ring and the flush queue
+ * hold pooled @ref csh_img::CSH_Image references to these buffers, so driver buffers are never
+ * pinned and a recorder with `ref_pooled = true` writes them without another copy. When every
+ * buffer is still held by a pending flush, new frames are dropped and counted.
+ *
+ * @code
+ * CImageSaver rec;
+ * CImageSaver::Options ro; ro.ref_pooled = true;
+ * rec.Start("/data/events", ro);
+ *
+ * CPreTriggerRing::Options po;
+ * po.frames = 300;              // 10 s @ 30 fps (memory = 300 * frame bytes)
+ * po.seconds = 5.0;             // but only keep the last 5 s
+ * po.post_seconds = 2.0;        // and 2 s after the trigger
+ * CPreTriggerRing black(po);
+ * black.SetRecorder(&rec);
+ * fanout.Subscribe("blackbox", black.Input());
+ * ...
+ * if (defectDetected) black.Trigger();   // returns immediately
+ * @endcode
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CFrameGrabber.h"
+#include "CGrabberFrame.h"
+#include "CImageSaver.h"
+#include "CSH_Log.h"
+
+/**
+ * @class CPreTriggerRing
+ * @brief Fixed-memory ring of recent frames with asynchronous flush to a @ref CImageSaver.
+ *
+ * @thread_safety All public methods are thread-safe. @ref Push is meant for one producer.
+ */
+class CPreTriggerRing {
+public:
+    /// Ring configuration (fixed for the lifetime of the ring).
+    struct Options {
+        uint32_t    frames = 64;        ///< Buffers in the pool: the hard cap on frames kept (minimum 2).
+        double      seconds = 0.0;      ///< Also drop frames older than this (0 = limited by @ref frames only).
+        std::size_t frame_bytes = 0;    ///< Bytes per buffer; 0 = size of the first frame.
+        uint32_t    post_frames = 0;    ///< Live frames forwarded after a trigger.
+        double      post_seconds = 0.0; ///< Live time forwarded after a trigger (whichever window is longer).
+    };
+
+    /// Counters (snapshot).
+    struct Stats {
+        uint32_t    frames = 0;         ///< Frames currently in the ring.
+        uint32_t    capacity = 0;       ///< Pool buffers.
+        std::size_t memory_bytes = 0;   ///< Pool memory (capacity * frame bytes; 0 until sized).
+        double      span_seconds = 0.0; ///< Time covered by the ring (oldest to newest frame).
+        uint64_t    pushed = 0;         ///< Frames offered.
+        uint64_t    dropped = 0;        ///< Frames not kept (no free buffer, or larger than a buffer).
+        uint64_t    triggers = 0;       ///< Trigger calls that started or extended a flush.
+        uint64_t    flushed = 0;        ///< Frames handed to the recorder.
+        uint64_t    flush_failed = 0;   ///< Frames the recorder did not accept (stopped or full on timeout).
+        uint32_t    flush_pending = 0;  ///< Frames waiting on the flush thread.
+        bool        flushing = false;   ///< A flush (or post-trigger window) is active.
+    };
+
+    explicit CPreTriggerRing(const Options& opt)
+        : opt_(opt), pool_(std::make_shared<Pool_>()) {
+        opt_.frames = std::max<uint32_t>(2, opt.frames);
+        if (opt_.frame_bytes) pool_->Allocate(opt_.frames, opt_.frame_bytes);
+    }
+
+    ~CPreTriggerRing() {
+        Detach();
+        std::thread t;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            quit_ = true;
+            std::swap(t, flusher_);
+        }
+        cv_.notify_all();
+        if (t.joinable()) t.join();
+        // Frames still referenced elsewhere (e.g. a recorder's ring) keep the pool alive.
+    }
+
+    CPreTriggerRing(const CPreTriggerRing&) = delete;
+    CPreTriggerRing& operator=(const CPreTriggerRing&) = delete;
+
+    /// @brief Recorder that receives flushed frames (not owned; nullptr disables flushing).
+    void SetRecorder(CImageSaver* rec) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        rec_ = rec;
+    }
+
+    /**
+     * @brief Register as @p grab's processor callback.
+     * @note The displayer callback of @p grab is left untouched.
+     */
+    void Attach(CFrameGrabber& grab) {
+        Detach();
+        grab.RegisterCallbackProcessor(gate_.Wrap(Input()));
+        std::lock_guard<std::mutex> lk(mtx_);
+        grab_ = &grab;
+    }
+
+    /**
+     * @brief Clear the processor callback of the attached grabber (no-op if not attached).
+     * @note Returns only after a push already running on the grab thread has finished, so the
+     *       ring may be destroyed while the grabber keeps running.
+     */
+    void Detach() {
+        CFrameGrabber* g = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            std::swap(g, grab_);
+        }
+        if (g) g->RegisterCallbackProcessor(nullptr);
+        gate_.Close(); // backends call a copy of the callback outside their lock
+    }
+
+    /// @return Callback that feeds this ring; register it with any frame source.
+    FrameGrabCallbackProc Input() {
+        return [this](const csh_img::CSH_Image& f) { Push(f); };
+    }
+
+    /**
+     * @brief Copy a frame into the ring (called on the producer's thread; never blocks on I/O).
+     * @note Evicts the oldest frames as needed. Frames inside an active post-trigger window are
+     *       also queued for the flush thread.
+     */
+    void Push(const csh_img::CSH_Image& frame) {
+        const auto* src = frame.data();
+        const std::size_t bytes = frame.buffer_size;
+        if (!src || bytes == 0) return;
+
+        if (!pool_->sized() && !pool_->Allocate(opt_.frames, bytes)) {
+            std::lock_guard<std::mutex> lk(mtx_);
+            ++stats_.pushed;
+            ++stats_.dropped;
+            return;
+        }
+
+        int buf = pool_->Acquire();
+        std::vector<csh_img::CSH_Image> evicted;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            ++stats_.pushed;
+            if (bytes > pool_->bytes()) {
+                ++stats_.dropped;
+                if (buf >= 0) pool_->Release(buf);
+                return;
+            }
+        }
+        // No free buffer: give up the oldest ring frames until one comes back. A frame that is
+        // also waiting to be flushed stays alive until the recorder is done with it.
+        while (buf < 0) {
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                if (ring_.empty()) {
+                    ++stats_.dropped; // every buffer is held by the flush
+                    return;
+                }
+                evicted.push_back(std::move(ring_.front().frame));
+                ring_.pop_front();
+            }
+            evicted.clear(); // recycle outside the lock
+            buf = pool_->Acquire();
+        }
+
+        const CFrameMeta* src_meta = GetFrameMeta(frame);
+        CFrameMeta meta;
+        meta.sequence = src_meta ? src_meta->sequence : seq_;
+        meta.timestamp_ns = src_meta ? src_meta->timestamp_ns : GrabberNowNs();
+        meta.dequeue_ns = src_meta ? src_meta->dequeue_ns : meta.timestamp_ns;
+        meta.buffer_index = static_cast<uint32_t>(buf);
+        meta.bytes_used = static_cast<uint32_t>(bytes);
+        meta.fourcc = src_meta ? src_meta->fourcc : 0;
+        ++seq_;
+
+        uint8_t* dst = pool_->data(buf);
+        std::memcpy(dst, src, bytes);
+        csh_img::CSH_Image copy;
+        // The deleter owns a pool reference: the buffer stays valid while any consumer holds the frame.
+        SetFrameView(copy, MakePooledBuffer(dst, meta, [pool = pool_, buf] { pool->Release(buf); }),
+            bytes, frame.width, frame.height, frame.format, frame.pattern, frame.memory_bit, frame.original_bit,
+            frame.memory_align);
+        copy.camera_id = frame.camera_id;
+
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            ring_.push_back({ copy, ++ringSeq_, meta.timestamp_ns });
+            if (opt_.seconds > 0.0) {
+                const int64_t window = static_cast<int64_t>(opt_.seconds * 1e9);
+                while (ring_.size() > 1 && meta.timestamp_ns - ring_.front().timestamp_ns > window) {
+                    evicted.push_back(std::move(ring_.front().frame));
+                    ring_.pop_front();
+                }
+            }
+            if (postActive_()) {
+                queue_.push_back(copy);
+                queuedSeq_ = ringSeq_;
+                ++postSent_;
+                wake = true;
+            }
+        }
+        if (wake) cv_.notify_all();
+    }
+
+    /**
+     * @brief Flush the ring (frames not flushed yet, oldest first) and open the post-trigger window.
+     *
+     * Returns immediately; the flush thread feeds the recorder with back-pressure
+     * (@ref CImageSaver::Enqueue). Triggering during an active window extends it.
+     * @return false if no recorder is set or it is not recording.
+     */
+    bool Trigger() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!rec_ || !rec_->isRecording()) return false;
+        for (const auto& e : ring_) {
+            if (e.id > queuedSeq_) queue_.push_back(e.frame);
+        }
+        if (!ring_.empty()) queuedSeq_ = std::max(queuedSeq_, ring_.back().id);
+        postSent_ = 0;
+        postUntilNs_ = GrabberNowNs() + static_cast<int64_t>(opt_.post_seconds * 1e9);
+        windowOpen_ = opt_.post_frames > 0 || opt_.post_seconds > 0.0;
+        ++stats_.triggers;
+        if (!flusher_.joinable()) flusher_ = std::thread([this] { flushLoop_(); });
+        cv_.notify_all();
+        return true;
+    }
+
+    /// @return true while frames are queued for the recorder or a post-trigger window is open.
+    bool isFlushing() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return !queue_.empty() || inFlight_ || postActive_();
+    }
+
+    /// @brief Drop every frame in the ring (queued flush frames are kept).
+    void Clear() {
+        std::deque<Entry_> old; // recycled after the lock is released
+        std::lock_guard<std::mutex> lk(mtx_);
+        old.swap(ring_);
+    }
+
+    /// @return Counter snapshot.
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        Stats s = stats_;
+        s.frames = static_cast<uint32_t>(ring_.size());
+        s.capacity = opt_.frames;
+        s.memory_bytes = pool_->sized() ? pool_->bytes() * opt_.frames : 0;
+        s.span_seconds = ring_.size() > 1 ? (ring_.back().timestamp_ns - ring_.front().timestamp_ns) * 1e-9 : 0.0;
+        s.flush_pending = static_cast<uint32_t>(queue_.size());
+        s.flushing = !queue_.empty() || inFlight_ || postActive_();
+        return s;
+    }
+
+private:
+    /// Fixed set of frame buffers; shared with the frames so it outlives the ring if needed.
+    class Pool_ {
+    public:
+        bool Allocate(uint32_t count, std::size_t bytes) {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (bytes_) return true;
+            std::vector<afw_detail::AlignedBuffer> bufs;
+            for (uint32_t i = 0; i < count; ++i) {
+                bufs.push_back(afw_detail::allocAligned(bytes));
+                if (!bufs.back()) {
+                    LOG_WRITE(cshlog::LogLevel::Error, L"pre-trigger: cannot allocate %u x %zu bytes", count, bytes);
+                    return false;
+                }
+            }
+            bufs_ = std::move(bufs);
+            free_.clear();
+            for (uint32_t i = count; i-- > 0;) free_.push_back(static_cast<int>(i));
+            bytes_ = bytes;
+            LOG_WRITE(cshlog::LogLevel::Info, L"pre-trigger: %u x %zu bytes", count, bytes);
+            return true;
+        }
+        bool sized() const {
+            std::lock_guard<std::mutex> lk(mtx_);
+            return bytes_ != 0;
+        }
+        std::size_t bytes() const {
+            std::lock_guard<std::mutex> lk(mtx_);
+            return bytes_;
+        }
+        int Acquire() {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (free_.empty()) return -1;
+            const int b = free_.back();
+            free_.pop_back();
+            return b;
+        }
+        void Release(int b) {
+            std::lock_guard<std::mutex> lk(mtx_);
+            free_.push_back(b);
+        }
+        uint8_t* data(int b) { return bufs_[b].get(); }
+
+    private:
+        mutable std::mutex mtx_;
+        std::vector<afw_detail::AlignedBuffer> bufs_;
+        std::vector<int> free_;
+        std::size_t bytes_ = 0;
+    };
+
+    struct Entry_ {
+        csh_img::CSH_Image frame;
+        uint64_t id = 0;            ///< Ring sequence (monotonic per ring).
+        int64_t  timestamp_ns = 0;
+    };
+
+    /// Caller holds mtx_.
+    bool postActive_() const {
+        if (!windowOpen_) return false;
+        return postSent_ < opt_.post_frames || GrabberNowNs() < postUntilNs_;
+    }
+
+    void flushLoop_() {
+        std::unique_lock<std::mutex> lk(mtx_);
+        for (;;) {
+            cv_.wait_for(lk, std::chrono::milliseconds(50), [&] { return quit_ || !queue_.empty(); });
+            if (quit_) break;
+            if (queue_.empty()) {
+                if (windowOpen_ && !postActive_()) windowOpen_ = false;
+                continue;
+            }
+            csh_img::CSH_Image f = std::move(queue_.front());
+            queue_.pop_front();
+            CImageSaver* rec = rec_;
+            inFlight_ = true;
+            lk.unlock();
+
+            bool ok = false;
+            while (rec && !ok && rec->isRecording()) {
+                ok = rec->Enqueue(f, std::chrono::milliseconds(100));
+                std::lock_guard<std::mutex> q(mtx_);
+                if (quit_) break;
+            }
+            f = csh_img::CSH_Image(); // recycle outside the lock
+
+            lk.lock();
+            inFlight_ = false;
+            if (ok) ++stats_.flushed;
+            else ++stats_.flush_failed;
+        }
+        // Release queued frames outside the lock.
+        std::deque<csh_img::CSH_Image> rest;
+        rest.swap(queue_);
+        lk.unlock();
+    }
+
+    Options opt_;
+    std::shared_ptr<Pool_> pool_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Entry_> ring_;                  ///< Oldest first.
+    std::deque<csh_img::CSH_Image> queue_;     ///< Waiting for the flush thread.
+    uint64_t ringSeq_ = 0;
+    uint64_t queuedSeq_ = 0;                   ///< Newest ring id already queued for flushing.
+    uint64_t seq_ = 0;                         ///< Sequence for frames without metadata (producer thread).
+    uint32_t postSent_ = 0;
+    int64_t  postUntilNs_ = 0;
+    bool     windowOpen_ = false;
+    bool     inFlight_ = false;
+    bool     quit_ = false;
+    Stats    stats_;
+    CImageSaver* rec_ = nullptr;
+    CFrameGrabber* grab_ = nullptr;
+    GrabberCallbackGate gate_;
+    std::thread flusher_;
+};
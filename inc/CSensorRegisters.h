@@ -0,0 +1,575 @@
+#pragma once
+/**
+ * @file CSensorRegisters.h
+ * @brief Batched, cached sensor register access with frame-boundary group commits.
+ *
+ * @ref IFrameGrabImpl::SetSensorRegister is one bus transaction per register. An AE loop that
+ * updates exposure and gain (often 4-8 registers) every frame needs them to land together,
+ * inside one frame time. This header splits register access in two layers:
+ *  - @ref ISensorRegisterIO: the transport. @ref CI2CRegisterIO (i2c-dev, combined I2C_RDWR
+ *    transfers with auto-increment runs), @ref CV4L2RegisterIO (VIDIOC_DBG_G/S_REGISTER on a
+ *    subdev or video node) and @ref CSimSensorRegisters (in-memory register map for tests).
+ *  - @ref CSensorRegisterCache: a shadow copy of every register written or read. Writes of the
+ *    current value are skipped; @ref CSensorRegisterCache::Stage queues a group that
+ *    @ref CSensorRegisterCache::CommitPending applies as one batch, optionally wrapped in the
+ *    sensor's group-hold register, when the backend reaches a frame boundary.
+ *
+ * Backends implementing @ref ISensorRegisterSource (CV4L2Stream, CTestPattern) route
+ * SetSensorRegister/GetSensorRegister through their cache and commit staged groups right
+ * after dequeuing a frame.
+ *
+ * @code
+ * auto* v4l2 = new CV4L2Stream();
+ * v4l2->registers().SetIO(std::make_shared<CI2CRegisterIO>("/dev/i2c-10", 0x1a));
+ * v4l2->registers().SetGroupHold(0x0104, 1, 0);          // grouped_parameter_hold
+ * ...
+ * grab.SetSensorRegisters({ { 0x0202, 0x04 }, { 0x0203, 0x80 }, { 0x0205, 0x20 } });
+ * @endcode
+ *
+ * @note The shadow assumes registers only change through this cache. Call
+ *       @ref CSensorRegisterCache::Invalidate after a sensor reset or for volatile registers.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/videodev2.h>
+#endif
+
+#include "CSH_Log.h"
+
+/**
+ * @brief One register write (address, value).
+ */
+struct CSensorRegWrite {
+    uint32_t address = 0;
+    uint32_t value = 0;
+};
+
+/**
+ * @class ISensorRegisterIO
+ * @brief Register transport (bus access only, no caching).
+ */
+class ISensorRegisterIO {
+public:
+    virtual ~ISensorRegisterIO() = default;
+
+    /// @brief Read one register. @return false on bus error.
+    virtual bool Read(uint32_t address, uint32_t& value) = 0;
+
+    /// @brief Write one register. @return false on bus error.
+    virtual bool Write(uint32_t address, uint32_t value) = 0;
+
+    /**
+     * @brief Write @p count registers in order, as few transactions as the transport allows.
+     * @return false if any write failed (earlier writes may have been applied).
+     * @note The default issues one @ref Write per register.
+     */
+    virtual bool WriteBatch(const CSensorRegWrite* regs, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!Write(regs[i].address, regs[i].value)) return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * @class CSimSensorRegisters
+ * @brief In-memory register map standing in for a sensor (tests, CTestPattern).
+ *
+ * Unwritten registers read as 0 (or the value given to @ref Preload). Counters report bus
+ * traffic so cache behavior can be checked without hardware.
+ *
+ * @thread_safety All methods are thread-safe.
+ */
+class CSimSensorRegisters : public ISensorRegisterIO {
+public:
+    /**
+     * @param valueBits Register width; written values are masked to it (8, 16 or 32).
+     */
+    explicit CSimSensorRegisters(uint32_t valueBits = 8)
+        : mask_(valueBits >= 32 ? 0xFFFFFFFFu : ((1u << valueBits) - 1u)) {}
+
+    bool Read(uint32_t address, uint32_t& value) override {
+        std::lock_guard<std::mutex> lk(mtx_);
+        ++reads_;
+        ++transactions_;
+        auto it = regs_.find(address);
+        value = it != regs_.end() ? it->second : 0u;
+        return true;
+    }
+
+    bool Write(uint32_t address, uint32_t value) override {
+        std::lock_guard<std::mutex> lk(mtx_);
+        ++transactions_;
+        return write_(address, value);
+    }
+
+    /// Applies the whole batch as one transaction.
+    bool WriteBatch(const CSensorRegWrite* regs, std::size_t count) override {
+        std::lock_guard<std::mutex> lk(mtx_);
+        ++transactions_;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!write_(regs[i].address, regs[i].value)) return false;
+        }
+        return true;
+    }
+
+    /// @brief Set register values without counting bus traffic (power-on defaults).
+    void Preload(const std::vector<CSensorRegWrite>& regs) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (const CSensorRegWrite& r : regs) regs_[r.address] = r.value & mask_;
+    }
+
+    /// @brief Reject writes to @p address (write returns false), like a read-only status register.
+    void SetReadOnly(uint32_t address) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        readOnly_.insert(address);
+    }
+
+    /// @return Current value of @p address (0 if never written), without counting a read.
+    uint32_t value(uint32_t address) const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it = regs_.find(address);
+        return it != regs_.end() ? it->second : 0u;
+    }
+
+    /// @return Register writes applied so far.
+    uint64_t writes() const { std::lock_guard<std::mutex> lk(mtx_); return writes_; }
+    /// @return Register reads so far.
+    uint64_t reads() const { std::lock_guard<std::mutex> lk(mtx_); return reads_; }
+    /// @return Bus transactions (a batch counts once).
+    uint64_t transactions() const { std::lock_guard<std::mutex> lk(mtx_); return transactions_; }
+
+private:
+    bool write_(uint32_t address, uint32_t value) {
+        if (readOnly_.count(address)) return false;
+        regs_[address] = value & mask_;
+        ++writes_;
+        return true;
+    }
+
+    mutable std::mutex mtx_;
+    uint32_t mask_;
+    std::map<uint32_t, uint32_t> regs_;
+    std::set<uint32_t> readOnly_;
+    uint64_t writes_ = 0, reads_ = 0, transactions_ = 0;
+};
+
+#if defined(__linux__)
+
+/**
+ * @class CI2CRegisterIO
+ * @brief Sensor registers over i2c-dev (`/dev/i2c-N`) with combined I2C_RDWR transfers.
+ *
+ * Addresses and values are big-endian on the wire (the usual CCI convention). A batch is sent
+ * as one I2C_RDWR call; a register whose address follows the previous one's last byte
+ * (address + value width) is merged into the same message (register auto-increment), so an
+ * exposure/gain group is typically one or two bus transactions.
+ *
+ * @note Opening the bus needs access to /dev/i2c-N; the sensor driver may hold the address
+ *       (I2C_SLAVE_FORCE is not used: messages address the slave directly).
+ */
+class CI2CRegisterIO : public ISensorRegisterIO {
+public:
+    /**
+     * @param bus        i2c-dev node, e.g. "/dev/i2c-10".
+     * @param slave      7-bit slave address.
+     * @param addrBytes  Register address width in bytes (1 or 2).
+     * @param valueBytes Register value width in bytes (1, 2 or 4).
+     */
+    CI2CRegisterIO(const std::string& bus, uint16_t slave, uint32_t addrBytes = 2, uint32_t valueBytes = 1)
+        : slave_(slave),
+          addrBytes_(std::min<uint32_t>(2, std::max<uint32_t>(1, addrBytes))),
+          valueBytes_(valueBytes == 2 || valueBytes == 4 ? valueBytes : 1) {
+        fd_ = ::open(bus.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd_ < 0) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"open(%ls) failed: errno=%d", std::wstring(bus.begin(), bus.end()).c_str(), errno);
+        }
+    }
+
+    ~CI2CRegisterIO() override {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    CI2CRegisterIO(const CI2CRegisterIO&) = delete;
+    CI2CRegisterIO& operator=(const CI2CRegisterIO&) = delete;
+
+    /// @return True if the bus node is open.
+    bool isOpen() const { return fd_ >= 0; }
+
+    bool Read(uint32_t address, uint32_t& value) override {
+        if (fd_ < 0) return false;
+        uint8_t a[2], v[4] = {};
+        putBE_(a, address, addrBytes_);
+        i2c_msg msgs[2] = {
+            { slave_, 0, static_cast<uint16_t>(addrBytes_), a },
+            { slave_, I2C_M_RD, static_cast<uint16_t>(valueBytes_), v },
+        };
+        if (!transfer_(msgs, 2)) return false;
+        value = 0;
+        for (uint32_t i = 0; i < valueBytes_; ++i) value = (value << 8) | v[i];
+        return true;
+    }
+
+    bool Write(uint32_t address, uint32_t value) override {
+        const CSensorRegWrite r{ address, value };
+        return WriteBatch(&r, 1);
+    }
+
+    bool WriteBatch(const CSensorRegWrite* regs, std::size_t count) override {
+        if (fd_ < 0) return false;
+        std::vector<std::vector<uint8_t>> bufs;
+        std::vector<i2c_msg> msgs;
+        for (std::size_t i = 0; i < count; ++i) {
+            const bool extend = i > 0 && !bufs.empty() && regs[i].address == regs[i - 1].address + valueBytes_;
+            if (!extend) {
+                if (msgs.size() == I2C_RDWR_IOCTL_MAX_MSGS && !flush_(bufs, msgs)) return false;
+                bufs.emplace_back(addrBytes_);
+                putBE_(bufs.back().data(), regs[i].address, addrBytes_);
+                msgs.push_back({ slave_, 0, 0, nullptr });
+            }
+            std::vector<uint8_t>& b = bufs.back();
+            const std::size_t at = b.size();
+            b.resize(at + valueBytes_);
+            putBE_(b.data() + at, regs[i].value, valueBytes_);
+        }
+        return flush_(bufs, msgs);
+    }
+
+private:
+    static void putBE_(uint8_t* dst, uint32_t v, uint32_t bytes) {
+        for (uint32_t i = 0; i < bytes; ++i) dst[i] = static_cast<uint8_t>(v >> (8 * (bytes - 1 - i)));
+    }
+
+    bool flush_(std::vector<std::vector<uint8_t>>& bufs, std::vector<i2c_msg>& msgs) {
+        if (msgs.empty()) return true;
+        for (std::size_t i = 0; i < msgs.size(); ++i) {
+            msgs[i].buf = bufs[i].data();
+            msgs[i].len = static_cast<uint16_t>(bufs[i].size());
+        }
+        const bool ok = transfer_(msgs.data(), static_cast<uint32_t>(msgs.size()));
+        bufs.clear();
+        msgs.clear();
+        return ok;
+    }
+
+    bool transfer_(i2c_msg* msgs, uint32_t n) {
+        i2c_rdwr_ioctl_data data{ msgs, n };
+        int r;
+        do { r = ::ioctl(fd_, I2C_RDWR, &data); } while (r < 0 && errno == EINTR);
+        if (r < 0) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"I2C_RDWR to 0x%02x failed: errno=%d", slave_, errno);
+            return false;
+        }
+        return true;
+    }
+
+    int fd_ = -1;
+    uint16_t slave_;
+    uint32_t addrBytes_;
+    uint32_t valueBytes_;
+};
+
+/**
+ * @class CV4L2RegisterIO
+ * @brief Sensor registers through the V4L2 debug interface (VIDIOC_DBG_G/S_REGISTER).
+ *
+ * Open the sensor's subdev node ("/dev/v4l-subdevN", match BRIDGE/0), or a video node and
+ * address a subdev by index (match V4L2_CHIP_MATCH_SUBDEV). Batches are one ioctl per register;
+ * the gain comes from the shadow cache and group commits above this transport.
+ *
+ * @note Requires a kernel with CONFIG_VIDEO_ADV_DEBUG and CAP_SYS_ADMIN, and a sensor driver
+ *       implementing g_register/s_register. Otherwise use @ref CI2CRegisterIO.
+ */
+class CV4L2RegisterIO : public ISensorRegisterIO {
+public:
+    /**
+     * @param node       Subdev or video node.
+     * @param valueBytes Register value width in bytes.
+     * @param matchType  V4L2_CHIP_MATCH_BRIDGE (subdev node) or V4L2_CHIP_MATCH_SUBDEV (video node).
+     * @param matchAddr  Chip/subdev index for @p matchType.
+     */
+    explicit CV4L2RegisterIO(const std::string& node, uint32_t valueBytes = 1,
+        uint32_t matchType = V4L2_CHIP_MATCH_BRIDGE, uint32_t matchAddr = 0)
+        : valueBytes_(valueBytes), matchType_(matchType), matchAddr_(matchAddr) {
+        fd_ = ::open(node.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd_ < 0) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"open(%ls) failed: errno=%d", std::wstring(node.begin(), node.end()).c_str(), errno);
+        }
+    }
+
+    ~CV4L2RegisterIO() override {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    CV4L2RegisterIO(const CV4L2RegisterIO&) = delete;
+    CV4L2RegisterIO& operator=(const CV4L2RegisterIO&) = delete;
+
+    /// @return True if the node is open.
+    bool isOpen() const { return fd_ >= 0; }
+
+    bool Read(uint32_t address, uint32_t& value) override {
+        v4l2_dbg_register r = make_(address, 0);
+        if (!ioctl_(VIDIOC_DBG_G_REGISTER, r)) return false;
+        value = static_cast<uint32_t>(r.val);
+        return true;
+    }
+
+    bool Write(uint32_t address, uint32_t value) override {
+        v4l2_dbg_register r = make_(address, value);
+        return ioctl_(VIDIOC_DBG_S_REGISTER, r);
+    }
+
+private:
+    v4l2_dbg_register make_(uint32_t address, uint32_t value) const {
+        v4l2_dbg_register r{};
+        r.match.type = matchType_;
+        r.match.addr = matchAddr_;
+        r.size = valueBytes_;
+        r.reg = address;
+        r.val = value;
+        return r;
+    }
+
+    bool ioctl_(unsigned long req, v4l2_dbg_register& r) {
+        if (fd_ < 0) return false;
+        int rc;
+        do { rc = ::ioctl(fd_, req, &r); } while (rc < 0 && errno == EINTR);
+        if (rc < 0) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"VIDIOC_DBG_%ls_REGISTER(0x%04x) failed: errno=%d",
+                req == VIDIOC_DBG_S_REGISTER ? L"S" : L"G", static_cast<unsigned>(r.reg), errno);
+            return false;
+        }
+        return true;
+    }
+
+    int fd_ = -1;
+    uint32_t valueBytes_;
+    uint32_t matchType_;
+    uint32_t matchAddr_;
+};
+
+#endif // __linux__
+
+/**
+ * @class CSensorRegisterCache
+ * @brief Shadow-register cache with batch writes and frame-boundary group commits.
+ *
+ * @thread_safety All methods are thread-safe. Bus access is serialized by the cache.
+ */
+class CSensorRegisterCache {
+public:
+    /// Counters (snapshot).
+    struct Stats {
+        uint64_t requested = 0;     ///< Register writes requested (immediate and staged).
+        uint64_t issued = 0;        ///< Register writes sent to the transport.
+        uint64_t skipped = 0;       ///< Writes dropped because the shadow already held the value.
+        uint64_t transactions = 0;  ///< Transport calls (Write/WriteBatch/Read).
+        uint64_t commits = 0;       ///< Staged groups applied by @ref CommitPending.
+        uint64_t failures = 0;      ///< Transport calls that failed.
+    };
+
+    explicit CSensorRegisterCache(std::shared_ptr<ISensorRegisterIO> io = nullptr) : io_(std::move(io)) {}
+
+    /// @brief Replace the transport; clears the shadow and any staged group.
+    void SetIO(std::shared_ptr<ISensorRegisterIO> io) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        io_ = std::move(io);
+        shadow_.clear();
+        pending_.clear();
+        hasPending_.store(false, std::memory_order_release);
+    }
+
+    /// @return True if a transport is set.
+    bool hasIO() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return io_ != nullptr;
+    }
+
+    /**
+     * @brief Wrap every commit in a group-hold sequence: write @p holdValue to @p address,
+     *        the group, then @p releaseValue (e.g., 0x0104 = 1 / 0 on CCI sensors).
+     * @param enable false removes the hold.
+     */
+    void SetGroupHold(uint32_t address, uint32_t holdValue, uint32_t releaseValue, bool enable = true) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        holdEnabled_ = enable;
+        hold_ = { address, holdValue };
+        release_ = { address, releaseValue };
+    }
+
+    /**
+     * @brief Write one register now unless the shadow already holds @p value.
+     * @return false if there is no transport or the bus write failed.
+     */
+    bool Write(uint32_t address, uint32_t value) {
+        const CSensorRegWrite r{ address, value };
+        return WriteBatch(&r, 1);
+    }
+
+    /// @brief Write a group now, skipping registers whose shadow matches (one transport batch).
+    bool WriteBatch(const std::vector<CSensorRegWrite>& regs) {
+        return WriteBatch(regs.data(), regs.size());
+    }
+
+    /// @copydoc WriteBatch(const std::vector<CSensorRegWrite>&)
+    bool WriteBatch(const CSensorRegWrite* regs, std::size_t count) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!io_) return false;
+        stats_.requested += count;
+        return apply_(regs, count, false);
+    }
+
+    /**
+     * @brief Read a register, from the shadow when known.
+     * @param fromBus Bypass the shadow (volatile registers); the shadow is refreshed.
+     */
+    bool Read(uint32_t address, uint32_t& value, bool fromBus = false) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!fromBus) {
+            auto it = shadow_.find(address);
+            if (it != shadow_.end()) {
+                value = it->second;
+                return true;
+            }
+        }
+        if (!io_) return false;
+        ++stats_.transactions;
+        uint32_t v = 0;
+        if (!io_->Read(address, v)) {
+            ++stats_.failures;
+            return false;
+        }
+        shadow_[address] = v;
+        value = v;
+        return true;
+    }
+
+    /**
+     * @brief Queue a write for the next @ref CommitPending (frame boundary).
+     * @note Restaging an address replaces its value and keeps its original position.
+     */
+    void Stage(uint32_t address, uint32_t value) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stage_(address, value);
+    }
+
+    /// @brief Queue a group for the next @ref CommitPending.
+    void Stage(const std::vector<CSensorRegWrite>& regs) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (const CSensorRegWrite& r : regs) stage_(r.address, r.value);
+    }
+
+    /// @return True if a staged group waits for @ref CommitPending (lock-free).
+    bool hasPending() const { return hasPending_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Apply the staged group as one batch (inside the group hold, if configured).
+     * @return true if nothing was staged or every write succeeded.
+     * @note Backends call this at a frame boundary; calling it directly applies immediately.
+     */
+    bool CommitPending() {
+        if (!hasPending()) return true;
+        std::lock_guard<std::mutex> lk(mtx_);
+        std::vector<CSensorRegWrite> group;
+        group.swap(pending_);
+        hasPending_.store(false, std::memory_order_release);
+        if (group.empty()) return true;
+        if (!io_) return false;
+        stats_.requested += group.size();
+        ++stats_.commits;
+        return apply_(group.data(), group.size(), holdEnabled_);
+    }
+
+    /// @brief Forget every shadowed value (next writes go to the bus).
+    void Invalidate() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        shadow_.clear();
+    }
+
+    /// @brief Forget the shadowed value of @p address.
+    void Invalidate(uint32_t address) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        shadow_.erase(address);
+    }
+
+    /// @return Counters.
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return stats_;
+    }
+
+private:
+    void stage_(uint32_t address, uint32_t value) {
+        auto it = std::find_if(pending_.begin(), pending_.end(), [address](const CSensorRegWrite& r) { return r.address == address; });
+        if (it != pending_.end()) it->value = value;
+        else pending_.push_back({ address, value });
+        hasPending_.store(true, std::memory_order_release);
+    }
+
+    /// Filter against the shadow and send one batch. Caller holds mtx_.
+    bool apply_(const CSensorRegWrite* regs, std::size_t count, bool withHold) {
+        batch_.clear();
+        if (withHold) batch_.push_back(hold_);
+        for (std::size_t i = 0; i < count; ++i) {
+            auto it = shadow_.find(regs[i].address);
+            if (it != shadow_.end() && it->second == regs[i].value) {
+                ++stats_.skipped;
+                continue;
+            }
+            batch_.push_back(regs[i]);
+        }
+        if (batch_.size() == (withHold ? 1u : 0u)) return true; // all redundant
+        if (withHold) batch_.push_back(release_);
+
+        ++stats_.transactions;
+        const std::size_t payload = batch_.size() - (withHold ? 2u : 0u);
+        if (!io_->WriteBatch(batch_.data(), batch_.size())) {
+            ++stats_.failures;
+            // Unknown which writes landed: drop their shadows so the next write retries.
+            for (const CSensorRegWrite& r : batch_) shadow_.erase(r.address);
+            return false;
+        }
+        stats_.issued += payload;
+        for (std::size_t i = withHold ? 1 : 0, n = i + payload; i < n; ++i) shadow_[batch_[i].address] = batch_[i].value;
+        return true;
+    }
+
+    mutable std::mutex mtx_;
+    std::shared_ptr<ISensorRegisterIO> io_;
+    std::map<uint32_t, uint32_t> shadow_;
+    std::vector<CSensorRegWrite> pending_;
+    std::vector<CSensorRegWrite> batch_;    ///< Reused transport batch.
+    std::atomic<bool> hasPending_{ false };
+    bool holdEnabled_ = false;
+    CSensorRegWrite hold_, release_;
+    Stats stats_;
+};
+
+/**
+ * @brief Implemented by backends that route register access through a @ref CSensorRegisterCache
+ *        and commit staged groups at frame boundaries.
+ * @see CFrameGrabber::SetSensorRegisters
+ */
+class ISensorRegisterSource {
+public:
+    virtual ~ISensorRegisterSource() = default;
+
+    /// @return Register cache of this backend (lives as long as the backend).
+    virtual CSensorRegisterCache& registers() = 0;
+};
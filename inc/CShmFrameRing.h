@@ -0,0 +1,527 @@
+#pragma once
+/**
+ * @file CShmFrameRing.h
+ * @brief Shared-memory frame ring: one capture process publishes, local processes map frames read-only.
+ *
+ * @ref CShmFramePublisher creates two POSIX shared-memory objects named after the ring:
+ *  - `/<name>`       header, per-slot metadata and frame data. Written by the publisher only;
+ *                    subscribers map it **read-only** and receive frames as zero-copy
+ *                    @ref csh_img::CSH_Image views on the mapping.
+ *  - `/<name>.lease` one lease per subscriber (pid + bitmask of slots it holds). This is the
+ *                    only memory subscribers write.
+ *
+ * Publishing copies the frame once into a free slot (a slot no live subscriber holds), fills the
+ * slot header (size, format, sequence, capture timestamp), marks it latest and wakes subscribers
+ * with a futex on the shared header. A slot is never overwritten while a subscriber holds a view
+ * of it; when every slot is held the frame is dropped and counted.
+ *
+ * @code
+ * // capture process
+ * CShmFramePublisher pub("cam0", 1920 * 1080 * 2, 6);
+ * fanout.Subscribe("shm", pub.Input());
+ *
+ * // analytics process
+ * CShmFrameSubscriber sub("cam0");
+ * csh_img::CSH_Image f;
+ * while (sub.WaitNext(f, 100)) analyze(f);    // GetFrameMeta(f)->sequence, ->timestamp_ns
+ * @endcode
+ *
+ * @note Linux only (futex). Leases of crashed subscribers are reclaimed by the publisher.
+ * @note Frame views point into read-only memory: writing through them faults. Copy with
+ *       @ref DeepCopyFrame to modify.
+ */
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "IFrameGrabImpl.h"
+#include "CGrabberFrame.h"
+#include "CSH_Log.h"
+
+namespace shmring_detail {
+
+    constexpr uint32_t kMagic = 0x52464853;   // 'SHFR'
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kMaxSlots = 64;        // one lease bit per slot
+    constexpr std::size_t kAlign = 64;
+
+    /// Ring header at offset 0 of `/<name>`.
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slot_count;
+        uint32_t max_subscribers;
+        uint64_t slot_bytes;                 ///< Capacity of one slot's frame data.
+        uint64_t data_offset;                ///< Offset of slot 0 data.
+        int32_t  publisher_pid;
+        std::atomic<uint32_t> futex;         ///< Bumped on every publish (and on close).
+        std::atomic<uint32_t> closed;        ///< Publisher shut down.
+        std::atomic<int32_t>  latest;        ///< Slot of the newest complete frame (-1: none).
+        std::atomic<uint64_t> published;     ///< Frames published.
+        std::atomic<uint64_t> dropped;       ///< Frames dropped because every slot was held.
+    };
+
+    /// Per-slot metadata (array after @ref Header).
+    struct Slot {
+        std::atomic<uint32_t> generation;    ///< Odd while the publisher writes the slot.
+        uint32_t width, height;
+        uint32_t format, pattern;
+        uint32_t memory_bit, original_bit;
+        uint32_t camera_id;
+        uint64_t bytes;
+        uint64_t frame_index;                ///< Value of Header::published for this frame.
+        uint64_t sequence;                   ///< Driver sequence (CFrameMeta), else frame_index.
+        int64_t  timestamp_ns;               ///< Capture timestamp (steady clock).
+    };
+
+    /// Subscriber lease in `/<name>.lease`.
+    struct Lease {
+        std::atomic<int32_t>  pid;           ///< 0: free.
+        std::atomic<uint64_t> pinned;        ///< Bit i: slot i held.
+    };
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+        "shared-memory ring needs address-free atomics");
+
+    inline std::size_t alignUp(std::size_t v) { return (v + kAlign - 1) & ~(kAlign - 1); }
+
+    inline std::size_t slotsOffset() { return alignUp(sizeof(Header)); }
+
+    inline std::string objName(const std::string& name) { return name.empty() || name[0] == '/' ? name : "/" + name; }
+
+    inline int futexWake(std::atomic<uint32_t>* addr) {
+        return static_cast<int>(::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0));
+    }
+
+    /// Shared (not private) futex wait: works on the subscriber's read-only mapping.
+    inline void futexWait(const std::atomic<uint32_t>* addr, uint32_t expected, int timeoutMs) {
+        timespec ts{ timeoutMs / 1000, static_cast<long>(timeoutMs % 1000) * 1000000L };
+        ::syscall(SYS_futex, reinterpret_cast<const uint32_t*>(addr), FUTEX_WAIT, expected, timeoutMs >= 0 ? &ts : nullptr, nullptr, 0);
+    }
+
+    inline void* mapObject(const std::string& name, int flags, int prot, std::size_t& bytes, int& fd) {
+        fd = ::shm_open(name.c_str(), flags, 0660);
+        if (fd < 0) return nullptr;
+        if (!bytes) {
+            struct stat st {};
+            if (::fstat(fd, &st) != 0) return nullptr;
+            bytes = static_cast<std::size_t>(st.st_size);
+        }
+        if (bytes == 0) return nullptr;
+        void* p = ::mmap(nullptr, bytes, prot, MAP_SHARED, fd, 0);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    inline std::wstring wstr(const std::string& s) { return std::wstring(s.begin(), s.end()); }
+
+} // namespace shmring_detail
+
+/**
+ * @class CShmFramePublisher
+ * @brief Owner of a shared-memory frame ring (one per ring name).
+ *
+ * @thread_safety @ref Publish may be called from one thread at a time (the grab thread).
+ */
+class CShmFramePublisher {
+public:
+    /**
+     * @param name           Ring name ("cam0" creates /dev/shm/cam0 and /dev/shm/cam0.lease).
+     * @param slotBytes      Largest frame in bytes (CSH_Image::buffer_size).
+     * @param slotCount      Frames in the ring, 2..64. Subscribers can hold slotCount-1 frames
+     *                       before the publisher starts dropping.
+     * @param maxSubscribers Concurrent subscriber leases.
+     * @note An existing ring of the same name is replaced.
+     */
+    CShmFramePublisher(const std::string& name, std::size_t slotBytes, uint32_t slotCount = 4, uint32_t maxSubscribers = 8)
+        : name_(shmring_detail::objName(name)) {
+        using namespace shmring_detail;
+        slotCount = std::max<uint32_t>(2, std::min(slotCount, kMaxSlots));
+        maxSubscribers = std::max<uint32_t>(1, maxSubscribers);
+        const std::size_t stride = alignUp(slotBytes);
+        const std::size_t dataOff = alignUp(slotsOffset() + sizeof(Slot) * slotCount);
+        bytes_ = dataOff + stride * slotCount;
+        leaseBytes_ = sizeof(Lease) * maxSubscribers;
+
+        ::shm_unlink(name_.c_str());
+        ::shm_unlink((name_ + ".lease").c_str());
+        if (!create_(name_, bytes_, fd_, base_) || !create_(name_ + ".lease", leaseBytes_, leaseFd_, leases_)) {
+            close_();
+            return;
+        }
+
+        Header* h = header_();
+        new (h) Header{};
+        h->slot_count = slotCount;
+        h->max_subscribers = maxSubscribers;
+        h->slot_bytes = slotBytes;
+        h->data_offset = dataOff;
+        h->publisher_pid = static_cast<int32_t>(::getpid());
+        h->latest.store(-1);
+        for (uint32_t i = 0; i < slotCount; ++i) new (slot_(i)) Slot{};
+        for (uint32_t i = 0; i < maxSubscribers; ++i) new (lease_(i)) Lease{};
+        stride_ = stride;
+        h->version = kVersion;
+        std::atomic_thread_fence(std::memory_order_release);
+        h->magic = kMagic;  // subscribers accept the ring from here on
+    }
+
+    ~CShmFramePublisher() {
+        if (base_) {
+            header_()->closed.store(1);
+            header_()->futex.fetch_add(1);
+            shmring_detail::futexWake(&header_()->futex);
+        }
+        close_();
+        if (!name_.empty()) {
+            ::shm_unlink(name_.c_str());
+            ::shm_unlink((name_ + ".lease").c_str());
+        }
+    }
+
+    CShmFramePublisher(const CShmFramePublisher&) = delete;
+    CShmFramePublisher& operator=(const CShmFramePublisher&) = delete;
+
+    /// @return True if the ring was created.
+    bool isOpen() const { return base_ != nullptr; }
+
+    /**
+     * @brief Copy @p frame into a free slot and wake subscribers.
+     * @return false if the ring is not open, the frame exceeds the slot size, or every slot
+     *         is held by subscribers (counted in @ref dropped).
+     */
+    bool Publish(const csh_img::CSH_Image& frame) {
+        if (!base_) return false;
+        const auto* src = frame.data();
+        shmring_detail::Header* h = header_();
+        if (!src || frame.buffer_size == 0 || frame.buffer_size > h->slot_bytes) return false;
+
+        const int idx = claimSlot_();
+        if (idx < 0) {
+            h->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        shmring_detail::Slot* s = slot_(static_cast<uint32_t>(idx));
+        std::memcpy(data_(static_cast<uint32_t>(idx)), src, frame.buffer_size);
+
+        const uint64_t n = h->published.load(std::memory_order_relaxed) + 1;
+        const CFrameMeta* meta = GetFrameMeta(frame);
+        s->width = frame.width;
+        s->height = frame.height;
+        s->format = static_cast<uint32_t>(frame.format);
+        s->pattern = static_cast<uint32_t>(frame.pattern);
+        s->memory_bit = frame.memory_bit;
+        s->original_bit = frame.original_bit;
+        s->camera_id = frame.camera_id;
+        s->bytes = frame.buffer_size;
+        s->frame_index = n;
+        s->sequence = meta ? meta->sequence : n;
+        s->timestamp_ns = meta ? meta->timestamp_ns : GrabberNowNs();
+        s->generation.fetch_add(1);           // even: complete
+
+        h->latest.store(idx);
+        h->published.store(n);
+        h->futex.fetch_add(1);
+        shmring_detail::futexWake(&h->futex);
+        return true;
+    }
+
+    /// @return Callback that publishes every frame; register it with any frame source.
+    FrameGrabCallbackProc Input() {
+        return [this](const csh_img::CSH_Image& f) { Publish(f); };
+    }
+
+    /// @return Frames published.
+    uint64_t published() const { return base_ ? header_()->published.load() : 0; }
+
+    /// @return Frames dropped because every slot was held.
+    uint64_t dropped() const { return base_ ? header_()->dropped.load() : 0; }
+
+private:
+    static bool create_(const std::string& name, std::size_t bytes, int& fd, void*& base) {
+        fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+        if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"shm %ls: create failed: errno=%d", shmring_detail::wstr(name).c_str(), errno);
+            return false;
+        }
+        base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            base = nullptr;
+            LOG_WRITE(cshlog::LogLevel::Error, L"shm %ls: mmap failed: errno=%d", shmring_detail::wstr(name).c_str(), errno);
+            return false;
+        }
+        return true;
+    }
+
+    void close_() {
+        if (base_) ::munmap(base_, bytes_);
+        if (leases_) ::munmap(leases_, leaseBytes_);
+        if (fd_ >= 0) ::close(fd_);
+        if (leaseFd_ >= 0) ::close(leaseFd_);
+        base_ = leases_ = nullptr;
+        fd_ = leaseFd_ = -1;
+    }
+
+    shmring_detail::Header* header_() const { return static_cast<shmring_detail::Header*>(base_); }
+    shmring_detail::Slot* slot_(uint32_t i) const {
+        return reinterpret_cast<shmring_detail::Slot*>(static_cast<uint8_t*>(base_) + shmring_detail::slotsOffset()) + i;
+    }
+    shmring_detail::Lease* lease_(uint32_t i) const { return static_cast<shmring_detail::Lease*>(leases_) + i; }
+    uint8_t* data_(uint32_t i) const { return static_cast<uint8_t*>(base_) + header_()->data_offset + stride_ * i; }
+
+    /// Release the leases of dead processes, pinned or not (one kill() per lease).
+    void reapLeases_() {
+        for (uint32_t i = 0; i < header_()->max_subscribers; ++i) {
+            shmring_detail::Lease* l = lease_(i);
+            const int32_t pid = l->pid.load();
+            if (pid && ::kill(pid, 0) != 0 && errno == ESRCH) {
+                l->pinned.store(0);
+                l->pid.store(0);
+            }
+        }
+    }
+
+    /// Union of the leases' pinned masks (loads only).
+    uint64_t pinnedSlots_() const {
+        uint64_t mask = 0;
+        for (uint32_t i = 0; i < header_()->max_subscribers; ++i) mask |= lease_(i)->pinned.load();
+        return mask;
+    }
+
+    /**
+     * Pick the oldest slot no subscriber holds and mark it as being written (odd generation).
+     * Pairs with the subscriber's pin-then-check: both sides store, then load (seq_cst), so
+     * either the publisher sees the pin or the subscriber sees the odd generation.
+     * Dead leases are reaped and the pinned mask is built once per call; only the
+     * post-store check (required by the handshake) reloads it.
+     */
+    int claimSlot_() {
+        shmring_detail::Header* h = header_();
+        const uint32_t n = h->slot_count;
+        reapLeases_();
+        const uint64_t pinned = pinnedSlots_();
+        for (uint32_t k = 1; k <= n; ++k) {
+            const uint32_t i = (cursor_ + k) % n;
+            if (static_cast<int>(i) == h->latest.load()) continue;
+            if (pinned & (1ull << i)) continue;
+            shmring_detail::Slot* s = slot_(i);
+            const uint32_t g = s->generation.load();
+            s->generation.store(g + 1);              // odd: writing
+            if (pinnedSlots_() & (1ull << i)) {      // a subscriber pinned it meanwhile
+                s->generation.store(g);
+                continue;
+            }
+            cursor_ = i;
+            return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    std::string name_;
+    int fd_ = -1, leaseFd_ = -1;
+    void* base_ = nullptr;
+    void* leases_ = nullptr;
+    std::size_t bytes_ = 0, leaseBytes_ = 0, stride_ = 0;
+    uint32_t cursor_ = 0;
+};
+
+/**
+ * @class CShmFrameSubscriber
+ * @brief Read-only view of a ring created by @ref CShmFramePublisher (any local process).
+ *
+ * Frames are zero-copy @ref csh_img::CSH_Image views carrying @ref CFrameMeta (sequence,
+ * capture timestamp, slot index). The slot stays reserved until the last copy of the view is
+ * released; the mapping stays valid as long as any view exists, even after this object dies.
+ *
+ * @thread_safety @ref WaitNext / @ref TryGetLatest from one thread at a time; views may be
+ * released on any thread.
+ */
+class CShmFrameSubscriber {
+public:
+    /// @param name Ring name given to the publisher.
+    explicit CShmFrameSubscriber(const std::string& name) {
+        using namespace shmring_detail;
+        const std::string obj = objName(name);
+        auto m = std::make_shared<Mapping_>();
+        std::size_t bytes = 0, leaseBytes = 0;
+        m->base = mapObject(obj, O_RDONLY | O_CLOEXEC, PROT_READ, bytes, m->fd);
+        m->bytes = bytes;
+        if (!m->base) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"shm %ls: no publisher (errno=%d)", wstr(obj).c_str(), errno);
+            return;
+        }
+        const Header* h = static_cast<const Header*>(m->base);
+        if (bytes < sizeof(Header) || h->magic != kMagic || h->version != kVersion) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"shm %ls: not a frame ring (or not initialized yet)", wstr(obj).c_str());
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        m->leases = mapObject(obj + ".lease", O_RDWR | O_CLOEXEC, PROT_READ | PROT_WRITE, leaseBytes, m->leaseFd);
+        m->leaseBytes = leaseBytes;
+        if (!m->leases || leaseBytes < sizeof(Lease) * h->max_subscribers) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"shm %ls: cannot map leases (errno=%d)", wstr(obj).c_str(), errno);
+            return;
+        }
+        const int32_t pid = static_cast<int32_t>(::getpid());
+        for (uint32_t i = 0; i < h->max_subscribers; ++i) {
+            Lease* l = static_cast<Lease*>(m->leases) + i;
+            int32_t expected = 0;
+            if (l->pid.compare_exchange_strong(expected, pid)) {
+                l->pinned.store(0);
+                m->lease = l;
+                break;
+            }
+        }
+        if (!m->lease) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"shm %ls: all %u subscriber leases in use", wstr(obj).c_str(), h->max_subscribers);
+            return;
+        }
+        map_ = std::move(m);
+    }
+
+    CShmFrameSubscriber(const CShmFrameSubscriber&) = delete;
+    CShmFrameSubscriber& operator=(const CShmFrameSubscriber&) = delete;
+
+    /// @return True if the ring is mapped and a lease was obtained.
+    bool isOpen() const { return map_ != nullptr; }
+
+    /// @return True while the publisher has not shut down.
+    bool isPublisherAlive() const { return map_ && !header_()->closed.load(); }
+
+    /**
+     * @brief Wait for a frame newer than the last one taken and return a view of it.
+     * @param out       Receives the view (freshly assigned).
+     * @param timeoutMs Maximum wait in milliseconds (-1: forever).
+     * @return false on timeout, when the publisher closed, or if the ring is not open.
+     * @note Returns the newest frame; frames published in between are counted in @ref missed.
+     */
+    bool WaitNext(csh_img::CSH_Image& out, int timeoutMs) {
+        if (!map_) return false;
+        const shmring_detail::Header* h = header_();
+        const int64_t deadline = timeoutMs >= 0 ? GrabberNowNs() + static_cast<int64_t>(timeoutMs) * 1000000LL : 0;
+        for (;;) {
+            const uint32_t f = h->futex.load();
+            if (h->published.load() > lastIndex_ && take_(out)) return true;
+            if (h->closed.load()) return false;
+            int waitMs = -1;
+            if (timeoutMs >= 0) {
+                const int64_t left = deadline - GrabberNowNs();
+                if (left <= 0) return false;
+                waitMs = static_cast<int>((left + 999999) / 1000000);
+            }
+            shmring_detail::futexWait(&h->futex, f, waitMs);
+        }
+    }
+
+    /**
+     * @brief View of the newest frame without waiting (may be the one taken last).
+     * @return false if nothing has been published yet.
+     */
+    bool TryGetLatest(csh_img::CSH_Image& out) { return map_ && take_(out); }
+
+    /// @return Frames skipped between successive @ref WaitNext / @ref TryGetLatest results.
+    uint64_t missed() const { return missed_; }
+
+    /// @return Frame capacity of one slot in bytes.
+    std::size_t slotBytes() const { return map_ ? static_cast<std::size_t>(header_()->slot_bytes) : 0; }
+
+private:
+    /// Mappings + lease; shared with frame views so they outlive the subscriber object.
+    struct Mapping_ {
+        void* base = nullptr;
+        void* leases = nullptr;
+        std::size_t bytes = 0, leaseBytes = 0;
+        int fd = -1, leaseFd = -1;
+        shmring_detail::Lease* lease = nullptr;
+        std::mutex mtx;
+        std::array<uint32_t, shmring_detail::kMaxSlots> refs{};  ///< Local views per slot.
+
+        /// Pin before reading; seq_cst pairs with the publisher's claim.
+        void pin(uint32_t i) {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (refs[i]++ == 0) lease->pinned.fetch_or(1ull << i);
+        }
+        void unpin(uint32_t i) {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (refs[i] && --refs[i] == 0) lease->pinned.fetch_and(~(1ull << i));
+        }
+
+        ~Mapping_() {
+            if (lease) {
+                lease->pinned.store(0);
+                lease->pid.store(0);
+            }
+            if (base) ::munmap(base, bytes);
+            if (leases) ::munmap(leases, leaseBytes);
+            if (fd >= 0) ::close(fd);
+            if (leaseFd >= 0) ::close(leaseFd);
+        }
+    };
+
+    const shmring_detail::Header* header_() const { return static_cast<const shmring_detail::Header*>(map_->base); }
+    const shmring_detail::Slot* slot_(uint32_t i) const {
+        return reinterpret_cast<const shmring_detail::Slot*>(static_cast<const uint8_t*>(map_->base) + shmring_detail::slotsOffset()) + i;
+    }
+
+    /// Pin the latest slot, validate it was not being rewritten, and wrap it.
+    bool take_(csh_img::CSH_Image& out) {
+        const shmring_detail::Header* h = header_();
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            const int32_t idx = h->latest.load();
+            if (idx < 0 || static_cast<uint32_t>(idx) >= h->slot_count) return false;
+            const uint32_t i = static_cast<uint32_t>(idx);
+            const shmring_detail::Slot* s = slot_(i);
+            map_->pin(i);
+            const uint32_t g = s->generation.load();
+            if ((g & 1u) || h->latest.load() != idx) { // being rewritten, or superseded: retry
+                map_->unpin(i);
+                continue;
+            }
+
+            CFrameMeta meta;
+            meta.sequence = s->sequence;
+            meta.timestamp_ns = s->timestamp_ns;
+            meta.dequeue_ns = GrabberNowNs();
+            meta.buffer_index = i;
+            meta.bytes_used = static_cast<uint32_t>(s->bytes);
+            if (lastIndex_ && s->frame_index > lastIndex_ + 1) missed_ += s->frame_index - lastIndex_ - 1;
+            lastIndex_ = s->frame_index;
+
+            auto* data = const_cast<csh_img::CSH_Image::byte*>(
+                static_cast<const uint8_t*>(map_->base) + h->data_offset + shmring_detail::alignUp(h->slot_bytes) * i);
+            std::shared_ptr<Mapping_> m = map_;
+            out = csh_img::CSH_Image();
+            SetFrameView(out, MakePooledBuffer(data, meta, [m, i] { m->unpin(i); }), static_cast<std::size_t>(s->bytes),
+                s->width, s->height, static_cast<csh_img::En_ImageFormat>(s->format),
+                static_cast<csh_img::En_ImagePattern>(s->pattern), s->memory_bit, s->original_bit);
+            out.camera_id = s->camera_id;
+            return true;
+        }
+        return false;
+    }
+
+    std::shared_ptr<Mapping_> map_;
+    uint64_t lastIndex_ = 0;
+    uint64_t missed_ = 0;
+};
+
+#endif // __linux__
@@ -0,0 +1,574 @@
+#pragma once
+/**
+ * @file CStillEncoder.h
+ * @brief Off-thread still capture: encode TIFF/PNG/JPEG/TLV files on a worker pool without stalling the pipeline.
+ *
+ * Encoding a 12 MP still inside a frame callback (e.g., `cv::imwrite`) blocks capture and
+ * display for 100+ ms. @ref CStillEncoder::Request only takes a shallow reference to the
+ * frame (a reference-count increment for pooled frames) and queues it; worker threads
+ * convert, encode and write the file, then report through a completion callback.
+ *
+ * Codecs:
+ *  - **TIFF** (native, no dependency): baseline uncompressed or PackBits. Rows are split into
+ *    strips that are converted/compressed in parallel on the pool. Gray/Bayer 8..16 bit are
+ *    written as grayscale (raw values, mosaic preserved); RGB888/BGR888/YUV422/RGB565 as RGB.
+ *  - **PNG / JPEG** via OpenCV (`CSH_IMAGE_WITH_OPENCV`). These codecs have no independent row
+ *    strips, so each file is one task; the pool still encodes several stills concurrently.
+ *    10..14-bit data is scaled to the full range (TIFF keeps raw values).
+ *  - **TLV** (`.ish`) via @ref csh_img::CSH_Image::saveImage.
+ *
+ * @code
+ * CStillEncoder stills;                          // hardware_concurrency / 2 workers
+ * // in any frame callback:
+ * stills.Request(img, "snap_0001.tif", [](const CStillEncoder::Result& r) {
+ *     LOG_WRITE(cshlog::LogLevel::Info, L"still %ls: %d (%.1f ms)", ..., r.ok, r.encode_ms);
+ * });
+ * @endcode
+ *
+ * @note A pooled driver buffer stays queued out until its still is encoded; keep
+ *       `max_pending` below the spare buffers of the capture pool. Frames that are not pooled
+ *       are deep-copied by @ref CStillEncoder::Request, since their source buffer may be reused.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CGrabberFrame.h"
+#include "CSH_Image.h"
+#include "CSH_Log.h"
+
+namespace still_detail {
+
+inline std::wstring wstr(const std::string& s) { return std::wstring(s.begin(), s.end()); }
+
+inline std::string lowerExt(const std::string& path) {
+    const auto dot = path.find_last_of('.');
+    const auto sep = path.find_last_of("/\\");
+    if (dot == std::string::npos || (sep != std::string::npos && dot < sep)) return {};
+    std::string e = path.substr(dot + 1);
+    for (auto& c : e) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return e;
+}
+
+/// PackBits (TIFF compression 32773) of one row, appended to @p out.
+inline void packBits(const uint8_t* p, std::size_t n, std::vector<uint8_t>& out) {
+    std::size_t i = 0;
+    while (i < n) {
+        std::size_t run = 1;
+        while (i + run < n && run < 128 && p[i + run] == p[i]) ++run;
+        if (run >= 2) {
+            out.push_back(static_cast<uint8_t>(257 - run)); // -(run - 1)
+            out.push_back(p[i]);
+            i += run;
+            continue;
+        }
+        std::size_t j = i + 1; // literal until a run of 3 starts
+        while (j < n && j - i < 128 && !(j + 2 < n && p[j] == p[j + 1] && p[j] == p[j + 2])) ++j;
+        out.push_back(static_cast<uint8_t>(j - i - 1));
+        out.insert(out.end(), p + i, p + j);
+        i = j;
+    }
+}
+
+inline uint8_t clamp8(int v) { return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v)); }
+
+/// BT.601 limited range YUV -> RGB (matches the CPU converter).
+inline void yuvToRgb(int y, int u, int v, uint8_t* rgb) {
+    const int c = 298 * (y - 16), d = u - 128, e = v - 128;
+    rgb[0] = clamp8((c + 409 * e + 128) >> 8);
+    rgb[1] = clamp8((c - 100 * d - 208 * e + 128) >> 8);
+    rgb[2] = clamp8((c + 516 * d + 128) >> 8);
+}
+
+/// Little-endian classic TIFF writer state (one image, strips).
+class TiffHeader {
+public:
+    /// Build header + IFD for strips whose byte counts are @p counts (data follows the header).
+    void Build(uint32_t w, uint32_t h, uint16_t spp, uint16_t bps, bool packbits, uint32_t rowsPerStrip,
+        const std::vector<uint32_t>& counts) {
+        const uint32_t strips = static_cast<uint32_t>(counts.size());
+        const uint16_t entries = 12;
+        const uint32_t ifdBytes = 2 + entries * 12 + 4;
+        uint32_t extra = 8 + ifdBytes;             // first byte after the IFD
+        const uint32_t bpsAt = extra;  if (spp > 1) extra += 2 * spp;
+        const uint32_t offAt = extra;  if (strips > 1) extra += 4 * strips;
+        const uint32_t cntAt = extra;  if (strips > 1) extra += 4 * strips;
+        const uint32_t resAt = extra;  extra += 16;
+
+        bytes_.assign(extra, 0);
+        std::memcpy(bytes_.data(), "II*\0", 4);
+        put32_(4, 8);
+        std::size_t at = 8;
+        put16_(at, entries); at += 2;
+        auto entry = [&](uint16_t tag, uint16_t type, uint32_t count, uint32_t value) {
+            put16_(at, tag); put16_(at + 2, type); put32_(at + 4, count);
+            if (type == 3 && count == 1) put16_(at + 8, static_cast<uint16_t>(value));
+            else put32_(at + 8, value);
+            at += 12;
+        };
+        uint32_t dataAt = extra;
+        entry(256, 4, 1, w);
+        entry(257, 4, 1, h);
+        entry(258, 3, spp, spp > 1 ? bpsAt : bps);
+        entry(259, 3, 1, packbits ? 32773u : 1u);
+        entry(262, 3, 1, spp > 1 ? 2u : 1u);
+        entry(273, 4, strips, strips > 1 ? offAt : dataAt);
+        entry(277, 3, 1, spp);
+        entry(278, 4, 1, rowsPerStrip);
+        entry(279, 4, strips, strips > 1 ? cntAt : counts[0]);
+        entry(282, 5, 1, resAt);
+        entry(283, 5, 1, resAt + 8);
+        entry(296, 3, 1, 2u);
+        put32_(at, 0); // no next IFD
+
+        for (uint16_t s = 0; spp > 1 && s < spp; ++s) put16_(bpsAt + 2u * s, bps);
+        for (uint32_t s = 0; strips > 1 && s < strips; ++s) {
+            put32_(offAt + 4u * s, dataAt);
+            put32_(cntAt + 4u * s, counts[s]);
+            dataAt += counts[s];
+        }
+        put32_(resAt, 72); put32_(resAt + 4, 1);
+        put32_(resAt + 8, 72); put32_(resAt + 12, 1);
+    }
+
+    const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+private:
+    void put16_(std::size_t at, uint16_t v) { bytes_[at] = static_cast<uint8_t>(v); bytes_[at + 1] = static_cast<uint8_t>(v >> 8); }
+    void put32_(std::size_t at, uint32_t v) { for (int i = 0; i < 4; ++i) bytes_[at + i] = static_cast<uint8_t>(v >> (8 * i)); }
+
+    std::vector<uint8_t> bytes_;
+};
+
+} // namespace still_detail
+
+/**
+ * @class CStillEncoder
+ * @brief Worker pool that encodes still images to files off the pipeline threads.
+ *
+ * @thread_safety All public methods are thread-safe. Completion callbacks run on a worker thread.
+ */
+class CStillEncoder {
+public:
+    /// Output codec; @ref Codec::Auto picks it from the file extension.
+    enum class Codec { Auto, Tiff, Png, Jpeg, Tlv };
+
+    /// Pool and codec settings.
+    struct Options {
+        uint32_t threads = 0;          ///< Worker threads (0 = hardware_concurrency / 2, at least 1).
+        uint32_t max_pending = 4;      ///< Stills queued or encoding; further requests are rejected.
+        uint32_t strip_rows = 64;      ///< TIFF rows per strip (unit of parallel work).
+        bool     tiff_packbits = false;///< TIFF PackBits compression (lossless).
+        int      jpeg_quality = 95;    ///< JPEG quality 0..100 (OpenCV).
+        int      png_level = 3;        ///< PNG zlib level 0..9 (OpenCV).
+        bool     demosaic = false;     ///< PNG/JPEG: demosaic Bayer frames to colour (OpenCV).
+    };
+
+    /// Completion report.
+    struct Result {
+        std::string path;
+        Codec       codec = Codec::Auto;
+        bool        ok = false;
+        std::size_t bytes = 0;          ///< File size written.
+        uint64_t    sequence = 0;       ///< Frame sequence (pooled frames), else 0.
+        double      queue_ms = 0.0;     ///< Request to start of encoding.
+        double      encode_ms = 0.0;    ///< Conversion + encoding + write.
+    };
+    using Done = std::function<void(const Result&)>;
+
+    /// Counters (snapshot).
+    struct Stats {
+        uint64_t requested = 0;
+        uint64_t completed = 0;        ///< Written successfully.
+        uint64_t failed = 0;           ///< Unsupported format/codec or I/O error.
+        uint64_t rejected = 0;         ///< Queue full or no image data.
+        uint32_t pending = 0;          ///< Queued or encoding now.
+        double   encode_ms_max = 0.0;
+    };
+
+    CStillEncoder() : CStillEncoder(Options{}) {}
+
+    explicit CStillEncoder(const Options& opt) : opt_(opt) {
+        uint32_t n = opt.threads;
+        if (n == 0) n = std::max(1u, std::thread::hardware_concurrency() / 2);
+        opt_.threads = n;
+        opt_.max_pending = std::max(1u, opt.max_pending);
+        opt_.strip_rows = std::max(1u, opt.strip_rows);
+        for (uint32_t i = 0; i < n; ++i) workers_.emplace_back([this] { workerLoop_(); });
+    }
+
+    /// Finishes every queued still, then stops the workers.
+    ~CStillEncoder() {
+        Wait();
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            quit_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    CStillEncoder(const CStillEncoder&) = delete;
+    CStillEncoder& operator=(const CStillEncoder&) = delete;
+
+    /**
+     * @brief Queue @p frame for encoding to @p path (never blocks on encoding or I/O).
+     * @param frame Image to save; pooled frames are retained by reference, others are deep-copied.
+     * @param path  Output file; the extension selects the codec when @p codec is Auto
+     *              (`.tif/.tiff`, `.png`, `.jpg/.jpeg`, `.ish`).
+     * @param done  Optional completion callback (worker thread).
+     * @return false if the queue is full or the frame has no data (counted as rejected).
+     */
+    bool Request(const csh_img::CSH_Image& frame, const std::string& path, Done done = nullptr, Codec codec = Codec::Auto) {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            ++stats_.requested;
+            if (!frame.data() || frame.buffer_size == 0 || pending_ >= opt_.max_pending) {
+                ++stats_.rejected;
+                return false;
+            }
+            ++pending_;
+        }
+        auto job = std::make_shared<Job_>();
+        job->frame = IsPooledFrame(frame) ? frame : DeepCopyFrame(frame);
+        job->path = path;
+        job->codec = codec == Codec::Auto ? codecFor(path) : codec;
+        job->done = std::move(done);
+        job->queuedNs = GrabberNowNs();
+        post_([this, job] { run_(*job); }, false);
+        return true;
+    }
+
+    /// @brief Block until every queued still has been written (callbacks included).
+    void Wait() {
+        std::unique_lock<std::mutex> lk(mtx_);
+        idleCv_.wait(lk, [&] { return pending_ == 0; });
+    }
+
+    /// @return Codec chosen for @p path by @ref Codec::Auto (Tiff when the extension is unknown).
+    static Codec codecFor(const std::string& path) {
+        const std::string e = still_detail::lowerExt(path);
+        if (e == "png") return Codec::Png;
+        if (e == "jpg" || e == "jpeg") return Codec::Jpeg;
+        if (e == "ish") return Codec::Tlv;
+        return Codec::Tiff;
+    }
+
+    /// @return Counter snapshot.
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        Stats s = stats_;
+        s.pending = pending_;
+        return s;
+    }
+
+private:
+    struct Job_ {
+        csh_img::CSH_Image frame;
+        std::string path;
+        Codec codec = Codec::Tiff;
+        Done done;
+        int64_t queuedNs = 0;
+    };
+
+    /// Shared state of one @ref parallelFor_ call (outlives the caller for late helpers).
+    struct ForCtl_ {
+        std::atomic<uint32_t> next{ 0 };
+        uint32_t n = 0;
+        const std::function<void(uint32_t)>* fn = nullptr;
+        std::mutex m;
+        std::condition_variable cv;
+        uint32_t done = 0;
+    };
+
+    void post_(std::function<void()> task, bool urgent) {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (urgent) tasks_.push_front(std::move(task));
+            else tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    void workerLoop_() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                cv_.wait(lk, [&] { return quit_ || !tasks_.empty(); });
+                if (tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    /**
+     * @brief Run fn(0..n-1) on the calling worker plus idle workers.
+     *
+     * Helpers are queued ahead of other stills; the caller claims indices itself, so it never
+     * waits on work nobody has picked up.
+     */
+    void parallelFor_(uint32_t n, const std::function<void(uint32_t)>& fn) {
+        auto c = std::make_shared<ForCtl_>();
+        c->n = n;
+        c->fn = &fn;
+        auto run = [c] {
+            for (;;) {
+                const uint32_t i = c->next.fetch_add(1);
+                if (i >= c->n) return;
+                (*c->fn)(i);
+                {
+                    std::lock_guard<std::mutex> lk(c->m);
+                    ++c->done;
+                }
+                c->cv.notify_all();
+            }
+        };
+        const uint32_t helpers = std::min(opt_.threads - 1, n > 0 ? n - 1 : 0u);
+        for (uint32_t h = 0; h < helpers; ++h) post_(run, true);
+        run();
+        std::unique_lock<std::mutex> lk(c->m);
+        c->cv.wait(lk, [&] { return c->done == c->n; });
+    }
+
+    void run_(Job_& job) {
+        const int64_t t0 = GrabberNowNs();
+        Result r;
+        r.path = job.path;
+        r.codec = job.codec;
+        const CFrameMeta* meta = GetFrameMeta(job.frame);
+        r.sequence = meta ? meta->sequence : 0;
+        r.queue_ms = (t0 - job.queuedNs) * 1e-6;
+
+        switch (job.codec) {
+        case Codec::Png:
+        case Codec::Jpeg: r.ok = writeCv_(job.frame, job.path, job.codec == Codec::Jpeg, r.bytes); break;
+        case Codec::Tlv:  r.ok = writeTlv_(job.frame, job.path, r.bytes); break;
+        default:          r.ok = writeTiff_(job.frame, job.path, r.bytes); break;
+        }
+        r.encode_ms = (GrabberNowNs() - t0) * 1e-6;
+        job.frame = csh_img::CSH_Image(); // release the (driver) buffer before the callback
+        if (!r.ok) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"still: failed to write %ls", still_detail::wstr(job.path).c_str());
+        }
+        if (job.done) job.done(r);
+
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (r.ok) ++stats_.completed;
+            else ++stats_.failed;
+            stats_.encode_ms_max = std::max(stats_.encode_ms_max, r.encode_ms);
+            --pending_;
+        }
+        idleCv_.notify_all();
+    }
+
+    /// Native TIFF: strips converted (and PackBits-compressed) in parallel, then written in order.
+    bool writeTiff_(const csh_img::CSH_Image& f, const std::string& path, std::size_t& written) {
+        using csh_img::En_ImageFormat;
+        const uint32_t w = f.width, h = f.height;
+        const auto* src = f.data();
+        if (!src || w == 0 || h == 0 || f.memory_align != csh_img::En_ImageMemoryAlign::Packed) return false;
+
+        const uint32_t fmt = static_cast<uint32_t>(f.format);
+        uint16_t spp = 1, bps = 8;
+        if (fmt >= 200 && fmt < 300 && f.format != En_ImageFormat::YUV422 && f.format != En_ImageFormat::RGB565) bps = 16;
+        if (f.format == En_ImageFormat::RGB888 || f.format == En_ImageFormat::BGR888 ||
+            f.format == En_ImageFormat::YUV422 || f.format == En_ImageFormat::RGB565) spp = 3;
+        else if (fmt >= 300) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"still: format %u not supported by the TIFF writer", fmt);
+            return false;
+        }
+        const std::size_t srcRow = f.format == En_ImageFormat::RGB888 || f.format == En_ImageFormat::BGR888 ? 3u * w
+            : (bps == 16 || f.format == En_ImageFormat::YUV422 || f.format == En_ImageFormat::RGB565 ? 2u * w : w);
+        const std::size_t dstRow = static_cast<std::size_t>(w) * spp * (bps / 8);
+        if (srcRow * h > f.buffer_size) return false;
+        if (dstRow * h > 0xF0000000u) return false; // classic TIFF offsets are 32-bit
+
+        const bool convert = f.format == En_ImageFormat::BGR888 || f.format == En_ImageFormat::YUV422 ||
+            f.format == En_ImageFormat::RGB565;
+        const uint32_t rps = std::min(opt_.strip_rows, h);
+        const uint32_t strips = (h + rps - 1) / rps;
+        const bool pack = opt_.tiff_packbits;
+
+        // Strip output: none when the frame is written as is, else converted and/or packed bytes.
+        std::vector<std::vector<uint8_t>> out(strips);
+        std::vector<uint32_t> counts(strips);
+        const std::function<void(uint32_t)> strip = [&](uint32_t s) {
+            const uint32_t y0 = s * rps, y1 = std::min(h, y0 + rps);
+            counts[s] = static_cast<uint32_t>(dstRow * (y1 - y0));
+            if (!convert && !pack) return;
+            std::vector<uint8_t> rowBuf(convert ? dstRow : 0);
+            if (pack) out[s].reserve(dstRow * (y1 - y0) / 2 + 64);
+            else out[s].resize(dstRow * (y1 - y0));
+            for (uint32_t y = y0; y < y1; ++y) {
+                const uint8_t* in = src + srcRow * y;
+                uint8_t* row = convert ? (pack ? rowBuf.data() : out[s].data() + dstRow * (y - y0)) : nullptr;
+                if (convert) convertRow_(f, in, row, w);
+                if (pack) still_detail::packBits(convert ? row : in, dstRow, out[s]);
+            }
+            if (pack) counts[s] = static_cast<uint32_t>(out[s].size());
+        };
+        parallelFor_(strips, strip);
+
+        still_detail::TiffHeader hdr;
+        hdr.Build(w, h, spp, bps, pack, rps, counts);
+
+        std::FILE* fp = std::fopen(path.c_str(), "wb");
+        if (!fp) return false;
+        bool ok = std::fwrite(hdr.bytes().data(), 1, hdr.bytes().size(), fp) == hdr.bytes().size();
+        written = hdr.bytes().size();
+        if (!convert && !pack) {
+            ok = ok && std::fwrite(src, 1, dstRow * h, fp) == dstRow * h;
+            written += dstRow * h;
+        }
+        else {
+            for (uint32_t s = 0; ok && s < strips; ++s) {
+                ok = std::fwrite(out[s].data(), 1, out[s].size(), fp) == out[s].size();
+                written += out[s].size();
+            }
+        }
+        if (std::fclose(fp) != 0) ok = false;
+        return ok;
+    }
+
+    /// One row of a colour format to RGB888.
+    static void convertRow_(const csh_img::CSH_Image& f, const uint8_t* in, uint8_t* out, uint32_t w) {
+        using csh_img::En_ImageFormat;
+        using csh_img::En_ImagePattern;
+        if (f.format == En_ImageFormat::BGR888) {
+            for (uint32_t x = 0; x < w; ++x, in += 3, out += 3) {
+                out[0] = in[2]; out[1] = in[1]; out[2] = in[0];
+            }
+        }
+        else if (f.format == En_ImageFormat::RGB565) {
+            for (uint32_t x = 0; x < w; ++x, in += 2, out += 3) {
+                const uint16_t v = static_cast<uint16_t>(in[0] | (in[1] << 8));
+                out[0] = static_cast<uint8_t>(((v >> 11) & 0x1F) * 255 / 31);
+                out[1] = static_cast<uint8_t>(((v >> 5) & 0x3F) * 255 / 63);
+                out[2] = static_cast<uint8_t>((v & 0x1F) * 255 / 31);
+            }
+        }
+        else { // YUV422: byte positions of Y0, U, Y1, V in each 4-byte pair
+            int y0 = 0, u = 1, y1 = 2, v = 3; // YUYV
+            if (f.pattern == En_ImagePattern::UYVY) { u = 0; y0 = 1; v = 2; y1 = 3; }
+            else if (f.pattern == En_ImagePattern::YVYU) { y0 = 0; v = 1; y1 = 2; u = 3; }
+            else if (f.pattern == En_ImagePattern::VYUY) { v = 0; y0 = 1; u = 2; y1 = 3; }
+            for (uint32_t x = 0; x + 1 < w; x += 2, in += 4, out += 6) {
+                still_detail::yuvToRgb(in[y0], in[u], in[v], out);
+                still_detail::yuvToRgb(in[y1], in[u], in[v], out + 3);
+            }
+            if (w & 1) still_detail::yuvToRgb(in[y0], in[u], in[v], out);
+        }
+    }
+
+    static bool writeTlv_(const csh_img::CSH_Image& f, const std::string& path, std::size_t& written) {
+        try {
+            f.saveImage(path);
+        }
+        catch (const std::exception& e) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"still: saveImage: %ls", still_detail::wstr(e.what()).c_str());
+            return false;
+        }
+        std::error_code ec;
+        written = static_cast<std::size_t>(std::filesystem::file_size(path, ec));
+        return !ec;
+    }
+
+#ifdef CSH_IMAGE_WITH_OPENCV
+    bool writeCv_(const csh_img::CSH_Image& f, const std::string& path, bool jpeg, std::size_t& written) const {
+        using csh_img::En_ImageFormat;
+        using csh_img::En_ImagePattern;
+        const uint32_t fmt = static_cast<uint32_t>(f.format);
+        const bool wide = fmt >= 200 && fmt < 300 && f.format != En_ImageFormat::YUV422 && f.format != En_ImageFormat::RGB565;
+        const bool bayer = f.format == En_ImageFormat::Bayer8 || (fmt >= 200 && fmt <= 203);
+        auto* p = const_cast<uint8_t*>(f.data());
+        const int w = static_cast<int>(f.width), h = static_cast<int>(f.height);
+
+        cv::Mat img;
+        try {
+            if (f.format == En_ImageFormat::RGB888) cv::cvtColor(cv::Mat(h, w, CV_8UC3, p), img, cv::COLOR_RGB2BGR);
+            else if (f.format == En_ImageFormat::BGR888) img = cv::Mat(h, w, CV_8UC3, p);
+            else if (f.format == En_ImageFormat::RGB565) cv::cvtColor(cv::Mat(h, w, CV_8UC2, p), img, cv::COLOR_BGR5652BGR);
+            else if (f.format == En_ImageFormat::YUV422) {
+                int code = cv::COLOR_YUV2BGR_YUYV;
+                if (f.pattern == En_ImagePattern::UYVY) code = cv::COLOR_YUV2BGR_UYVY;
+                else if (f.pattern == En_ImagePattern::YVYU) code = cv::COLOR_YUV2BGR_YVYU;
+                cv::cvtColor(cv::Mat(h, w, CV_8UC2, p), img, code);
+            }
+            else if (fmt < 300) {
+                img = cv::Mat(h, w, wide ? CV_16UC1 : CV_8UC1, p);
+                if (wide && f.original_bit > 0 && f.original_bit < 16) {
+                    cv::Mat scaled; // use the full 16-bit range (or 8-bit for JPEG below)
+                    img.convertTo(scaled, CV_16UC1, static_cast<double>(1 << (16 - f.original_bit)));
+                    img = scaled;
+                }
+                if (bayer && opt_.demosaic) {
+                    // OpenCV names Bayer codes after the second row's first two pixels.
+                    int code = cv::COLOR_BayerBG2BGR;                              // RGGB
+                    if (f.pattern == En_ImagePattern::GRBG) code = cv::COLOR_BayerGB2BGR;
+                    else if (f.pattern == En_ImagePattern::BGGR) code = cv::COLOR_BayerRG2BGR;
+                    else if (f.pattern == En_ImagePattern::GBRG) code = cv::COLOR_BayerGR2BGR;
+                    cv::Mat bgr;
+                    cv::cvtColor(img, bgr, code);
+                    img = bgr;
+                }
+            }
+            else {
+                LOG_WRITE(cshlog::LogLevel::Warn, L"still: format %u not supported for PNG/JPEG", fmt);
+                return false;
+            }
+            if (jpeg && img.depth() == CV_16U) {
+                cv::Mat m8;
+                img.convertTo(m8, CV_8U, 1.0 / 256.0);
+                img = m8;
+            }
+            std::vector<int> params = jpeg ? std::vector<int>{ cv::IMWRITE_JPEG_QUALITY, opt_.jpeg_quality }
+                                           : std::vector<int>{ cv::IMWRITE_PNG_COMPRESSION, opt_.png_level };
+            std::vector<uchar> enc;
+            if (!cv::imencode(jpeg ? ".jpg" : ".png", img, enc, params)) return false;
+            std::FILE* fp = std::fopen(path.c_str(), "wb");
+            if (!fp) return false;
+            bool ok = std::fwrite(enc.data(), 1, enc.size(), fp) == enc.size();
+            if (std::fclose(fp) != 0) ok = false;
+            written = enc.size();
+            return ok;
+        }
+        catch (const cv::Exception& e) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"still: OpenCV: %ls", still_detail::wstr(e.what()).c_str());
+            return false;
+        }
+    }
+#else
+    bool writeCv_(const csh_img::CSH_Image&, const std::string& path, bool, std::size_t&) const {
+        LOG_WRITE(cshlog::LogLevel::Warn, L"still: PNG/JPEG need CSH_IMAGE_WITH_OPENCV (%ls); use .tif", still_detail::wstr(path).c_str());
+        return false;
+    }
+#endif
+
+    Options opt_;
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;      ///< Workers: task queued or quit.
+    std::condition_variable idleCv_;  ///< Wait: a still finished.
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> workers_;
+    uint32_t pending_ = 0;
+    bool quit_ = false;
+    Stats stats_;
+};
@@ -0,0 +1,691 @@
+#pragma once
+/**
+ * @file CStreamExporter.h
+ * @brief Stream pipeline frames as YUV4MPEG2 (Y4M) or raw planar video to a file, pipe or FIFO.
+ *
+ * External encoders and analysis tools (ffmpeg, x264, VapourSynth, ...) read Y4M or raw planar
+ * YUV. @ref CStreamExporter converts each frame into planar layout in one fused pass
+ * (SSE2 on x86-64, NEON on AArch64, scalar elsewhere) and hands it to a writer thread through
+ * a small ring of output buffers (double-buffered by default), so conversion of frame N+1
+ * overlaps the pipe write of frame N.
+ *
+ * | Input                         | Native output         | `Chroma::C420` output                  |
+ * |-------------------------------|-----------------------|----------------------------------------|
+ * | YUV422 (YUYV/UYVY/YVYU/VYUY)  | 4:2:2 planar (`C422`) | `C420mpeg2` (rows averaged, cosited)   |
+ * | Gray8 / Bayer8                | `Cmono`               | `C420jpeg`, neutral chroma             |
+ * | Gray10..16 / Bayer10..16      | `Cmono16` (raw values)| `C420jpeg`, top 8 bits                 |
+ * | RGB888 / BGR888               | 4:4:4 (BT.601)        | `C420jpeg` (2x2 averaged, centered)    |
+ *
+ * @code
+ * // mkfifo /tmp/cam.y4m; ffmpeg -i /tmp/cam.y4m -c:v libx264 out.mp4
+ * CStreamExporter out;
+ * CStreamExporter::Options o;
+ * o.chroma = CStreamExporter::Chroma::C420;  // what most encoders want
+ * o.fps_num = 30;
+ * o.block = true;                            // lossless: wait for the reader
+ * out.Start("/tmp/cam.y4m", o);              // returns at once; the FIFO opens when a reader appears
+ * fanout.Subscribe("y4m", out.Input(), { 4, CFrameFanout::DropPolicy::DropOldest });
+ * @endcode
+ *
+ * The stream geometry and layout are fixed by the first frame; later frames that differ are
+ * rejected and counted. Raw output has no header or frame markers (`ffmpeg -f rawvideo
+ * -pix_fmt yuv422p -s WxH -i ...`).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <csignal>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if !defined(CSH_EXPORT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define CSH_EXPORT_SSE2 1
+#elif !defined(CSH_EXPORT_NO_SIMD) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CSH_EXPORT_NEON 1
+#endif
+
+#include "CFrameGrabber.h"
+#include "CGrabberFrame.h"
+#include "CSH_Log.h"
+
+namespace export_detail {
+
+inline std::wstring wstr(const std::string& s) { return std::wstring(s.begin(), s.end()); }
+
+/**
+ * @brief Split packed 4:2:2 rows into planes in one pass.
+ *
+ * With @p r1 set, two rows are read: both luma rows are written and their chroma is averaged
+ * (4:2:0); otherwise one row keeps its own chroma (4:2:2).
+ * @param r0,r1  Source rows (@p r1 may be nullptr).
+ * @param pairs  Pixel pairs per row.
+ * @param yOdd   Luma at bytes 1 and 3 of each pair (UYVY/VYUY), else at 0 and 2.
+ * @param y0,y1  Luma outputs for @p r0 / @p r1 (@p y1 may be nullptr to skip it).
+ * @param c0,c1  First / second chroma byte of each pair (the caller maps them to U/V).
+ */
+inline void splitYuv422Rows(const uint8_t* r0, const uint8_t* r1, uint32_t pairs, bool yOdd,
+    uint8_t* y0, uint8_t* y1, uint8_t* c0, uint8_t* c1) {
+    uint32_t i = 0;
+#if defined(CSH_EXPORT_SSE2)
+    const __m128i m = _mm_set1_epi16(0x00FF);
+    auto lo = [&](__m128i v) { return _mm_and_si128(v, m); };
+    auto hi = [&](__m128i v) { return _mm_srli_epi16(v, 8); };
+    // 32 pixels: luma stored, interleaved chroma (c0 c1 c0 c1 ...) returned in a, b.
+    auto row = [&](const uint8_t* p, uint8_t* y, __m128i& a, __m128i& b) {
+        const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+        const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+        const __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48));
+        if (y) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y),
+                yOdd ? _mm_packus_epi16(hi(v0), hi(v1)) : _mm_packus_epi16(lo(v0), lo(v1)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y + 16),
+                yOdd ? _mm_packus_epi16(hi(v2), hi(v3)) : _mm_packus_epi16(lo(v2), lo(v3)));
+        }
+        a = yOdd ? _mm_packus_epi16(lo(v0), lo(v1)) : _mm_packus_epi16(hi(v0), hi(v1));
+        b = yOdd ? _mm_packus_epi16(lo(v2), lo(v3)) : _mm_packus_epi16(hi(v2), hi(v3));
+    };
+    for (; i + 16 <= pairs; i += 16) {
+        __m128i a, b;
+        row(r0 + 4 * i, y0 + 2 * i, a, b);
+        if (r1) {
+            __m128i a1, b1;
+            row(r1 + 4 * i, y1 ? y1 + 2 * i : nullptr, a1, b1);
+            a = _mm_avg_epu8(a, a1);
+            b = _mm_avg_epu8(b, b1);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(c0 + i), _mm_packus_epi16(lo(a), lo(b)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(c1 + i), _mm_packus_epi16(hi(a), hi(b)));
+    }
+#elif defined(CSH_EXPORT_NEON)
+    for (; i + 16 <= pairs; i += 16) {
+        const uint8x16x4_t v = vld4q_u8(r0 + 4 * i);
+        uint8x16_t a = yOdd ? v.val[0] : v.val[1];
+        uint8x16_t b = yOdd ? v.val[2] : v.val[3];
+        uint8x16x2_t l;
+        l.val[0] = yOdd ? v.val[1] : v.val[0];
+        l.val[1] = yOdd ? v.val[3] : v.val[2];
+        vst2q_u8(y0 + 2 * i, l);
+        if (r1) {
+            const uint8x16x4_t w = vld4q_u8(r1 + 4 * i);
+            a = vrhaddq_u8(a, yOdd ? w.val[0] : w.val[1]);
+            b = vrhaddq_u8(b, yOdd ? w.val[2] : w.val[3]);
+            if (y1) {
+                l.val[0] = yOdd ? w.val[1] : w.val[0];
+                l.val[1] = yOdd ? w.val[3] : w.val[2];
+                vst2q_u8(y1 + 2 * i, l);
+            }
+        }
+        vst1q_u8(c0 + i, a);
+        vst1q_u8(c1 + i, b);
+    }
+#endif
+    const int yo = yOdd ? 1 : 0, co = yOdd ? 0 : 1;
+    for (; i < pairs; ++i) {
+        const uint8_t* p = r0 + 4 * i;
+        y0[2 * i] = p[yo];
+        y0[2 * i + 1] = p[yo + 2];
+        if (r1) {
+            const uint8_t* q = r1 + 4 * i;
+            if (y1) {
+                y1[2 * i] = q[yo];
+                y1[2 * i + 1] = q[yo + 2];
+            }
+            c0[i] = static_cast<uint8_t>((p[co] + q[co] + 1) >> 1);
+            c1[i] = static_cast<uint8_t>((p[co + 2] + q[co + 2] + 1) >> 1);
+        }
+        else {
+            c0[i] = p[co];
+            c1[i] = p[co + 2];
+        }
+    }
+}
+
+inline uint8_t clamp8(int v) { return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v)); }
+
+/// BT.601 limited-range RGB -> YUV.
+inline void rgbToYuv(int r, int g, int b, int& y, int& u, int& v) {
+    y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+    u = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+    v = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+} // namespace export_detail
+
+/**
+ * @class CStreamExporter
+ * @brief Converts frames to planar YUV and streams them to a file, pipe or FIFO on a writer thread.
+ *
+ * @thread_safety @ref Push is meant for one producer thread (frames are written in push order).
+ * @ref Start, @ref Stop, @ref GetStats and @ref Attach / @ref Detach are thread-safe.
+ */
+class CStreamExporter {
+public:
+    /// Stream container.
+    enum class Container : uint32_t {
+        Y4m = 0,   ///< YUV4MPEG2: text header, "FRAME" marker per frame.
+        Raw        ///< Planes only.
+    };
+
+    /// Output chroma layout.
+    enum class Chroma : uint32_t {
+        Native = 0, ///< Keep the input sampling (4:2:2, mono, mono16 or 4:4:4).
+        C420        ///< Always 8-bit 4:2:0 (the common encoder input).
+    };
+
+    /// Export options (fixed for one stream).
+    struct Options {
+        Container container = Container::Y4m;
+        Chroma    chroma = Chroma::Native;
+        uint32_t  fps_num = 30;       ///< Y4M frame rate numerator.
+        uint32_t  fps_den = 1;        ///< Y4M frame rate denominator.
+        uint32_t  buffers = 2;        ///< Converted frames that may wait for the writer (minimum 2).
+        bool      block = false;      ///< @ref Push waits for a free buffer instead of dropping.
+        bool      make_fifo = false;  ///< Create @p path as a named pipe if it does not exist (Linux).
+    };
+
+    /// Counters (snapshot).
+    struct Stats {
+        uint64_t pushed = 0;          ///< Frames offered while running.
+        uint64_t written = 0;         ///< Frames written to the output.
+        uint64_t dropped = 0;         ///< No free buffer (block = false), or the output failed.
+        uint64_t rejected = 0;        ///< Unsupported format or geometry different from the first frame.
+        uint64_t bytes_written = 0;
+        double   convert_ms_max = 0.0;
+        bool     connected = false;   ///< Output opened (a FIFO reader is attached).
+        bool     failed = false;      ///< A write failed (e.g., the reader closed the pipe).
+    };
+
+    CStreamExporter() = default;
+    ~CStreamExporter() {
+        Stop(); // first: wakes a Push blocked on a full queue (block = true, no reader)
+        Detach();
+    }
+
+    CStreamExporter(const CStreamExporter&) = delete;
+    CStreamExporter& operator=(const CStreamExporter&) = delete;
+
+    /**
+     * @brief Start the writer thread for @p path ("-" = standard output).
+     * @note Returns without waiting for the output: a FIFO is opened by the writer once a reader
+     *       attaches. Frames pushed before that wait in the buffers (and then drop or block).
+     * @return false if already running or the FIFO cannot be created.
+     */
+    bool Start(const std::string& path, const Options& opt) {
+        std::lock_guard<std::mutex> ctl(ctlMtx_);
+        if (writer_.joinable()) return false;
+        opt_ = opt;
+        opt_.buffers = std::max<uint32_t>(2, opt.buffers);
+        if (opt_.fps_num == 0 || opt_.fps_den == 0) { opt_.fps_num = 30; opt_.fps_den = 1; }
+        path_ = path;
+#if defined(__linux__)
+        if (opt_.make_fifo && path != "-" && ::mkfifo(path.c_str(), 0666) != 0 && errno != EEXIST) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"exporter: mkfifo %ls failed (errno=%d)", export_detail::wstr(path).c_str(), errno);
+            return false;
+        }
+#endif
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            bufs_.assign(opt_.buffers, std::vector<uint8_t>());
+            free_.clear();
+            for (uint32_t i = opt_.buffers; i-- > 0;) free_.push_back(i);
+            ready_.clear();
+            layout_ = Layout_();
+            stats_ = Stats();
+            stopping_ = false;
+        }
+        running_.store(true, std::memory_order_release);
+        writer_ = std::thread([this] { writerLoop_(); });
+        return true;
+    }
+
+    /**
+     * @brief Stop accepting frames, write the frames already converted and close the output.
+     * @note A FIFO without a reader is abandoned (its buffered frames are dropped).
+     */
+    void Stop() {
+        std::lock_guard<std::mutex> ctl(ctlMtx_);
+        if (!writer_.joinable()) return;
+        running_.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        freeCv_.notify_all();
+        writer_.join();
+    }
+
+    /// @return true between @ref Start and @ref Stop.
+    bool isRunning() const { return running_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Register as @p grab's processor callback.
+     * @note The displayer callback of @p grab is left untouched.
+     */
+    void Attach(CFrameGrabber& grab) {
+        Detach();
+        grab.RegisterCallbackProcessor(gate_.Wrap(Input()));
+        std::lock_guard<std::mutex> lk(mtx_);
+        grab_ = &grab;
+    }
+
+    /**
+     * @brief Clear the processor callback of the attached grabber (no-op if not attached).
+     * @note Returns only after a push already running on the grab thread has finished, so the
+     *       exporter may be destroyed while the grabber keeps running. With `block` set, a push
+     *       waiting for a buffer holds Detach until the writer frees one or @ref Stop is called.
+     */
+    void Detach() {
+        CFrameGrabber* g = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            std::swap(g, grab_);
+        }
+        if (g) g->RegisterCallbackProcessor(nullptr);
+        gate_.Close(); // backends call a copy of the callback outside their lock
+    }
+
+    /// @return Callback that feeds this exporter; register it with any frame source.
+    FrameGrabCallbackProc Input() {
+        return [this](const csh_img::CSH_Image& f) { Push(f); };
+    }
+
+    /**
+     * @brief Convert @p frame into a free output buffer and queue it for the writer.
+     * @note Runs the conversion on the calling thread; subscribe through @ref CFrameFanout to
+     *       keep it off the capture thread. Waits for a buffer only when `block` is set.
+     */
+    void Push(const csh_img::CSH_Image& frame) {
+        if (!running_.load(std::memory_order_acquire)) return;
+        const uint8_t* src = frame.data();
+        if (!src) return;
+
+        uint32_t idx = 0;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            ++stats_.pushed;
+            if (!layout_.valid && !planFor_(frame, layout_)) {
+                ++stats_.rejected;
+                return;
+            }
+            if (!layout_.matches(frame)) {
+                ++stats_.rejected;
+                return;
+            }
+            if (opt_.block) freeCv_.wait(lk, [&] { return !free_.empty() || stopping_ || stats_.failed; });
+            if (free_.empty() || stopping_ || stats_.failed) {
+                ++stats_.dropped;
+                return;
+            }
+            idx = free_.back();
+            free_.pop_back();
+        }
+
+        const int64_t t0 = GrabberNowNs();
+        std::vector<uint8_t>& out = bufs_[idx];
+        out.resize(layout_.frameBytes);
+        convert_(frame, out.data());
+        const double ms = (GrabberNowNs() - t0) * 1e-6;
+
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stats_.convert_ms_max = std::max(stats_.convert_ms_max, ms);
+            ready_.push_back(idx);
+        }
+        cv_.notify_one();
+    }
+
+    /// @return Counter snapshot.
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return stats_;
+    }
+
+private:
+    /// Output layout derived from the first frame.
+    struct Layout_ {
+        bool valid = false;
+        csh_img::En_ImageFormat format = csh_img::En_ImageFormat::Gray8;
+        csh_img::En_ImagePattern pattern = csh_img::En_ImagePattern::RGGB;
+        uint32_t width = 0, height = 0;
+        std::size_t srcRow = 0;       ///< Input bytes per row.
+        uint32_t cw = 0, ch = 0;      ///< Chroma plane size (0 = mono).
+        uint32_t bpc = 1;             ///< Bytes per output sample.
+        std::size_t frameBytes = 0;
+        const char* tag = "mono";     ///< Y4M colourspace tag.
+
+        bool matches(const csh_img::CSH_Image& f) const {
+            return f.format == format && f.pattern == pattern && f.width == width && f.height == height &&
+                f.buffer_size >= srcRow * height;
+        }
+    };
+
+    /// Caller holds mtx_.
+    bool planFor_(const csh_img::CSH_Image& f, Layout_& l) const {
+        using csh_img::En_ImageFormat;
+        const uint32_t fmt = static_cast<uint32_t>(f.format);
+        const bool c420 = opt_.chroma == Chroma::C420;
+        l.format = f.format;
+        l.pattern = f.pattern;
+        l.width = f.width;
+        l.height = f.height;
+        if (f.width == 0 || f.height == 0 || f.memory_align != csh_img::En_ImageMemoryAlign::Packed) return false;
+
+        if (f.format == En_ImageFormat::YUV422) {
+            if (f.width & 1) {
+                LOG_WRITE(cshlog::LogLevel::Warn, L"exporter: YUV422 needs an even width (%u)", f.width);
+                return false;
+            }
+            l.srcRow = 2u * f.width;
+            l.cw = f.width / 2;
+            l.ch = c420 ? (f.height + 1) / 2 : f.height;
+            l.tag = c420 ? "420mpeg2" : "422"; // rows averaged, horizontally cosited samples kept
+        }
+        else if (f.format == En_ImageFormat::RGB888 || f.format == En_ImageFormat::BGR888) {
+            l.srcRow = 3u * f.width;
+            l.cw = c420 ? (f.width + 1) / 2 : f.width;
+            l.ch = c420 ? (f.height + 1) / 2 : f.height;
+            l.tag = c420 ? "420jpeg" : "444";
+        }
+        else if (fmt < 200 || (fmt < 300 && f.format != En_ImageFormat::RGB565)) { // gray / Bayer
+            const bool wide = fmt >= 200;
+            l.srcRow = (wide ? 2u : 1u) * f.width;
+            l.bpc = wide && !c420 ? 2u : 1u;
+            l.cw = c420 ? (f.width + 1) / 2 : 0;
+            l.ch = c420 ? (f.height + 1) / 2 : 0;
+            l.tag = c420 ? "420jpeg" : (wide ? "mono16" : "mono");
+        }
+        else {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"exporter: format %u is not supported", fmt);
+            return false;
+        }
+        l.frameBytes = (static_cast<std::size_t>(f.width) * f.height + 2ull * l.cw * l.ch) * l.bpc;
+        l.valid = true;
+        return true;
+    }
+
+    /// Fused conversion of one frame into Y, U, V planes (producer thread).
+    void convert_(const csh_img::CSH_Image& f, uint8_t* out) const {
+        using csh_img::En_ImageFormat;
+        using csh_img::En_ImagePattern;
+        const Layout_& l = layout_;
+        const uint32_t w = l.width, h = l.height;
+        const uint8_t* src = f.data();
+        uint8_t* Y = out;
+        uint8_t* U = out + static_cast<std::size_t>(w) * h * l.bpc;
+        uint8_t* V = U + static_cast<std::size_t>(l.cw) * l.ch;
+
+        if (l.format == En_ImageFormat::YUV422) {
+            const bool yOdd = l.pattern == En_ImagePattern::UYVY || l.pattern == En_ImagePattern::VYUY;
+            const bool vFirst = l.pattern == En_ImagePattern::YVYU || l.pattern == En_ImagePattern::VYUY;
+            uint8_t* c0 = vFirst ? V : U;
+            uint8_t* c1 = vFirst ? U : V;
+            if (opt_.chroma != Chroma::C420) {
+                for (uint32_t y = 0; y < h; ++y) {
+                    export_detail::splitYuv422Rows(src + l.srcRow * y, nullptr, l.cw, yOdd,
+                        Y + std::size_t(w) * y, nullptr, c0 + std::size_t(l.cw) * y, c1 + std::size_t(l.cw) * y);
+                }
+            }
+            else {
+                for (uint32_t cy = 0; cy < l.ch; ++cy) {
+                    const uint32_t y0 = 2 * cy, y1 = std::min(y0 + 1, h - 1);
+                    export_detail::splitYuv422Rows(src + l.srcRow * y0, src + l.srcRow * y1, l.cw, yOdd,
+                        Y + std::size_t(w) * y0, y1 != y0 ? Y + std::size_t(w) * y1 : nullptr,
+                        c0 + std::size_t(l.cw) * cy, c1 + std::size_t(l.cw) * cy);
+                }
+            }
+        }
+        else if (l.format == En_ImageFormat::RGB888 || l.format == En_ImageFormat::BGR888) {
+            const int ri = l.format == En_ImageFormat::RGB888 ? 0 : 2, bi = 2 - ri;
+            const bool sub = opt_.chroma == Chroma::C420;
+            std::vector<uint16_t> accU(sub ? l.cw : 0), accV(sub ? l.cw : 0);
+            std::vector<uint8_t> cnt(sub ? l.cw : 0);
+            for (uint32_t y = 0; y < h; ++y) {
+                const uint8_t* p = src + l.srcRow * y;
+                uint8_t* yr = Y + std::size_t(w) * y;
+                for (uint32_t x = 0; x < w; ++x, p += 3) {
+                    int yy, uu, vv;
+                    export_detail::rgbToYuv(p[ri], p[1], p[bi], yy, uu, vv);
+                    yr[x] = export_detail::clamp8(yy);
+                    if (!sub) {
+                        U[std::size_t(w) * y + x] = export_detail::clamp8(uu);
+                        V[std::size_t(w) * y + x] = export_detail::clamp8(vv);
+                    }
+                    else {
+                        accU[x / 2] = static_cast<uint16_t>(accU[x / 2] + export_detail::clamp8(uu));
+                        accV[x / 2] = static_cast<uint16_t>(accV[x / 2] + export_detail::clamp8(vv));
+                        ++cnt[x / 2];
+                    }
+                }
+                if (sub && ((y & 1) || y + 1 == h)) {
+                    const std::size_t row = std::size_t(l.cw) * (y / 2);
+                    for (uint32_t cx = 0; cx < l.cw; ++cx) {
+                        U[row + cx] = static_cast<uint8_t>((accU[cx] + cnt[cx] / 2) / cnt[cx]);
+                        V[row + cx] = static_cast<uint8_t>((accV[cx] + cnt[cx] / 2) / cnt[cx]);
+                    }
+                    std::fill(accU.begin(), accU.end(), 0);
+                    std::fill(accV.begin(), accV.end(), 0);
+                    std::fill(cnt.begin(), cnt.end(), 0);
+                }
+            }
+        }
+        else if (l.srcRow == w) { // 8-bit gray / Bayer
+            std::memcpy(Y, src, std::size_t(w) * h);
+        }
+        else if (l.bpc == 2) {    // 16-bit container, raw values
+            std::memcpy(Y, src, std::size_t(w) * h * 2);
+        }
+        else {                    // 16-bit container to 8 bits
+            const uint32_t bits = f.original_bit >= 8 && f.original_bit <= 16 ? f.original_bit : 16;
+            const int shift = static_cast<int>(bits) - 8;
+            for (std::size_t i = 0, n = std::size_t(w) * h; i < n; ++i) {
+                uint16_t v;
+                std::memcpy(&v, src + 2 * i, 2);
+                Y[i] = static_cast<uint8_t>(std::min<uint32_t>(255u, v >> shift));
+            }
+        }
+        if (l.cw && l.format != En_ImageFormat::YUV422 && l.format != En_ImageFormat::RGB888 &&
+            l.format != En_ImageFormat::BGR888) {
+            std::memset(U, 128, 2 * std::size_t(l.cw) * l.ch); // neutral chroma for gray input
+        }
+    }
+
+    void writerLoop_() {
+#if defined(__linux__)
+        // A reader closing the pipe must fail the write (EPIPE), not kill the process.
+        sigset_t pipeSet;
+        sigemptyset(&pipeSet);
+        sigaddset(&pipeSet, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipeSet, nullptr);
+#endif
+        bool headerDone = opt_.container != Container::Y4m;
+        bool opened = open_();
+        for (;;) {
+            uint32_t idx = 0;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                if (!opened) {
+                    // FIFO without a reader: retry until one attaches or Stop is called.
+                    cv_.wait_for(lk, std::chrono::milliseconds(50), [&] { return stopping_; });
+                    if (stopping_) break;
+                    lk.unlock();
+                    opened = open_();
+                    continue;
+                }
+                cv_.wait(lk, [&] { return !ready_.empty() || stopping_; });
+                if (ready_.empty()) break;
+                idx = ready_.front();
+                ready_.pop_front();
+            }
+
+            bool ok = !failed_();
+            if (ok && !headerDone) {
+                char hdr[128];
+                const int n = std::snprintf(hdr, sizeof(hdr), "YUV4MPEG2 W%u H%u F%u:%u Ip A1:1 C%s\n",
+                    layout_.width, layout_.height, opt_.fps_num, opt_.fps_den, layout_.tag);
+                ok = write_(hdr, static_cast<std::size_t>(n), nullptr, 0);
+                headerDone = true;
+            }
+            if (ok) {
+                static const char kFrame[] = "FRAME\n";
+                const bool y4m = opt_.container == Container::Y4m;
+                ok = write_(y4m ? kFrame : nullptr, y4m ? 6 : 0, bufs_[idx].data(), bufs_[idx].size());
+            }
+
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                if (ok) ++stats_.written;
+                else {
+                    ++stats_.dropped;
+                    if (!stats_.failed) {
+                        stats_.failed = true;
+                        LOG_WRITE(cshlog::LogLevel::Error, L"exporter: write to %ls failed (errno=%d)",
+                            export_detail::wstr(path_).c_str(), errno);
+                    }
+                }
+                free_.push_back(idx);
+            }
+            freeCv_.notify_one();
+        }
+
+        std::lock_guard<std::mutex> lk(mtx_);
+        stats_.dropped += ready_.size(); // only when the output never opened
+        for (uint32_t i : ready_) free_.push_back(i);
+        ready_.clear();
+        close_();
+        stats_.connected = false;
+    }
+
+    bool failed_() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return stats_.failed;
+    }
+
+    /// Writer thread. @return false only while a FIFO has no reader; other errors set stats_.failed.
+    bool open_() {
+#if defined(__linux__)
+        if (path_ == "-") fd_ = ::dup(STDOUT_FILENO);
+        else {
+            struct stat st{};
+            const bool fifo = ::stat(path_.c_str(), &st) == 0 && S_ISFIFO(st.st_mode);
+            if (fifo) {
+                fd_ = ::open(path_.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+                if (fd_ < 0 && errno == ENXIO) return false; // no reader yet
+                if (fd_ >= 0) ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) & ~O_NONBLOCK);
+            }
+            else {
+                fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            }
+        }
+        const bool ok = fd_ >= 0;
+#else
+        fp_ = path_ == "-" ? stdout : std::fopen(path_.c_str(), "wb");
+        const bool ok = fp_ != nullptr;
+#endif
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (ok) stats_.connected = true;
+        else {
+            LOG_WRITE(cshlog::LogLevel::Error, L"exporter: cannot open %ls (errno=%d)", export_detail::wstr(path_).c_str(), errno);
+            stats_.failed = true;
+        }
+        return true;
+    }
+
+    void close_() {
+#if defined(__linux__)
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#else
+        if (fp_ && fp_ != stdout) std::fclose(fp_);
+        else if (fp_) std::fflush(fp_);
+        fp_ = nullptr;
+#endif
+    }
+
+    /// Write @p a then @p b (either may be empty) completely.
+    bool write_(const void* a, std::size_t an, const void* b, std::size_t bn) {
+#if defined(__linux__)
+        if (fd_ < 0) return false;
+        iovec iov[2] = { { const_cast<void*>(a), an }, { const_cast<void*>(b), bn } };
+        iovec* v = an ? iov : iov + 1;
+        int cnt = (an ? 1 : 0) + (bn ? 1 : 0);
+        while (cnt > 0) {
+            const ssize_t n = ::writev(fd_, v, cnt);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EPIPE) {
+                    sigset_t s;
+                    sigemptyset(&s);
+                    sigaddset(&s, SIGPIPE);
+                    timespec zero{};
+                    sigtimedwait(&s, nullptr, &zero); // discard the pending SIGPIPE
+                    errno = EPIPE;
+                }
+                return false;
+            }
+            std::size_t left = static_cast<std::size_t>(n);
+            while (cnt > 0 && left >= v->iov_len) {
+                left -= v->iov_len;
+                ++v;
+                --cnt;
+            }
+            if (cnt > 0) {
+                v->iov_base = static_cast<uint8_t*>(v->iov_base) + left;
+                v->iov_len -= left;
+            }
+            std::lock_guard<std::mutex> lk(mtx_);
+            stats_.bytes_written += static_cast<uint64_t>(n);
+        }
+        return true;
+#else
+        if (!fp_) return false;
+        if (an && std::fwrite(a, 1, an, fp_) != an) return false;
+        if (bn && std::fwrite(b, 1, bn, fp_) != bn) return false;
+        std::lock_guard<std::mutex> lk(mtx_);
+        stats_.bytes_written += an + bn;
+        return true;
+#endif
+    }
+
+    Options opt_;
+    std::string path_;
+    std::mutex ctlMtx_;                 ///< Serializes Start / Stop.
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;        ///< Writer: frame ready or stopping.
+    std::condition_variable freeCv_;    ///< Push (block): buffer released.
+    std::vector<std::vector<uint8_t>> bufs_;
+    std::vector<uint32_t> free_;
+    std::deque<uint32_t> ready_;
+    Layout_ layout_;                    ///< Fixed by the first frame (guarded by mtx_ until valid).
+    Stats stats_;
+    bool stopping_ = false;
+    std::atomic<bool> running_{ false };
+    CFrameGrabber* grab_ = nullptr;
+    GrabberCallbackGate gate_;
+    std::thread writer_;
+#if defined(__linux__)
+    int fd_ = -1;
+#else
+    std::FILE* fp_ = nullptr;
+#endif
+};
@@ -0,0 +1,592 @@
+#pragma once
+/**
+ * @file CTestPattern.h
+ * @brief Header-only synthetic grabber backend (test patterns, no I/O).
+ *
+ * Generates frames for load and latency testing of the processing pipeline at rates and
+ * sizes no sensor delivers (e.g., 4K @ 240 fps):
+ *  - Patterns: colour bars, moving gradient, noise, or a counter-stamped frame.
+ *  - Any @ref csh_img::En_ImageFormat (Bayer/Gray 8..16 bit, YUV422, RGB565, RGB/BGR888, YUYV444).
+ *  - Frames are rendered once into a ring of buffers at @ref Connect; delivery only stamps
+ *    and publishes a pooled view, so generation cost does not limit the rate.
+ *  - Paced at @ref CGrabberConfig::fps, or free-running (@ref CTestPattern::setFreeRun).
+ *
+ * Every frame carries an embedded stamp in its first bytes (@ref CTestPatternStamp: sequence
+ * and steady-clock timestamp at delivery). Because it lives in the pixels, it survives deep
+ * copies and pass-through processing; read it back with @ref ReadTestPatternStamp and compare
+ * against @ref GrabberNowNs to measure end-to-end latency.
+ *
+ * Register access goes to a simulated sensor (@ref CSimSensorRegisters behind a
+ * @ref CSensorRegisterCache); staged groups are committed before each frame, so AE and
+ * register-batching logic can be exercised without hardware.
+ *
+ * Ring slots are recycled like driver buffers: a slot still referenced by a consumer is not
+ * overwritten. If every slot is held, the tick is skipped and counted in @ref ringExhausted.
+ *
+ * @code
+ * auto tp = std::make_unique<CTestPattern>();
+ * tp->setFormat(csh_img::En_ImageFormat::Bayer10, csh_img::En_ImagePattern::GRBG);
+ * tp->setPattern(CTestPattern::Pattern::ColorBars);
+ * CGrabberConfig cfg; cfg.width = 3840; cfg.height = 2160; cfg.fps = 240;
+ * grab.SetBackend(std::move(tp));
+ * grab.SetConfig(&cfg);
+ * grab.Connect();
+ * @endcode
+ *
+ * @note Ring memory is width * height * bytes-per-pixel * @ref CTestPattern::setRingSize.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IFrameGrabImpl.h"
+#include "CGrabberFrame.h"
+#include "CGrabberStats.h"
+#include "CSensorRegisters.h"
+#include "CSH_Log.h"
+
+/**
+ * @brief Stamp written at the start of every synthetic frame (little-endian, unaligned).
+ */
+struct CTestPatternStamp {
+    static constexpr uint32_t kMagic = 0x54415054; ///< 'TPAT'.
+    uint32_t magic = kMagic;
+    uint32_t reserved = 0;
+    uint64_t sequence = 0;      ///< Delivery sequence number.
+    int64_t  timestamp_ns = 0;  ///< Steady-clock time of delivery (see @ref GrabberNowNs).
+};
+
+/**
+ * @brief Read the embedded stamp of a synthetic frame (or any copy of it).
+ * @return false if @p img does not start with a @ref CTestPatternStamp.
+ */
+inline bool ReadTestPatternStamp(const csh_img::CSH_Image& img, CTestPatternStamp& out) {
+    const auto* p = img.data();
+    if (!p || img.buffer_size < sizeof(CTestPatternStamp)) return false;
+    CTestPatternStamp s;
+    std::memcpy(&s, p, sizeof(s));
+    if (s.magic != CTestPatternStamp::kMagic) return false;
+    out = s;
+    return true;
+}
+
+/**
+ * @class CTestPattern
+ * @brief Synthetic frame source implementing @ref IFrameGrabImpl.
+ *
+ * @thread_safety Public methods follow @ref IFrameGrabImpl (serialized by CFrameGrabber).
+ * Pattern/format/ring setters take effect on the next @ref Connect (or @ref SetConfig).
+ */
+class CTestPattern : public IFrameGrabImpl, public IGrabberStatsSource, public ISensorRegisterSource {
+public:
+    /// Frame content.
+    enum class Pattern : uint32_t {
+        ColorBars = 0,  ///< Eight vertical bars (white, yellow, cyan, green, magenta, red, blue, black).
+        Gradient,       ///< Diagonal RGB ramp that scrolls horizontally across the ring.
+        Noise,          ///< Uniform pseudo-random noise (different per ring slot).
+        Counter         ///< Mid-gray frame with the sequence number drawn as a 32-cell binary strip.
+    };
+
+    CTestPattern() : sensor_(std::make_shared<CSimSensorRegisters>()), regs_(sensor_) {}
+    ~CTestPattern() override {
+        StopGrabbing();
+        Disconnect();
+    }
+
+    CTestPattern(const CTestPattern&) = delete;
+    CTestPattern& operator=(const CTestPattern&) = delete;
+
+    /// @brief Always reports one device, "Test pattern".
+    bool GetConnected(int& outDeviceCount, std::vector<std::string>& outModelNames) override {
+        outModelNames.assign(1, "Test pattern");
+        outDeviceCount = 1;
+        return true;
+    }
+
+    /**
+     * @brief Allocate and pre-render the frame ring.
+     * @return false on invalid geometry or allocation failure.
+     */
+    bool Connect() override {
+        if (pool_) return true;
+
+        uint32_t w = grabberConfig.width, h = grabberConfig.height;
+        const FormatInfo_ fi = formatInfo_(format_);
+        if (format_ == csh_img::En_ImageFormat::YUV422) w &= ~1u;
+        if (w == 0 || h == 0) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"test pattern: invalid size %ux%u", w, h);
+            return false;
+        }
+
+        auto pool = std::make_shared<Pool_>();
+        pool->frameBytes = static_cast<std::size_t>(w) * h * fi.bytesPerPixel;
+        pool->slots.resize(ringSize_);
+        pool->busy.reset(new std::atomic<bool>[ringSize_]);
+        try {
+            for (uint32_t i = 0; i < ringSize_; ++i) {
+                pool->slots[i].reset(new csh_img::CSH_Image::byte[pool->frameBytes]);
+                pool->busy[i].store(false);
+            }
+        }
+        catch (const std::bad_alloc&) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"test pattern: cannot allocate %u x %llu bytes",
+                ringSize_, static_cast<unsigned long long>(pool->frameBytes));
+            return false;
+        }
+
+        width_ = w;
+        height_ = h;
+        info_ = fi;
+        for (uint32_t i = 0; i < ringSize_; ++i) renderSlot_(pool->slots[i].get(), i);
+
+        pool_ = std::move(pool);
+        LOG_WRITE(cshlog::LogLevel::Info, L"test pattern: %ux%u format=%u ring=%u fps=%u%ls",
+            width_, height_, static_cast<unsigned>(format_), ringSize_, grabberConfig.fps,
+            freeRun_ ? L" (free-run)" : L"");
+        return true;
+    }
+
+    /// @brief Stop and drop the ring. Outstanding frames keep their slot alive.
+    void Disconnect() override {
+        StopGrabbing();
+        pool_.reset();
+    }
+
+    /**
+     * @brief Store the configuration (width/height/fps; pixel_format picks the default format).
+     * @return false while grabbing or if @p cfg is null.
+     */
+    bool SetConfig(const CGrabberConfig* cfg) override {
+        if (!cfg || running_.load()) return false;
+        grabberConfig = *cfg;
+        if (!formatOverride_) formatFromPixelFormat_(cfg->pixel_format);
+        if (pool_) {
+            Disconnect();
+            return Connect();
+        }
+        return true;
+    }
+
+    /// @brief Start the delivery thread.
+    bool GrabFrames() override {
+        if (running_.load()) return true;
+        if (!pool_) return false;
+        delivered_.store(0);
+        exhausted_.store(0);
+        late_.store(0);
+        stats_.start(freeRun_ ? 0.0 : grabberConfig.fps);
+        running_.store(true);
+        worker_ = std::thread([this] { workerLoop_(); });
+        return true;
+    }
+
+    /// @brief Stop and join the delivery thread.
+    void StopGrabbing() override {
+        if (!running_.exchange(false)) return;
+        stats_.stop();
+        if (worker_.joinable()) worker_.join();
+    }
+
+    void RegisterCallbackProcessor(FrameGrabCallbackProc cb) override {
+        std::lock_guard<std::mutex> lk(cbMtx_);
+        cbProc_ = std::move(cb);
+    }
+
+    void RegisterCallbackDisplayer(FrameGrabCallbackDisp cb) override {
+        std::lock_guard<std::mutex> lk(cbMtx_);
+        cbDisp_ = std::move(cb);
+    }
+
+    /// @brief Write a register of the simulated sensor (through the shadow cache).
+    bool SetSensorRegister(uint32_t address, uint32_t value) override { return regs_.Write(address, value); }
+    /// @brief Read a register of the simulated sensor (through the shadow cache).
+    bool GetSensorRegister(uint32_t address, uint32_t& outValue) override { return regs_.Read(address, outValue); }
+
+    /// @brief Register cache in front of @ref sensor; staged groups commit before each frame.
+    CSensorRegisterCache& registers() override { return regs_; }
+
+    /// @return The simulated register map (inspect bus traffic, preload defaults).
+    CSimSensorRegisters& sensor() { return *sensor_; }
+
+    // ---------------- Generator options ----------------
+
+    /// Select the frame content (default ColorBars).
+    void setPattern(Pattern p) { pattern_ = p; }
+    Pattern pattern() const { return pattern_; }
+
+    /**
+     * @brief Generate @p fmt instead of the format derived from CGrabberConfig::pixel_format.
+     * @param pat CFA order for Bayer, component order for YUV422; ignored otherwise.
+     */
+    void setFormat(csh_img::En_ImageFormat fmt, csh_img::En_ImagePattern pat = csh_img::En_ImagePattern::RGGB) {
+        format_ = fmt;
+        imgPattern_ = pat;
+        formatOverride_ = true;
+    }
+    csh_img::En_ImageFormat format() const { return format_; }
+
+    /// Number of pre-rendered frames (default 4, minimum 2).
+    void setRingSize(uint32_t n) { ringSize_ = std::max<uint32_t>(2, n); }
+    uint32_t ringSize() const { return ringSize_; }
+
+    /// Ignore CGrabberConfig::fps and deliver as fast as consumers return (default false).
+    void setFreeRun(bool on) { freeRun_ = on; }
+    bool freeRun() const { return freeRun_; }
+
+    // ---------------- Status ----------------
+
+    /// @return Frames delivered since @ref GrabFrames.
+    uint64_t framesDelivered() const { return delivered_.load(std::memory_order_relaxed); }
+
+    /// @return Ticks skipped because consumers held every ring slot.
+    uint64_t ringExhausted() const { return exhausted_.load(std::memory_order_relaxed); }
+
+    /// @return Paced frames delivered after their due time (consumer slower than fps).
+    uint64_t lateFrames() const { return late_.load(std::memory_order_relaxed); }
+
+    /// @brief Health counters; "queued" is free ring slots, "held" slots referenced by consumers.
+    CGrabberStats& stats() override { return stats_; }
+
+private:
+    /// Ring shared with outstanding frames.
+    struct Pool_ {
+        std::size_t frameBytes = 0;
+        std::vector<std::unique_ptr<csh_img::CSH_Image::byte[]>> slots;
+        std::unique_ptr<std::atomic<bool>[]> busy;  ///< Slot referenced by a consumer.
+    };
+
+    struct FormatInfo_ {
+        csh_img::En_ImagePattern pat;
+        uint32_t memoryBit;
+        uint32_t originalBit;
+        uint32_t bytesPerPixel;
+    };
+
+    /// 16-bit linear RGB sample.
+    struct Rgb16_ { uint16_t r, g, b; };
+
+    static std::wstring wstr_(const std::string& s) { return std::wstring(s.begin(), s.end()); }
+
+    FormatInfo_ formatInfo_(csh_img::En_ImageFormat f) const {
+        using F = csh_img::En_ImageFormat;
+        using P = csh_img::En_ImagePattern;
+        switch (f) {
+        case F::Bayer8:  return { imgPattern_, 8, 8, 1 };
+        case F::Gray8:   return { P::RGGB, 8, 8, 1 };
+        case F::Bayer10: return { imgPattern_, 16, 10, 2 };
+        case F::Bayer12: return { imgPattern_, 16, 12, 2 };
+        case F::Bayer14: return { imgPattern_, 16, 14, 2 };
+        case F::Bayer16: return { imgPattern_, 16, 16, 2 };
+        case F::Gray10:  return { P::RGGB, 16, 10, 2 };
+        case F::Gray12:  return { P::RGGB, 16, 12, 2 };
+        case F::Gray14:  return { P::RGGB, 16, 14, 2 };
+        case F::Gray16:  return { P::RGGB, 16, 16, 2 };
+        case F::YUV422: {
+            const bool ordered = imgPattern_ >= P::YUYV && imgPattern_ <= P::VYUY;
+            return { ordered ? imgPattern_ : P::YUYV, 16, 8, 2 };
+        }
+        case F::RGB565:  return { P::RGB, 16, 16, 2 };
+        case F::YUYV444: return { P::YUYV, 24, 8, 3 };
+        case F::RGB888:  return { P::RGB, 24, 8, 3 };
+        case F::BGR888:  return { P::BGR, 24, 8, 3 };
+        }
+        return { P::RGB, 24, 8, 3 };
+    }
+
+    void formatFromPixelFormat_(CGrabberConfig::PixelFormat pf) {
+        using F = csh_img::En_ImageFormat;
+        using P = csh_img::En_ImagePattern;
+        switch (pf) {
+        case CGrabberConfig::PixelFormat::GRAY8:   format_ = F::Gray8; break;
+        case CGrabberConfig::PixelFormat::BGR24:   format_ = F::BGR888; break;
+        case CGrabberConfig::PixelFormat::YUYV422: format_ = F::YUV422; imgPattern_ = P::YUYV; break;
+        case CGrabberConfig::PixelFormat::UYVY422: format_ = F::YUV422; imgPattern_ = P::UYVY; break;
+        default:                                   format_ = F::RGB888; break;
+        }
+    }
+
+    // ---------------- Rendering ----------------
+
+    static uint16_t luma16_(const Rgb16_& c) {
+        return static_cast<uint16_t>((19595u * c.r + 38470u * c.g + 7471u * c.b) >> 16);
+    }
+    static uint8_t y8_(const Rgb16_& c) { return static_cast<uint8_t>(luma16_(c) >> 8); }
+    static uint8_t u8_(const Rgb16_& c) {
+        const int r = c.r >> 8, g = c.g >> 8, b = c.b >> 8;
+        return static_cast<uint8_t>((-43 * r - 85 * g + 128 * b + 32768) >> 8);
+    }
+    static uint8_t v8_(const Rgb16_& c) {
+        const int r = c.r >> 8, g = c.g >> 8, b = c.b >> 8;
+        return static_cast<uint8_t>((128 * r - 107 * g - 21 * b + 32768) >> 8);
+    }
+
+    static void put16_(csh_img::CSH_Image::byte* p, uint16_t v) {
+        p[0] = static_cast<uint8_t>(v & 0xFF);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    /// CFA channel (0=R, 1=G, 2=B) at (x, y).
+    static int cfaChannel_(csh_img::En_ImagePattern pat, uint32_t x, uint32_t y) {
+        static const int kCfa[4][4] = { { 0, 1, 1, 2 }, { 1, 0, 2, 1 }, { 2, 1, 1, 0 }, { 1, 2, 0, 1 } };
+        const uint32_t idx = static_cast<uint32_t>(pat) < 4 ? static_cast<uint32_t>(pat) : 0;
+        return kCfa[idx][((y & 1) << 1) | (x & 1)];
+    }
+
+    /**
+     * @brief Write the rectangle [x0,x1) x [y0,y1) of @p dst with colour @p fn(x, y) in the current format.
+     * @note For YUV422, x0/x1 must be even (pixel pairs share chroma).
+     */
+    template <typename Fn>
+    void renderRect_(csh_img::CSH_Image::byte* dst, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, Fn&& fn) const {
+        using F = csh_img::En_ImageFormat;
+        using P = csh_img::En_ImagePattern;
+        const std::size_t stride = static_cast<std::size_t>(width_) * info_.bytesPerPixel;
+        const uint32_t shift = 16 - info_.originalBit;
+
+        for (uint32_t y = y0; y < y1; ++y) {
+            csh_img::CSH_Image::byte* row = dst + stride * y;
+            switch (format_) {
+            case F::Bayer8: case F::Bayer10: case F::Bayer12: case F::Bayer14: case F::Bayer16:
+                for (uint32_t x = x0; x < x1; ++x) {
+                    const Rgb16_ c = fn(x, y);
+                    const int ch = cfaChannel_(info_.pat, x, y);
+                    const uint16_t v = static_cast<uint16_t>((ch == 0 ? c.r : ch == 1 ? c.g : c.b) >> shift);
+                    if (info_.bytesPerPixel == 1) row[x] = static_cast<uint8_t>(v);
+                    else put16_(row + 2 * x, v);
+                }
+                break;
+            case F::Gray8: case F::Gray10: case F::Gray12: case F::Gray14: case F::Gray16:
+                for (uint32_t x = x0; x < x1; ++x) {
+                    const uint16_t v = static_cast<uint16_t>(luma16_(fn(x, y)) >> shift);
+                    if (info_.bytesPerPixel == 1) row[x] = static_cast<uint8_t>(v);
+                    else put16_(row + 2 * x, v);
+                }
+                break;
+            case F::YUV422:
+                for (uint32_t x = x0; x + 1 < x1; x += 2) {
+                    const Rgb16_ a = fn(x, y), b = fn(x + 1, y);
+                    const Rgb16_ m{ static_cast<uint16_t>((a.r + b.r) >> 1), static_cast<uint16_t>((a.g + b.g) >> 1),
+                                    static_cast<uint16_t>((a.b + b.b) >> 1) };
+                    const uint8_t y0v = y8_(a), y1v = y8_(b), u = u8_(m), v = v8_(m);
+                    csh_img::CSH_Image::byte* p = row + 2 * x;
+                    switch (info_.pat) {
+                    case P::UYVY: p[0] = u; p[1] = y0v; p[2] = v; p[3] = y1v; break;
+                    case P::YVYU: p[0] = y0v; p[1] = v; p[2] = y1v; p[3] = u; break;
+                    case P::VYUY: p[0] = v; p[1] = y0v; p[2] = u; p[3] = y1v; break;
+                    default:      p[0] = y0v; p[1] = u; p[2] = y1v; p[3] = v; break;
+                    }
+                }
+                break;
+            case F::RGB565:
+                for (uint32_t x = x0; x < x1; ++x) {
+                    const Rgb16_ c = fn(x, y);
+                    put16_(row + 2 * x, static_cast<uint16_t>(((c.r >> 11) << 11) | ((c.g >> 10) << 5) | (c.b >> 11)));
+                }
+                break;
+            case F::YUYV444:
+                for (uint32_t x = x0; x < x1; ++x) {
+                    const Rgb16_ c = fn(x, y);
+                    csh_img::CSH_Image::byte* p = row + 3 * x;
+                    p[0] = y8_(c); p[1] = u8_(c); p[2] = v8_(c);
+                }
+                break;
+            case F::RGB888: case F::BGR888: {
+                const bool bgr = format_ == F::BGR888;
+                for (uint32_t x = x0; x < x1; ++x) {
+                    const Rgb16_ c = fn(x, y);
+                    csh_img::CSH_Image::byte* p = row + 3 * x;
+                    p[bgr ? 2 : 0] = static_cast<uint8_t>(c.r >> 8);
+                    p[1] = static_cast<uint8_t>(c.g >> 8);
+                    p[bgr ? 0 : 2] = static_cast<uint8_t>(c.b >> 8);
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    /// Pre-render ring slot @p i.
+    void renderSlot_(csh_img::CSH_Image::byte* dst, uint32_t i) const {
+        const uint32_t w = width_, h = height_;
+        switch (pattern_) {
+        case Pattern::ColorBars: {
+            static const Rgb16_ kBars[8] = {
+                { 0xFFFF, 0xFFFF, 0xFFFF }, { 0xFFFF, 0xFFFF, 0 }, { 0, 0xFFFF, 0xFFFF }, { 0, 0xFFFF, 0 },
+                { 0xFFFF, 0, 0xFFFF }, { 0xFFFF, 0, 0 }, { 0, 0, 0xFFFF }, { 0, 0, 0 } };
+            renderRect_(dst, 0, 0, w, h, [w](uint32_t x, uint32_t) {
+                return kBars[std::min<uint32_t>(7, static_cast<uint32_t>(uint64_t(x) * 8 / w))];
+            });
+            break;
+        }
+        case Pattern::Gradient: {
+            const uint32_t shift = static_cast<uint32_t>(uint64_t(w) * i / ringSize_);
+            renderRect_(dst, 0, 0, w, h, [w, h, shift](uint32_t x, uint32_t y) {
+                const uint16_t gx = static_cast<uint16_t>(uint64_t((x + shift) % w) * 0xFFFF / (w > 1 ? w - 1 : 1));
+                const uint16_t gy = static_cast<uint16_t>(uint64_t(y) * 0xFFFF / (h > 1 ? h - 1 : 1));
+                return Rgb16_{ gx, gy, static_cast<uint16_t>(0xFFFF - gx) };
+            });
+            break;
+        }
+        case Pattern::Noise: {
+            uint64_t s = 0x9E3779B97F4A7C15ull * (i + 1);
+            renderRect_(dst, 0, 0, w, h, [&s](uint32_t, uint32_t) {
+                s ^= s << 13; s ^= s >> 7; s ^= s << 17; // xorshift64
+                return Rgb16_{ static_cast<uint16_t>(s), static_cast<uint16_t>(s >> 16), static_cast<uint16_t>(s >> 32) };
+            });
+            break;
+        }
+        case Pattern::Counter:
+            renderRect_(dst, 0, 0, w, h, [](uint32_t, uint32_t) { return Rgb16_{ 0x8000, 0x8000, 0x8000 }; });
+            break;
+        }
+    }
+
+    /// Draw @p seq as 32 black/white cells across the middle of the frame.
+    void drawCounter_(csh_img::CSH_Image::byte* dst, uint64_t seq) const {
+        const uint32_t cell = std::max<uint32_t>(2, (width_ / 32) & ~1u);
+        const uint32_t y0 = height_ / 2 > cell / 2 ? height_ / 2 - cell / 2 : 0;
+        const uint32_t y1 = std::min(height_, y0 + cell);
+        for (uint32_t bit = 0; bit < 32; ++bit) {
+            const uint32_t x0 = bit * cell;
+            if (x0 + cell > width_) break;
+            const uint16_t v = ((seq >> (31 - bit)) & 1) ? 0xFFFF : 0;
+            renderRect_(dst, x0, y0, x0 + cell, y1, [v](uint32_t, uint32_t) { return Rgb16_{ v, v, v }; });
+        }
+    }
+
+    // ---------------- Delivery ----------------
+
+    /// @return Index of a slot no consumer holds (marked busy), or -1.
+    /// @note Bounded by the pool, not ringSize_: setRingSize() after Connect does not resize it.
+    int acquireSlot_(uint32_t start) {
+        const uint32_t ring = static_cast<uint32_t>(pool_->slots.size());
+        for (uint32_t k = 0; k < ring; ++k) {
+            const uint32_t i = (start + k) % ring;
+            bool expected = false;
+            if (pool_->busy[i].compare_exchange_strong(expected, true)) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    void workerLoop_() {
+        using clock = std::chrono::steady_clock;
+        const bool paced = !freeRun_ && grabberConfig.fps > 0;
+        const auto period = std::chrono::nanoseconds(paced ? 1000000000LL / grabberConfig.fps : 0);
+        const auto start = clock::now();
+        const uint32_t ring = static_cast<uint32_t>(pool_->slots.size());
+        uint64_t tick = 0, seq = 0;
+        uint32_t next = 0;
+
+        while (running_.load(std::memory_order_relaxed)) {
+            if (paced) {
+                const auto due = start + period * tick;
+                if (clock::now() > due + period) late_.fetch_add(1, std::memory_order_relaxed);
+                else std::this_thread::sleep_until(due);
+            }
+            ++tick;
+
+            const int slot = acquireSlot_(next);
+            if (slot < 0) {
+                exhausted_.fetch_add(1, std::memory_order_relaxed);
+                if (!paced) std::this_thread::yield();
+                continue;
+            }
+            next = (static_cast<uint32_t>(slot) + 1) % ring;
+            if (regs_.hasPending()) regs_.CommitPending(); // frame boundary
+
+            CFrameMeta meta;
+            meta.sequence = seq++;
+            meta.buffer_index = static_cast<uint32_t>(slot);
+            meta.bytes_used = static_cast<uint32_t>(pool_->frameBytes);
+
+            csh_img::CSH_Image::byte* data = pool_->slots[slot].get();
+            if (pattern_ == Pattern::Counter) drawCounter_(data, meta.sequence);
+
+            // Stamp last so the timestamp is as close to delivery as possible.
+            meta.timestamp_ns = meta.dequeue_ns = GrabberNowNs();
+            if (pool_->frameBytes >= sizeof(CTestPatternStamp)) {
+                CTestPatternStamp st;
+                st.sequence = meta.sequence;
+                st.timestamp_ns = meta.timestamp_ns;
+                std::memcpy(data, &st, sizeof(st));
+            }
+
+            int64_t cbStart = 0, cbDone = 0;
+            {
+                std::shared_ptr<Pool_> pool = pool_;
+                csh_img::CSH_Image frame;
+                SetFrameView(frame, MakePooledBuffer(data, meta, [pool, slot] { pool->busy[slot].store(false); }),
+                    pool_->frameBytes, width_, height_, format_, info_.pat, info_.memoryBit, info_.originalBit);
+                cbStart = GrabberNowNs();
+                deliver_(frame);
+                cbDone = GrabberNowNs();
+            }
+            delivered_.fetch_add(1, std::memory_order_relaxed);
+
+            uint32_t held = 0;
+            for (uint32_t i = 0; i < ring; ++i) held += pool_->busy[i].load(std::memory_order_relaxed) ? 1u : 0u;
+            stats_.setOccupancy(ring - held, held, ring);
+            stats_.onFrame(meta.sequence, meta.dequeue_ns, cbStart, cbDone);
+        }
+    }
+
+    void deliver_(const csh_img::CSH_Image& frame) {
+        FrameGrabCallbackProc proc;
+        FrameGrabCallbackDisp disp;
+        {
+            std::lock_guard<std::mutex> lk(cbMtx_);
+            proc = cbProc_;
+            disp = cbDisp_;
+        }
+        try {
+            if (proc) proc(frame);
+            if (disp) disp(frame);
+        }
+        catch (const std::exception& e) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"frame callback threw: %ls", wstr_(e.what()).c_str());
+        }
+        catch (...) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"frame callback threw an unknown exception");
+        }
+    }
+
+    // Options
+    Pattern pattern_ = Pattern::ColorBars;
+    csh_img::En_ImageFormat format_ = csh_img::En_ImageFormat::RGB888;
+    csh_img::En_ImagePattern imgPattern_ = csh_img::En_ImagePattern::RGGB;
+    bool formatOverride_ = false;
+    uint32_t ringSize_ = 4;
+    bool freeRun_ = false;
+
+    // Ring + geometry (valid while connected)
+    std::shared_ptr<Pool_> pool_;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    FormatInfo_ info_{ csh_img::En_ImagePattern::RGB, 24, 8, 3 };
+
+    // Delivery
+    std::thread worker_;
+    std::atomic<bool> running_{ false };
+    std::atomic<uint64_t> delivered_{ 0 };
+    std::atomic<uint64_t> exhausted_{ 0 };
+    std::atomic<uint64_t> late_{ 0 };
+    CGrabberStats stats_;
+
+    // Simulated sensor
+    std::shared_ptr<CSimSensorRegisters> sensor_;
+    CSensorRegisterCache regs_;
+
+    // Callbacks
+    std::mutex cbMtx_;
+    FrameGrabCallbackProc cbProc_;
+    FrameGrabCallbackDisp cbDisp_;
+};
@@ -0,0 +1,537 @@
+#pragma once
+/**
+ * @file CV4L2Enum.h
+ * @brief Fast V4L2 device enumeration from sysfs with a capability cache (Linux).
+ *
+ * Probing capture indices by opening them (e.g., OpenCV on 0..15) takes seconds and can
+ * disturb devices that are already streaming. This header enumerates instead:
+ *  1. List /sys/class/video4linux/video* (no device is opened; udev is not required).
+ *  2. Read sysfs attributes for the result: `name`, `index` (0 = primary node of a function)
+ *     and USB vendor/product when present.
+ *  3. VIDIOC_QUERYCAP on nodes not cached yet, to keep video capture nodes. `index` is not
+ *     used as a filter: a second stream of a multi-stream device has a non-zero index as
+ *     well as its metadata nodes. Rejected nodes are cached, so each is queried once per plug.
+ *  4. Cache the result per node; formats, frame sizes and frame intervals
+ *     (VIDIOC_ENUM_FMT / ENUM_FRAMESIZES / ENUM_FRAMEINTERVALS) are enumerated on first
+ *     request and cached as well.
+ *
+ * @ref ListV4L2Modes flattens the cached formats into (pixel format, size, fps) tuples and
+ * @ref SelectV4L2Mode picks the mode with the least bus bandwidth and conversion work for a
+ * target pipeline output (e.g., native YUYV at the target size rather than RGB24 + downscale).
+ *
+ * The cache is keyed by device path and invalidated when the node's device number or
+ * change time differs (unplug/replug), so repeated calls are cheap.
+ *
+ * @code
+ * for (const auto& d : EnumerateV4L2Devices()) {
+ *     printf("%s: %s [%s]\n", d.path.c_str(), d.card.c_str(), d.bus_info.c_str());
+ *     for (const auto& f : GetV4L2Formats(d.path))
+ *         printf("  %s (%zu sizes)\n", f.description.c_str(), f.sizes.size());
+ * }
+ * @endcode
+ *
+ * @note QUERYCAP and the ENUM_* ioctls do not change the device state and are safe on a
+ *       node streaming in another process.
+ */
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+/**
+ * @brief Frame interval (seconds per frame = numerator / denominator).
+ */
+struct CV4L2FrameInterval {
+    uint32_t numerator = 0;
+    uint32_t denominator = 0;
+    bool     stepwise = false;   ///< Min or max of a continuous/stepwise range.
+
+    /// @return Frame rate in Hz (0 if invalid).
+    double fps() const { return numerator ? static_cast<double>(denominator) / numerator : 0.0; }
+};
+
+/**
+ * @brief One frame size and its frame intervals.
+ * @note Stepwise/continuous ranges are reported as two entries (minimum and maximum size)
+ *       with @ref stepwise set and the step in @ref step_width / @ref step_height.
+ */
+struct CV4L2FrameSize {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool     stepwise = false;
+    uint32_t step_width = 0;
+    uint32_t step_height = 0;
+    std::vector<CV4L2FrameInterval> intervals;
+};
+
+/**
+ * @brief One pixel format supported by a device.
+ */
+struct CV4L2FormatDesc {
+    uint32_t fourcc = 0;
+    uint32_t flags = 0;                 ///< V4L2_FMT_FLAG_* (e.g., COMPRESSED).
+    std::string description;            ///< Driver description, e.g., "YUYV 4:2:2".
+    std::vector<CV4L2FrameSize> sizes;
+};
+
+/**
+ * @brief One V4L2 video capture node.
+ */
+struct CV4L2DeviceInfo {
+    std::string path;          ///< /dev/videoN
+    int         index = -1;    ///< N of /dev/videoN (usable as CGrabberConfig::video_id).
+    std::string sysfs_name;    ///< sysfs `name` attribute.
+    int         node_index = 0;///< sysfs `index` (0 = primary node of the function).
+    std::string driver;        ///< QUERYCAP driver (uvcvideo, rp1-cfe, ...).
+    std::string card;          ///< QUERYCAP card.
+    std::string bus_info;      ///< QUERYCAP bus_info (stable across renumbering).
+    uint32_t    capabilities = 0;  ///< QUERYCAP capabilities.
+    uint32_t    device_caps = 0;   ///< Node capabilities (device_caps when provided).
+    uint16_t    usb_vendor = 0;    ///< USB idVendor (0 if not a USB device).
+    uint16_t    usb_product = 0;   ///< USB idProduct (0 if not a USB device).
+    bool        multiplanar = false; ///< Capture through the MPLANE API only.
+};
+
+/**
+ * @brief One capture mode: pixel format, frame size and frame interval.
+ */
+struct CV4L2Mode {
+    uint32_t fourcc = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t interval_num = 0;      ///< Seconds per frame, numerator.
+    uint32_t interval_den = 0;      ///< Seconds per frame, denominator.
+    bool     compressed = false;    ///< V4L2_FMT_FLAG_COMPRESSED (MJPEG, H.264, ...).
+    bool     stepwise = false;      ///< Size range: [width..max_width] x [height..max_height].
+    uint32_t max_width = 0;
+    uint32_t max_height = 0;
+    uint32_t step_width = 0;
+    uint32_t step_height = 0;
+
+    /// @return Frame rate in Hz (0 if unknown).
+    double fps() const { return interval_num ? static_cast<double>(interval_den) / interval_num : 0.0; }
+};
+
+/**
+ * @brief Target of @ref SelectV4L2Mode: what the pipeline needs at its input.
+ */
+struct CV4L2ModeRequest {
+    uint32_t width = 0;     ///< Required output width (0 = any).
+    uint32_t height = 0;    ///< Required output height (0 = any).
+    double   fps = 0.0;     ///< Minimum frame rate (0 = any).
+    /// Formats the pipeline consumes without conversion; empty = all formats cost the same.
+    std::vector<uint32_t> native_fourccs;
+    /// Formats that may be captured at all; empty = any (subject to @ref allow_compressed).
+    std::vector<uint32_t> allowed_fourccs;
+    bool allow_compressed = false;  ///< Consider MJPEG/H.264 (adds a decode cost).
+    bool allow_downscale = true;    ///< Accept larger sizes that the pipeline downscales.
+};
+
+/**
+ * @brief Bits per pixel transferred for @p fourcc (average over planes).
+ * @return 0 for compressed or unknown formats.
+ */
+inline uint32_t V4L2FourccBitsPerPixel(uint32_t fourcc) {
+    switch (fourcc) {
+    case V4L2_PIX_FMT_GREY: case V4L2_PIX_FMT_SRGGB8: case V4L2_PIX_FMT_SGRBG8:
+    case V4L2_PIX_FMT_SBGGR8: case V4L2_PIX_FMT_SGBRG8:
+        return 8;
+    case V4L2_PIX_FMT_Y10P: case V4L2_PIX_FMT_SRGGB10P: case V4L2_PIX_FMT_SGRBG10P:
+    case V4L2_PIX_FMT_SBGGR10P: case V4L2_PIX_FMT_SGBRG10P:
+        return 10;
+    case V4L2_PIX_FMT_NV12: case V4L2_PIX_FMT_NV21: case V4L2_PIX_FMT_NV12M: case V4L2_PIX_FMT_NV21M:
+    case V4L2_PIX_FMT_YUV420: case V4L2_PIX_FMT_YVU420: case V4L2_PIX_FMT_YUV420M: case V4L2_PIX_FMT_YVU420M:
+    case V4L2_PIX_FMT_SRGGB12P: case V4L2_PIX_FMT_SGRBG12P: case V4L2_PIX_FMT_SBGGR12P: case V4L2_PIX_FMT_SGBRG12P:
+        return 12;
+    case V4L2_PIX_FMT_Y10: case V4L2_PIX_FMT_Y12: case V4L2_PIX_FMT_Y16:
+    case V4L2_PIX_FMT_YUYV: case V4L2_PIX_FMT_UYVY: case V4L2_PIX_FMT_YVYU: case V4L2_PIX_FMT_VYUY:
+    case V4L2_PIX_FMT_NV16: case V4L2_PIX_FMT_NV61: case V4L2_PIX_FMT_NV16M: case V4L2_PIX_FMT_NV61M:
+    case V4L2_PIX_FMT_RGB565:
+    case V4L2_PIX_FMT_SRGGB10: case V4L2_PIX_FMT_SGRBG10: case V4L2_PIX_FMT_SBGGR10: case V4L2_PIX_FMT_SGBRG10:
+    case V4L2_PIX_FMT_SRGGB12: case V4L2_PIX_FMT_SGRBG12: case V4L2_PIX_FMT_SBGGR12: case V4L2_PIX_FMT_SGBRG12:
+    case V4L2_PIX_FMT_SRGGB16: case V4L2_PIX_FMT_SGRBG16: case V4L2_PIX_FMT_SBGGR16: case V4L2_PIX_FMT_SGBRG16:
+        return 16;
+    case V4L2_PIX_FMT_RGB24: case V4L2_PIX_FMT_BGR24:
+        return 24;
+    case V4L2_PIX_FMT_XRGB32: case V4L2_PIX_FMT_XBGR32: case V4L2_PIX_FMT_ARGB32: case V4L2_PIX_FMT_ABGR32:
+        return 32;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Printable fourcc ("YUYV", "pRAA", ...).
+ */
+inline std::string V4L2FourccToString(uint32_t fourcc) {
+    std::string s(4, ' ');
+    for (int i = 0; i < 4; ++i) {
+        const char c = static_cast<char>((fourcc >> (8 * i)) & 0xFF);
+        s[i] = (c >= 32 && c < 127) ? c : '?';
+    }
+    return s;
+}
+
+namespace v4l2enum_detail {
+
+    inline int xioctl(int fd, unsigned long req, void* arg) {
+        int r;
+        do { r = ::ioctl(fd, req, arg); } while (r < 0 && errno == EINTR);
+        return r;
+    }
+
+    inline std::string readAttr(const std::string& path) {
+        std::ifstream in(path);
+        std::string s;
+        std::getline(in, s);
+        while (!s.empty() && (s.back() == '\n' || s.back() == '\r' || s.back() == ' ')) s.pop_back();
+        return s;
+    }
+
+    inline uint16_t readHex16(const std::string& path) {
+        const std::string s = readAttr(path);
+        return s.empty() ? 0 : static_cast<uint16_t>(std::strtoul(s.c_str(), nullptr, 16));
+    }
+
+    /// Identity of a /dev node: a replugged device gets a new ctime (and often a new dev_t).
+    struct NodeKey {
+        dev_t rdev = 0;
+        int64_t ctime_ns = 0;
+        bool operator==(const NodeKey& o) const { return rdev == o.rdev && ctime_ns == o.ctime_ns; }
+    };
+
+    inline bool nodeKey(const std::string& path, NodeKey& out) {
+        struct stat st {};
+        if (::stat(path.c_str(), &st) != 0) return false;
+        out.rdev = st.st_rdev;
+        out.ctime_ns = static_cast<int64_t>(st.st_ctim.tv_sec) * 1000000000LL + st.st_ctim.tv_nsec;
+        return true;
+    }
+
+    inline std::vector<CV4L2FrameInterval> enumIntervals(int fd, uint32_t fourcc, uint32_t w, uint32_t h) {
+        std::vector<CV4L2FrameInterval> out;
+        v4l2_frmivalenum fi{};
+        fi.pixel_format = fourcc;
+        fi.width = w;
+        fi.height = h;
+        for (fi.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &fi) == 0; ++fi.index) {
+            if (fi.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+                out.push_back({ fi.discrete.numerator, fi.discrete.denominator, false });
+                continue;
+            }
+            out.push_back({ fi.stepwise.min.numerator, fi.stepwise.min.denominator, true });
+            out.push_back({ fi.stepwise.max.numerator, fi.stepwise.max.denominator, true });
+            break;
+        }
+        return out;
+    }
+
+    inline std::vector<CV4L2FormatDesc> enumFormats(int fd, uint32_t bufType) {
+        std::vector<CV4L2FormatDesc> out;
+        v4l2_fmtdesc fd_{};
+        fd_.type = bufType;
+        for (fd_.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &fd_) == 0; ++fd_.index) {
+            CV4L2FormatDesc f;
+            f.fourcc = fd_.pixelformat;
+            f.flags = fd_.flags;
+            f.description = reinterpret_cast<const char*>(fd_.description);
+
+            v4l2_frmsizeenum fs{};
+            fs.pixel_format = f.fourcc;
+            for (fs.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &fs) == 0; ++fs.index) {
+                if (fs.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                    CV4L2FrameSize s;
+                    s.width = fs.discrete.width;
+                    s.height = fs.discrete.height;
+                    s.intervals = enumIntervals(fd, f.fourcc, s.width, s.height);
+                    f.sizes.push_back(std::move(s));
+                    continue;
+                }
+                for (int k = 0; k < 2; ++k) {
+                    CV4L2FrameSize s;
+                    s.width = k ? fs.stepwise.max_width : fs.stepwise.min_width;
+                    s.height = k ? fs.stepwise.max_height : fs.stepwise.min_height;
+                    s.stepwise = true;
+                    s.step_width = fs.stepwise.step_width;
+                    s.step_height = fs.stepwise.step_height;
+                    s.intervals = enumIntervals(fd, f.fourcc, s.width, s.height);
+                    f.sizes.push_back(std::move(s));
+                }
+                break;
+            }
+            out.push_back(std::move(f));
+        }
+        return out;
+    }
+
+    /// Process-wide cache of device info and formats.
+    struct Cache {
+        struct Entry {
+            NodeKey key;
+            CV4L2DeviceInfo info;
+        };
+        struct Formats {
+            NodeKey key;
+            std::vector<CV4L2FormatDesc> list;
+        };
+        std::mutex mtx;
+        std::map<std::string, Entry> entries;
+        std::map<std::string, Formats> formats;
+        /// Non-capture nodes (metadata, output, m2m) by path, so they are not re-queried.
+        std::map<std::string, NodeKey> rejected;
+
+        static Cache& instance() {
+            static Cache c;
+            return c;
+        }
+    };
+
+    /// QUERYCAP @p path and fill @p info. @return false if not a streaming video capture node.
+    inline bool queryNode(const std::string& path, CV4L2DeviceInfo& info) {
+        const int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) return false;
+        v4l2_capability cap{};
+        const bool ok = xioctl(fd, VIDIOC_QUERYCAP, &cap) == 0;
+        ::close(fd);
+        if (!ok) return false;
+
+        info.driver = reinterpret_cast<const char*>(cap.driver);
+        info.card = reinterpret_cast<const char*>(cap.card);
+        info.bus_info = reinterpret_cast<const char*>(cap.bus_info);
+        info.capabilities = cap.capabilities;
+        info.device_caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+        const uint32_t c = info.device_caps;
+        info.multiplanar = !(c & V4L2_CAP_VIDEO_CAPTURE) && (c & V4L2_CAP_VIDEO_CAPTURE_MPLANE);
+        return (c & (V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_VIDEO_CAPTURE_MPLANE)) && (c & V4L2_CAP_STREAMING);
+    }
+
+} // namespace v4l2enum_detail
+
+/**
+ * @brief Enumerate video capture nodes via /sys/class/video4linux (cached).
+ * @param refresh Ignore cached entries and query every candidate again.
+ * @return Capture nodes sorted by /dev/videoN index.
+ */
+inline std::vector<CV4L2DeviceInfo> EnumerateV4L2Devices(bool refresh = false) {
+    using namespace v4l2enum_detail;
+    static const char* kSysClass = "/sys/class/video4linux";
+
+    std::vector<std::string> nodes;
+    if (DIR* dir = ::opendir(kSysClass)) {
+        while (dirent* e = ::readdir(dir)) {
+            if (std::strncmp(e->d_name, "video", 5) == 0) nodes.emplace_back(e->d_name);
+        }
+        ::closedir(dir);
+    }
+
+    Cache& cache = Cache::instance();
+    std::lock_guard<std::mutex> lk(cache.mtx);
+    if (refresh) {
+        cache.entries.clear();
+        cache.rejected.clear();
+        cache.formats.clear();
+    }
+
+    std::vector<CV4L2DeviceInfo> out;
+    for (const std::string& n : nodes) {
+        const std::string path = "/dev/" + n;
+        NodeKey key;
+        if (!nodeKey(path, key)) continue;
+
+        auto it = cache.entries.find(path);
+        if (it != cache.entries.end() && it->second.key == key) {
+            out.push_back(it->second.info);
+            continue;
+        }
+        auto rj = cache.rejected.find(path);
+        if (rj != cache.rejected.end() && rj->second == key) continue;
+
+        const std::string sys = std::string(kSysClass) + "/" + n;
+        CV4L2DeviceInfo info;
+        info.path = path;
+        info.index = std::atoi(n.c_str() + 5);
+        info.sysfs_name = readAttr(sys + "/name");
+        const std::string idx = readAttr(sys + "/index");
+        info.node_index = idx.empty() ? 0 : std::atoi(idx.c_str());
+        // UVC: device -> USB interface; vendor/product live on the parent USB device.
+        info.usb_vendor = readHex16(sys + "/device/../idVendor");
+        info.usb_product = readHex16(sys + "/device/../idProduct");
+
+        if (!queryNode(path, info)) {
+            cache.entries.erase(path);
+            cache.rejected[path] = key;
+            continue;
+        }
+        Cache::Entry e;
+        e.key = key;
+        e.info = info;
+        cache.entries[path] = std::move(e);
+        cache.rejected.erase(path);
+        out.push_back(std::move(info));
+    }
+
+    std::sort(out.begin(), out.end(), [](const CV4L2DeviceInfo& a, const CV4L2DeviceInfo& b) { return a.index < b.index; });
+    return out;
+}
+
+/**
+ * @brief Formats, frame sizes and frame intervals of capture node @p path (cached).
+ * @param refresh Re-enumerate even if cached.
+ * @return Empty if @p path cannot be opened or is not a capture node.
+ */
+inline std::vector<CV4L2FormatDesc> GetV4L2Formats(const std::string& path, bool refresh = false) {
+    using namespace v4l2enum_detail;
+    Cache& cache = Cache::instance();
+    NodeKey key;
+    if (!nodeKey(path, key)) return {};
+
+    {
+        std::lock_guard<std::mutex> lk(cache.mtx);
+        auto it = cache.formats.find(path);
+        if (!refresh && it != cache.formats.end() && it->second.key == key) return it->second.list;
+    }
+
+    CV4L2DeviceInfo info;
+    info.path = path;
+    if (!queryNode(path, info)) return {};
+    const int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return {};
+    auto formats = enumFormats(fd, info.multiplanar ? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE : V4L2_BUF_TYPE_VIDEO_CAPTURE);
+    ::close(fd);
+
+    std::lock_guard<std::mutex> lk(cache.mtx);
+    cache.formats[path] = { key, formats };
+    return formats;
+}
+
+/**
+ * @brief Every (pixel format, size, frame interval) tuple of capture node @p path.
+ * @note Uses the format cache of @ref GetV4L2Formats. Stepwise size ranges yield one mode
+ *       per interval of the largest size, with @ref CV4L2Mode::stepwise set (min size in width/height).
+ */
+inline std::vector<CV4L2Mode> ListV4L2Modes(const std::string& path) {
+    std::vector<CV4L2Mode> out;
+    for (const CV4L2FormatDesc& f : GetV4L2Formats(path)) {
+        const bool compressed = (f.flags & V4L2_FMT_FLAG_COMPRESSED) != 0;
+        for (std::size_t i = 0; i < f.sizes.size(); ++i) {
+            const CV4L2FrameSize& sz = f.sizes[i];
+            CV4L2Mode m;
+            m.fourcc = f.fourcc;
+            m.width = sz.width;
+            m.height = sz.height;
+            m.compressed = compressed;
+            const std::vector<CV4L2FrameInterval>* intervals = &sz.intervals;
+            if (sz.stepwise) {
+                if (i + 1 >= f.sizes.size()) break;
+                const CV4L2FrameSize& mx = f.sizes[++i]; // stepwise sizes come as (min, max)
+                m.stepwise = true;
+                m.max_width = mx.width;
+                m.max_height = mx.height;
+                m.step_width = std::max<uint32_t>(1, sz.step_width);
+                m.step_height = std::max<uint32_t>(1, sz.step_height);
+                intervals = &mx.intervals; // rates at the largest size hold across the range
+            }
+            if (intervals->empty()) {
+                out.push_back(m);
+                continue;
+            }
+            for (const CV4L2FrameInterval& iv : *intervals) {
+                m.interval_num = iv.numerator;
+                m.interval_den = iv.denominator;
+                out.push_back(m);
+            }
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief Pick the mode with the least bus bandwidth and conversion work for @p req.
+ *
+ * Candidates must reach the requested size (exactly, or larger when downscaling is allowed)
+ * and frame rate. Cost, in bytes-equivalent per second at the mode's frame rate:
+ *  - bus transfer: width * height * bits-per-pixel / 8 (compressed formats estimated at 4 bpp),
+ *  - +2 per pixel if the format is not in @ref CV4L2ModeRequest::native_fourccs,
+ *  - +2 per pixel if the size differs from the target (scaling pass),
+ *  - +8 per pixel for compressed formats (decode).
+ * Ties prefer the lower frame rate, then the smaller size.
+ *
+ * @param modes Modes from @ref ListV4L2Modes.
+ * @param req   Pipeline target.
+ * @param out   Selected mode; stepwise ranges are resolved to a concrete size.
+ * @return false if no mode satisfies @p req.
+ */
+inline bool SelectV4L2Mode(const std::vector<CV4L2Mode>& modes, const CV4L2ModeRequest& req, CV4L2Mode& out) {
+    auto contains = [](const std::vector<uint32_t>& v, uint32_t x) { return std::find(v.begin(), v.end(), x) != v.end(); };
+    auto roundUp = [](uint32_t v, uint32_t lo, uint32_t step) { return v <= lo ? lo : lo + ((v - lo + step - 1) / step) * step; };
+
+    bool found = false;
+    double bestCost = 0.0;
+    for (CV4L2Mode m : modes) {
+        if (m.compressed && !req.allow_compressed) continue;
+        if (!req.allowed_fourccs.empty() && !contains(req.allowed_fourccs, m.fourcc)) continue;
+        const double fps = m.fps();
+        if (req.fps > 0.0 && fps > 0.0 && fps + 0.01 < req.fps) continue;
+
+        if (m.stepwise) { // resolve to the smallest size covering the target
+            const uint32_t w = roundUp(req.width, m.width, m.step_width);
+            const uint32_t h = roundUp(req.height, m.height, m.step_height);
+            if (w > m.max_width || h > m.max_height) continue;
+            m.width = w;
+            m.height = h;
+            m.stepwise = false;
+        }
+        if (req.width && req.height) {
+            if (m.width < req.width || m.height < req.height) continue;
+            if (!req.allow_downscale && (m.width != req.width || m.height != req.height)) continue;
+        }
+
+        const uint32_t bpp = V4L2FourccBitsPerPixel(m.fourcc);
+        if (!bpp && !m.compressed) continue; // unknown layout
+        const double rate = fps > 0.0 ? fps : (req.fps > 0.0 ? req.fps : 30.0);
+        const double pixels = static_cast<double>(m.width) * m.height * rate;
+        double cost = pixels * (m.compressed ? 4.0 : static_cast<double>(bpp)) / 8.0;
+        if (!req.native_fourccs.empty() && !contains(req.native_fourccs, m.fourcc)) cost += pixels * 2.0;
+        if (req.width && req.height && (m.width != req.width || m.height != req.height)) cost += pixels * 2.0;
+        if (m.compressed) cost += pixels * 8.0;
+
+        const bool better = !found || cost < bestCost ||
+            (cost == bestCost && (fps < out.fps() ||
+                (fps == out.fps() && static_cast<uint64_t>(m.width) * m.height < static_cast<uint64_t>(out.width) * out.height)));
+        if (better) {
+            found = true;
+            bestCost = cost;
+            out = m;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Drop all cached device and format information.
+ */
+inline void ClearV4L2DeviceCache() {
+    auto& cache = v4l2enum_detail::Cache::instance();
+    std::lock_guard<std::mutex> lk(cache.mtx);
+    cache.entries.clear();
+    cache.rejected.clear();
+    cache.formats.clear();
+}
+
+#endif // __linux__
@@ -0,0 +1,1046 @@
+#pragma once
+/**
+ * @file CV4L2Stream.h
+ * @brief Header-only V4L2 streaming backend with zero-copy frame delivery.
+ *
+ * Implements @ref IFrameGrabImpl on top of the V4L2 streaming I/O model:
+ *  - VIDIOC_REQBUFS with a configurable buffer count (@ref CV4L2Stream::Options::buffer_count).
+ *  - Driver buffers are mmap'ed once; with @ref CV4L2Stream::BufferMemory::DMABUF each
+ *    buffer is additionally exported as a dma-buf fd (VIDIOC_EXPBUF).
+ *  - Each VIDIOC_DQBUF is published as a @ref csh_img::CSH_Image **view** on the mapped
+ *    buffer (no copy). The view's buffer carries a @ref CFrameReleaser, so the driver
+ *    buffer is re-queued (VIDIOC_QBUF) when the last reference—including any shallow
+ *    copy kept by a consumer—is released.
+ *
+ * Frames are delivered in the native driver format (e.g., YUYV as YUV422/YUYV, SRGGB10 as
+ * Bayer10/RGGB). Capture metadata (sequence, timestamp, buffer index, dma-buf fd) is
+ * available through @ref GetFrameMeta.
+ *
+ * Multi-planar capture:
+ *  - Devices exposing only V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE (rp1-cfe, ISP outputs) are
+ *    driven through the MPLANE API; every memory plane is mapped (and exported) separately.
+ *  - Semi-planar / planar YUV (NV12, NV16, YUV420 and their `M` variants), CSI-2 packed raw
+ *    (memory_bit 10/12) and extra driver planes (embedded data) are described plane by plane
+ *    in @ref CFrameMeta::planes. The callback image is plane 0 (luma / pixels); the other
+ *    planes are available as zero-copy views via @ref GetFramePlane.
+ *
+ * Mode selection:
+ *  - An explicit @ref CV4L2Stream::Options::fourcc or @ref CGrabberConfig::pixel_format is requested
+ *    as is (the driver may adjust size and rate).
+ *  - With pixel_format UNKNOWN and no fourcc, the backend picks, among the formats it can
+ *    publish, the mode with the least bus bandwidth that still reaches the configured size and
+ *    fps (see @ref SelectV4L2Mode), e.g. YUYV 640x480 instead of RGB24 1920x1080 + downscale.
+ *  - @ref negotiatedMode reports what the driver actually applied; @ref modes lists every
+ *    (format, size, fps) tuple of the device.
+ *
+ * Sensor registers:
+ *  - SetSensorRegister/GetSensorRegister go through @ref registers(), a shadow cache over a
+ *    transport set by the application (@ref CI2CRegisterIO or @ref CV4L2RegisterIO on the
+ *    sensor subdev); without a transport they return false.
+ *  - Groups staged with @ref CSensorRegisterCache::Stage (or CFrameGrabber::SetSensorRegisters)
+ *    are written as one batch right after a frame is dequeued, i.e. early in the next frame.
+ *
+ * Install through the façade:
+ * @code
+ * CFrameGrabber grab;
+ * CV4L2Stream::Options opt; opt.buffer_count = 6;
+ * grab.SetBackend(std::make_unique<CV4L2Stream>(opt));
+ * CGrabberConfig cfg; cfg.strVideo = "/dev/video0";
+ * grab.SetConfig(&cfg);
+ * grab.Connect();
+ * @endcode
+ *
+ * @note Linux only. Holding frames pins driver buffers: if consumers keep every buffer,
+ *       capture stalls until one is released (the driver reports no new frames).
+ * @note When the driver pads rows (bytesperline > width * bpp) plane 0 cannot be described
+ *       by a packed CSH_Image; the callback image is then compacted into a heap buffer.
+ *       Single-plane frames re-queue the driver buffer immediately; multi-plane frames keep
+ *       it until the copy is released so the stride-wide plane views stay valid.
+ */
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <functional>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#include "IFrameGrabImpl.h"
+#include "CGrabberFrame.h"
+#include "CGrabberStats.h"
+#include "CSensorRegisters.h"
+#include "CV4L2Enum.h"
+#include "CSH_Log.h"
+
+/**
+ * @class CV4L2Stream
+ * @brief Zero-copy V4L2 capture backend (MMAP / exported DMABUF streaming).
+ *
+ * @thread_safety Public methods follow @ref IFrameGrabImpl (serialized by CFrameGrabber).
+ * Buffer release (re-queue) may happen on any thread.
+ */
+class CV4L2Stream : public IFrameGrabImpl, public IGrabberStatsSource, public ISensorRegisterSource {
+public:
+    /**
+     * @brief Memory model for the driver buffers.
+     *
+     * Both values use driver-allocated buffers mapped into the process; DMABUF
+     * additionally exports each buffer as a dma-buf fd (VIDIOC_EXPBUF) so frames
+     * can be shared with GPU/encoder/other processes without copies.
+     */
+    enum class BufferMemory : uint32_t {
+        MMAP = 0,     ///< V4L2_MEMORY_MMAP buffers, mapped read/write.
+        DMABUF        ///< MMAP buffers exported as dma-buf fds (see CFrameMeta::dmabuf\_fd).
+    };
+
+    /**
+     * @brief V4L2-only streaming settings, applied at @ref Connect.
+     * @note Kept out of CGrabberConfig: that struct is embedded in IFrameGrabImpl, whose
+     *       layout is shared with the prebuilt backends.
+     */
+    struct Options {
+        /// Driver buffers requested with VIDIOC_REQBUFS (default 4, at least 2). The driver
+        /// may adjust it; more buffers let consumers hold zero-copy frames longer.
+        uint32_t buffer_count = 4;
+
+        /// Buffer memory model (default MMAP).
+        BufferMemory buffer_memory = BufferMemory::MMAP;
+
+        /// Explicit V4L2 fourcc (e.g. 'pRAA' for CSI-2 packed RAW10). 0 (default) maps
+        /// CGrabberConfig::pixel_format; non-zero overrides it for formats without a
+        /// PixelFormat value (packed raw, ISP-specific layouts).
+        uint32_t fourcc = 0;
+    };
+
+    CV4L2Stream() = default;
+    explicit CV4L2Stream(const Options& opt) : opt_(opt) {}
+    ~CV4L2Stream() override {
+        StopGrabbing();
+        Disconnect();
+    }
+
+    CV4L2Stream(const CV4L2Stream&) = delete;
+    CV4L2Stream& operator=(const CV4L2Stream&) = delete;
+
+    /**
+     * @brief Enumerate streaming capture nodes from sysfs (see CV4L2Enum.h; cached).
+     * @note Names are "<card> (<path>)". No device is opened except for VIDIOC_QUERYCAP
+     *       on new /sys/class/video4linux candidates.
+     */
+    bool GetConnected(int& outDeviceCount, std::vector<std::string>& outModelNames) override {
+        outModelNames.clear();
+        devicePaths_.clear();
+        for (const CV4L2DeviceInfo& d : EnumerateV4L2Devices()) {
+            devicePaths_.push_back(d.path);
+            outModelNames.push_back(d.card + " (" + d.path + ")");
+        }
+        outDeviceCount = static_cast<int>(outModelNames.size());
+        return true;
+    }
+
+    /**
+     * @brief Open the device, negotiate format/fps and allocate + map driver buffers.
+     */
+    bool Connect() override {
+        if (pool_) return true;
+
+        const std::string path = resolveDevicePath_();
+        if (path.empty()) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"no V4L2 capture device to open");
+            return false;
+        }
+
+        const int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"open(%ls) failed: errno=%d", wstr_(path).c_str(), errno);
+            return false;
+        }
+
+        auto pool = std::make_shared<Pool_>();
+        pool->fd = fd;
+
+        v4l2_capability cap{};
+        if (xioctl_(fd, VIDIOC_QUERYCAP, &cap) < 0 || !isStreamingCapture_(cap)) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"%ls is not a streaming capture device", wstr_(path).c_str());
+            return false;
+        }
+        // Prefer the single-plane API when both are offered; contiguous NV12/YUV420
+        // are still split into planes by the layout below.
+        pool->mplane = !(deviceCaps_(cap) & V4L2_CAP_VIDEO_CAPTURE);
+        pool->bufType = pool->mplane ? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE : V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+        if (!negotiateFormat_(*pool, path) || !allocateBuffers_(*pool)) return false;
+
+        {
+            std::lock_guard<std::mutex> lk(pumpMtx_);
+            devicePath_ = path;
+            pool_ = std::move(pool);
+        }
+        LOG_WRITE(cshlog::LogLevel::Info, L"%ls: %ux%u %ls @ %.2f fps planes=%u%ls buffers=%u%ls",
+            wstr_(path).c_str(), width_, height_, wstr_(V4L2FourccToString(fourcc_)).c_str(), mode_.fps(),
+            static_cast<unsigned>(layout_.size()),
+            pool_->mplane ? L" (mplane)" : L"", static_cast<unsigned>(pool_->bufs.size()),
+            pool_->exported ? L" (dmabuf)" : L"");
+        return true;
+    }
+
+    /**
+     * @brief Stop streaming and drop this backend's reference to the buffer pool.
+     * @note Mappings and the device fd stay alive until every outstanding frame is released.
+     */
+    void Disconnect() override {
+        StopGrabbing();
+        std::lock_guard<std::mutex> lk(pumpMtx_);
+        pool_.reset();
+        devicePath_.clear();
+    }
+
+    /**
+     * @brief Store the configuration; re-negotiates if connected but not grabbing.
+     * @return false while grabbing or if @p cfg is null.
+     */
+    bool SetConfig(const CGrabberConfig* cfg) override {
+        if (!cfg || running_.load()) return false;
+        grabberConfig = *cfg;
+        if (pool_) {
+            Disconnect();
+            return Connect();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Queue all idle buffers, VIDIOC_STREAMON and start the dequeue worker.
+     * @note With an external pump (see @ref setExternalPump) no worker is started;
+     *       the owner of the pump dequeues through @ref serviceReady.
+     */
+    bool GrabFrames() override {
+        std::lock_guard<std::mutex> lk(pumpMtx_);
+        if (running_.load()) return true;
+        if (!pool_) return false;
+        if (!pool_->streamOn()) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"VIDIOC_STREAMON failed: errno=%d", errno);
+            return false;
+        }
+        stats_.start(grabberConfig.fps);
+        running_.store(true);
+        if (!externalPump_) startWorker_();
+        return true;
+    }
+
+    /**
+     * @brief Stop the worker and VIDIOC_STREAMOFF. Outstanding frames remain valid.
+     */
+    void StopGrabbing() override {
+        if (!running_.exchange(false)) return;
+        stats_.stop();
+        std::lock_guard<std::mutex> lk(pumpMtx_);
+        stopWorker_();
+        if (pool_) pool_->streamOff();
+    }
+
+    void RegisterCallbackProcessor(FrameGrabCallbackProc cb) override {
+        std::lock_guard<std::mutex> lk(cbMtx_);
+        cbProc_ = std::move(cb);
+    }
+
+    void RegisterCallbackDisplayer(FrameGrabCallbackDisp cb) override {
+        std::lock_guard<std::mutex> lk(cbMtx_);
+        cbDisp_ = std::move(cb);
+    }
+
+    /// @brief Write through the register cache; false without a transport (see @ref registers).
+    bool SetSensorRegister(uint32_t address, uint32_t value) override { return regs_.Write(address, value); }
+    /// @brief Read from the register cache (bus on a shadow miss); false without a transport.
+    bool GetSensorRegister(uint32_t address, uint32_t& outValue) override { return regs_.Read(address, outValue); }
+
+    /// @return True between a successful @ref GrabFrames and @ref StopGrabbing (STREAMON issued).
+    bool isGrabbing() const { return running_.load(); }
+
+    /// @return Device fd while connected, -1 otherwise.
+    int fd() const { return pool_ ? pool_->fd : -1; }
+
+    /// @return Number of driver buffers actually allocated (0 when disconnected).
+    uint32_t bufferCount() const { return pool_ ? static_cast<uint32_t>(pool_->bufs.size()) : 0; }
+
+    /// @return Number of buffers currently held by consumers (not queued to the driver).
+    uint32_t outstandingCount() const { return pool_ ? pool_->outstanding() : 0; }
+
+    /// @brief Health counters (sequence gaps, latency, queue occupancy, fps); see CGrabberStats.h.
+    CGrabberStats& stats() override { return stats_; }
+
+    /// @brief Sensor register cache; set its transport before using register access.
+    CSensorRegisterCache& registers() override { return regs_; }
+
+    /// @brief Replace the streaming options; used by the next @ref Connect.
+    void SetOptions(const Options& opt) { opt_ = opt; }
+    /// @return Streaming options used by @ref Connect.
+    const Options& options() const { return opt_; }
+
+    /// @return Negotiated V4L2 fourcc (0 when disconnected).
+    uint32_t fourcc() const { return pool_ ? fourcc_ : 0; }
+
+    /**
+     * @brief Mode applied by the driver at @ref Connect (format, size and frame interval).
+     * @return Zero-initialized mode when disconnected; interval is 0/0 if the driver
+     *         does not report one.
+     */
+    CV4L2Mode negotiatedMode() const { return pool_ ? mode_ : CV4L2Mode(); }
+
+    /**
+     * @brief Every (pixel format, size, frame interval) tuple of the configured device.
+     * @note Served from the enumeration cache of CV4L2Enum.h; works before @ref Connect.
+     */
+    std::vector<CV4L2Mode> modes() {
+        const std::string path = pool_ ? devicePath_ : resolveDevicePath_();
+        return path.empty() ? std::vector<CV4L2Mode>() : ListV4L2Modes(path);
+    }
+
+    /// @return True when the device is driven through the multi-planar (MPLANE) API.
+    bool isMultiPlanar() const { return pool_ && pool_->mplane; }
+
+    /// @return Number of logical planes published per frame (0 when disconnected).
+    uint32_t planeCount() const { return pool_ ? static_cast<uint32_t>(layout_.size()) : 0; }
+
+    // ---------------- External pump (event loop integration) ----------------
+
+    /**
+     * @brief Hand frame dequeueing to an external event loop (e.g., @ref CGrabberHub).
+     * @param on true: no per-device worker; the loop calls @ref serviceReady when @ref fd
+     *           is readable. false: (re)start the internal worker if grabbing.
+     * @note Callable while grabbing and from another thread than the one calling
+     *       GrabFrames/StopGrabbing; the internal worker is stopped/started accordingly.
+     */
+    void setExternalPump(bool on) {
+        std::lock_guard<std::mutex> lk(pumpMtx_);
+        if (on == externalPump_) return;
+        externalPump_ = on;
+        if (!running_.load()) return;
+        if (on) stopWorker_();
+        else startWorker_();
+    }
+
+    /// @return True if an external event loop drives this stream.
+    bool hasExternalPump() const { return externalPump_.load(); }
+
+    /**
+     * @brief Device fd while streaming, -1 when stopped or disconnected.
+     * @note Read under the pump lock, so an external loop gets an answer consistent with
+     *       a concurrent Connect/Disconnect/GrabFrames/StopGrabbing on the app thread.
+     */
+    int streamingFd() {
+        std::lock_guard<std::mutex> lk(pumpMtx_);
+        return running_.load() && pool_ ? pool_->fd : -1;
+    }
+
+    /**
+     * @brief Dequeue and deliver every ready buffer without blocking.
+     * @return Number of frames delivered (0 if nothing was ready or not grabbing).
+     * @note Called by the external pump's thread; callbacks run on that thread.
+     */
+    uint32_t serviceReady() {
+        std::lock_guard<std::mutex> lk(pumpMtx_);
+        if (!running_.load(std::memory_order_relaxed) || !pool_) return 0;
+        uint32_t n = 0;
+        while (dequeueOne_()) ++n;
+        return n;
+    }
+
+private:
+    // ---------------- Buffer pool (shared with frame views) ----------------
+
+    enum class BufState_ : uint8_t { Idle = 0, Queued, Outstanding };
+
+    struct PlaneMap_ {
+        uint8_t* start = nullptr;
+        std::size_t length = 0;
+        int dmabuf_fd = -1;
+    };
+
+    struct Buffer_ {
+        std::array<PlaneMap_, VIDEO_MAX_PLANES> planes{};
+        BufState_ state = BufState_::Idle;
+    };
+
+    /**
+     * @brief Owns the device fd, mappings and per-buffer queue state.
+     *
+     * Frame views hold a shared_ptr to the pool, so it outlives Disconnect() until
+     * the last frame is released.
+     */
+    struct Pool_ {
+        int fd = -1;
+        uint32_t bufType = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        bool mplane = false;
+        uint32_t memPlanes = 1;     ///< Memory planes per buffer (1 for the single-plane API).
+        bool exported = false;
+        std::vector<Buffer_> bufs;
+        bool streaming = false;
+        mutable std::mutex mtx;
+
+        ~Pool_() {
+            for (auto& b : bufs) {
+                for (auto& p : b.planes) {
+                    if (p.dmabuf_fd >= 0) ::close(p.dmabuf_fd);
+                    if (p.start) ::munmap(p.start, p.length);
+                }
+            }
+            if (fd >= 0) ::close(fd);
+        }
+
+        /// Prepare a v4l2_buffer (and plane array for MPLANE) for QBUF/DQBUF/QUERYBUF.
+        void initBuffer(v4l2_buffer& b, v4l2_plane* planes, uint32_t idx) const {
+            b = v4l2_buffer{};
+            b.type = bufType;
+            b.memory = V4L2_MEMORY_MMAP;
+            b.index = idx;
+            if (mplane) {
+                std::memset(planes, 0, sizeof(v4l2_plane) * VIDEO_MAX_PLANES);
+                b.m.planes = planes;
+                b.length = memPlanes;
+            }
+        }
+
+        /// Requires @ref mtx held.
+        bool queue_(uint32_t idx) {
+            v4l2_buffer b;
+            v4l2_plane planes[VIDEO_MAX_PLANES];
+            initBuffer(b, planes, idx);
+            if (xioctl_(fd, VIDIOC_QBUF, &b) < 0) return false;
+            bufs[idx].state = BufState_::Queued;
+            return true;
+        }
+
+        bool streamOn() {
+            std::lock_guard<std::mutex> lk(mtx);
+            for (uint32_t i = 0; i < bufs.size(); ++i) {
+                if (bufs[i].state == BufState_::Idle && !queue_(i)) return false;
+            }
+            int type = static_cast<int>(bufType);
+            if (xioctl_(fd, VIDIOC_STREAMON, &type) < 0) return false;
+            streaming = true;
+            return true;
+        }
+
+        void streamOff() {
+            std::lock_guard<std::mutex> lk(mtx);
+            int type = static_cast<int>(bufType);
+            xioctl_(fd, VIDIOC_STREAMOFF, &type);
+            streaming = false;
+            for (auto& b : bufs) {
+                if (b.state == BufState_::Queued) b.state = BufState_::Idle;
+            }
+        }
+
+        void markOutstanding(uint32_t idx) {
+            std::lock_guard<std::mutex> lk(mtx);
+            bufs[idx].state = BufState_::Outstanding;
+        }
+
+        /// Return a buffer: re-queue while streaming, otherwise park it as idle.
+        void release(uint32_t idx) {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (idx >= bufs.size() || bufs[idx].state != BufState_::Outstanding) return;
+            if (!(streaming && queue_(idx))) bufs[idx].state = BufState_::Idle;
+        }
+
+        uint32_t outstanding() const {
+            std::lock_guard<std::mutex> lk(mtx);
+            uint32_t n = 0;
+            for (const auto& b : bufs) n += (b.state == BufState_::Outstanding) ? 1u : 0u;
+            return n;
+        }
+
+        /// Buffers owned by the driver and held by consumers.
+        void occupancy(uint32_t& queued, uint32_t& held) const {
+            std::lock_guard<std::mutex> lk(mtx);
+            queued = held = 0;
+            for (const auto& b : bufs) {
+                queued += (b.state == BufState_::Queued) ? 1u : 0u;
+                held += (b.state == BufState_::Outstanding) ? 1u : 0u;
+            }
+        }
+    };
+
+    // ---------------- Format mapping ----------------
+
+    struct FormatInfo_ {
+        csh_img::En_ImageFormat fmt;
+        csh_img::En_ImagePattern pat;
+        uint32_t memoryBit;
+        uint32_t originalBit;
+        uint32_t bitsPerPixel;   ///< Storage bits per pixel (10 for CSI-2 packed RAW10).
+    };
+
+    /// One logical plane: where it lives (memory plane + offset) and how to view it.
+    struct PlaneLayout_ {
+        uint32_t memPlane = 0;
+        std::size_t offset = 0;
+        uint32_t bytesPerLine = 0;
+        uint32_t width = 0, height = 0, viewWidth = 0;
+        FormatInfo_ info{};
+        CFramePlaneRole role = CFramePlaneRole::Pixels;
+
+        std::size_t rowBytes() const { return (static_cast<std::size_t>(width) * info.bitsPerPixel + 7) / 8; }
+        std::size_t bytes() const { return static_cast<std::size_t>(bytesPerLine) * height; }
+        bool padded() const { return bytesPerLine != rowBytes(); }
+    };
+
+    /// Per memory plane format reported by the driver.
+    struct MemPlaneFmt_ {
+        uint32_t bytesPerLine = 0;
+        uint32_t sizeImage = 0;
+    };
+
+    static bool formatFromFourcc_(uint32_t fcc, FormatInfo_& out) {
+        using F = csh_img::En_ImageFormat;
+        using P = csh_img::En_ImagePattern;
+        switch (fcc) {
+        case V4L2_PIX_FMT_GREY:     out = { F::Gray8,   P::RGGB, 8, 8, 8 }; return true;
+        case V4L2_PIX_FMT_Y10:      out = { F::Gray10,  P::RGGB, 16, 10, 16 }; return true;
+        case V4L2_PIX_FMT_Y12:      out = { F::Gray12,  P::RGGB, 16, 12, 16 }; return true;
+        case V4L2_PIX_FMT_Y16:      out = { F::Gray16,  P::RGGB, 16, 16, 16 }; return true;
+        case V4L2_PIX_FMT_Y10P:     out = { F::Gray10,  P::RGGB, 10, 10, 10 }; return true;
+        case V4L2_PIX_FMT_YUYV:     out = { F::YUV422,  P::YUYV, 16, 8, 16 }; return true;
+        case V4L2_PIX_FMT_UYVY:     out = { F::YUV422,  P::UYVY, 16, 8, 16 }; return true;
+        case V4L2_PIX_FMT_YVYU:     out = { F::YUV422,  P::YVYU, 16, 8, 16 }; return true;
+        case V4L2_PIX_FMT_VYUY:     out = { F::YUV422,  P::VYUY, 16, 8, 16 }; return true;
+        case V4L2_PIX_FMT_RGB565:   out = { F::RGB565,  P::RGB, 16, 16, 16 }; return true;
+        case V4L2_PIX_FMT_RGB24:    out = { F::RGB888,  P::RGB, 24, 8, 24 }; return true;
+        case V4L2_PIX_FMT_BGR24:    out = { F::BGR888,  P::BGR, 24, 8, 24 }; return true;
+        case V4L2_PIX_FMT_SRGGB8:   out = { F::Bayer8,  P::RGGB, 8, 8, 8 }; return true;
+        case V4L2_PIX_FMT_SGRBG8:   out = { F::Bayer8,  P::GRBG, 8, 8, 8 }; return true;
+        case V4L2_PIX_FMT_SBGGR8:   out = { F::Bayer8,  P::BGGR, 8, 8, 8 }; return true;
+        case V4L2_PIX_FMT_SGBRG8:   out = { F::Bayer8,  P::GBRG, 8, 8, 8 }; return true;
+        case V4L2_PIX_FMT_SRGGB10:  out = { F::Bayer10, P::RGGB, 16, 10, 16 }; return true;
+        case V4L2_PIX_FMT_SGRBG10:  out = { F::Bayer10, P::GRBG, 16, 10, 16 }; return true;
+        case V4L2_PIX_FMT_SBGGR10:  out = { F::Bayer10, P::BGGR, 16, 10, 16 }; return true;
+        case V4L2_PIX_FMT_SGBRG10:  out = { F::Bayer10, P::GBRG, 16, 10, 16 }; return true;
+        case V4L2_PIX_FMT_SRGGB12:  out = { F::Bayer12, P::RGGB, 16, 12, 16 }; return true;
+        case V4L2_PIX_FMT_SGRBG12:  out = { F::Bayer12, P::GRBG, 16, 12, 16 }; return true;
+        case V4L2_PIX_FMT_SBGGR12:  out = { F::Bayer12, P::BGGR, 16, 12, 16 }; return true;
+        case V4L2_PIX_FMT_SGBRG12:  out = { F::Bayer12, P::GBRG, 16, 12, 16 }; return true;
+        case V4L2_PIX_FMT_SRGGB16:  out = { F::Bayer16, P::RGGB, 16, 16, 16 }; return true;
+        case V4L2_PIX_FMT_SGRBG16:  out = { F::Bayer16, P::GRBG, 16, 16, 16 }; return true;
+        case V4L2_PIX_FMT_SBGGR16:  out = { F::Bayer16, P::BGGR, 16, 16, 16 }; return true;
+        case V4L2_PIX_FMT_SGBRG16:  out = { F::Bayer16, P::GBRG, 16, 16, 16 }; return true;
+        // CSI-2 packed raw: Bayer10/12 "packed as policy" (memory_bit 10/12)
+        case V4L2_PIX_FMT_SRGGB10P: out = { F::Bayer10, P::RGGB, 10, 10, 10 }; return true;
+        case V4L2_PIX_FMT_SGRBG10P: out = { F::Bayer10, P::GRBG, 10, 10, 10 }; return true;
+        case V4L2_PIX_FMT_SBGGR10P: out = { F::Bayer10, P::BGGR, 10, 10, 10 }; return true;
+        case V4L2_PIX_FMT_SGBRG10P: out = { F::Bayer10, P::GBRG, 10, 10, 10 }; return true;
+        case V4L2_PIX_FMT_SRGGB12P: out = { F::Bayer12, P::RGGB, 12, 12, 12 }; return true;
+        case V4L2_PIX_FMT_SGRBG12P: out = { F::Bayer12, P::GRBG, 12, 12, 12 }; return true;
+        case V4L2_PIX_FMT_SBGGR12P: out = { F::Bayer12, P::BGGR, 12, 12, 12 }; return true;
+        case V4L2_PIX_FMT_SGBRG12P: out = { F::Bayer12, P::GBRG, 12, 12, 12 }; return true;
+        default: return false;
+        }
+    }
+
+    /**
+     * @brief Split a negotiated format into logical planes.
+     * @return false if the fourcc is not understood.
+     * @details Memory planes not consumed by the pixel layout are published as
+     *          @ref CFramePlaneRole::EmbeddedData (Gray8, one byte per sample).
+     */
+    static bool buildLayout_(uint32_t fcc, uint32_t w, uint32_t h,
+        const MemPlaneFmt_* mem, uint32_t memPlanes, std::vector<PlaneLayout_>& out) {
+        out.clear();
+        const FormatInfo_ u8{ csh_img::En_ImageFormat::Gray8, csh_img::En_ImagePattern::RGGB, 8, 8, 8 };
+        auto add = [&](uint32_t mp, std::size_t off, uint32_t bpl, uint32_t pw, uint32_t ph,
+                       const FormatInfo_& fi, CFramePlaneRole role) {
+            PlaneLayout_ L;
+            L.memPlane = mp; L.offset = off; L.bytesPerLine = bpl;
+            L.width = pw; L.height = ph; L.info = fi; L.role = role;
+            L.viewWidth = L.padded() ? static_cast<uint32_t>((static_cast<std::size_t>(bpl) * 8) / fi.bitsPerPixel) : pw;
+            out.push_back(L);
+        };
+
+        uint32_t used = 1;
+        const uint32_t bpl0 = mem[0].bytesPerLine;
+        switch (fcc) {
+        case V4L2_PIX_FMT_NV12: case V4L2_PIX_FMT_NV21:
+        case V4L2_PIX_FMT_NV16: case V4L2_PIX_FMT_NV61: {
+            const bool is420 = (fcc == V4L2_PIX_FMT_NV12 || fcc == V4L2_PIX_FMT_NV21);
+            add(0, 0, bpl0, w, h, u8, CFramePlaneRole::Luma);
+            add(0, static_cast<std::size_t>(bpl0) * h, bpl0, w, is420 ? h / 2 : h, u8, CFramePlaneRole::Chroma);
+            break;
+        }
+        case V4L2_PIX_FMT_NV12M: case V4L2_PIX_FMT_NV21M:
+        case V4L2_PIX_FMT_NV16M: case V4L2_PIX_FMT_NV61M: {
+            if (memPlanes < 2) return false;
+            const bool is420 = (fcc == V4L2_PIX_FMT_NV12M || fcc == V4L2_PIX_FMT_NV21M);
+            add(0, 0, bpl0, w, h, u8, CFramePlaneRole::Luma);
+            add(1, 0, mem[1].bytesPerLine, w, is420 ? h / 2 : h, u8, CFramePlaneRole::Chroma);
+            used = 2;
+            break;
+        }
+        case V4L2_PIX_FMT_YUV420: case V4L2_PIX_FMT_YVU420: {
+            const uint32_t cbpl = bpl0 / 2;
+            const std::size_t ySize = static_cast<std::size_t>(bpl0) * h;
+            const std::size_t cSize = static_cast<std::size_t>(cbpl) * (h / 2);
+            const bool yvu = (fcc == V4L2_PIX_FMT_YVU420);
+            add(0, 0, bpl0, w, h, u8, CFramePlaneRole::Luma);
+            add(0, ySize + (yvu ? cSize : 0), cbpl, w / 2, h / 2, u8, CFramePlaneRole::ChromaU);
+            add(0, ySize + (yvu ? 0 : cSize), cbpl, w / 2, h / 2, u8, CFramePlaneRole::ChromaV);
+            break;
+        }
+        case V4L2_PIX_FMT_YUV420M: case V4L2_PIX_FMT_YVU420M: {
+            if (memPlanes < 3) return false;
+            const bool yvu = (fcc == V4L2_PIX_FMT_YVU420M);
+            add(0, 0, bpl0, w, h, u8, CFramePlaneRole::Luma);
+            add(yvu ? 2 : 1, 0, mem[yvu ? 2 : 1].bytesPerLine, w / 2, h / 2, u8, CFramePlaneRole::ChromaU);
+            add(yvu ? 1 : 2, 0, mem[yvu ? 1 : 2].bytesPerLine, w / 2, h / 2, u8, CFramePlaneRole::ChromaV);
+            used = 3;
+            break;
+        }
+        default: {
+            FormatInfo_ fi;
+            if (!formatFromFourcc_(fcc, fi)) return false;
+            add(0, 0, bpl0, w, h, fi, CFramePlaneRole::Pixels);
+            break;
+        }
+        }
+
+        for (uint32_t mp = used; mp < memPlanes && out.size() < kMaxFramePlanes; ++mp) {
+            const uint32_t bpl = mem[mp].bytesPerLine ? mem[mp].bytesPerLine : mem[mp].sizeImage;
+            if (!bpl) continue;
+            add(mp, 0, bpl, bpl, mem[mp].sizeImage / bpl, u8, CFramePlaneRole::EmbeddedData);
+        }
+        return true;
+    }
+
+    static uint32_t fourccFromPixelFormat_(CGrabberConfig::PixelFormat pf) {
+        switch (pf) {
+        case CGrabberConfig::PixelFormat::GRAY8:   return V4L2_PIX_FMT_GREY;
+        case CGrabberConfig::PixelFormat::RGB24:   return V4L2_PIX_FMT_RGB24;
+        case CGrabberConfig::PixelFormat::BGR24:   return V4L2_PIX_FMT_BGR24;
+        case CGrabberConfig::PixelFormat::YUYV422: return V4L2_PIX_FMT_YUYV;
+        case CGrabberConfig::PixelFormat::UYVY422: return V4L2_PIX_FMT_UYVY;
+        case CGrabberConfig::PixelFormat::NV12:    return V4L2_PIX_FMT_NV12;
+        case CGrabberConfig::PixelFormat::NV16:    return V4L2_PIX_FMT_NV16;
+        case CGrabberConfig::PixelFormat::YUV420:  return V4L2_PIX_FMT_YUV420;
+        default:                                   return 0;
+        }
+    }
+
+    // ---------------- Helpers ----------------
+
+    static int xioctl_(int fd, unsigned long req, void* arg) {
+        int r;
+        do { r = ::ioctl(fd, req, arg); } while (r < 0 && errno == EINTR);
+        return r;
+    }
+
+    static std::wstring wstr_(const std::string& s) { return std::wstring(s.begin(), s.end()); }
+
+    static uint32_t deviceCaps_(const v4l2_capability& cap) {
+        return (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    }
+
+    static bool isStreamingCapture_(const v4l2_capability& cap) {
+        const uint32_t caps = deviceCaps_(cap);
+        return (caps & (V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_VIDEO_CAPTURE_MPLANE)) && (caps & V4L2_CAP_STREAMING);
+    }
+
+    std::string resolveDevicePath_() {
+        if (!grabberConfig.strVideo.empty()) return grabberConfig.strVideo;
+        if (grabberConfig.video_id >= 0) return "/dev/video" + std::to_string(grabberConfig.video_id);
+        int n = 0;
+        std::vector<std::string> names;
+        if (devicePaths_.empty()) GetConnected(n, names);
+        return devicePaths_.empty() ? std::string() : devicePaths_.front();
+    }
+
+    /// @return True if frames of @p fcc can be published (packed table or planar YUV layout).
+    static bool isPublishable_(uint32_t fcc) {
+        switch (fcc) {
+        case V4L2_PIX_FMT_NV12: case V4L2_PIX_FMT_NV21: case V4L2_PIX_FMT_NV16: case V4L2_PIX_FMT_NV61:
+        case V4L2_PIX_FMT_NV12M: case V4L2_PIX_FMT_NV21M: case V4L2_PIX_FMT_NV16M: case V4L2_PIX_FMT_NV61M:
+        case V4L2_PIX_FMT_YUV420: case V4L2_PIX_FMT_YVU420: case V4L2_PIX_FMT_YUV420M: case V4L2_PIX_FMT_YVU420M:
+            return true;
+        default: {
+            FormatInfo_ fi;
+            return formatFromFourcc_(fcc, fi);
+        }
+        }
+    }
+
+    /**
+     * Publishable mode for pixel_format UNKNOWN: the lowest-bandwidth one reaching the configured
+     * size and fps. If no mode reaches the fps, the highest frame rate offered at that size wins;
+     * among modes at that rate the usual @ref SelectV4L2Mode order applies (lowest cost, then
+     * smaller size).
+     */
+    bool selectAutoMode_(const std::string& path, CV4L2Mode& out) const {
+        const std::vector<CV4L2Mode> all = ListV4L2Modes(path);
+        CV4L2ModeRequest req;
+        req.width = grabberConfig.width;
+        req.height = grabberConfig.height;
+        req.fps = grabberConfig.fps;
+        for (const CV4L2Mode& m : all) {
+            if (isPublishable_(m.fourcc) && std::find(req.allowed_fourccs.begin(), req.allowed_fourccs.end(), m.fourcc) == req.allowed_fourccs.end())
+                req.allowed_fourccs.push_back(m.fourcc);
+        }
+        if (req.allowed_fourccs.empty()) return false;
+        if (SelectV4L2Mode(all, req, out)) return true;
+
+        // Nothing reaches the rate: step the minimum down through the offered rates, fastest
+        // first, so the first match runs at the highest rate available at the requested size.
+        std::vector<double> rates;
+        for (const CV4L2Mode& m : all) {
+            if (m.fps() > 0.0) rates.push_back(m.fps());
+        }
+        std::sort(rates.begin(), rates.end(), std::greater<double>());
+        rates.erase(std::unique(rates.begin(), rates.end()), rates.end());
+        rates.push_back(0.0); // modes without a known interval
+        for (double r : rates) {
+            req.fps = r;
+            if (SelectV4L2Mode(all, req, out)) return true;
+        }
+        return false;
+    }
+
+    /// VIDIOC_S_FMT / S_PARM with the requested (or auto-selected) mode; records what the driver chose.
+    bool negotiateFormat_(Pool_& pool, const std::string& path) {
+        const int fd = pool.fd;
+        v4l2_format fmt{};
+        fmt.type = pool.bufType;
+        if (xioctl_(fd, VIDIOC_G_FMT, &fmt) < 0) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"VIDIOC_G_FMT failed: errno=%d", errno);
+            return false;
+        }
+        uint32_t want = opt_.fourcc ? opt_.fourcc : fourccFromPixelFormat_(grabberConfig.pixel_format);
+        uint32_t reqWidth = grabberConfig.width, reqHeight = grabberConfig.height;
+        CV4L2Mode autoMode;
+        const bool haveAuto = !want && selectAutoMode_(path, autoMode);
+        if (haveAuto) {
+            want = autoMode.fourcc;
+            reqWidth = autoMode.width;
+            reqHeight = autoMode.height;
+            LOG_WRITE(cshlog::LogLevel::Debug, L"%ls: auto-selected %ls %ux%u @ %.2f fps",
+                wstr_(path).c_str(), wstr_(V4L2FourccToString(want)).c_str(), reqWidth, reqHeight, autoMode.fps());
+        }
+        if (pool.mplane) {
+            fmt.fmt.pix_mp.width = reqWidth;
+            fmt.fmt.pix_mp.height = reqHeight;
+            if (want) fmt.fmt.pix_mp.pixelformat = want;
+            fmt.fmt.pix_mp.field = V4L2_FIELD_NONE;
+            fmt.fmt.pix_mp.num_planes = 0; // driver fills
+        } else {
+            fmt.fmt.pix.width = reqWidth;
+            fmt.fmt.pix.height = reqHeight;
+            if (want) fmt.fmt.pix.pixelformat = want;
+            fmt.fmt.pix.field = V4L2_FIELD_NONE;
+        }
+        if (xioctl_(fd, VIDIOC_S_FMT, &fmt) < 0) {
+            LOG_WRITE(cshlog::LogLevel::Warn, L"VIDIOC_S_FMT failed (errno=%d); keeping current mode", errno);
+            if (xioctl_(fd, VIDIOC_G_FMT, &fmt) < 0) return false;
+        }
+
+        MemPlaneFmt_ mem[VIDEO_MAX_PLANES]{};
+        if (pool.mplane) {
+            fourcc_ = fmt.fmt.pix_mp.pixelformat;
+            width_ = fmt.fmt.pix_mp.width;
+            height_ = fmt.fmt.pix_mp.height;
+            pool.memPlanes = std::max<uint32_t>(1u, std::min<uint32_t>(fmt.fmt.pix_mp.num_planes, VIDEO_MAX_PLANES));
+            for (uint32_t p = 0; p < pool.memPlanes; ++p) {
+                mem[p].bytesPerLine = fmt.fmt.pix_mp.plane_fmt[p].bytesperline;
+                mem[p].sizeImage = fmt.fmt.pix_mp.plane_fmt[p].sizeimage;
+            }
+        } else {
+            fourcc_ = fmt.fmt.pix.pixelformat;
+            width_ = fmt.fmt.pix.width;
+            height_ = fmt.fmt.pix.height;
+            pool.memPlanes = 1;
+            mem[0].bytesPerLine = fmt.fmt.pix.bytesperline;
+            mem[0].sizeImage = fmt.fmt.pix.sizeimage;
+        }
+
+        if (!mem[0].bytesPerLine) {
+            // Some drivers leave bytesperline at 0 for packed formats; derive it.
+            FormatInfo_ fi;
+            const uint32_t bits = formatFromFourcc_(fourcc_, fi) ? fi.bitsPerPixel : 8u;
+            mem[0].bytesPerLine = (width_ * bits + 7) / 8;
+        }
+        if (!buildLayout_(fourcc_, width_, height_, mem, pool.memPlanes, layout_)) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"unsupported driver fourcc 0x%08x (%u planes)", fourcc_, pool.memPlanes);
+            return false;
+        }
+
+        v4l2_streamparm parm{};
+        parm.type = pool.bufType;
+        const bool haveParm = xioctl_(fd, VIDIOC_G_PARM, &parm) == 0;
+        if (haveParm && (parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+            if (haveAuto && autoMode.interval_num && fourcc_ == autoMode.fourcc) {
+                parm.parm.capture.timeperframe.numerator = autoMode.interval_num;
+                parm.parm.capture.timeperframe.denominator = autoMode.interval_den;
+                xioctl_(fd, VIDIOC_S_PARM, &parm);
+            } else if (grabberConfig.fps > 0) {
+                parm.parm.capture.timeperframe.numerator = 1;
+                parm.parm.capture.timeperframe.denominator = grabberConfig.fps;
+                xioctl_(fd, VIDIOC_S_PARM, &parm);
+            }
+            xioctl_(fd, VIDIOC_G_PARM, &parm); // what the driver applied
+        }
+
+        mode_ = CV4L2Mode();
+        mode_.fourcc = fourcc_;
+        mode_.width = width_;
+        mode_.height = height_;
+        if (haveParm) {
+            mode_.interval_num = parm.parm.capture.timeperframe.numerator;
+            mode_.interval_den = parm.parm.capture.timeperframe.denominator;
+        }
+        for (const CV4L2FormatDesc& f : GetV4L2Formats(path)) {
+            if (f.fourcc == fourcc_) mode_.compressed = (f.flags & V4L2_FMT_FLAG_COMPRESSED) != 0;
+        }
+        return true;
+    }
+
+    /// VIDIOC_REQBUFS + QUERYBUF + mmap (+ EXPBUF when DMABUF is requested).
+    bool allocateBuffers_(Pool_& pool) {
+        v4l2_requestbuffers req{};
+        req.count = std::max<uint32_t>(2u, opt_.buffer_count);
+        req.type = pool.bufType;
+        req.memory = V4L2_MEMORY_MMAP;
+        if (xioctl_(pool.fd, VIDIOC_REQBUFS, &req) < 0 || req.count == 0) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"VIDIOC_REQBUFS(%u) failed: errno=%d (frames from a previous session still held?)",
+                opt_.buffer_count, errno);
+            return false;
+        }
+
+        pool.exported = (opt_.buffer_memory == BufferMemory::DMABUF);
+        pool.bufs.resize(req.count);
+        for (uint32_t i = 0; i < req.count; ++i) {
+            v4l2_buffer b;
+            v4l2_plane planes[VIDEO_MAX_PLANES];
+            pool.initBuffer(b, planes, i);
+            if (xioctl_(pool.fd, VIDIOC_QUERYBUF, &b) < 0) return false;
+
+            for (uint32_t p = 0; p < pool.memPlanes; ++p) {
+                const std::size_t length = pool.mplane ? planes[p].length : b.length;
+                const off_t offset = pool.mplane ? static_cast<off_t>(planes[p].m.mem_offset) : static_cast<off_t>(b.m.offset);
+                void* ptr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, pool.fd, offset);
+                if (ptr == MAP_FAILED) {
+                    LOG_WRITE(cshlog::LogLevel::Error, L"mmap of buffer %u plane %u failed: errno=%d", i, p, errno);
+                    return false;
+                }
+                PlaneMap_& pm = pool.bufs[i].planes[p];
+                pm.start = static_cast<uint8_t*>(ptr);
+                pm.length = length;
+
+                if (pool.exported) {
+                    v4l2_exportbuffer exp{};
+                    exp.type = pool.bufType;
+                    exp.index = i;
+                    exp.plane = p;
+                    exp.flags = O_RDONLY | O_CLOEXEC;
+                    if (xioctl_(pool.fd, VIDIOC_EXPBUF, &exp) == 0) {
+                        pm.dmabuf_fd = exp.fd;
+                    } else {
+                        LOG_WRITE(cshlog::LogLevel::Warn, L"VIDIOC_EXPBUF unsupported (errno=%d); falling back to MMAP", errno);
+                        pool.exported = false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    void startWorker_() {
+        workerStop_.store(false);
+        worker_ = std::thread([this] { workerLoop_(); });
+    }
+
+    void stopWorker_() {
+        workerStop_.store(true);
+        if (worker_.joinable()) worker_.join();
+    }
+
+    void workerLoop_() {
+        pollfd pfd{ pool_->fd, POLLIN, 0 };
+        while (!workerStop_.load(std::memory_order_relaxed)) {
+            const int r = ::poll(&pfd, 1, 100);
+            if (r < 0 && errno != EINTR) {
+                LOG_WRITE(cshlog::LogLevel::Error, L"poll failed: errno=%d", errno);
+                break;
+            }
+            if (r <= 0) continue;
+            if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                LOG_WRITE(cshlog::LogLevel::Error, L"device error on %ls (revents=0x%x)", wstr_(devicePath_).c_str(), pfd.revents);
+                break;
+            }
+            while (dequeueOne_()) {}
+        }
+    }
+
+    /// Non-blocking VIDIOC_DQBUF + publish. @return true if a frame was dequeued.
+    bool dequeueOne_() {
+        v4l2_buffer b;
+        v4l2_plane planes[VIDEO_MAX_PLANES];
+        pool_->initBuffer(b, planes, 0);
+        if (xioctl_(pool_->fd, VIDIOC_DQBUF, &b) < 0) {
+            if (errno != EAGAIN) LOG_WRITE(cshlog::LogLevel::Warn, L"VIDIOC_DQBUF failed: errno=%d", errno);
+            return false;
+        }
+        const int64_t dequeued = GrabberNowNs(); // before the register commit: latency starts here
+        pool_->markOutstanding(b.index);
+        if (regs_.hasPending()) regs_.CommitPending(); // frame boundary: apply the staged group
+
+        const Buffer_& buf = pool_->bufs[b.index];
+        CFrameMeta meta;
+        meta.sequence = b.sequence;
+        meta.timestamp_ns = static_cast<int64_t>(b.timestamp.tv_sec) * 1000000000LL
+                          + static_cast<int64_t>(b.timestamp.tv_usec) * 1000LL;
+        meta.dequeue_ns = dequeued;
+        meta.buffer_index = b.index;
+        meta.dmabuf_fd = buf.planes[0].dmabuf_fd;
+        meta.flags = b.flags;
+        meta.bytes_used = pool_->mplane ? planes[0].bytesused : b.bytesused;
+        meta.fourcc = fourcc_;
+        meta.num_planes = static_cast<uint32_t>(std::min<std::size_t>(layout_.size(), kMaxFramePlanes));
+        for (uint32_t p = 0; p < meta.num_planes; ++p) {
+            const PlaneLayout_& L = layout_[p];
+            CFramePlaneDesc& d = meta.planes[p];
+            d.data = buf.planes[L.memPlane].start + L.offset;
+            d.bytes = L.bytes();
+            d.bytes_per_line = L.bytesPerLine;
+            d.width = L.width;
+            d.height = L.height;
+            d.view_width = L.viewWidth;
+            d.format = L.info.fmt;
+            d.pattern = L.info.pat;
+            d.memory_bit = L.info.memoryBit;
+            d.original_bit = L.info.originalBit;
+            d.role = L.role;
+            d.dmabuf_fd = buf.planes[L.memPlane].dmabuf_fd;
+            d.dmabuf_offset = static_cast<uint32_t>(L.offset);
+        }
+
+        int64_t cbStart = 0, cbDone = 0;
+        {
+            csh_img::CSH_Image frame;
+            buildView_(frame, b.index, meta);
+            frame.camera_id = grabberConfig.video_id >= 0 ? static_cast<uint32_t>(grabberConfig.video_id) : 0u;
+            cbStart = GrabberNowNs();
+            deliver_(frame);
+            cbDone = GrabberNowNs();
+        } // our reference is gone: "held" below counts consumers only
+
+        uint32_t queued = 0, held = 0;
+        pool_->occupancy(queued, held);
+        stats_.setOccupancy(queued, held, static_cast<uint32_t>(pool_->bufs.size()));
+        stats_.onFrame(meta.sequence, meta.dequeue_ns, cbStart, cbDone);
+        return true;
+    }
+
+    /// Callback image = plane 0 (zero-copy unless rows are padded).
+    void buildView_(csh_img::CSH_Image& frame, uint32_t idx, const CFrameMeta& meta) {
+        const PlaneLayout_& L = layout_.front();
+        uint8_t* src = meta.planes[0].data;
+        std::shared_ptr<Pool_> pool = pool_;
+        std::shared_ptr<csh_img::CSH_Image::byte[]> buf;
+        std::size_t bytes = L.bytes();
+
+        if (!L.padded()) {
+            buf = MakePooledBuffer(src, meta, [pool, idx] { pool->release(idx); });
+        } else {
+            // Padded rows: compact plane 0 into a heap buffer. Keep the driver buffer only
+            // when other planes are published (their views point into it).
+            const std::size_t rowBytes = L.rowBytes();
+            bytes = rowBytes * L.height;
+            auto* dst = new csh_img::CSH_Image::byte[bytes];
+            for (uint32_t y = 0; y < L.height; ++y) {
+                std::memcpy(dst + y * rowBytes, src + static_cast<std::size_t>(y) * L.bytesPerLine, rowBytes);
+            }
+            const bool holdDriver = meta.num_planes > 1;
+            if (holdDriver) {
+                buf = MakePooledBuffer(dst, meta, [dst, pool, idx] {
+                    delete[] dst;
+                    pool->release(idx);
+                });
+            } else {
+                // The driver buffer is requeued now: plane 0 must describe the copy, not
+                // memory (or a dmabuf) the driver is already refilling.
+                pool->release(idx);
+                CFrameMeta own = meta;
+                CFramePlaneDesc& d = own.planes[0];
+                d.data = dst;
+                d.bytes = bytes;
+                d.bytes_per_line = static_cast<uint32_t>(rowBytes);
+                d.view_width = d.width;
+                d.dmabuf_fd = -1;
+                d.dmabuf_offset = 0;
+                own.dmabuf_fd = -1;
+                buf = MakePooledBuffer(dst, own, [dst] { delete[] dst; });
+            }
+        }
+        SetFrameView(frame, std::move(buf), bytes, L.width, L.height,
+            L.info.fmt, L.info.pat, L.info.memoryBit, L.info.originalBit);
+    }
+
+    /// Processor first, then displayer (same order as the built-in backends).
+    void deliver_(const csh_img::CSH_Image& frame) {
+        FrameGrabCallbackProc proc;
+        FrameGrabCallbackDisp disp;
+        {
+            std::lock_guard<std::mutex> lk(cbMtx_);
+            proc = cbProc_;
+            disp = cbDisp_;
+        }
+        try {
+            if (proc) proc(frame);
+            if (disp) disp(frame);
+        }
+        catch (const std::exception& e) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"frame callback threw: %ls", wstr_(e.what()).c_str());
+        }
+        catch (...) {
+            LOG_WRITE(cshlog::LogLevel::Error, L"frame callback threw an unknown exception");
+        }
+    }
+
+private:
+    Options opt_;
+    std::shared_ptr<Pool_> pool_;
+    std::string devicePath_;
+    std::vector<std::string> devicePaths_;  ///< Cached from GetConnected().
+
+    // Negotiated mode
+    std::vector<PlaneLayout_> layout_;  ///< Logical planes; [0] is the callback image.
+    uint32_t fourcc_ = 0;
+    uint32_t width_ = 0, height_ = 0;
+    CV4L2Mode mode_;                    ///< Including the frame interval read back with G_PARM.
+
+    // Worker
+    std::thread worker_;
+    std::atomic<bool> running_{ false };      ///< Streaming (STREAMON issued).
+    std::atomic<bool> workerStop_{ false };   ///< Stop request for the internal worker.
+    std::atomic<bool> externalPump_{ false }; ///< Dequeue driven by an external loop.
+    std::mutex pumpMtx_;                      ///< Serializes the pump (serviceReady, hand-over)
+                                              ///< against start/stop/(dis)connect.
+    CGrabberStats stats_;
+    CSensorRegisterCache regs_;
+
+    // Callbacks
+    std::mutex cbMtx_;
+    FrameGrabCallbackProc cbProc_;
+    FrameGrabCallbackDisp cbDisp_;
+};
+
+#endif // __linux__
@@ -23,7 +23,9 @@
 /**
  * @brief Per-frame processing callback signature.
  * @details Called from the backend's grabbing thread whenever a frame is ready.
- *          The image is read-only within the callback.
+ *          The image is read-only within the callback. Streaming backends may deliver
+ *          pooled views (see CGrabberFrame.h); a shallow copy of such a frame keeps the
+ *          driver buffer until released, anything else must be deep-copied to be retained.
  */
 using FrameGrabCallbackProc = std::function<void(const csh_img::CSH_Image&)>;
 
@@ -59,6 +61,7 @@ public:
      * @param[out] outModelNames  Human-readable names; may include device paths.
      * @return true on successful probe (even if 0 devices), false on failure.
      * @note CUVC probes indices [0..15] with OpenCV; CV4L2 scans /dev/video*.
+     *       CV4L2Stream enumerates /sys/class/video4linux without probing (see CV4L2Enum.h).
      */
     virtual bool GetConnected(int& outDeviceCount, std::vector<std::string>& outModelNames) = 0;
 
@@ -83,6 +86,9 @@ public:
      * @note CUVC applies width/height/fps via cv::VideoCapture properties.
      *       CV4L2 maps @ref CGrabberConfig::PixelFormat to V4L2 fourcc and
      *       may also adjust the media graph (rp1-cfe pipeline).
+     *       CV4L2Stream also accepts multi-planar formats (NV12/NV16/YUV420 or an explicit
+     *       @ref CGrabberConfig::fourcc) on single- and multi-planar (MPLANE) devices and
+     *       publishes every plane through CFrameMeta (see CGrabberFrame.h).
      */
     virtual bool SetConfig(const CGrabberConfig* cfg) = 0;
 
@@ -118,7 +124,8 @@ public:
      * @param[in] address Register address.
      * @param[in] value   Value to write.
      * @return true if the backend supports and successfully writes the register; false otherwise.
-     * @note CUVC and current CV4L2 implementations return false (not supported).
+     * @note CUVC and built-in CV4L2 return false (not supported); see CSensorRegisters.h for
+     *       the cached, batched path of header-only backends.
      */
     virtual bool SetSensorRegister(uint32_t address, uint32_t value) = 0;
 
@@ -127,7 +134,8 @@ public:
      * @param[in]  address  Register address.
      * @param[out] outValue Read-back value on success (unchanged on failure).
      * @return true if the backend supports and successfully reads the register; false otherwise.
-     * @note CUVC and current CV4L2 implementations return false (not supported).
+     * @note CUVC and built-in CV4L2 return false (not supported); see CSensorRegisters.h for
+     *       the cached, batched path of header-only backends.
      */
     virtual bool GetSensorRegister(uint32_t address, uint32_t& outValue) = 0;
 